@@ -39,9 +39,11 @@
 * @endmsc
 *
 * Similar principle has been used in text extraction. Data offset that TC sends in unitIndex
-* cannot be used to jump to a position in PDF. When a block of text is extracted from PDF,
-* extraction thread stops and informs TC thread about extracted data. TC compares data
-* with search string and informs plugin if document can be closed.
+* cannot be used to jump to a position in PDF. Extracted text is split into blocks of TC buffer size.
+* Blocks are passed to TC thread through a ring of #TEXT_RING_SIZE blocks, so extraction thread
+* can extract next blocks while TC compares previous ones with search string. Extraction thread
+* waits only when all blocks are full. When string is found, TC informs plugin that
+* extraction can be cancelled and document can be closed.
 *
 * @msc
 * TC,WDX,PRODUCER,XPDF,OUTPUT_DEV;
@@ -49,24 +51,22 @@
 * WDX=>PRODUCER [label="StartWorkerThread"];
 * PRODUCER=>PRODUCER [label="waitForProducer"];
 * WDX->PRODUCER [label="PRODUCER EVENT"];
-* WDX=>WDX [label="waitForConsumer"];
+* WDX=>WDX [label="readText"];
 * PRODUCER=>XPDF [label="doWork"];
 * XPDF=>>OUTPUT_DEV [label="outputFunction"];
-* OUTPUT_DEV->WDX [label="CONSUMER EVENT"];
-* OUTPUT_DEV=>OUTPUT_DEV [label="wait for PRODUCER"];
+* OUTPUT_DEV->WDX [label="FILLED EVENT"];
 * WDX>>TC [label="fieldValue"];
-* TC=>TC [label="compare"];
-* TC=>WDX [label="ContentGetValueW(unitIndex=1)"];
-* WDX->OUTPUT_DEV [label="PRODUCER EVENT"];
 * OUTPUT_DEV>>XPDF [label="return 0"];
 * XPDF=>>OUTPUT_DEV [label="outputFunction"];
-* OUTPUT_DEV->WDX [label="CONSUMER EVENT"];
-* OUTPUT_DEV=>OUTPUT_DEV [label="wait for PRODUCER"];
+* OUTPUT_DEV->WDX [label="FILLED EVENT"];
+* TC=>TC [label="compare"];
+* TC=>WDX [label="ContentGetValueW(unitIndex=1)"];
+* WDX->OUTPUT_DEV [label="FREED EVENT"];
 * WDX>>TC [label="fieldValue"];
 * TC=>TC [label="string found"];
 * TC=>WDX [label="ContentGetValueW(unitIndex=-1)"];
-* WDX->OUTPUT_DEV [label="cancel, PRODUCER EVENT"];
-* WDX=>WDX [label="waitForConsumer"];
+* WDX->OUTPUT_DEV [label="cancel, FREED EVENT"];
+* WDX=>WDX [label="wait for CONSUMER"];
 * OUTPUT_DEV>>XPDF [label="return 1"];
 * XPDF>>PRODUCER [label="Request"];
 * PRODUCER->WDX [label="CONSUMER EVENT, close PDF"];
@@ -116,6 +116,24 @@ PDFExtractor::~PDFExtractor()
             CloseHandle(m_data->handles[PRODUCER_HANDLE]);
             m_data->handles[PRODUCER_HANDLE] = nullptr;
         }
+        if (m_data->ring.filled)
+        {
+            CloseHandle(m_data->ring.filled);
+            m_data->ring.filled = nullptr;
+        }
+        if (m_data->ring.freed)
+        {
+            CloseHandle(m_data->ring.freed);
+            m_data->ring.freed = nullptr;
+        }
+        for (auto& block : m_data->ring.blocks)
+        {
+            if (block)
+            {
+                delete[] block;
+                block = nullptr;
+            }
+        }
         if (m_data->request.allocated && m_data->request.fieldValue)
         {
             delete[] static_cast<char*>(m_data->request.fieldValue);
@@ -145,7 +163,8 @@ PDFExtractor::~PDFExtractor()
 }
 
 /**
-* Close PdfDoc.
+* Close PdfDoc and drop cached page text.
+* If TC stopped waiting for extraction, page text is kept to resume extraction later.
 * Set Request::status to closed.
 */
 void PDFExtractor::closeDoc()
@@ -153,6 +172,17 @@ void PDFExtractor::closeDoc()
     if (m_doc)
     {
         InterlockedExchange(&m_data->request.status, request_status::closed);
+        auto suspended = false;
+        EnterCriticalSection(&m_data->lock);
+        {
+            suspended = m_data->request.suspended;
+            m_data->request.suspended = false;
+        }
+        LeaveCriticalSection(&m_data->lock);
+        if (suspended)
+            m_tc.suspend(m_fileName);
+        else
+            m_tc.close();
         delete m_doc;
         m_doc = nullptr;
     }
@@ -163,13 +193,14 @@ void PDFExtractor::closeDoc()
 */
 void PDFExtractor::close()
 {
+    // file name is needed to suspend extraction
+    closeDoc();
     if (m_fileName)
     {
         TRACE(L"%hs!%ls\n", __FUNCTION__, m_fileName);
         free(m_fileName);
         m_fileName = nullptr;
     }
-    closeDoc();
 }
 
 /**
@@ -214,7 +245,11 @@ bool PDFExtractor::open()
         if (m_doc)
         {
             if (m_doc->isOk())
+            {
+                // resume suspended extraction, or start a new one
+                m_tc.open(m_doc, m_fileName);
                 InterlockedExchange(&m_data->request.status, request_status::active);
+            }
             else
             {
                 closeDoc();
@@ -660,6 +695,9 @@ void PDFExtractor::doWork()
     case fiText:
         m_tc.output(m_doc, m_data);
         break;
+    case fiThumbnail:
+        m_thumb.output(m_doc, m_fileName, m_data);
+        break;
     default:
         break;
     }
@@ -737,7 +775,7 @@ unsigned int __stdcall threadFunc(void* param)
 
 /**
 * Start extraction thread, if not already started.
-* Create unnamed events with automatic reset.
+* Create unnamed events with automatic reset, including text ring events.
 *
 * @return thread ID number
 */
@@ -751,7 +789,13 @@ unsigned int PDFExtractor::startWorkerThread()
     if (!m_data->handles[PRODUCER_HANDLE])
         m_data->handles[PRODUCER_HANDLE] = CreateEventW(nullptr, FALSE, FALSE, nullptr);
 
-    if (m_data->handles[CONSUMER_HANDLE] && m_data->handles[PRODUCER_HANDLE])
+    if (!m_data->ring.filled)
+        m_data->ring.filled = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+
+    if (!m_data->ring.freed)
+        m_data->ring.freed = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+
+    if (m_data->handles[CONSUMER_HANDLE] && m_data->handles[PRODUCER_HANDLE] && m_data->ring.filled && m_data->ring.freed)
     {
         // if thread is not started..
         if (!m_data->handles[THREAD_HANDLE])
@@ -775,6 +819,21 @@ unsigned int PDFExtractor::startWorkerThread()
     return threadID;
 }
 
+/**
+* Cancel extraction which takes longer than #CONSUMER_TIMEOUT.
+* Text extracted so far is kept when PdfDoc is closed,
+* next request for the same file resumes extraction (see TcOutputDev::open).
+*/
+void PDFExtractor::suspend()
+{
+    EnterCriticalSection(&m_data->lock);
+    {
+        if (request_status::active == InterlockedCompareExchange(&m_data->request.status, request_status::canceled, request_status::active))
+            m_data->request.suspended = true;
+    }
+    LeaveCriticalSection(&m_data->lock);
+}
+
 /**
 * Raise producer event to start extraction and wait for consumer event.
 * If consumer doesn't respond in #CONSUMER_TIMEOUT, function returns #ft_fieldempty.
@@ -797,7 +856,7 @@ int PDFExtractor::waitForConsumer()
             LeaveCriticalSection(&m_data->lock);
             break;
         case WAIT_TIMEOUT:
-            InterlockedCompareExchange(&m_data->request.status, request_status::canceled, request_status::active);
+            suspend();
             result = ft_fieldempty;
             break;
         default:
@@ -872,16 +931,121 @@ int PDFExtractor::initData(const wchar_t* fileName, int fieldIndex, int unitInde
         m_data->request.flags = flags;
         m_data->request.result = ft_fieldempty;
         m_data->request.timeout = timeout;
+        m_data->request.ring = false;
     }
     LeaveCriticalSection(&m_data->lock);
 
     return ft_setsuccess;
 }
 
+/**
+* Prepare text ring for a new text extraction.
+* Ring blocks have the same size as TC buffer. Request buffer is set to the first block.
+*
+* @param[in]    cbfieldValue    size of TC buffer in bytes
+* @return       true if ring is ready
+*/
+bool PDFExtractor::initRing(int cbfieldValue)
+{
+    auto ring = &m_data->ring;
+    // block must hold at least one wchar and NUL character
+    if (cbfieldValue < static_cast<int>(2 * sizeOfWchar))
+        return false;
+
+    if (ring->cbBlock != cbfieldValue)
+    {
+        for (auto& block : ring->blocks)
+        {
+            if (block)
+                delete[] block;
+            block = new wchar_t[cbfieldValue / sizeOfWchar];
+        }
+        ring->cbBlock = cbfieldValue;
+    }
+    InterlockedExchange(&ring->written, 0);
+    InterlockedExchange(&ring->read, 0);
+    ring->used = true;
+    ring->done = false;
+    ResetEvent(ring->filled);
+    ResetEvent(ring->freed);
+
+    EnterCriticalSection(&m_data->lock);
+    {
+        *ring->blocks[0] = 0;
+        m_data->request.fieldValue = ring->blocks[0];
+        m_data->request.ptr = ring->blocks[0];
+        m_data->request.cbfieldValue = ring->cbBlock;
+        m_data->request.ring = true;
+    }
+    LeaveCriticalSection(&m_data->lock);
+    return true;
+}
+
+/**
+* Copy next block of text from text ring to TC buffer.
+* Wait for extraction thread, if there is no block ready.
+* If extraction thread doesn't respond in #CONSUMER_TIMEOUT, function returns #ft_fieldempty.
+*
+* @param[out]   fieldValue      buffer for retrieved data
+* @param[in]    cbfieldValue    sizeof buffer in bytes
+* @return       ft_fulltextw if text is copied, ft_fieldempty if there is no more text
+*/
+int PDFExtractor::readText(void* fieldValue, int cbfieldValue)
+{
+    auto ring = &m_data->ring;
+    if (!ring->used || !fieldValue || (cbfieldValue < static_cast<int>(sizeOfWchar)))
+        return ft_fieldempty;
+
+    while (InterlockedOr(&m_data->active, 0))
+    {
+        auto read = InterlockedOr(&ring->read, 0);
+        if (read < InterlockedOr(&ring->written, 0))
+        {
+            auto dst = static_cast<wchar_t*>(fieldValue);
+            auto cch = ring->cchBlock[read % TEXT_RING_SIZE];
+            if (cch > static_cast<int>(cbfieldValue / sizeOfWchar) - 1)
+                cch = static_cast<int>(cbfieldValue / sizeOfWchar) - 1;
+            wmemcpy(dst, ring->blocks[read % TEXT_RING_SIZE], cch);
+            dst[cch] = 0;
+            // release the block
+            InterlockedIncrement(&ring->read);
+            SetEvent(ring->freed);
+            return ft_fulltextw;
+        }
+        if (ring->done)
+            break;
+
+        HANDLE events[] = { ring->filled, m_data->handles[CONSUMER_HANDLE] };
+        auto dwRet = WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, CONSUMER_TIMEOUT);
+        switch (dwRet)
+        {
+        case WAIT_OBJECT_0:
+            // new block
+            break;
+        case WAIT_OBJECT_0 + 1:
+            // extraction is complete or cancelled, read remaining blocks
+            ring->done = true;
+            break;
+        case WAIT_TIMEOUT:
+            TRACE(L"%hs!timeout\n", __FUNCTION__);
+            suspend();
+            ring->used = false;
+            return ft_fieldempty;
+        default:
+            InterlockedCompareExchange(&m_data->request.status, request_status::canceled, request_status::active);
+            ring->used = false;
+            return ft_fileerror;
+        }
+    }
+    ring->used = false;
+    return ft_fieldempty;
+}
+
 /**
 * Starts data extraction form PDF document.
 * Thread state is changed from complete to active to enable new request.
 * Producer timeout is set to low value, because producer is TC. It should respond in short time.
+* Text field is extracted in blocks, TC gets them from text ring (see #readText).
 *
 * @param[in]    fileName        full path to PDF document
 * @param[in]    fieldIndex      index of the field
@@ -893,6 +1057,21 @@ int PDFExtractor::initData(const wchar_t* fileName, int fieldIndex, int unitInde
 */
 int PDFExtractor::extract(const wchar_t* fileName, int fieldIndex, int unitIndex, void* fieldValue, int cbfieldValue, int flags)
 {
+    if ((fieldIndex == fiText) && (unitIndex != 0))
+    {
+        if (unitIndex == -1)
+        {
+            stop();
+            return ft_fieldempty;
+        }
+        // next text block is already extracted, or it's being extracted
+        return readText(fieldValue, cbfieldValue);
+    }
+
+    // TC left previous text search without reading it to the end, don't let extractor wait for it
+    if (m_data->ring.used)
+        done();
+
     int result = initData(fileName, fieldIndex, unitIndex, fieldValue, cbfieldValue, flags, PRODUCER_TIMEOUT);
     if (result != ft_setsuccess)
         return result;
@@ -900,18 +1079,13 @@ int PDFExtractor::extract(const wchar_t* fileName, int fieldIndex, int unitIndex
     InterlockedCompareExchange(&m_data->request.status, request_status::active, request_status::complete);
     if (fieldIndex == fiText)
     {
-        if (unitIndex == -1)
-        {
-            stop();
-            result = ft_fieldempty;
-        }
-        else if (unitIndex == 0)
+        result = ft_fileerror;
+        if (startWorkerThread() && initRing(cbfieldValue))
         {
-            if (startWorkerThread())
-                result = waitForConsumer();
+            // start extraction, extractor runs ahead of TC
+            SetEvent(m_data->handles[PRODUCER_HANDLE]);
+            result = readText(fieldValue, cbfieldValue);
         }
-        else
-            result = waitForConsumer();
     }
     else
     {
@@ -921,6 +1095,41 @@ int PDFExtractor::extract(const wchar_t* fileName, int fieldIndex, int unitIndex
     return result;
 }
 
+/**
+* Renders thumbnail of the first page of PDF document.
+* Thumbnail of unchanged file is created from cached page, without opening the document.
+* Otherwise the page is rendered in extraction thread, the same way as other fields are extracted.
+*
+* @param[in]    fileName        full path to PDF document
+* @param[in]    width           max. width of the thumbnail in pixels
+* @param[in]    height          max. height of the thumbnail in pixels
+* @return       thumbnail bitmap, nullptr if the thumbnail cannot be rendered
+*/
+HBITMAP PDFExtractor::thumbnail(const wchar_t* fileName, int width, int height)
+{
+    ThumbnailRequest thumb{ width, height, nullptr };
+    if ((width <= 0) || (height <= 0))
+        return nullptr;
+
+    auto found = false;
+    EnterCriticalSection(&m_data->lock);
+    {
+        found = m_thumb.find(fileName, &thumb);
+    }
+    LeaveCriticalSection(&m_data->lock);
+    if (found)
+        return thumb.bitmap;
+
+    if (initData(fileName, fiThumbnail, 0, &thumb, sizeof(thumb), 0, PRODUCER_TIMEOUT) != ft_setsuccess)
+        return nullptr;
+
+    InterlockedCompareExchange(&m_data->request.status, request_status::active, request_status::complete);
+    if (startWorkerThread() && (waitForConsumer() == ft_bitmap))
+        return thumb.bitmap;
+
+    return nullptr;
+}
+
 /**
 * Notifiy text extracting threads that the state of requests is changed.
 * Threads should close PdfDocs and exit.
@@ -937,6 +1146,9 @@ void PDFExtractor::abort()
             m_data->request.fileName = nullptr;
         }
         LeaveCriticalSection(&m_data->lock);
+        // wake extractor waiting for free ring block
+        if (m_data->ring.freed)
+            SetEvent(m_data->ring.freed);
         if (m_data->handles[PRODUCER_HANDLE] && m_data->handles[THREAD_HANDLE])
         {
             TRACE(L"%hs\n", __FUNCTION__);
@@ -969,6 +1181,22 @@ void PDFExtractor::stop()
             m_data->request.fileName = nullptr;
         }
         LeaveCriticalSection(&m_data->lock);
+    }
+    if (m_data->ring.used)
+    {
+        m_data->ring.used = false;
+        // extractor may still run ahead of TC, or it has finished and it's waiting for TC to read the result
+        if (!m_data->ring.done && InterlockedOr(&m_data->active, 0) && m_data->handles[CONSUMER_HANDLE])
+        {
+            TRACE(L"%hs!ring\n", __FUNCTION__);
+            // wake extractor waiting for free block, and wait until it finishes
+            SetEvent(m_data->ring.freed);
+            WaitForSingleObject(m_data->handles[CONSUMER_HANDLE], CONSUMER_TIMEOUT);
+            m_data->ring.done = true;
+        }
+    }
+    else if (status == request_status::active)
+    {
         if (InterlockedOr(&m_data->active, 0) && m_data->handles[PRODUCER_HANDLE] && m_data->handles[CONSUMER_HANDLE])
         {
             TRACE(L"%hs\n", __FUNCTION__);
@@ -986,7 +1214,19 @@ void PDFExtractor::stop()
 void PDFExtractor::done()
 {
     auto status = InterlockedCompareExchange(&m_data->request.status, request_status::complete, request_status::active);
-    if (status == request_status::active)
+    if (m_data->ring.used)
+    {
+        m_data->ring.used = false;
+        // wake extractor waiting for free block, and wait until it finishes, PdfDoc stays open
+        if (!m_data->ring.done && InterlockedOr(&m_data->active, 0) && m_data->handles[CONSUMER_HANDLE])
+        {
+            TRACE(L"%hs!ring\n", __FUNCTION__);
+            SetEvent(m_data->ring.freed);
+            WaitForSingleObject(m_data->handles[CONSUMER_HANDLE], CONSUMER_TIMEOUT);
+            m_data->ring.done = true;
+        }
+    }
+    else if (status == request_status::active)
     {
         if (InterlockedOr(&m_data->active, 0) && m_data->handles[PRODUCER_HANDLE] && m_data->handles[CONSUMER_HANDLE])
         {
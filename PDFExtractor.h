@@ -5,6 +5,7 @@
 
 #include <Object.h>
 #include "TcOutputDev.h"
+#include "TcThumbnail.h"
 
 /**
 * @file 
@@ -23,6 +24,7 @@ public:
     PDFExtractor& operator=(const PDFExtractor&) = delete;
     ~PDFExtractor();
     int extract(const wchar_t* fileName, int fieldIndex, int unitIndex, void* fieldValue, int cbfieldValue, int flags);
+    HBITMAP thumbnail(const wchar_t* fileName, int width, int height);
     int compare(PROGRESSCALLBACKPROC progresscallback, const wchar_t* fileName1, const wchar_t* fileName2, int compareIndex);
     void abort();
     void stop();
@@ -45,8 +47,11 @@ private:
     static void appendHexValue(wchar_t* dst, int cbDst, int value);
     static wchar_t nibble2wchar(int value);
     int initData(const wchar_t* fileName, int fieldIndex, int unitIndex, void* fieldValue, int cbfieldValue, int flags, DWORD timeout);
+    bool initRing(int cbfieldValue);
+    int readText(void* fieldValue, int cbfieldValue);
 
     unsigned int startWorkerThread();
+    void suspend();
     int waitForConsumer();
     int waitForConsumers();
     bool open();
@@ -61,4 +66,5 @@ private:
     PDFExtractor*   m_search{ nullptr };    /**< pointer to second instance of PDFExtractor, used to extract data from second file when comparing data */
     _locale_t       m_locale{ nullptr };    /**< locale-specific value, used for compare as text */
     TcOutputDev     m_tc;                   /**< text extraction object */
+    TcThumbnail     m_thumb;                /**< thumbnail rendering object */
 };
@@ -37,57 +37,63 @@ static ptrdiff_t convertToUTF16(const char* src, int cbSrc, wchar_t* dst, int *c
 /**
 * Callback function used in PdfDoc::displayPage to abort text extraction.
 * If ThreadData::request::status is not request_status::active, extraction should abort.
+* Text of an aborted page is incomplete, it isn't cached.
 * 
-* @param[in] stream     pointer to ThreadData structure
+* @param[in] stream     pointer to TcOutputDev object
 * @return gTrue if extraction should abort
 */
-static GBool abortExtraction(void* stream)
+GBool TcOutputDev::abortExtraction(void* stream)
 {
     if (stream)
     {
-        auto data = static_cast<ThreadData*>(stream);
-        return (request_status::active == InterlockedOr(&data->request.status, 0)) ? gFalse : gTrue;
+        auto dev = static_cast<TcOutputDev*>(stream);
+        if (request_status::active == InterlockedOr(&dev->m_data->request.status, 0))
+            return gFalse;
+        dev->m_pageAborted = true;
     }
     return gTrue;
 }
 
 /**
-* Callback function used in PdfDoc::displayPage used to copy extracted text to request structure.
-* For "First Row" field, text is extracted up to first EOL.
-* For "Document Start" field, request::cbfieldValue bytes is extracted.
-* For "Text" field, data is extracted until TC responds that search string is found.
-* To be able to continue to extract text, threading has been used. When block of text has been extracted,
-* calling thread is woken up to send data to TC. This thread goes to sleep. TC compares data and sends back result.
-* This thread wakes up and continues text extraction or canceles if string has been found.
-* TcOutputDev.c has been modified to speedup extraction cancelation when string is found.
-* Extracted text is converted to UTF-16 and stored to ThreadData::Request::fieldValue buffer.
-* This callback function may be called multiple times before ThreadData::Request::fieldValue is filled up, or line ending has been found.
+* Copies text to request structure.
+* For "First Row" field, text is copied up to first EOL.
+* For "Document Start" field, request::cbfieldValue bytes is copied.
+* For "Text" field, data is copied until TC responds that search string is found.
+* For "Text" field searched by TC, full request buffer is passed to TC through ThreadData::ring
+* and extraction continues in the next ring block, TC searches the text meanwhile.
+* Otherwise (compare), when request buffer is full, calling thread is woken up to send data to TC.
+* This thread goes to sleep. TC compares data and sends back result.
+* This thread wakes up and continues with the rest of the text, or canceles if string has been found.
 * 
-* @param[in,out]    stream      pointer to ThreadData structure
-* @param[in]        text        extracted text
-* @param[in]        len         length of extracted text
-* @return   0 - extraction shuld continue, 1 - extraction should abort
+* @param[in,out]    data        pointer to ThreadData structure
+* @param[in]        text        UTF-16 text
+* @param[in]        cchText     number of wchars in text
+* @return   0 - more text is expected, 1 - request is complete or canceled
 */
-static int outputFunction(void *stream, const char *text, int len)
+int TcOutputDev::sendText(ThreadData* data, const wchar_t* text, int cchText)
 {
-    auto data = static_cast<ThreadData*>(stream);
-    if (data && (request_status::active == InterlockedOr(&data->request.status, 0)) && text && (len > 0))
+    while ((cchText > 0) && (request_status::active == InterlockedOr(&data->request.status, 0)))
     {
-        int remaining, index;
+        int index, cch;
+        bool full = false, ring;
         DWORD timeout;
         EnterCriticalSection(&data->lock);
         {
             // get data from request structure for later use outside of CriticalSection
             timeout = data->request.timeout;
-            remaining = data->request.cbfieldValue;
             index = data->request.fieldIndex;
+            ring = data->request.ring;
 
             // get end of current string
             auto dst = static_cast<wchar_t*>(data->request.ptr);
-            // convert data from TextOutputDev to wchar_t
-            auto dstLen = convertToUTF16(text, len, dst, &data->request.cbfieldValue);
-            if (dstLen)
+            // free space in request buffer, one wchar is reserved for NUL character
+            cch = static_cast<int>(data->request.cbfieldValue / sizeOfWchar) - 1;
+            if (cch > cchText)
+                cch = cchText;
+            if (cch > 0)
             {
+                wmemcpy(dst, text, cch);
+                dst[cch] = 0;   // put NUL character at the end of the string
                 if (index == fiFirstRow)
                 {
                     data->request.result = ft_stringw;
@@ -97,7 +103,7 @@ static int outputFunction(void *stream, const char *text, int len)
                     {
                         // EOL found!
                         *pos = 0;       // remove EOL
-                        remaining = 0;  // flag to exit extraction
+                        full = true;    // flag to exit extraction
                     }
                 }
                 else if (index == fiDocStart)
@@ -105,28 +111,40 @@ static int outputFunction(void *stream, const char *text, int len)
                 else
                     data->request.result = ft_fulltextw;
 
-                dst += dstLen;
                 // update end of string pointer
-                data->request.ptr = dst;
+                data->request.ptr = dst + cch;
+                data->request.cbfieldValue -= cch * sizeOfWchar;
             }
+            else
+                cch = 0;
+
+            // if no bytes left in dest buffer
+            if (data->request.cbfieldValue <= static_cast<int>(sizeOfWchar))
+                full = true;
         }
         LeaveCriticalSection(&data->lock);
 
-        // if no bytes left in dest buffer
-        if (remaining <= 2)
+        text += cch;
+        cchText -= cch;
+
+        if (full)
         {
-            if (index == fiText)
+            if ((index == fiText) && ring)
             {
-                if (data->handles[CONSUMER_HANDLE] && data->handles[PRODUCER_HANDLE])
+                // pass the block to TC and continue with the next one
+                pushText(data);
+                if (!waitForRing(data))
+                    return 1;
+            }
+            else if ((index == fiText) && data->handles[CONSUMER_HANDLE] && data->handles[PRODUCER_HANDLE])
+            {
+                // signal to TC that data is ready and wait for TC to respond
+                auto dwRet = SignalObjectAndWait(data->handles[CONSUMER_HANDLE], data->handles[PRODUCER_HANDLE], timeout, FALSE);
+                if (dwRet != WAIT_OBJECT_0)
                 {
-                    // signal to TC that data is ready and wait for TC to respond
-                    auto dwRet = SignalObjectAndWait(data->handles[CONSUMER_HANDLE], data->handles[PRODUCER_HANDLE], timeout, FALSE);
-                    if (dwRet != WAIT_OBJECT_0)
-                    {
-                        InterlockedCompareExchange(&data->request.status, request_status::canceled, request_status::active);
-                        TRACE(L"%hs!dw=%lu!TC not responding\n", __FUNCTION__, dwRet);
-                        return 1;
-                    }
+                    InterlockedCompareExchange(&data->request.status, request_status::canceled, request_status::active);
+                    TRACE(L"%hs!dw=%lu!TC not responding\n", __FUNCTION__, dwRet);
+                    return 1;
                 }
             }
             else
@@ -137,8 +155,110 @@ static int outputFunction(void *stream, const char *text, int len)
             }
         }
     }
+    return (request_status::active == InterlockedOr(&data->request.status, 0)) ? 0 : 1;
+}
+
+/**
+* Passes current request buffer (ring block) to TC, if it contains any text.
+* 
+* @param[in,out]    data        pointer to ThreadData structure
+*/
+void TcOutputDev::pushText(ThreadData* data)
+{
+    auto ring = &data->ring;
+    auto written = InterlockedOr(&ring->written, 0);
+    bool empty;
+    EnterCriticalSection(&data->lock);
+    {
+        auto block = ring->blocks[written % TEXT_RING_SIZE];
+        ring->cchBlock[written % TEXT_RING_SIZE] = static_cast<int>(static_cast<wchar_t*>(data->request.ptr) - block);
+        empty = (data->request.ptr == block);
+    }
+    LeaveCriticalSection(&data->lock);
+
+    if (!empty)
+    {
+        // publish the block
+        InterlockedIncrement(&ring->written);
+        SetEvent(ring->filled);
+    }
+}
+
+/**
+* Waits until TC reads a block from the ring, if all blocks are full.
+* TC may search the blocks slower than the extractor fills them, so it waits for #RING_TIMEOUT,
+* not for Request::timeout used in lock-step handoff.
+* Sets request buffer to the next free block.
+* 
+* @param[in,out]    data        pointer to ThreadData structure
+* @return   true - extraction should continue, false - extraction is canceled
+*/
+bool TcOutputDev::waitForRing(ThreadData* data)
+{
+    auto ring = &data->ring;
+    while (InterlockedOr(&ring->written, 0) - InterlockedOr(&ring->read, 0) >= static_cast<LONG>(TEXT_RING_SIZE))
+    {
+        if (request_status::active != InterlockedOr(&data->request.status, 0))
+            return false;
+
+        auto dwRet = WaitForSingleObject(ring->freed, RING_TIMEOUT);
+        if (dwRet != WAIT_OBJECT_0)
+        {
+            InterlockedCompareExchange(&data->request.status, request_status::canceled, request_status::active);
+            TRACE(L"%hs!dw=%lu!TC not responding\n", __FUNCTION__, dwRet);
+            return false;
+        }
+    }
+    if (request_status::active != InterlockedOr(&data->request.status, 0))
+        return false;
+
+    EnterCriticalSection(&data->lock);
+    {
+        auto block = ring->blocks[InterlockedOr(&ring->written, 0) % TEXT_RING_SIZE];
+        *block = 0;
+        data->request.fieldValue = block;
+        data->request.ptr = block;
+        data->request.cbfieldValue = ring->cbBlock;
+    }
+    LeaveCriticalSection(&data->lock);
+    return true;
+}
+
+/**
+* Callback function used in PdfDoc::displayPage used to collect extracted text.
+* Extracted text is converted to UTF-16 and appended to the text of the current page,
+* which is cached when the page is complete. New text is sent to TC (see #sendText).
+* TcOutputDev.c has been modified to speedup extraction cancelation when string is found.
+* When TC has got enough text (e.g. "First Row" field), the rest of the page is still collected,
+* it is already laid out and following requests can use it.
+* This callback function may be called multiple times before ThreadData::Request::fieldValue is filled up, or line ending has been found.
+* 
+* @param[in,out]    stream      pointer to TcOutputDev object
+* @param[in]        text        extracted text
+* @param[in]        len         length of extracted text
+* @return   0 - extraction shuld continue, 1 - extraction should abort
+*/
+int TcOutputDev::outputFunction(void *stream, const char *text, int len)
+{
+    auto dev = static_cast<TcOutputDev*>(stream);
+    if (dev && text && (len > 0) && !dev->m_pageAborted)
+    {
+        auto start = dev->m_cchPage;
+        dev->appendText(text, len);
+        if (dev->m_sending && sendText(dev->m_data, dev->m_page + start, dev->m_cchPage - start))
+        {
+            dev->m_sending = false;
+            // document is about to be closed, don't waste time
+            if (request_status::canceled == InterlockedOr(&dev->m_data->request.status, 0))
+            {
+                dev->m_pageAborted = true;
+                return 1;
+            }
+        }
+    }
     return 0;
 }
+
 /**
 * TcOutputDev constructor.
 * Sets values for TextOutputControl structure used in text extraction.
@@ -158,17 +278,182 @@ TcOutputDev::TcOutputDev()
 
 /**
 * TcOutputDev denstructor.
-* Releases TextOutputDev instance.
+* Releases TextOutputDev instance and cached text.
 */
 TcOutputDev::~TcOutputDev()
 {
+    close();
     if (m_dev)
         delete m_dev;
 }
 
+/**
+* Prepares text cache for newly open document.
+* If extraction of the same unchanged file has been suspended (see #suspend),
+* its cached text is used and extraction resumes from the first uncached page.
+*
+* @param[in]        doc         pointer to xPDF PdcDoc instance
+* @param[in]        fileName    full path to PDF document
+*/
+void TcOutputDev::open(PDFDoc* doc, const wchar_t* fileName)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fileInfo;
+    if (m_fileName && fileName && !wcsicmp(m_fileName, fileName)
+        && (doc->getNumPages() == m_numPages)
+        && GetFileAttributesExW(fileName, GetFileExInfoStandard, &fileInfo)
+        && (fileInfo.nFileSizeHigh == m_fileInfo.nFileSizeHigh)
+        && (fileInfo.nFileSizeLow == m_fileInfo.nFileSizeLow)
+        && !CompareFileTime(&fileInfo.ftLastWriteTime, &m_fileInfo.ftLastWriteTime))
+    {
+        TRACE(L"%hs!resume!%ls\n", __FUNCTION__, m_fileName);
+        free(m_fileName);
+        m_fileName = nullptr;
+        m_doc = doc;
+    }
+    else
+        reset(doc);
+}
+
+/**
+* Keeps cached text of the document after PdfDoc is closed, so the extraction
+* can be resumed when the same file is open again.
+* Used when TC stops waiting for extraction (#CONSUMER_TIMEOUT).
+* Must be called before PdfDoc is deleted.
+*
+* @param[in]        fileName    full path to PDF document
+*/
+void TcOutputDev::suspend(const wchar_t* fileName)
+{
+    if (m_doc && m_cachedPages && fileName
+        && GetFileAttributesExW(fileName, GetFileExInfoStandard, &m_fileInfo))
+    {
+        TRACE(L"%hs!%ls\n", __FUNCTION__, fileName);
+        if (m_fileName)
+            free(m_fileName);
+        m_fileName = _wcsdup(fileName);
+        m_doc = nullptr;
+        if (m_page)
+        {
+            delete[] m_page;
+            m_page = nullptr;
+        }
+        m_cchPage = m_cchPageSize = 0;
+    }
+    else
+        close();
+}
+
+/**
+* Releases cached text of the document.
+* Must be called before PdfDoc is deleted.
+*/
+void TcOutputDev::close()
+{
+    if (m_fileName)
+    {
+        free(m_fileName);
+        m_fileName = nullptr;
+    }
+    if (m_pageText)
+    {
+        for (int i = 0; i < m_numPages; ++i)
+        {
+            if (m_pageText[i])
+                delete[] m_pageText[i];
+        }
+        delete[] m_pageText;
+        m_pageText = nullptr;
+    }
+    if (m_pageLength)
+    {
+        delete[] m_pageLength;
+        m_pageLength = nullptr;
+    }
+    if (m_page)
+    {
+        delete[] m_page;
+        m_page = nullptr;
+    }
+    m_cchPage = m_cchPageSize = 0;
+    m_cacheSize = 0;
+    m_cachedPages = 0;
+    m_numPages = 0;
+    m_doc = nullptr;
+}
+
+/**
+* Drops cached text and prepares empty cache for the document.
+*
+* @param[in]        doc     pointer to xPDF PdcDoc instance
+*/
+void TcOutputDev::reset(PDFDoc* doc)
+{
+    close();
+    m_numPages = doc->getNumPages();
+    if (m_numPages > 0)
+    {
+        m_pageText = new wchar_t*[m_numPages]();
+        m_pageLength = new int[m_numPages];
+        for (int i = 0; i < m_numPages; ++i)
+            m_pageLength[i] = -1;
+    }
+    m_doc = doc;
+}
+
+/**
+* Converts extracted text to UTF-16 and appends it to the text of the current page.
+*
+* @param[in]        text    extracted text
+* @param[in]        len     length of extracted text
+*/
+void TcOutputDev::appendText(const char* text, int len)
+{
+    auto cchNeeded = m_cchPage + len / static_cast<int>(sizeOfWchar) + 1;
+    if (cchNeeded > m_cchPageSize)
+    {
+        auto cchSize = m_cchPageSize ? m_cchPageSize : 1024;
+        while (cchSize < cchNeeded)
+            cchSize *= 2;
+        auto page = new wchar_t[cchSize];
+        if (m_cchPage)
+            wmemcpy(page, m_page, m_cchPage);
+        if (m_page)
+            delete[] m_page;
+        m_page = page;
+        m_cchPageSize = cchSize;
+    }
+    auto cbDst = static_cast<int>((m_cchPageSize - m_cchPage) * sizeOfWchar);
+    m_cchPage += static_cast<int>(convertToUTF16(text, len, m_page + m_cchPage, &cbDst));
+}
+
+/**
+* Stores the text of completely extracted page, if it fits into #PAGE_CACHE_CB.
+*
+* @param[in]        page    page number
+*/
+void TcOutputDev::storePage(int page)
+{
+    auto cb = m_cchPage * sizeOfWchar;
+    if (m_cacheSize + cb <= PAGE_CACHE_CB)
+    {
+        wchar_t* text = nullptr;
+        if (m_cchPage)
+        {
+            text = new wchar_t[m_cchPage];
+            wmemcpy(text, m_page, m_cchPage);
+        }
+        m_pageText[page - 1] = text;
+        m_pageLength[page - 1] = m_cchPage;
+        m_cacheSize += cb;
+        ++m_cachedPages;
+    }
+}
+
 /**
 * Starts text extraction.
 * Extraction goes through all document pages until search string is found.
+* Text of already processed pages is taken from cache,
+* remaining pages are extracted from PDF document.
 *
 * @param[in]        doc     pointer to xPDF PdcDoc instance
 * @param[in,out]    data    pointer to request data
@@ -177,26 +462,48 @@ void TcOutputDev::output(PDFDoc* doc, ThreadData* data)
 {
     if (data && doc && doc->isOk())
     {
+        m_data = data;
+        // drop text cached for previous document
+        if (m_doc != doc)
+            reset(doc);
+
         if (!m_dev)
         {
             // register <b>outputFunction<b> as a callback function for text extraction
-            m_dev = new TextOutputDev(&outputFunction, data, &toc);
+            m_dev = new TextOutputDev(&outputFunction, this, &toc);
         }
 
         if (m_dev && m_dev->isOk())
         {
             // for each page
-            for (int page = 1; page <= doc->getNumPages(); ++page) {
-                // extract text from page
-                doc->displayPage(m_dev, page, 72, 72, 0, gFalse, gTrue, gFalse, abortExtraction, data);
-                // release page resources
-                doc->getCatalog()->doneWithPage(page);
+            for (int page = 1; page <= m_numPages; ++page) {
+                if (m_pageLength[page - 1] >= 0)
+                {
+                    // send cached text
+                    sendText(data, m_pageText[page - 1], m_pageLength[page - 1]);
+                }
+                else
+                {
+                    m_cchPage = 0;
+                    m_sending = true;
+                    m_pageAborted = false;
+                    // extract text from page
+                    doc->displayPage(m_dev, page, 72, 72, 0, gFalse, gTrue, gFalse, &abortExtraction, this);
+                    // release page resources
+                    doc->getCatalog()->doneWithPage(page);
+                    if (!m_pageAborted)
+                        storePage(page);
+                }
                 // check if extraction is active
                 if (request_status::active != InterlockedOr(&data->request.status, 0))
                     break;
             }
         }
 
+        // pass the last block to TC
+        if (data->request.ring)
+            pushText(data);
+
         EnterCriticalSection(&data->lock);
         {
             // no text extracted
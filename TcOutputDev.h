@@ -8,15 +8,48 @@
 
 /**
 * Class for text extraction from PDF to TC.
+* UTF-16 text of processed pages is kept until the document is closed,
+* so following requests for the same document don't have to extract the same pages again.
+* If TC stops waiting for the extraction, text is kept after the document is closed
+* and extraction resumes when the same file is open again.
 */
 class TcOutputDev
 {
 public:
     explicit TcOutputDev();
+    TcOutputDev(const TcOutputDev&) = delete;
+    TcOutputDev& operator=(const TcOutputDev&) = delete;
     ~TcOutputDev();
 
+    void open(PDFDoc* doc, const wchar_t* fileName);
     void output(PDFDoc* doc, ThreadData* data);
+    void suspend(const wchar_t* fileName);
+    void close();
 private:
-    TextOutputDev*      m_dev{ nullptr };   /**< text extractor */
-    TextOutputControl   toc;                /**< settings for TextOutputDev */
+    static int outputFunction(void *stream, const char *text, int len);
+    static GBool abortExtraction(void* stream);
+    static int sendText(ThreadData* data, const wchar_t* text, int cchText);
+    static void pushText(ThreadData* data);
+    static bool waitForRing(ThreadData* data);
+
+    void appendText(const char* text, int len);
+    void storePage(int page);
+    void reset(PDFDoc* doc);
+
+    TextOutputDev*      m_dev{ nullptr };       /**< text extractor */
+    TextOutputControl   toc;                    /**< settings for TextOutputDev */
+    ThreadData*         m_data{ nullptr };      /**< request data of the current extraction */
+    PDFDoc*             m_doc{ nullptr };       /**< document the cached pages belong to */
+    int                 m_numPages{ 0 };        /**< number of pages in m_doc */
+    wchar_t**           m_pageText{ nullptr };  /**< cached text of each page, nullptr if page is empty */
+    int*                m_pageLength{ nullptr };/**< number of wchars in each cached page, -1 if page isn't cached */
+    size_t              m_cacheSize{ 0 };       /**< size of cached text in bytes */
+    int                 m_cachedPages{ 0 };     /**< number of cached pages */
+    wchar_t*            m_page{ nullptr };      /**< text of the page being extracted */
+    int                 m_cchPage{ 0 };         /**< number of wchars in m_page */
+    int                 m_cchPageSize{ 0 };     /**< size of m_page buffer in wchars */
+    bool                m_sending{ false };     /**< text of the page being extracted is sent to TC */
+    bool                m_pageAborted{ false }; /**< extraction of the page was aborted, its text is incomplete */
+    wchar_t*            m_fileName{ nullptr };  /**< file name of suspended extraction, cached text belongs to it */
+    WIN32_FILE_ATTRIBUTE_DATA m_fileInfo{};     /**< size and time of suspended file, to detect changes */
 };
@@ -0,0 +1,219 @@
+#include "TcThumbnail.h"
+#include <SplashOutputDev.h>
+#include "xPDFInfo.h"
+
+/**
+* @file
+* PDF thumbnail rendering class and callback functions.
+*/
+
+/**
+* TcThumbnail destructor.
+* Releases cached pages.
+*/
+TcThumbnail::~TcThumbnail()
+{
+    for (auto& entry : m_cache)
+    {
+        if (entry.fileName)
+            free(entry.fileName);
+        if (entry.bitmap)
+            delete entry.bitmap;
+    }
+}
+
+/**
+* Callback function used in PdfDoc::displayPage to abort rendering.
+* If ThreadData::request::status is not request_status::active, rendering should abort.
+* Aborted page is incomplete, it isn't cached.
+*
+* @param[in] data     pointer to TcThumbnail object
+* @return gTrue if rendering should abort
+*/
+GBool TcThumbnail::abortRendering(void* data)
+{
+    if (data)
+    {
+        auto thumbnail = static_cast<TcThumbnail*>(data);
+        if (request_status::active == InterlockedOr(&thumbnail->m_data->request.status, 0))
+            return gFalse;
+        thumbnail->m_aborted = true;
+    }
+    return gTrue;
+}
+
+/**
+* Creates thumbnail bitmap from rendered page.
+* Thumbnail fits into requested size and keeps aspect ratio of the page.
+* The page is never enlarged, it is shrunk with halftone stretch mode.
+*
+* @param[in]    bitmap  rendered page
+* @param[in]    width   max. width of the thumbnail
+* @param[in]    height  max. height of the thumbnail
+* @return thumbnail bitmap, nullptr on error
+*/
+HBITMAP TcThumbnail::createBitmap(SplashBitmap* bitmap, int width, int height)
+{
+    auto srcWidth = bitmap->getWidth();
+    auto srcHeight = bitmap->getHeight();
+    if ((width <= 0) || (height <= 0) || (srcWidth <= 0) || (srcHeight <= 0))
+        return nullptr;
+
+    if ((width >= srcWidth) && (height >= srcHeight))
+    {
+        width = srcWidth;
+        height = srcHeight;
+    }
+    else if (static_cast<double>(width) * srcHeight > static_cast<double>(height) * srcWidth)
+        width = max(1, static_cast<int>(static_cast<double>(height) * srcWidth / srcHeight));
+    else
+        height = max(1, static_cast<int>(static_cast<double>(width) * srcHeight / srcWidth));
+
+    BITMAPINFO bmi{};
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 24;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    HBITMAP result = nullptr;
+    auto dc = CreateCompatibleDC(nullptr);
+    if (dc)
+    {
+        // destination, top-down
+        bmi.bmiHeader.biWidth = width;
+        bmi.bmiHeader.biHeight = -height;
+        void* bits = nullptr;
+        result = CreateDIBSection(dc, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+        if (result)
+        {
+            auto old = SelectObject(dc, result);
+            SetStretchBltMode(dc, HALFTONE);
+            SetBrushOrgEx(dc, 0, 0, nullptr);
+            // source, page is rendered top-down
+            bmi.bmiHeader.biWidth = srcWidth;
+            bmi.bmiHeader.biHeight = -srcHeight;
+            if (!StretchDIBits(dc, 0, 0, width, height, 0, 0, srcWidth, srcHeight,
+                               bitmap->getDataPtr(), &bmi, DIB_RGB_COLORS, SRCCOPY))
+            {
+                SelectObject(dc, old);
+                DeleteObject(result);
+                result = nullptr;
+            }
+            else
+                SelectObject(dc, old);
+        }
+        DeleteDC(dc);
+    }
+    return result;
+}
+
+/**
+* Creates thumbnail from cached page, if the file hasn't changed since it was rendered.
+* Caller must hold ThreadData::lock, the cache is updated by the extraction thread.
+*
+* @param[in]        fileName    full path to PDF document
+* @param[in,out]    thumb       requested size, created bitmap
+* @return true if thumbnail has been created from cache
+*/
+bool TcThumbnail::find(const wchar_t* fileName, ThumbnailRequest* thumb)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fileInfo;
+    if (!fileName || !GetFileAttributesExW(fileName, GetFileExInfoStandard, &fileInfo))
+        return false;
+
+    for (auto& entry : m_cache)
+    {
+        if (entry.fileName && !wcsicmp(entry.fileName, fileName)
+            && (fileInfo.nFileSizeHigh == entry.fileInfo.nFileSizeHigh)
+            && (fileInfo.nFileSizeLow == entry.fileInfo.nFileSizeLow)
+            && !CompareFileTime(&fileInfo.ftLastWriteTime, &entry.fileInfo.ftLastWriteTime))
+        {
+            TRACE(L"%hs!%ls\n", __FUNCTION__, fileName);
+            thumb->bitmap = createBitmap(entry.bitmap, thumb->width, thumb->height);
+            return thumb->bitmap != nullptr;
+        }
+    }
+    return false;
+}
+
+/**
+* Keeps rendered page, replaces the oldest cached one.
+*
+* @param[in]    fileName    full path to PDF document
+* @param[in]    bitmap      rendered page, cache takes ownership
+*/
+void TcThumbnail::store(const wchar_t* fileName, SplashBitmap* bitmap)
+{
+    auto& entry = m_cache[m_next];
+    if (!GetFileAttributesExW(fileName, GetFileExInfoStandard, &entry.fileInfo))
+    {
+        delete bitmap;
+        return;
+    }
+    if (entry.fileName)
+        free(entry.fileName);
+    if (entry.bitmap)
+        delete entry.bitmap;
+    entry.fileName = _wcsdup(fileName);
+    entry.bitmap = bitmap;
+    m_next = (m_next + 1) % THUMBNAIL_CACHE_SIZE;
+}
+
+/**
+* Renders page 1 through reduced-cost Splash pipeline.
+* Anti-aliasing is disabled, glyphs and lines at #THUMBNAIL_DPI are too small to benefit from it.
+* Draft mode draws text as boxes, the plugin has no font engine and glyphs are only a few pixels high.
+* Images with filters excluded from the plugin (DCT, JPX, JBIG2, CCITT) are left blank instead of black.
+* In builds that include them, DCT and JPX images are decoded at 1/2, 1/4 or 1/8 resolution when downsampled anyway.
+*
+* @param[in]    doc     pointer to xPDF PdfDoc instance
+* @return rendered page, nullptr if rendering was aborted
+*/
+SplashBitmap* TcThumbnail::render(PDFDoc* doc)
+{
+    SplashColor paper;
+    paper[0] = paper[1] = paper[2] = 0xFF;
+    // BGR rows padded to DWORD are the same as 24 bpp DIB
+    SplashOutputDev dev(splashModeBGR8, 4, gFalse, paper, gTrue, gFalse);
+    dev.setReduceImages(gTrue);
+    dev.setDraft(gTrue);
+    dev.startDoc(doc->getXRef());
+
+    m_aborted = false;
+    doc->displayPage(&dev, 1, THUMBNAIL_DPI, THUMBNAIL_DPI, 0, gFalse, gTrue, gFalse, &abortRendering, this);
+    // release page resources
+    doc->getCatalog()->doneWithPage(1);
+
+    return m_aborted ? nullptr : dev.takeBitmap();
+}
+
+/**
+* Renders thumbnail of the document to request structure.
+* Complete page is cached. Thumbnail bitmap is created only if the request is still active,
+* otherwise ThreadData::Request::fieldValue may be gone.
+*
+* @param[in]        doc         pointer to xPDF PdfDoc instance
+* @param[in]        fileName    full path to PDF document
+* @param[in,out]    data        pointer to ThreadData structure
+*/
+void TcThumbnail::output(PDFDoc* doc, const wchar_t* fileName, ThreadData* data)
+{
+    m_data = data;
+    auto bitmap = render(doc);
+    if (bitmap)
+    {
+        EnterCriticalSection(&data->lock);
+        {
+            if (request_status::active == InterlockedOr(&data->request.status, 0))
+            {
+                auto thumb = static_cast<ThumbnailRequest*>(data->request.fieldValue);
+                thumb->bitmap = createBitmap(bitmap, thumb->width, thumb->height);
+                if (thumb->bitmap)
+                    data->request.result = ft_bitmap;
+            }
+            store(fileName, bitmap);
+        }
+        LeaveCriticalSection(&data->lock);
+    }
+    m_data = nullptr;
+}
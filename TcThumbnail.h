@@ -0,0 +1,48 @@
+#pragma once
+#include "ThreadData.h"
+#include <SplashBitmap.h>
+
+/**
+* @file
+* TcThumbnail class declaration.
+*/
+
+/**
+* Class for rendering thumbnails of PDF documents to TC.
+* Page 1 is rendered at fixed low resolution #THUMBNAIL_DPI, without anti-aliasing,
+* text is drawn as boxes, and images are decoded at reduced resolution whenever they are downsampled anyway.
+* Rendered pages of the last #THUMBNAIL_CACHE_SIZE files are kept,
+* so following requests of unchanged files (e.g. with different size) don't render the page again.
+*/
+class TcThumbnail
+{
+public:
+    explicit TcThumbnail() = default;
+    TcThumbnail(const TcThumbnail&) = delete;
+    TcThumbnail& operator=(const TcThumbnail&) = delete;
+    ~TcThumbnail();
+
+    bool find(const wchar_t* fileName, ThumbnailRequest* thumb);
+    void output(PDFDoc* doc, const wchar_t* fileName, ThreadData* data);
+private:
+    /**
+    * Rendered page 1 of a file
+    */
+    struct Entry
+    {
+        wchar_t* fileName;                  /**< full path to PDF document, nullptr if entry is empty */
+        WIN32_FILE_ATTRIBUTE_DATA fileInfo; /**< size and time of the file, to detect changes */
+        SplashBitmap* bitmap;               /**< rendered page, BGR rows padded to DWORD, top-down */
+    };
+
+    static GBool abortRendering(void* data);
+    static HBITMAP createBitmap(SplashBitmap* bitmap, int width, int height);
+
+    SplashBitmap* render(PDFDoc* doc);
+    void store(const wchar_t* fileName, SplashBitmap* bitmap);
+
+    Entry               m_cache[THUMBNAIL_CACHE_SIZE]{};/**< rendered pages */
+    unsigned int        m_next{ 0 };                    /**< next entry to be replaced */
+    ThreadData*         m_data{ nullptr };              /**< request data of the current rendering */
+    bool                m_aborted{ false };             /**< rendering was aborted, page is incomplete */
+};
@@ -34,6 +34,20 @@ constexpr auto PRODUCER_TIMEOUT = 100U;/**< extractor waits for next request fro
 
 constexpr auto DEFAULT_FIELD_CB = 4096U;/**< size of Request.fieldValue, if not provided form TC */
 
+constexpr auto TEXT_RING_SIZE = 4U;/**< number of text blocks the extractor can run ahead of TC */
+
+/**
+* wait for 10 s for TC to read a block from the full text ring,
+* TC may be busy between blocks, it ends the search itself (unitIndex -1, ContentStopGetValueW)
+*/
+constexpr auto RING_TIMEOUT = CONSUMER_TIMEOUT;/**< extractor waits for TC to free a ring block, or cancels extraction */
+
+constexpr auto PAGE_CACHE_CB = 16U * 1024U * 1024U;/**< max. size of extracted page text kept for the open document, in bytes */
+
+constexpr auto THUMBNAIL_DPI = 24.0;/**< fixed resolution of page 1 rendered for a thumbnail (Letter page is 204x264 pixels), the bitmap is shrunk to the requested size */
+
+constexpr auto THUMBNAIL_CACHE_SIZE = 8U;/**< number of rendered thumbnails kept for following requests */
+
 constexpr auto sizeOfWchar = sizeof(wchar_t);/**< sizeof wchar_t */
 
 /** 
@@ -58,6 +72,8 @@ struct Request
     int flags;                  /**< flags from TC */
     int result;                 /**< result of an extraction */
     bool allocated;             /**< true=fieldValue is allocated in this class */
+    bool ring;                  /**< true=text is passed to TC through ThreadData::ring, fieldValue is a ring block */
+    bool suspended;             /**< true=TC stopped waiting after CONSUMER_TIMEOUT, extracted text is kept to resume */
     DWORD timeout;              /**< time to wait in text extraction procedure */
     volatile LONG status;       /**< request status, @see request_status */
     void* fieldValue;           /**< extracted data buffer */
@@ -65,6 +81,34 @@ struct Request
     const wchar_t* fileName;    /**< name of PDF document */
 };
 
+/**
+* Thumbnail request, passed to extractor in Request::fieldValue
+*/
+struct ThumbnailRequest
+{
+    int width;          /**< max. width of the thumbnail in pixels */
+    int height;         /**< max. height of the thumbnail in pixels */
+    HBITMAP bitmap;     /**< created thumbnail, caller releases it with DeleteObject */
+};
+
+/**
+* Single-producer/single-consumer ring of text blocks.
+* Extractor thread fills blocks while TC searches the previous ones.
+* Only the extractor changes TextRing::written and only TC changes TextRing::read.
+*/
+struct TextRing
+{
+    HANDLE filled;                      /**< event raised by extractor when a block is written */
+    HANDLE freed;                       /**< event raised by TC when a block is read */
+    int cbBlock;                        /**< size of each block in BYTES!!! */
+    wchar_t* blocks[TEXT_RING_SIZE];    /**< text blocks */
+    int cchBlock[TEXT_RING_SIZE];       /**< number of wchars in each written block */
+    volatile LONG written;              /**< number of blocks written by extractor */
+    volatile LONG read;                 /**< number of blocks read by TC */
+    bool used;                          /**< TC reads current text extraction from the ring */
+    bool done;                          /**< extractor finished, TC reads remaining blocks */
+};
+
 /**
 * Extraction thread related data 
 */
@@ -74,4 +118,5 @@ struct ThreadData
     CRITICAL_SECTION lock;  /**< lock to protect Request while exchanging data */
     HANDLE handles[3U];     /**< thread, producer and consumer event handles */
     Request request;        /**< extraction request */
+    TextRing ring;          /**< text blocks passed from extractor to TC */
 };
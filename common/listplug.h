@@ -0,0 +1,18 @@
+/**
+* @file
+* Part of file listplug.h version 2.0, functions used for thumbnails only
+*/
+#pragma once
+#include <Windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+    __declspec(dllexport) HWND __stdcall ListLoad(HWND ParentWin, char* FileToLoad, int ShowFlags);
+    __declspec(dllexport) HWND __stdcall ListLoadW(HWND ParentWin, WCHAR* FileToLoad, int ShowFlags);
+    __declspec(dllexport) void __stdcall ListGetDetectString(char* DetectString, int maxlen);
+    __declspec(dllexport) HBITMAP __stdcall ListGetPreviewBitmap(char* FileToLoad, int width, int height, char* contentbuf, int contentbuflen);
+    __declspec(dllexport) HBITMAP __stdcall ListGetPreviewBitmapW(WCHAR* FileToLoad, int width, int height, char* contentbuf, int contentbuflen);
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -1,6 +1,7 @@
 #include "xPDFInfo.h"
 #include <wchar.h>
 #include "PDFExtractor.h"
+#include "listplug.h"
 #include <GlobalParams.h>
 #include <strsafe.h>
 
@@ -349,3 +350,71 @@ int __stdcall ContentCompareFilesW(PROGRESSCALLBACKPROC progresscallback, int co
 
     return ft_compare_next;
 }
+
+/**
+* Lister plugin functions are exported for thumbnails only.
+* To show thumbnails in TC, copy or rename the plugin to xPDFSearch.wlx (wlx64) and install it as lister plugin.
+* PDF documents are not shown in lister window, ListLoad always fails.
+*
+* @param[in]    ParentWin       not used
+* @param[in]    FileToLoad      not used
+* @param[in]    ShowFlags       not used
+* @return nullptr
+*/
+HWND __stdcall ListLoad(HWND ParentWin, char* FileToLoad, int ShowFlags)
+{
+    return nullptr;
+}
+
+/**
+* Unicode version of ListLoad, always fails.
+* @see ListLoad
+*/
+HWND __stdcall ListLoadW(HWND ParentWin, WCHAR* FileToLoad, int ShowFlags)
+{
+    return nullptr;
+}
+
+/**
+* Returns PDF detection string for lister plugin.
+* @param[out]    DetectString    detection buffer
+* @param[in]     maxlen          detection buffer size in chars
+*/
+void __stdcall ListGetDetectString(char* DetectString, int maxlen)
+{
+    StringCchCopyA(DetectString, maxlen, "EXT=\"PDF\"");
+}
+
+/**
+* ANSI version of ListGetPreviewBitmap is not supported
+*/
+HBITMAP __stdcall ListGetPreviewBitmap(char* FileToLoad, int width, int height, char* contentbuf, int contentbuflen)
+{
+    TRACE(L"%hs\n", __FUNCTION__);
+    return nullptr;
+}
+
+/**
+* Creates thumbnail of PDF document.
+* See "Lister Plugin Interface" document.
+* The first page is rendered by PDFExtractor object of calling thread, the same as content fields.
+*
+* @param[in]    FileToLoad      full path to PDF document
+* @param[in]    width           max. width of the thumbnail
+* @param[in]    height          max. height of the thumbnail
+* @param[in]    contentbuf      not used
+* @param[in]    contentbuflen   not used
+* @return thumbnail bitmap, TC releases it; nullptr on error
+*/
+HBITMAP __stdcall ListGetPreviewBitmapW(WCHAR* FileToLoad, int width, int height, char* contentbuf, int contentbuflen)
+{
+    TRACE(L"%hs!%ls!%dx%d\n", __FUNCTION__, FileToLoad, width, height);
+
+    if (!g_extractor)
+        g_extractor = new PDFExtractor();
+
+    if (g_extractor)
+        return g_extractor->thumbnail(FileToLoad, width, height);
+
+    return nullptr;
+}
@@ -29,10 +29,13 @@ enum fieldIndexes
     fiCopyingAllowed, fiPrintingAllowed, fiAddCommentsAllowed, fiChangingAllowed, fiEncrypted, fiTagged, fiLinearized, fiIncremental, fiSignature,
     fiCreationDate, fiLastModifiedDate, 
     fiID, fiAttributesString,
-    fiText
+    fiText,
+    fiThumbnail     /**< internal request, not exposed to TC, see PDFExtractor::thumbnail */
 };
 /**< used to globally set the number of supported fields. */
 constexpr auto FIELD_COUNT = 26;
+/**< result type of fiThumbnail request, ThumbnailRequest::bitmap is set */
+constexpr auto ft_bitmap = 200;
 
 #ifdef _DEBUG
 extern bool __cdecl _trace(const wchar_t *format, ...);
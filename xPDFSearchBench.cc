@@ -0,0 +1,246 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include "xPDFInfo.h"
+#include "ThreadData.h"
+
+/**
+* @file
+* Command line benchmark for xPDFSearch plugin.
+* Plugin is loaded and called in the same way as TC does it.
+*
+* Usage: xPDFSearchBench [-p plugin] [-n iterations] [-o] PDF-file ...
+*
+* For every file, the time of the typical TC field sequence (Document Start, First Row, Text)
+* is measured twice: with all three fields requested from one open document,
+* and with the document closed after each field.
+* Then the text is read once more from the still open document, all its pages are
+* served from the page text cache.
+* With -o, the time to open the document is measured instead: the first open,
+* and the average of the following opens, which can use what the plugin cached
+* during the first one (e.g. file keys of encrypted documents).
+*/
+
+typedef int (__stdcall *ContentGetValueWProc)(const wchar_t* fileName, int fieldIndex, int unitIndex, void* fieldValue, int cbfieldValue, int flags);
+typedef void (__stdcall *ContentSetDefaultParamsProc)(ContentDefaultParamStruct* dps);
+typedef void (__stdcall *ContentPluginUnloadingProc)();
+
+#ifdef _WIN64
+constexpr auto DEFAULT_PLUGIN = L"xPDFSearch.wdx64"; /**< plugin loaded by default */
+#else
+constexpr auto DEFAULT_PLUGIN = L"xPDFSearch.wdx"; /**< plugin loaded by default */
+#endif
+
+/** time to wait for plugin to close an idle PDF document, in ms (extractor closes it after #PRODUCER_TIMEOUT) */
+constexpr auto CLOSE_WAIT = 3 * PRODUCER_TIMEOUT;
+
+/** fields requested by TC, when a PDF is listed with Document Start and First Row columns and searched for text */
+static const int sequenceFields[] = { fiDocStart, fiFirstRow, fiText };
+
+static ContentGetValueWProc getValue = nullptr;
+
+/**
+* Returns current time in ms.
+*/
+static double now()
+{
+    LARGE_INTEGER freq, counter;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return 1000.0 * counter.QuadPart / freq.QuadPart;
+}
+
+/**
+* Retrieves a field from PDF document.
+* Text field is read block by block until the end of the text.
+*
+* @param[in]    fileName    full path to PDF document
+* @param[in]    fieldIndex  index of the field
+* @return       result of the last ContentGetValueW call
+*/
+static int getField(const wchar_t* fileName, int fieldIndex)
+{
+    wchar_t fieldValue[DEFAULT_FIELD_CB / sizeOfWchar];
+    auto offset = 0;
+
+    auto result = getValue(fileName, fieldIndex, 0, fieldValue, sizeof(fieldValue), 0);
+    if (fieldIndex == fiText)
+    {
+        while (result == ft_fulltextw)
+        {
+            offset += lstrlenW(fieldValue) * sizeOfWchar;
+            result = getValue(fileName, fieldIndex, offset, fieldValue, sizeof(fieldValue), 0);
+        }
+    }
+    return result;
+}
+
+/**
+* Measures the field sequence for one PDF document.
+*
+* @param[in]    fileName    full path to PDF document
+* @param[in]    iterations  number of measurements
+* @param[out]   separate    average time of the sequence, when PDF is closed after each field, in ms
+* @param[out]   sequence    average time of the sequence in one open PDF, in ms
+* @param[out]   cached      average time of the text read again after the sequence, in ms
+* @return       false if a field couldn't be read
+*/
+static bool benchFields(const wchar_t* fileName, int iterations, double* separate, double* sequence, double* cached)
+{
+    double start;
+
+    // read the file once, so the first measurement doesn't include loading it from disk
+    if (getField(fileName, fiNumberOfPages) != ft_numeric_32)
+        return false;
+    Sleep(CLOSE_WAIT);
+
+    *separate = *sequence = *cached = 0.0;
+    for (auto i = 0; i < iterations; i++)
+    {
+        for (auto field : sequenceFields)
+        {
+            start = now();
+            auto result = getField(fileName, field);
+            *separate += now() - start;
+            if (result == ft_fileerror)
+                return false;
+            Sleep(CLOSE_WAIT);
+        }
+
+        start = now();
+        for (auto field : sequenceFields)
+            getField(fileName, field);
+        *sequence += now() - start;
+
+        start = now();
+        getField(fileName, fiText);
+        *cached += now() - start;
+        Sleep(CLOSE_WAIT);
+    }
+    *separate /= iterations;
+    *sequence /= iterations;
+    *cached /= iterations;
+    return true;
+}
+
+/**
+* Measures opening of one PDF document.
+* Number of pages is requested, and the document is closed after each request.
+*
+* @param[in]    fileName    full path to PDF document
+* @param[in]    iterations  number of measured re-opens
+* @param[out]   firstOpen   time of the first open, in ms
+* @param[out]   reopen      average time of the following opens, in ms
+* @return       false if the document couldn't be open
+*/
+static bool benchOpen(const wchar_t* fileName, int iterations, double* firstOpen, double* reopen)
+{
+    double start;
+
+    start = now();
+    if (getField(fileName, fiNumberOfPages) != ft_numeric_32)
+        return false;
+    *firstOpen = now() - start;
+    Sleep(CLOSE_WAIT);
+
+    *reopen = 0.0;
+    for (auto i = 0; i < iterations; i++)
+    {
+        start = now();
+        getField(fileName, fiNumberOfPages);
+        *reopen += now() - start;
+        Sleep(CLOSE_WAIT);
+    }
+    *reopen /= iterations;
+    return true;
+}
+
+/**
+* Prints usage information.
+*/
+static void usage()
+{
+    fwprintf(stderr, L"Usage: xPDFSearchBench [-p plugin] [-n iterations] [-o] PDF-file ...\n");
+    fwprintf(stderr, L"  -p plugin      plugin to load (default: %ls)\n", DEFAULT_PLUGIN);
+    fwprintf(stderr, L"  -n iterations  number of measurements per file (default: 3)\n");
+    fwprintf(stderr, L"  -o             measure document open time instead of the field sequence\n");
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+    const wchar_t* pluginName = DEFAULT_PLUGIN;
+    auto iterations = 3;
+    auto openTime = false;
+    auto i = 1;
+
+    for (; i < argc && argv[i][0] == L'-'; i++)
+    {
+        if (!wcscmp(argv[i], L"-p") && (i + 1 < argc))
+            pluginName = argv[++i];
+        else if (!wcscmp(argv[i], L"-n") && (i + 1 < argc))
+            iterations = _wtoi(argv[++i]);
+        else if (!wcscmp(argv[i], L"-o"))
+            openTime = true;
+        else
+        {
+            usage();
+            return 99;
+        }
+    }
+    if ((i == argc) || (iterations < 1))
+    {
+        usage();
+        return 99;
+    }
+
+    auto plugin = LoadLibraryW(pluginName);
+    if (!plugin)
+    {
+        fwprintf(stderr, L"Couldn't load plugin %ls\n", pluginName);
+        return 2;
+    }
+    getValue = reinterpret_cast<ContentGetValueWProc>(GetProcAddress(plugin, "ContentGetValueW"));
+    auto setDefaultParams = reinterpret_cast<ContentSetDefaultParamsProc>(GetProcAddress(plugin, "ContentSetDefaultParams"));
+    auto pluginUnloading = reinterpret_cast<ContentPluginUnloadingProc>(GetProcAddress(plugin, "ContentPluginUnloading"));
+    if (!getValue || !setDefaultParams || !pluginUnloading)
+    {
+        fwprintf(stderr, L"%ls is not a content plugin\n", pluginName);
+        FreeLibrary(plugin);
+        return 2;
+    }
+
+    ContentDefaultParamStruct dps{};
+    dps.size = sizeof(dps);
+    dps.PluginInterfaceVersionHi = 2;
+    dps.PluginInterfaceVersionLow = 12;
+    setDefaultParams(&dps);
+
+    auto exitCode = 0;
+    if (openTime)
+        wprintf(L"first_open_ms\treopen_ms\tfile\n");
+    else
+        wprintf(L"fields_separate_ms\tfields_sequence_ms\ttext_cached_ms\tfile\n");
+    for (; i < argc; i++)
+    {
+        double time1, time2, time3;
+        wchar_t fileName[MAX_PATH];
+
+        if (!GetFullPathNameW(argv[i], MAX_PATH, fileName, nullptr)
+            || !(openTime ? benchOpen(fileName, iterations, &time1, &time2) : benchFields(fileName, iterations, &time1, &time2, &time3)))
+        {
+            fwprintf(stderr, L"Couldn't read %ls\n", argv[i]);
+            exitCode = 1;
+            continue;
+        }
+        if (openTime)
+            wprintf(L"%.3f\t%.3f\t%ls\n", time1, time2, argv[i]);
+        else
+            wprintf(L"%.3f\t%.3f\t%.3f\t%ls\n", time1, time2, time3, argv[i]);
+    }
+
+    pluginUnloading();
+    FreeLibrary(plugin);
+    return exitCode;
+}
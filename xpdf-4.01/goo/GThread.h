@@ -0,0 +1,67 @@
+//========================================================================
+//
+// GThread.h
+//
+// Portable thread creation functions.
+//
+//========================================================================
+
+#ifndef GTHREAD_H
+#define GTHREAD_H
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+
+//------------------------------------------------------------------------
+// GThreadID
+//------------------------------------------------------------------------
+
+// Usage:
+//
+// static GThreadReturn threadFunc(void *data) {
+//   ...
+//   return 0;
+// }
+// ...
+// GThreadID thr;
+// gCreateThread(&thr, &threadFunc, data);
+// ...
+// gJoinThread(thr);
+
+#ifdef _WIN32
+
+typedef HANDLE GThreadID;
+typedef DWORD (WINAPI *GThreadFunc)(void *);
+#define GThreadReturn DWORD WINAPI
+
+static inline void gCreateThread(GThreadID *thr, GThreadFunc threadFunc,
+				 void *data) {
+  *thr = CreateThread(NULL, 0, threadFunc, data, 0, NULL);
+}
+
+static inline void gJoinThread(GThreadID thr) {
+  WaitForSingleObject(thr, INFINITE);
+  CloseHandle(thr);
+}
+
+#else // assume pthreads
+
+typedef pthread_t GThreadID;
+typedef void *(*GThreadFunc)(void *);
+#define GThreadReturn void*
+
+static inline void gCreateThread(GThreadID *thr, GThreadFunc threadFunc,
+				 void *data) {
+  pthread_create(thr, NULL, threadFunc, data);
+}
+
+static inline void gJoinThread(GThreadID thr) {
+  pthread_join(thr, NULL);
+}
+
+#endif
+
+#endif
@@ -20,6 +20,16 @@
 #endif
 #include "gmem.h"
 
+#ifdef GMEM_COUNT_ALLOCS
+// number of blocks handed out by gmalloc/gmalloc64/grealloc -- this
+// is only built into pdfstreambench, and it is not synchronized, so
+// it is approximate when several threads allocate at once
+static size_t gMemAllocCount = 0;
+#  define gMemCountAlloc ++gMemAllocCount
+#else
+#  define gMemCountAlloc
+#endif
+
 #ifdef DEBUG_MEM
 
 typedef struct _GMemHdr {
@@ -99,6 +109,7 @@ void *gmalloc(int size, int ignore) GMEM_EXCEP {
     return NULL;
   }
   size1 = gMemDataSize(size);
+  gMemCountAlloc;
   if (!(mem = (char *)malloc(size1 + gMemHdrSize + gMemTrlSize))) {
     gMemError("Out of memory");
   }
@@ -143,6 +154,7 @@ void *gmalloc(int size) GMEM_EXCEP {
   if (size == 0) {
     return NULL;
   }
+  gMemCountAlloc;
   if (!(p = malloc(size))) {
     gMemError("Out of memory");
   }
@@ -187,6 +199,7 @@ void *grealloc(void *p, int size) GMEM_EXCEP {
     }
     return NULL;
   }
+  gMemCountAlloc;
   if (p) {
     q = realloc(p, size);
   } else {
@@ -225,6 +238,7 @@ void *gmalloc64(size_t size, int ignore) GMEM_EXCEP {
     return NULL;
   }
   size1 = gMemDataSize64(size);
+  gMemCountAlloc;
   if (!(mem = (char *)malloc(size1 + gMemHdrSize + gMemTrlSize))) {
     gMemError("Out of memory");
   }
@@ -266,6 +280,7 @@ void *gmalloc64(size_t size) GMEM_EXCEP {
   if (size == 0) {
     return NULL;
   }
+  gMemCountAlloc;
   if (!(p = malloc(size))) {
     gMemError("Out of memory");
   }
@@ -349,6 +364,12 @@ void gfree(void *p) {
 #endif
 }
 
+#ifdef GMEM_COUNT_ALLOCS
+size_t gMemGetAllocCount(void) {
+  return gMemAllocCount;
+}
+#endif
+
 void gMemError(const char *msg) GMEM_EXCEP {
 #if USE_EXCEPTIONS
   throw GMemException();
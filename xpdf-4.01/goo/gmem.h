@@ -73,6 +73,15 @@ extern void *gmallocn64(int nObjs, size_t objSize) GMEM_EXCEP;
  */
 extern void gfree(void *p);
 
+#ifdef GMEM_COUNT_ALLOCS
+/*
+ * Return the number of allocations (including reallocations) made so
+ * far.  This is only available when gmem is compiled with
+ * GMEM_COUNT_ALLOCS, which is intended for benchmarking.
+ */
+extern size_t gMemGetAllocCount(void);
+#endif
+
 /*
  * Report a memory error.
  */
@@ -16,6 +16,11 @@
 #include <string.h>
 #include <limits.h>
 #include <math.h>
+#if (defined(__GNUC__) && defined(__SSE2__)) || \
+    (defined(_WIN32) && (_M_IX86_FP == 2 || defined(_M_X64)))
+#  include <emmintrin.h>
+#  define SPLASH_SSE2 1
+#endif
 #include "gmem.h"
 #include "gmempp.h"
 #include "SplashErrorCodes.h"
@@ -53,6 +58,453 @@ static inline Guchar clip255(int x) {
   return x < 0 ? 0 : x > 255 ? 255 : (Guchar)x;
 }
 
+// Limit the rows [*ySrc, *ySrc + *h) of <src>, and the corresponding
+// rows [*yDest, *yDest + *h) of <dest>, to rows that are present in
+// both bitmaps (see SplashBitmap::isBand).  Returns false if no rows
+// are left.
+static GBool limitToBands(SplashBitmap *src, int *ySrc,
+			  SplashBitmap *dest, int *yDest, int *h) {
+  int d;
+
+  if ((d = src->getBandY() - *ySrc) > 0) {
+    *ySrc += d;
+    *yDest += d;
+    *h -= d;
+  }
+  if ((d = dest->getBandY() - *yDest) > 0) {
+    *ySrc += d;
+    *yDest += d;
+    *h -= d;
+  }
+  if ((d = *ySrc + *h - (src->getBandY() + src->getBandHeight())) > 0) {
+    *h -= d;
+  }
+  if ((d = *yDest + *h - (dest->getBandY() + dest->getBandHeight())) > 0) {
+    *h -= d;
+  }
+  return *h > 0;
+}
+
+// Fill <n> pixels of 3-component color at <p>.
+static void fillSpan3(Guchar *p, Guchar c0, Guchar c1, Guchar c2, int n) {
+  int done, total;
+
+  if (n < 8) {
+    for (; n > 0; --n) {
+      p[0] = c0;
+      p[1] = c1;
+      p[2] = c2;
+      p += 3;
+    }
+    return;
+  }
+  p[0] = c0;
+  p[1] = c1;
+  p[2] = c2;
+  total = 3 * n;
+  for (done = 3; done < total; done *= 2) {
+    memcpy(p + done, p, done < total - done ? done : total - done);
+  }
+}
+
+#if SPLASH_SSE2
+
+//------------------------------------------------------------------------
+// SSE2 span kernels
+//------------------------------------------------------------------------
+
+// These composite a span in blocks of 8 pixels, using 16-bit lanes,
+// with exactly the same arithmetic as the scalar code, so the results
+// are bit-identical.  The scalar code handles any leftover pixels.
+//
+// In the pipeRunShape* formula:
+//   aResult = aSrc + aDest - div255(aSrc * aDest)
+//   cResult = ((aResult - aSrc) * cDest + aSrc * cSrc) / aResult
+// the aSrc = 255 and aDest = 0 special cases come out the same as
+// the general case, so all pixels with nonzero shape can go through
+// one formula.
+
+// div255() on eight 16-bit lanes.
+static inline __m128i div255x8(__m128i x) {
+  return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)),
+				      _mm_set1_epi16(0x80)),
+			8);
+}
+
+// Integer division (num / den) on eight 16-bit lanes, with num in [0,
+// 255 * 255] and den in [1, 255].  In this range, the truncated
+// single-precision quotient is always the exact integer quotient.
+static inline __m128i div16x8(__m128i num, __m128i den) {
+  __m128i zero;
+  __m128 qLo, qHi;
+
+  zero = _mm_setzero_si128();
+  qLo = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(num, zero)),
+		   _mm_cvtepi32_ps(_mm_unpacklo_epi16(den, zero)));
+  qHi = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(num, zero)),
+		   _mm_cvtepi32_ps(_mm_unpackhi_epi16(den, zero)));
+  return _mm_packs_epi32(_mm_cvttps_epi32(qLo), _mm_cvttps_epi32(qHi));
+}
+
+// Composite eight color components.  Components with zero shape are
+// left unchanged.
+static inline __m128i shapeBlend8(__m128i shape, __m128i aResult,
+				  __m128i cDest, __m128i cSrc) {
+  __m128i num, c, mask;
+
+  num = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(aResult, shape), cDest),
+		      _mm_mullo_epi16(shape, cSrc));
+  c = div16x8(num, _mm_max_epi16(aResult, _mm_set1_epi16(1)));
+  mask = _mm_cmpeq_epi16(shape, _mm_setzero_si128());
+  return _mm_or_si128(_mm_and_si128(mask, cDest), _mm_andnot_si128(mask, c));
+}
+
+// Expand eight per-pixel 16-bit lanes <a> to the 24 per-component
+// lanes of eight 3-component pixels.
+static inline void expand3x8(__m128i a, __m128i *v0, __m128i *v1,
+			     __m128i *v2) {
+  __m128i t;
+
+  t = _mm_unpacklo_epi64(a, a);
+  *v0 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(1, 0, 0, 0)),
+			    _MM_SHUFFLE(2, 2, 1, 1));
+  *v1 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(3, 3, 3, 2)),
+			    _MM_SHUFFLE(1, 0, 0, 0));
+  t = _mm_unpackhi_epi64(a, a);
+  *v2 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(2, 2, 1, 1)),
+			    _MM_SHUFFLE(3, 3, 3, 2));
+}
+
+// Index of the last nonzero shape value in an 8-pixel block, given
+// the movemask of (shape == 0), or -1.
+static inline int lastShape8(int zeroMask) {
+  int i;
+
+  for (i = 7; i >= 0 && (zeroMask & (1 << i)); --i) ;
+  return i;
+}
+
+// Composite the 8-pixel blocks of a 1-component pipeRunShape span.
+// <transfer> is applied to the source values, unless <srcIsFinal> is
+// set.  Returns the number of pixels done (a multiple of 8), and sets
+// *lastI to the index of the last pixel with nonzero shape (or leaves
+// it unchanged if there are none).
+static int shapeSpan1(Guchar *shapePtr, SplashColorPtr cSrcPtr,
+		      int cSrcStride, Guchar *transfer, GBool srcIsFinal,
+		      SplashColorPtr destColorPtr, Guchar *destAlphaPtr,
+		      int n, int *lastI) {
+  SplashColorPtr src;
+  Guchar srcBuf[8];
+  __m128i zero, shape8, shape, aDest, aResult, cSrc, c;
+  int zeroMask, i, j;
+
+  zero = _mm_setzero_si128();
+  if (!cSrcStride) {
+    memset(srcBuf, transfer[cSrcPtr[0]], 8);
+  }
+  for (i = 0; i + 8 <= n; i += 8) {
+    shape8 = _mm_loadl_epi64((__m128i *)(shapePtr + i));
+    zeroMask = _mm_movemask_epi8(_mm_cmpeq_epi8(shape8, zero)) & 0xff;
+    if (zeroMask == 0xff) {
+      continue;
+    }
+    *lastI = i + lastShape8(zeroMask);
+    if (!cSrcStride) {
+      src = srcBuf;
+    } else if (srcIsFinal) {
+      src = cSrcPtr + i;
+    } else {
+      for (j = 0; j < 8; ++j) {
+	srcBuf[j] = transfer[cSrcPtr[i + j]];
+      }
+      src = srcBuf;
+    }
+    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(shape8, _mm_set1_epi8((char)0xff)))
+	 & 0xff) == 0xff) {
+      memcpy(destColorPtr + i, src, 8);
+      memset(destAlphaPtr + i, 0xff, 8);
+      continue;
+    }
+    shape = _mm_unpacklo_epi8(shape8, zero);
+    aDest = _mm_unpacklo_epi8(
+		_mm_loadl_epi64((__m128i *)(destAlphaPtr + i)), zero);
+    aResult = _mm_sub_epi16(_mm_add_epi16(shape, aDest),
+			    div255x8(_mm_mullo_epi16(shape, aDest)));
+    cSrc = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)src), zero);
+    c = shapeBlend8(shape, aResult,
+		    _mm_unpacklo_epi8(
+			_mm_loadl_epi64((__m128i *)(destColorPtr + i)), zero),
+		    cSrc);
+    _mm_storel_epi64((__m128i *)(destColorPtr + i), _mm_packus_epi16(c, c));
+    _mm_storel_epi64((__m128i *)(destAlphaPtr + i),
+		     _mm_packus_epi16(aResult, aResult));
+  }
+  return i;
+}
+
+// Composite the 8-pixel blocks of a 3-component pipeRunShape span.
+// Destination component k is set from transfer<k>[cSrcPtr[srcIdx<k>]]
+// (srcIdx1 is always 1).  If <srcIsFinal> is set, the source values
+// are used as is, in RGB order.  Returns the number of pixels done,
+// and sets *lastI, as shapeSpan1 does.
+static int shapeSpan3(Guchar *shapePtr, SplashColorPtr cSrcPtr,
+		      int cSrcStride, Guchar *transfer0, Guchar *transfer1,
+		      Guchar *transfer2, int srcIdx0, int srcIdx2,
+		      GBool srcIsFinal,
+		      SplashColorPtr destColorPtr, Guchar *destAlphaPtr,
+		      int n, int *lastI) {
+  SplashColorPtr src, s, dest;
+  Guchar srcBuf[24];
+  __m128i zero, shape8, shape, aDest, aResult, dest16;
+  __m128i shape0, shape1, shape2, aResult0, aResult1, aResult2;
+  __m128i c0, c1, c2;
+  int zeroMask, i, j;
+
+  zero = _mm_setzero_si128();
+  if (!cSrcStride) {
+    for (j = 0; j < 24; j += 3) {
+      srcBuf[j] = transfer0[cSrcPtr[srcIdx0]];
+      srcBuf[j + 1] = transfer1[cSrcPtr[1]];
+      srcBuf[j + 2] = transfer2[cSrcPtr[srcIdx2]];
+    }
+  }
+  for (i = 0; i + 8 <= n; i += 8) {
+    shape8 = _mm_loadl_epi64((__m128i *)(shapePtr + i));
+    zeroMask = _mm_movemask_epi8(_mm_cmpeq_epi8(shape8, zero)) & 0xff;
+    if (zeroMask == 0xff) {
+      continue;
+    }
+    *lastI = i + lastShape8(zeroMask);
+    if (!cSrcStride) {
+      src = srcBuf;
+    } else if (srcIsFinal) {
+      src = cSrcPtr + 3 * i;
+    } else {
+      s = cSrcPtr + 3 * i;
+      for (j = 0; j < 24; j += 3) {
+	srcBuf[j] = transfer0[s[j + srcIdx0]];
+	srcBuf[j + 1] = transfer1[s[j + 1]];
+	srcBuf[j + 2] = transfer2[s[j + srcIdx2]];
+      }
+      src = srcBuf;
+    }
+    dest = destColorPtr + 3 * i;
+    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(shape8, _mm_set1_epi8((char)0xff)))
+	 & 0xff) == 0xff) {
+      memcpy(dest, src, 24);
+      memset(destAlphaPtr + i, 0xff, 8);
+      continue;
+    }
+    shape = _mm_unpacklo_epi8(shape8, zero);
+    aDest = _mm_unpacklo_epi8(
+		_mm_loadl_epi64((__m128i *)(destAlphaPtr + i)), zero);
+    aResult = _mm_sub_epi16(_mm_add_epi16(shape, aDest),
+			    div255x8(_mm_mullo_epi16(shape, aDest)));
+    expand3x8(shape, &shape0, &shape1, &shape2);
+    expand3x8(aResult, &aResult0, &aResult1, &aResult2);
+    dest16 = _mm_loadu_si128((__m128i *)dest);
+    c0 = shapeBlend8(shape0, aResult0, _mm_unpacklo_epi8(dest16, zero),
+		     _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)src),
+				       zero));
+    c1 = shapeBlend8(shape1, aResult1, _mm_unpackhi_epi8(dest16, zero),
+		     _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(src + 8)),
+				       zero));
+    c2 = shapeBlend8(shape2, aResult2,
+		     _mm_unpacklo_epi8(
+			 _mm_loadl_epi64((__m128i *)(dest + 16)), zero),
+		     _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(src + 16)),
+				       zero));
+    _mm_storeu_si128((__m128i *)dest, _mm_packus_epi16(c0, c1));
+    _mm_storel_epi64((__m128i *)(dest + 16), _mm_packus_epi16(c2, c2));
+    _mm_storel_epi64((__m128i *)(destAlphaPtr + i),
+		     _mm_packus_epi16(aResult, aResult));
+  }
+  return i;
+}
+
+// Composite the 8-pixel blocks of a 1-component span over the
+// background color <color0> (see Splash::compositeBackground).
+// Returns the number of pixels done.
+static int backgroundSpan1(SplashColorPtr p, Guchar *q, Guchar color0,
+			   int n) {
+  __m128i zero, ff, alpha8, alpha, c;
+  int i, mask;
+
+  zero = _mm_setzero_si128();
+  ff = _mm_set1_epi8((char)0xff);
+  for (i = 0; i + 8 <= n; i += 8) {
+    alpha8 = _mm_loadl_epi64((__m128i *)(q + i));
+    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(alpha8, ff)) & 0xff) == 0xff) {
+      continue;
+    }
+    mask = _mm_movemask_epi8(_mm_cmpeq_epi8(alpha8, zero)) & 0xff;
+    if (mask == 0xff) {
+      memset(p + i, color0, 8);
+      continue;
+    }
+    alpha = _mm_unpacklo_epi8(alpha8, zero);
+    c = div255x8(_mm_add_epi16(
+		   _mm_mullo_epi16(_mm_sub_epi16(_mm_set1_epi16(255), alpha),
+				   _mm_set1_epi16(color0)),
+		   _mm_mullo_epi16(alpha,
+				   _mm_unpacklo_epi8(
+				       _mm_loadl_epi64((__m128i *)(p + i)),
+				       zero))));
+    _mm_storel_epi64((__m128i *)(p + i), _mm_packus_epi16(c, c));
+  }
+  return i;
+}
+
+// Composite the 8-pixel blocks of a 3-component span over the
+// background color <color> (see Splash::compositeBackground).
+// Returns the number of pixels done.
+static int backgroundSpan3(SplashColorPtr p, Guchar *q,
+			   SplashColorPtr color, int n) {
+  Guchar colorBuf[24];
+  __m128i zero, ff, alpha8, alpha, color0, color1, color2;
+  __m128i alpha0, alpha1, alpha2, p16, c0, c1, c2;
+  SplashColorPtr pp;
+  int i, j;
+
+  for (j = 0; j < 24; j += 3) {
+    colorBuf[j] = color[0];
+    colorBuf[j + 1] = color[1];
+    colorBuf[j + 2] = color[2];
+  }
+  zero = _mm_setzero_si128();
+  ff = _mm_set1_epi8((char)0xff);
+  color0 = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)colorBuf), zero);
+  color1 = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(colorBuf + 8)),
+			     zero);
+  color2 = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(colorBuf + 16)),
+			     zero);
+  for (i = 0; i + 8 <= n; i += 8) {
+    alpha8 = _mm_loadl_epi64((__m128i *)(q + i));
+    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(alpha8, ff)) & 0xff) == 0xff) {
+      continue;
+    }
+    pp = p + 3 * i;
+    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(alpha8, zero)) & 0xff) == 0xff) {
+      memcpy(pp, colorBuf, 24);
+      continue;
+    }
+    alpha = _mm_unpacklo_epi8(alpha8, zero);
+    expand3x8(alpha, &alpha0, &alpha1, &alpha2);
+    p16 = _mm_loadu_si128((__m128i *)pp);
+    c0 = div255x8(_mm_add_epi16(
+		    _mm_mullo_epi16(_mm_sub_epi16(_mm_set1_epi16(255), alpha0),
+				    color0),
+		    _mm_mullo_epi16(alpha0, _mm_unpacklo_epi8(p16, zero))));
+    c1 = div255x8(_mm_add_epi16(
+		    _mm_mullo_epi16(_mm_sub_epi16(_mm_set1_epi16(255), alpha1),
+				    color1),
+		    _mm_mullo_epi16(alpha1, _mm_unpackhi_epi8(p16, zero))));
+    c2 = div255x8(_mm_add_epi16(
+		    _mm_mullo_epi16(_mm_sub_epi16(_mm_set1_epi16(255), alpha2),
+				    color2),
+		    _mm_mullo_epi16(alpha2,
+				    _mm_unpacklo_epi8(
+					_mm_loadl_epi64((__m128i *)(pp + 16)),
+					zero))));
+    _mm_storeu_si128((__m128i *)pp, _mm_packus_epi16(c0, c1));
+    _mm_storel_epi64((__m128i *)(pp + 16), _mm_packus_epi16(c2, c2));
+  }
+  return i;
+}
+
+//------------------------------------------------------------------------
+// SSE2 image scaling kernels
+//------------------------------------------------------------------------
+
+// Add <n> bytes from <line> to the 32-bit sums in <acc>, in blocks of
+// 16.  Returns the number of bytes done; the scalar code handles the
+// rest.
+static inline int addRowx16(Guint *acc, Guchar *line, int n) {
+  __m128i zero, p, lo, hi;
+  __m128i *a;
+  int i;
+
+  zero = _mm_setzero_si128();
+  for (i = 0; i + 16 <= n; i += 16) {
+    p = _mm_loadu_si128((__m128i *)(line + i));
+    lo = _mm_unpacklo_epi8(p, zero);
+    hi = _mm_unpackhi_epi8(p, zero);
+    a = (__m128i *)(acc + i);
+    _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a),
+				      _mm_unpacklo_epi16(lo, zero)));
+    _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1),
+					  _mm_unpackhi_epi16(lo, zero)));
+    _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2),
+					  _mm_unpacklo_epi16(hi, zero)));
+    _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3),
+					  _mm_unpackhi_epi16(hi, zero)));
+  }
+  return i;
+}
+
+// (x * d) >> 23 on four 32-bit lanes.  The products must fit in 32
+// bits, and the results in 8 bits.
+static inline __m128i mulShift23x4(__m128i x, __m128i d) {
+  __m128i even, odd;
+
+  even = _mm_srli_epi64(_mm_mul_epu32(x, d), 23);
+  odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), d), 23);
+  return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+}
+
+// Compute (acc[i] * d) >> 23 for <n> sums, in blocks of 16, and store
+// the results as bytes.  As in the scalar code, the products must fit
+// in 32 bits.  Returns the number of values done.
+static inline int normRowx16(Guchar *out, Guint *acc, Guint d, int n) {
+  __m128i dd, r0, r1, r2, r3;
+  __m128i *a;
+  int i;
+
+  dd = _mm_set1_epi32((int)d);
+  for (i = 0; i + 16 <= n; i += 16) {
+    a = (__m128i *)(acc + i);
+    r0 = mulShift23x4(_mm_loadu_si128(a), dd);
+    r1 = mulShift23x4(_mm_loadu_si128(a + 1), dd);
+    r2 = mulShift23x4(_mm_loadu_si128(a + 2), dd);
+    r3 = mulShift23x4(_mm_loadu_si128(a + 3), dd);
+    _mm_storeu_si128((__m128i *)(out + i),
+		     _mm_packus_epi16(_mm_packs_epi32(r0, r1),
+				      _mm_packs_epi32(r2, r3)));
+  }
+  return i;
+}
+
+#endif // SPLASH_SSE2
+
+// Add a row of bytes to the 32-bit sums of the box filters in
+// scaleMask and scaleImage.
+static inline void addRow(Guint *acc, Guchar *line, int n) {
+  int i;
+
+#if SPLASH_SSE2
+  i = addRowx16(acc, line, n);
+#else
+  i = 0;
+#endif
+  for (; i < n; ++i) {
+    acc[i] += line[i];
+  }
+}
+
+// Normalize the box filter sums: out[i] = (acc[i] * d) >> 23.
+static inline void normRow(Guchar *out, Guint *acc, Guint d, int n) {
+  int i;
+
+#if SPLASH_SSE2
+  i = normRowx16(out, acc, d, n);
+#else
+  i = 0;
+#endif
+  for (; i < n; ++i) {
+    out[i] = (Guchar)((acc[i] * d) >> 23);
+  }
+}
+
 // Used by drawImage and fillImageMask to divide the target
 // quadrilateral into sections.
 struct ImageSection {
@@ -877,14 +1329,18 @@ void Splash::pipeRunSimpleMono8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->alphaRowSize + x0];
 
-  for (x = x0; x <= x1; ++x) {
-
-    //----- write destination pixel
-    *destColorPtr++ = state->grayTransfer[cSrcPtr[0]];
-    *destAlphaPtr++ = 255;
-
-    cSrcPtr += cSrcStride;
+  //----- write destination pixels
+  if (!cSrcStride) {
+    memset(destColorPtr, state->grayTransfer[cSrcPtr[0]], x1 - x0 + 1);
+  } else if (state->transferIsIdentity) {
+    memcpy(destColorPtr, cSrcPtr, x1 - x0 + 1);
+  } else {
+    for (x = x0; x <= x1; ++x) {
+      *destColorPtr++ = state->grayTransfer[cSrcPtr[0]];
+      cSrcPtr += cSrcStride;
+    }
   }
+  memset(destAlphaPtr, 255, x1 - x0 + 1);
 }
 
 // special case:
@@ -912,17 +1368,23 @@ void Splash::pipeRunSimpleRGB8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + 3 * x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->alphaRowSize + x0];
 
-  for (x = x0; x <= x1; ++x) {
-
-    //----- write destination pixel
-    destColorPtr[0] = state->rgbTransferR[cSrcPtr[0]];
-    destColorPtr[1] = state->rgbTransferG[cSrcPtr[1]];
-    destColorPtr[2] = state->rgbTransferB[cSrcPtr[2]];
-    destColorPtr += 3;
-    *destAlphaPtr++ = 255;
-
-    cSrcPtr += cSrcStride;
+  //----- write destination pixels
+  if (!cSrcStride) {
+    fillSpan3(destColorPtr, state->rgbTransferR[cSrcPtr[0]],
+	      state->rgbTransferG[cSrcPtr[1]],
+	      state->rgbTransferB[cSrcPtr[2]], x1 - x0 + 1);
+  } else if (state->transferIsIdentity) {
+    memcpy(destColorPtr, cSrcPtr, 3 * (x1 - x0 + 1));
+  } else {
+    for (x = x0; x <= x1; ++x) {
+      destColorPtr[0] = state->rgbTransferR[cSrcPtr[0]];
+      destColorPtr[1] = state->rgbTransferG[cSrcPtr[1]];
+      destColorPtr[2] = state->rgbTransferB[cSrcPtr[2]];
+      destColorPtr += 3;
+      cSrcPtr += cSrcStride;
+    }
   }
+  memset(destAlphaPtr, 255, x1 - x0 + 1);
 }
 
 // special case:
@@ -950,17 +1412,21 @@ void Splash::pipeRunSimpleBGR8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + 3 * x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->alphaRowSize + x0];
 
-  for (x = x0; x <= x1; ++x) {
-
-    //----- write destination pixel
-    destColorPtr[0] = state->rgbTransferB[cSrcPtr[2]];
-    destColorPtr[1] = state->rgbTransferG[cSrcPtr[1]];
-    destColorPtr[2] = state->rgbTransferR[cSrcPtr[0]];
-    destColorPtr += 3;
-    *destAlphaPtr++ = 255;
-
-    cSrcPtr += cSrcStride;
+  //----- write destination pixels
+  if (!cSrcStride) {
+    fillSpan3(destColorPtr, state->rgbTransferB[cSrcPtr[2]],
+	      state->rgbTransferG[cSrcPtr[1]],
+	      state->rgbTransferR[cSrcPtr[0]], x1 - x0 + 1);
+  } else {
+    for (x = x0; x <= x1; ++x) {
+      destColorPtr[0] = state->rgbTransferB[cSrcPtr[2]];
+      destColorPtr[1] = state->rgbTransferG[cSrcPtr[1]];
+      destColorPtr[2] = state->rgbTransferR[cSrcPtr[0]];
+      destColorPtr += 3;
+      cSrcPtr += cSrcStride;
+    }
   }
+  memset(destAlphaPtr, 255, x1 - x0 + 1);
 }
 
 #if SPLASH_CMYK
@@ -1098,6 +1564,9 @@ void Splash::pipeRunShapeMono8(SplashPipe *pipe, int x0, int x1, int y,
   SplashColorPtr destColorPtr;
   Guchar *destAlphaPtr;
   int cSrcStride, x, lastX;
+#if SPLASH_SSE2
+  int n, lastI;
+#endif
 
   if (cSrcPtr) {
     cSrcStride = 1;
@@ -1122,6 +1591,20 @@ void Splash::pipeRunShapeMono8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->alphaRowSize + x0];
 
+#if SPLASH_SSE2
+  //----- blocks of 8 pixels
+  lastI = 0;
+  n = shapeSpan1(shapePtr, cSrcPtr, cSrcStride, state->grayTransfer,
+		 state->transferIsIdentity, destColorPtr, destAlphaPtr,
+		 x1 - x0 + 1, &lastI);
+  lastX = x0 + lastI;
+  destColorPtr += n;
+  destAlphaPtr += n;
+  cSrcPtr += n * cSrcStride;
+  shapePtr += n;
+  x0 += n;
+#endif
+
   for (x = x0; x <= x1; ++x) {
 
     //----- shape
@@ -1191,6 +1674,9 @@ void Splash::pipeRunShapeRGB8(SplashPipe *pipe, int x0, int x1, int y,
   SplashColorPtr destColorPtr;
   Guchar *destAlphaPtr;
   int cSrcStride, x, lastX;
+#if SPLASH_SSE2
+  int n, lastI;
+#endif
 
   if (cSrcPtr) {
     cSrcStride = 3;
@@ -1215,6 +1701,21 @@ void Splash::pipeRunShapeRGB8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + 3 * x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->alphaRowSize + x0];
 
+#if SPLASH_SSE2
+  //----- blocks of 8 pixels
+  lastI = 0;
+  n = shapeSpan3(shapePtr, cSrcPtr, cSrcStride, state->rgbTransferR,
+		 state->rgbTransferG, state->rgbTransferB, 0, 2,
+		 state->transferIsIdentity, destColorPtr, destAlphaPtr,
+		 x1 - x0 + 1, &lastI);
+  lastX = x0 + lastI;
+  destColorPtr += 3 * n;
+  destAlphaPtr += n;
+  cSrcPtr += n * cSrcStride;
+  shapePtr += n;
+  x0 += n;
+#endif
+
   for (x = x0; x <= x1; ++x) {
 
     //----- shape
@@ -1297,6 +1798,9 @@ void Splash::pipeRunShapeBGR8(SplashPipe *pipe, int x0, int x1, int y,
   SplashColorPtr destColorPtr;
   Guchar *destAlphaPtr;
   int cSrcStride, x, lastX;
+#if SPLASH_SSE2
+  int n, lastI;
+#endif
 
   if (cSrcPtr) {
     cSrcStride = 3;
@@ -1321,6 +1825,20 @@ void Splash::pipeRunShapeBGR8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + 3 * x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->alphaRowSize + x0];
 
+#if SPLASH_SSE2
+  //----- blocks of 8 pixels
+  lastI = 0;
+  n = shapeSpan3(shapePtr, cSrcPtr, cSrcStride, state->rgbTransferB,
+		 state->rgbTransferG, state->rgbTransferR, 2, 0,
+		 gFalse, destColorPtr, destAlphaPtr, x1 - x0 + 1, &lastI);
+  lastX = x0 + lastI;
+  destColorPtr += 3 * n;
+  destAlphaPtr += n;
+  cSrcPtr += n * cSrcStride;
+  shapePtr += n;
+  x0 += n;
+#endif
+
   for (x = x0; x <= x1; ++x) {
 
     //----- shape
@@ -2011,6 +2529,9 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
   inShading = gFalse;
   state = new SplashState(bitmap->width, bitmap->height, vectorAntialias,
 			  screenParams);
+  if (bitmap->isBand()) {
+    state->clip->setHardYBounds(bitmap->bandY, bitmap->bandY + bitmap->bandH);
+  }
   scanBuf = (Guchar *)gmalloc(bitmap->width);
   if (bitmap->mode == splashModeMono1) {
     scanBuf2 = (Guchar *)gmalloc(bitmap->width);
@@ -2031,6 +2552,9 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
   inShading = gFalse;
   state = new SplashState(bitmap->width, bitmap->height, vectorAntialias,
 			  screenA);
+  if (bitmap->isBand()) {
+    state->clip->setHardYBounds(bitmap->bandY, bitmap->bandY + bitmap->bandH);
+  }
   scanBuf = (Guchar *)gmalloc(bitmap->width);
   if (bitmap->mode == splashModeMono1) {
     scanBuf2 = (Guchar *)gmalloc(bitmap->width);
@@ -2280,39 +2804,42 @@ SplashError Splash::restoreState() {
 //------------------------------------------------------------------------
 
 void Splash::clear(SplashColorPtr color, Guchar alpha) {
-  SplashColorPtr row, p;
+  SplashColorPtr data, row, p;
   Guchar mono;
   int x, y;
 
+  // only the band rows are allocated in a band bitmap
+  data = bitmap->data + bitmap->bandY * bitmap->rowSize;
+
   switch (bitmap->mode) {
   case splashModeMono1:
     mono = (color[0] & 0x80) ? 0xff : 0x00;
     if (bitmap->rowSize < 0) {
-      memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	     mono, -bitmap->rowSize * bitmap->height);
+      memset(data + bitmap->rowSize * (bitmap->bandH - 1),
+	     mono, -bitmap->rowSize * bitmap->bandH);
     } else {
-      memset(bitmap->data, mono, bitmap->rowSize * bitmap->height);
+      memset(data, mono, bitmap->rowSize * bitmap->bandH);
     }
     break;
   case splashModeMono8:
     if (bitmap->rowSize < 0) {
-      memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	     color[0], -bitmap->rowSize * bitmap->height);
+      memset(data + bitmap->rowSize * (bitmap->bandH - 1),
+	     color[0], -bitmap->rowSize * bitmap->bandH);
     } else {
-      memset(bitmap->data, color[0], bitmap->rowSize * bitmap->height);
+      memset(data, color[0], bitmap->rowSize * bitmap->bandH);
     }
     break;
   case splashModeRGB8:
     if (color[0] == color[1] && color[1] == color[2]) {
       if (bitmap->rowSize < 0) {
-	memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	       color[0], -bitmap->rowSize * bitmap->height);
+	memset(data + bitmap->rowSize * (bitmap->bandH - 1),
+	       color[0], -bitmap->rowSize * bitmap->bandH);
       } else {
-	memset(bitmap->data, color[0], bitmap->rowSize * bitmap->height);
+	memset(data, color[0], bitmap->rowSize * bitmap->bandH);
       }
     } else {
-      row = bitmap->data;
-      for (y = 0; y < bitmap->height; ++y) {
+      row = data;
+      for (y = 0; y < bitmap->bandH; ++y) {
 	p = row;
 	for (x = 0; x < bitmap->width; ++x) {
 	  *p++ = color[0];
@@ -2326,14 +2853,14 @@ void Splash::clear(SplashColorPtr color, Guchar alpha) {
   case splashModeBGR8:
     if (color[0] == color[1] && color[1] == color[2]) {
       if (bitmap->rowSize < 0) {
-	memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	       color[0], -bitmap->rowSize * bitmap->height);
+	memset(data + bitmap->rowSize * (bitmap->bandH - 1),
+	       color[0], -bitmap->rowSize * bitmap->bandH);
       } else {
-	memset(bitmap->data, color[0], bitmap->rowSize * bitmap->height);
+	memset(data, color[0], bitmap->rowSize * bitmap->bandH);
       }
     } else {
-      row = bitmap->data;
-      for (y = 0; y < bitmap->height; ++y) {
+      row = data;
+      for (y = 0; y < bitmap->bandH; ++y) {
 	p = row;
 	for (x = 0; x < bitmap->width; ++x) {
 	  *p++ = color[2];
@@ -2348,14 +2875,14 @@ void Splash::clear(SplashColorPtr color, Guchar alpha) {
   case splashModeCMYK8:
     if (color[0] == color[1] && color[1] == color[2] && color[2] == color[3]) {
       if (bitmap->rowSize < 0) {
-	memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	       color[0], -bitmap->rowSize * bitmap->height);
+	memset(data + bitmap->rowSize * (bitmap->bandH - 1),
+	       color[0], -bitmap->rowSize * bitmap->bandH);
       } else {
-	memset(bitmap->data, color[0], bitmap->rowSize * bitmap->height);
+	memset(data, color[0], bitmap->rowSize * bitmap->bandH);
       }
     } else {
-      row = bitmap->data;
-      for (y = 0; y < bitmap->height; ++y) {
+      row = data;
+      for (y = 0; y < bitmap->bandH; ++y) {
 	p = row;
 	for (x = 0; x < bitmap->width; ++x) {
 	  *p++ = color[0];
@@ -2371,13 +2898,14 @@ void Splash::clear(SplashColorPtr color, Guchar alpha) {
   }
 
   if (bitmap->alpha) {
-    memset(bitmap->alpha, alpha, bitmap->alphaRowSize * bitmap->height);
+    memset(bitmap->alpha + bitmap->bandY * bitmap->alphaRowSize, alpha,
+	   bitmap->alphaRowSize * bitmap->bandH);
   }
 
   updateModX(0);
-  updateModY(0);
+  updateModY(bitmap->bandY);
   updateModX(bitmap->width - 1);
-  updateModY(bitmap->height - 1);
+  updateModY(bitmap->bandY + bitmap->bandH - 1);
 }
 
 SplashError Splash::stroke(SplashPath *path) {
@@ -2498,7 +3026,7 @@ void Splash::strokeNarrow(SplashPath *path) {
   SplashPipe pipe;
   SplashXPath *xPath;
   SplashXPathSeg *seg;
-  int x0, x1, y0, y1, xa, xb, y;
+  int x0, x1, y0, y1, xa, xb, y, yMinI, yMaxI;
   SplashCoord dxdy;
   SplashClipResult clipRes;
   int nClipRes[3];
@@ -2538,19 +3066,33 @@ void Splash::strokeNarrow(SplashPath *path) {
 	}
       } else {
 	dxdy = seg->dxdy;
-	y = state->clip->getYMinI(state->strokeAdjust);
+	// the end points depend on the clip rect on the full page; with
+	// a band bitmap, only the rows yMinI .. yMaxI are drawn
+	y = state->clip->getPageYMinI(state->strokeAdjust);
 	if (y0 < y) {
 	  y0 = y;
 	  x0 = splashFloor(seg->x0 + ((SplashCoord)y0 - seg->y0) * dxdy);
 	}
-	y = state->clip->getYMaxI(state->strokeAdjust);
+	y = state->clip->getPageYMaxI(state->strokeAdjust);
 	if (y1 > y) {
 	  y1 = y;
 	  x1 = splashFloor(seg->x0 + ((SplashCoord)y1 - seg->y0) * dxdy);
 	}
+	yMinI = state->clip->getYMinI(state->strokeAdjust);
+	if (yMinI < y0) {
+	  yMinI = y0;
+	}
+	yMaxI = state->clip->getYMaxI(state->strokeAdjust);
+	if (yMaxI > y1) {
+	  yMaxI = y1;
+	}
 	if (x0 <= x1) {
-	  xa = x0;
-	  for (y = y0; y <= y1; ++y) {
+	  if (yMinI == y0) {
+	    xa = x0;
+	  } else {
+	    xa = splashFloor(seg->x0 + ((SplashCoord)yMinI - seg->y0) * dxdy);
+	  }
+	  for (y = yMinI; y <= yMaxI; ++y) {
 	    if (y < y1) {
 	      xb = splashFloor(seg->x0 +
 			       ((SplashCoord)y + 1 - seg->y0) * dxdy);
@@ -2566,8 +3108,12 @@ void Splash::strokeNarrow(SplashPath *path) {
 	    xa = xb;
 	  }
 	} else {
-	  xa = x0;
-	  for (y = y0; y <= y1; ++y) {
+	  if (yMinI == y0) {
+	    xa = x0;
+	  } else {
+	    xa = splashFloor(seg->x0 + ((SplashCoord)yMinI - seg->y0) * dxdy);
+	  }
+	  for (y = yMinI; y <= yMaxI; ++y) {
 	    if (y < y1) {
 	      xb = splashFloor(seg->x0 +
 			       ((SplashCoord)y + 1 - seg->y0) * dxdy);
@@ -3948,7 +4494,7 @@ void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
   Guint pix;
   Guchar *destPtr;
   int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, d, d0, d1;
-  int i, j;
+  int i;
 
   // Bresenham parameters for y scale
   yp = srcHeight / scaledHeight;
@@ -3980,9 +4526,7 @@ void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
     memset(pixBuf, 0, srcWidth * sizeof(int));
     for (i = 0; i < yStep; ++i) {
       (*src)(srcData, lineBuf);
-      for (j = 0; j < srcWidth; ++j) {
-	pixBuf[j] += lineBuf[j];
-      }
+      addRow(pixBuf, lineBuf, srcWidth);
     }
 
     // init x scale Bresenham
@@ -4026,10 +4570,10 @@ void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
 			   SplashBitmap *dest) {
   Guchar *lineBuf;
   Guint *pixBuf;
-  Guint pix;
+  Guchar pix;
   Guchar *destPtr;
   int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, d;
-  int i, j;
+  int i;
 
   // Bresenham parameters for y scale
   yp = srcHeight / scaledHeight;
@@ -4061,14 +4605,15 @@ void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
     memset(pixBuf, 0, srcWidth * sizeof(int));
     for (i = 0; i < yStep; ++i) {
       (*src)(srcData, lineBuf);
-      for (j = 0; j < srcWidth; ++j) {
-	pixBuf[j] += lineBuf[j];
-      }
+      addRow(pixBuf, lineBuf, srcWidth);
     }
 
+    // (255 * pixBuf[]) / yStep
+    d = (255 << 23) / yStep;
+    normRow(lineBuf, pixBuf, d, srcWidth);
+
     // init x scale Bresenham
     xt = 0;
-    d = (255 << 23) / yStep;
 
     for (x = 0; x < srcWidth; ++x) {
 
@@ -4080,14 +4625,10 @@ void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
 	xStep = xp;
       }
 
-      // compute the final pixel
-      pix = pixBuf[x];
-      // (255 * pix) / yStep
-      pix = (pix * d) >> 23;
-
       // store the pixel
+      pix = lineBuf[x];
       for (i = 0; i < xStep; ++i) {
-	*destPtr++ = (Guchar)pix;
+	*destPtr++ = pix;
       }
     }
   }
@@ -4102,7 +4643,7 @@ void Splash::scaleMaskYuXd(SplashImageMaskSource src, void *srcData,
 			   SplashBitmap *dest) {
   Guchar *lineBuf;
   Guint pix;
-  Guchar *destPtr0, *destPtr;
+  Guchar *destPtr0;
   int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, d, d0, d1;
   int i;
 
@@ -4161,12 +4702,13 @@ void Splash::scaleMaskYuXd(SplashImageMaskSource src, void *srcData,
       pix = (pix * d) >> 23;
 
       // store the pixel
-      for (i = 0; i < yStep; ++i) {
-	destPtr = destPtr0 + i * scaledWidth + x;
-	*destPtr = (Guchar)pix;
-      }
+      destPtr0[x] = (Guchar)pix;
     }
 
+    // duplicate the row vertically
+    for (i = 1; i < yStep; ++i) {
+      memcpy(destPtr0 + i * scaledWidth, destPtr0, scaledWidth);
+    }
     destPtr0 += yStep * scaledWidth;
   }
 
@@ -5088,6 +5630,7 @@ void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
 			    SplashBitmap *dest) {
   Guchar *lineBuf, *alphaLineBuf;
   Guint *pixBuf, *alphaPixBuf;
+  int *xSteps;
   Guint pix0, pix1, pix2;
 #if SPLASH_CMYK
   Guint pix3;
@@ -5095,7 +5638,7 @@ void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
   Guint alpha;
   Guchar *destPtr, *destAlphaPtr;
   int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, xxa, d, d0, d1;
-  int i, j;
+  int i;
 
   // Bresenham parameters for y scale
   yp = srcHeight / scaledHeight;
@@ -5116,6 +5659,18 @@ void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
     alphaPixBuf = NULL;
   }
 
+  // the x scale Bresenham steps are the same for every row
+  xSteps = (int *)gmallocn(scaledWidth, sizeof(int));
+  xt = 0;
+  for (x = 0; x < scaledWidth; ++x) {
+    if ((xt += xq) >= scaledWidth) {
+      xt -= scaledWidth;
+      xSteps[x] = xp + 1;
+    } else {
+      xSteps[x] = xp;
+    }
+  }
+
   // init y scale Bresenham
   yt = 0;
 
@@ -5138,53 +5693,35 @@ void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
     }
     for (i = 0; i < yStep; ++i) {
       (*src)(srcData, lineBuf, alphaLineBuf);
-      for (j = 0; j < srcWidth * nComps; ++j) {
-	pixBuf[j] += lineBuf[j];
-      }
+      addRow(pixBuf, lineBuf, srcWidth * nComps);
       if (srcAlpha) {
-	for (j = 0; j < srcWidth; ++j) {
-	  alphaPixBuf[j] += alphaLineBuf[j];
-	}
+	addRow(alphaPixBuf, alphaLineBuf, srcWidth);
       }
     }
 
-    // init x scale Bresenham
-    xt = 0;
+    // init x scale
     d0 = (1 << 23) / (yStep * xp);
     d1 = (1 << 23) / (yStep * (xp + 1));
 
-    xx = xxa = 0;
-    for (x = 0; x < scaledWidth; ++x) {
-
-      // x scale Bresenham
-      if ((xt += xq) >= scaledWidth) {
-	xt -= scaledWidth;
-	xStep = xp + 1;
-	d = d1;
-      } else {
-	xStep = xp;
-	d = d0;
-      }
-
-      switch (srcMode) {
-
-      case splashModeMono8:
+    // compute the final pixels: pix / xStep * yStep
+    xx = 0;
+    switch (srcMode) {
 
-	// compute the final pixel
+    case splashModeMono8:
+      for (x = 0; x < scaledWidth; ++x) {
+	xStep = xSteps[x];
 	pix0 = 0;
 	for (i = 0; i < xStep; ++i) {
 	  pix0 += pixBuf[xx++];
 	}
-	// pix / xStep * yStep
-	pix0 = (pix0 * d) >> 23;
-
-	// store the pixel
-	*destPtr++ = (Guchar)pix0;
-	break;
-
-      case splashModeRGB8:
+	d = xStep == xp ? d0 : d1;
+	*destPtr++ = (Guchar)((pix0 * d) >> 23);
+      }
+      break;
 
-	// compute the final pixel
+    case splashModeRGB8:
+      for (x = 0; x < scaledWidth; ++x) {
+	xStep = xSteps[x];
 	pix0 = pix1 = pix2 = 0;
 	for (i = 0; i < xStep; ++i) {
 	  pix0 += pixBuf[xx];
@@ -5192,21 +5729,17 @@ void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
 	  pix2 += pixBuf[xx+2];
 	  xx += 3;
 	}
-	// pix / xStep * yStep
-	pix0 = (pix0 * d) >> 23;
-	pix1 = (pix1 * d) >> 23;
-	pix2 = (pix2 * d) >> 23;
-
-	// store the pixel
-	*destPtr++ = (Guchar)pix0;
-	*destPtr++ = (Guchar)pix1;
-	*destPtr++ = (Guchar)pix2;
-	break;
+	d = xStep == xp ? d0 : d1;
+	*destPtr++ = (Guchar)((pix0 * d) >> 23);
+	*destPtr++ = (Guchar)((pix1 * d) >> 23);
+	*destPtr++ = (Guchar)((pix2 * d) >> 23);
+      }
+      break;
 
 #if SPLASH_CMYK
-      case splashModeCMYK8:
-
-	// compute the final pixel
+    case splashModeCMYK8:
+      for (x = 0; x < scaledWidth; ++x) {
+	xStep = xSteps[x];
 	pix0 = pix1 = pix2 = pix3 = 0;
 	for (i = 0; i < xStep; ++i) {
 	  pix0 += pixBuf[xx];
@@ -5215,40 +5748,37 @@ void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
 	  pix3 += pixBuf[xx+3];
 	  xx += 4;
 	}
-	// pix / xStep * yStep
-	pix0 = (pix0 * d) >> 23;
-	pix1 = (pix1 * d) >> 23;
-	pix2 = (pix2 * d) >> 23;
-	pix3 = (pix3 * d) >> 23;
-
-	// store the pixel
-	*destPtr++ = (Guchar)pix0;
-	*destPtr++ = (Guchar)pix1;
-	*destPtr++ = (Guchar)pix2;
-	*destPtr++ = (Guchar)pix3;
-	break;
+	d = xStep == xp ? d0 : d1;
+	*destPtr++ = (Guchar)((pix0 * d) >> 23);
+	*destPtr++ = (Guchar)((pix1 * d) >> 23);
+	*destPtr++ = (Guchar)((pix2 * d) >> 23);
+	*destPtr++ = (Guchar)((pix3 * d) >> 23);
+      }
+      break;
 #endif
 
+    case splashModeMono1: // mono1 is not allowed
+    case splashModeBGR8: // bgr8 is not allowed
+    default:
+      break;
+    }
 
-      case splashModeMono1: // mono1 is not allowed
-      case splashModeBGR8: // bgr8 is not allowed
-      default:
-	break;
-      }
-
-      // process alpha
-      if (srcAlpha) {
+    // process alpha: alpha / xStep * yStep
+    if (srcAlpha) {
+      xxa = 0;
+      for (x = 0; x < scaledWidth; ++x) {
+	xStep = xSteps[x];
 	alpha = 0;
 	for (i = 0; i < xStep; ++i, ++xxa) {
 	  alpha += alphaPixBuf[xxa];
 	}
-	// alpha / xStep * yStep
-	alpha = (alpha * d) >> 23;
-	*destAlphaPtr++ = (Guchar)alpha;
+	d = xStep == xp ? d0 : d1;
+	*destAlphaPtr++ = (Guchar)((alpha * d) >> 23);
       }
     }
   }
 
+  gfree(xSteps);
   gfree(alphaPixBuf);
   gfree(alphaLineBuf);
   gfree(pixBuf);
@@ -5262,11 +5792,10 @@ void Splash::scaleImageYdXu(SplashImageSource src, void *srcData,
 			    SplashBitmap *dest) {
   Guchar *lineBuf, *alphaLineBuf;
   Guint *pixBuf, *alphaPixBuf;
-  Guint pix[splashMaxColorComps];
-  Guint alpha;
-  Guchar *destPtr, *destAlphaPtr;
+  Guchar alpha;
+  Guchar *srcPtr, *destPtr, *destAlphaPtr;
   int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, d;
-  int i, j;
+  int i;
 
   // Bresenham parameters for y scale
   yp = srcHeight / scaledHeight;
@@ -5287,12 +5816,6 @@ void Splash::scaleImageYdXu(SplashImageSource src, void *srcData,
     alphaPixBuf = NULL;
   }
 
-  // make gcc happy
-  pix[0] = pix[1] = pix[2] = 0;
-#if SPLASH_CMYK
-  pix[3] = 0;
-#endif
-
   // init y scale Bresenham
   yt = 0;
 
@@ -5315,19 +5838,21 @@ void Splash::scaleImageYdXu(SplashImageSource src, void *srcData,
     }
     for (i = 0; i < yStep; ++i) {
       (*src)(srcData, lineBuf, alphaLineBuf);
-      for (j = 0; j < srcWidth * nComps; ++j) {
-	pixBuf[j] += lineBuf[j];
-      }
+      addRow(pixBuf, lineBuf, srcWidth * nComps);
       if (srcAlpha) {
-	for (j = 0; j < srcWidth; ++j) {
-	  alphaPixBuf[j] += alphaLineBuf[j];
-	}
+	addRow(alphaPixBuf, alphaLineBuf, srcWidth);
       }
     }
 
+    // pixBuf[] / yStep
+    d = (1 << 23) / yStep;
+    normRow(lineBuf, pixBuf, d, srcWidth * nComps);
+    if (srcAlpha) {
+      normRow(alphaLineBuf, alphaPixBuf, d, srcWidth);
+    }
+
     // init x scale Bresenham
     xt = 0;
-    d = (1 << 23) / yStep;
 
     for (x = 0; x < srcWidth; ++x) {
 
@@ -5339,33 +5864,28 @@ void Splash::scaleImageYdXu(SplashImageSource src, void *srcData,
 	xStep = xp;
       }
 
-      // compute the final pixel
-      for (i = 0; i < nComps; ++i) {
-	// pixBuf[] / yStep
-	pix[i] = (pixBuf[x * nComps + i] * d) >> 23;
-      }
-
       // store the pixel
+      srcPtr = lineBuf + x * nComps;
       switch (srcMode) {
       case splashModeMono8:
 	for (i = 0; i < xStep; ++i) {
-	  *destPtr++ = (Guchar)pix[0];
+	  *destPtr++ = srcPtr[0];
 	}
 	break;
       case splashModeRGB8:
 	for (i = 0; i < xStep; ++i) {
-	  *destPtr++ = (Guchar)pix[0];
-	  *destPtr++ = (Guchar)pix[1];
-	  *destPtr++ = (Guchar)pix[2];
+	  *destPtr++ = srcPtr[0];
+	  *destPtr++ = srcPtr[1];
+	  *destPtr++ = srcPtr[2];
 	}
 	break;
 #if SPLASH_CMYK
       case splashModeCMYK8:
 	for (i = 0; i < xStep; ++i) {
-	  *destPtr++ = (Guchar)pix[0];
-	  *destPtr++ = (Guchar)pix[1];
-	  *destPtr++ = (Guchar)pix[2];
-	  *destPtr++ = (Guchar)pix[3];
+	  *destPtr++ = srcPtr[0];
+	  *destPtr++ = srcPtr[1];
+	  *destPtr++ = srcPtr[2];
+	  *destPtr++ = srcPtr[3];
 	}
 	break;
 #endif
@@ -5377,8 +5897,7 @@ void Splash::scaleImageYdXu(SplashImageSource src, void *srcData,
 
       // process alpha
       if (srcAlpha) {
-	// alphaPixBuf[] / yStep
-	alpha = (alphaPixBuf[x] * d) >> 23;
+	alpha = alphaLineBuf[x];
 	for (i = 0; i < xStep; ++i) {
 	  *destAlphaPtr++ = (Guchar)alpha;
 	}
@@ -5400,7 +5919,7 @@ void Splash::scaleImageYuXd(SplashImageSource src, void *srcData,
   Guchar *lineBuf, *alphaLineBuf;
   Guint pix[splashMaxColorComps];
   Guint alpha;
-  Guchar *destPtr0, *destPtr, *destAlphaPtr0, *destAlphaPtr;
+  Guchar *destPtr, *destAlphaPtr;
   int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, xxa, d, d0, d1;
   int i, j;
 
@@ -5429,8 +5948,8 @@ void Splash::scaleImageYuXd(SplashImageSource src, void *srcData,
   // init y scale Bresenham
   yt = 0;
 
-  destPtr0 = dest->data;
-  destAlphaPtr0 = dest->alpha;
+  destPtr = dest->data;
+  destAlphaPtr = dest->alpha;
   for (y = 0; y < srcHeight; ++y) {
 
     // y scale Bresenham
@@ -5477,36 +5996,8 @@ void Splash::scaleImageYuXd(SplashImageSource src, void *srcData,
       }
 
       // store the pixel
-      switch (srcMode) {
-      case splashModeMono8:
-	for (i = 0; i < yStep; ++i) {
-	  destPtr = destPtr0 + (i * scaledWidth + x) * nComps;
-	  *destPtr++ = (Guchar)pix[0];
-	}
-	break;
-      case splashModeRGB8:
-	for (i = 0; i < yStep; ++i) {
-	  destPtr = destPtr0 + (i * scaledWidth + x) * nComps;
-	  *destPtr++ = (Guchar)pix[0];
-	  *destPtr++ = (Guchar)pix[1];
-	  *destPtr++ = (Guchar)pix[2];
-	}
-	break;
-#if SPLASH_CMYK
-      case splashModeCMYK8:
-	for (i = 0; i < yStep; ++i) {
-	  destPtr = destPtr0 + (i * scaledWidth + x) * nComps;
-	  *destPtr++ = (Guchar)pix[0];
-	  *destPtr++ = (Guchar)pix[1];
-	  *destPtr++ = (Guchar)pix[2];
-	  *destPtr++ = (Guchar)pix[3];
-	}
-	break;
-#endif
-      case splashModeMono1: // mono1 is not allowed
-      case splashModeBGR8: // BGR8 is not allowed
-      default:
-	break;
+      for (i = 0; i < nComps; ++i) {
+	*destPtr++ = (Guchar)pix[i];
       }
 
       // process alpha
@@ -5517,16 +6008,21 @@ void Splash::scaleImageYuXd(SplashImageSource src, void *srcData,
 	}
 	// alpha / xStep
 	alpha = (alpha * d) >> 23;
-	for (i = 0; i < yStep; ++i) {
-	  destAlphaPtr = destAlphaPtr0 + i * scaledWidth + x;
-	  *destAlphaPtr = (Guchar)alpha;
-	}
+	*destAlphaPtr++ = (Guchar)alpha;
       }
     }
 
-    destPtr0 += yStep * scaledWidth * nComps;
+    // duplicate the row vertically
+    for (i = 1; i < yStep; ++i) {
+      memcpy(destPtr, destPtr - scaledWidth * nComps,
+	     scaledWidth * nComps);
+      destPtr += scaledWidth * nComps;
+    }
     if (srcAlpha) {
-      destAlphaPtr0 += yStep * scaledWidth;
+      for (i = 1; i < yStep; ++i) {
+	memcpy(destAlphaPtr, destAlphaPtr - scaledWidth, scaledWidth);
+	destAlphaPtr += scaledWidth;
+      }
     }
   }
 
@@ -5936,6 +6432,14 @@ void Splash::blitImage(SplashBitmap *src, GBool srcAlpha, int xDest, int yDest,
       if ((y1 = splashFloor(state->clip->getYMax()) - yDest) > h) {
 	y1 = h; 
      }
+      // the clip rectangle covers the whole page, not just the band
+      // of a band bitmap
+      if (y0 < bitmap->bandY - yDest) {
+	y0 = bitmap->bandY - yDest;
+      }
+      if (y1 > bitmap->bandY + bitmap->bandH - yDest) {
+	y1 = bitmap->bandY + bitmap->bandH - yDest;
+      }
       if (y1 < y0) {
 	y1 = y0;
       }
@@ -5993,13 +6497,13 @@ void Splash::blitImageClipped(SplashBitmap *src, GBool srcAlpha,
   if (xDest + w > bitmap->width) {
     w = bitmap->width - xDest;
   }
-  if (yDest < 0) {
-    ySrc -= yDest;
-    h += yDest;
-    yDest = 0;
+  if (yDest < bitmap->bandY) {
+    ySrc += bitmap->bandY - yDest;
+    h -= bitmap->bandY - yDest;
+    yDest = bitmap->bandY;
   }
-  if (yDest + h > bitmap->height) {
-    h = bitmap->height - yDest;
+  if (yDest + h > bitmap->bandY + bitmap->bandH) {
+    h = bitmap->bandY + bitmap->bandH - yDest;
   }
   if (w <= 0 || h <= 0) {
     return;
@@ -6057,6 +6561,11 @@ SplashError Splash::composite(SplashBitmap *src, int xSrc, int ySrc,
     return splashErrModeMismatch;
   }
 
+  // a band bitmap only has the band rows
+  if (!limitToBands(src, &ySrc, bitmap, &yDest, &h)) {
+    return splashOk;
+  }
+
   pipeInit(&pipe, NULL,
 	   (Guchar)splashRound(state->fillAlpha * 255),
 	   !noClip || src->alpha != NULL, nonIsolated);
@@ -6341,12 +6850,14 @@ void Splash::compositeBackground(SplashColorPtr color) {
 #if SPLASH_CMYK
   Guchar color3;
 #endif
-  int x, y;
+  int x, y, yMin, yMax;
 
+  yMin = bitmap->bandY;
+  yMax = bitmap->bandY + bitmap->bandH;
   switch (bitmap->mode) {
   case splashModeMono1:
     color0 = color[0];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = yMin; y < yMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->alphaRowSize];
       mask = 0x80;
@@ -6377,10 +6888,16 @@ void Splash::compositeBackground(SplashColorPtr color) {
     break;
   case splashModeMono8:
     color0 = color[0];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = yMin; y < yMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->alphaRowSize];
-      for (x = 0; x < bitmap->width; ++x) {
+      x = 0;
+#if SPLASH_SSE2
+      x = backgroundSpan1(p, q, color0, bitmap->width);
+      p += x;
+      q += x;
+#endif
+      for (; x < bitmap->width; ++x) {
 	alpha = *q++;
 	if (alpha == 0) {
 	  p[0] = color0;
@@ -6397,10 +6914,16 @@ void Splash::compositeBackground(SplashColorPtr color) {
     color0 = color[0];
     color1 = color[1];
     color2 = color[2];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = yMin; y < yMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->alphaRowSize];
-      for (x = 0; x < bitmap->width; ++x) {
+      x = 0;
+#if SPLASH_SSE2
+      x = backgroundSpan3(p, q, color, bitmap->width);
+      p += 3 * x;
+      q += x;
+#endif
+      for (; x < bitmap->width; ++x) {
 	alpha = *q++;
 	if (alpha == 0) {
 	  p[0] = color0;
@@ -6422,7 +6945,7 @@ void Splash::compositeBackground(SplashColorPtr color) {
     color1 = color[1];
     color2 = color[2];
     color3 = color[3];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = yMin; y < yMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->alphaRowSize];
       for (x = 0; x < bitmap->width; ++x) {
@@ -6445,7 +6968,8 @@ void Splash::compositeBackground(SplashColorPtr color) {
     break;
 #endif
   }
-  memset(bitmap->alpha, 255, bitmap->alphaRowSize * bitmap->height);
+  memset(bitmap->alpha + yMin * bitmap->alphaRowSize, 255,
+	 bitmap->alphaRowSize * (yMax - yMin));
 }
 
 SplashError Splash::blitTransparent(SplashBitmap *src, int xSrc, int ySrc,
@@ -6457,6 +6981,9 @@ SplashError Splash::blitTransparent(SplashBitmap *src, int xSrc, int ySrc,
   if (src->mode != bitmap->mode) {
     return splashErrModeMismatch;
   }
+  if (!limitToBands(src, &ySrc, bitmap, &yDest, &h)) {
+    return splashOk;
+  }
 
   switch (bitmap->mode) {
   case splashModeMono1:
@@ -6531,6 +7058,9 @@ SplashError Splash::blitCorrectedAlpha(SplashBitmap *dest, int xSrc, int ySrc,
       !groupBackBitmap) {
     return splashErrModeMismatch;
   }
+  if (!limitToBands(bitmap, &ySrc, dest, &yDest, &h)) {
+    return splashOk;
+  }
 
   switch (bitmap->mode) {
   case splashModeMono1:
@@ -7148,6 +7678,11 @@ SplashClipResult Splash::limitRectToClipRect(int *xMin, int *yMin,
 			       state->strokeAdjust);
 }
 
+void Splash::getPageClipYBounds(int *yMin, int *yMax) {
+  *yMin = state->clip->getPageYMinI(state->strokeAdjust);
+  *yMax = state->clip->getPageYMaxI(state->strokeAdjust) + 1;
+}
+
 void Splash::dumpPath(SplashPath *path) {
   int i;
 
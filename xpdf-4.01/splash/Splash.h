@@ -234,6 +234,11 @@ public:
   SplashClipResult limitRectToClipRect(int *xMin, int *yMin,
 				       int *xMax, int *yMax);
 
+  // Get the rows [*yMin, *yMax) of the clip rectangle on the full
+  // page -- when drawing into a band bitmap, limitRectToClipRect
+  // also limits the rectangle to the band.
+  void getPageClipYBounds(int *yMin, int *yMax);
+
   // Return the associated bitmap.
   SplashBitmap *getBitmap() { return bitmap; }
 
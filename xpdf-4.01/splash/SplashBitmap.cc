@@ -25,12 +25,23 @@
 
 SplashBitmap::SplashBitmap(int widthA, int heightA, int rowPad,
 			   SplashColorMode modeA, GBool alphaA,
-			   GBool topDown) {
+			   GBool topDown, int bandYA, int bandHA) {
   // NB: this code checks that rowSize fits in a signed 32-bit
   // integer, because some code (outside this class) makes that
   // assumption
   width = widthA;
   height = heightA;
+  if (bandHA < 0) {
+    bandY = 0;
+    bandH = height;
+  } else {
+    bandY = bandYA;
+    bandH = bandHA;
+    if (bandY < 0 || bandY > height - bandH) {
+      gMemError("invalid bitmap band");
+    }
+    topDown = gTrue;
+  }
   mode = modeA;
   switch (mode) {
   case splashModeMono1:
@@ -63,14 +74,18 @@ SplashBitmap::SplashBitmap(int widthA, int heightA, int rowPad,
   }
   rowSize += rowPad - 1;
   rowSize -= rowSize % rowPad;
-  data = (SplashColorPtr)gmallocn64(height, rowSize);
+  data = (SplashColorPtr)gmallocn64(bandH > 0 ? bandH : 1, rowSize);
+  // NB: for band bitmaps, data points to (unallocated) row zero of the
+  // page, so that page coordinates can be used unchanged
+  data -= bandY * rowSize;
   if (!topDown) {
     data += (height - 1) * rowSize;
     rowSize = -rowSize;
   }
   if (alphaA) {
     alphaRowSize = width;
-    alpha = (Guchar *)gmallocn64(height, alphaRowSize);
+    alpha = (Guchar *)gmallocn64(bandH > 0 ? bandH : 1, alphaRowSize);
+    alpha -= bandY * alphaRowSize;
   } else {
     alphaRowSize = 0;
     alpha = NULL;
@@ -82,10 +97,12 @@ SplashBitmap::~SplashBitmap() {
     if (rowSize < 0) {
       gfree(data + (height - 1) * rowSize);
     } else {
-      gfree(data);
+      gfree(data + bandY * rowSize);
     }
   }
-  gfree(alpha);
+  if (alpha) {
+    gfree(alpha + bandY * alphaRowSize);
+  }
 }
 
 SplashError SplashBitmap::writePNMFile(char *fileName) {
@@ -101,15 +118,56 @@ SplashError SplashBitmap::writePNMFile(char *fileName) {
 }
 
 SplashError SplashBitmap::writePNMFile(FILE *f) {
+  SplashError err;
+
+  if ((err = writePNMHeader(f)) != splashOk) {
+    return err;
+  }
+  return writePNMRows(f);
+}
+
+SplashError SplashBitmap::writePNMHeader(FILE *f) {
+  switch (mode) {
+
+  case splashModeMono1:
+    fprintf(f, "P4\n%d %d\n", width, height);
+    break;
+
+  case splashModeMono8:
+    fprintf(f, "P5\n%d %d\n255\n", width, height);
+    break;
+
+  case splashModeRGB8:
+  case splashModeBGR8:
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    break;
+
+#if SPLASH_CMYK
+  case splashModeCMYK8:
+    fprintf(f, "P7\n");
+    fprintf(f, "WIDTH %d\n", width);
+    fprintf(f, "HEIGHT %d\n", height);
+    fprintf(f, "DEPTH 4\n");
+    fprintf(f, "MAXVAL 255\n");
+    fprintf(f, "TUPLTYPE CMYK\n");
+    fprintf(f, "ENDHDR\n");
+    break;
+#endif
+
+  }
+
+  return splashOk;
+}
+
+SplashError SplashBitmap::writePNMRows(FILE *f) {
   SplashColorPtr row, p;
   int x, y;
 
+  row = data + bandY * rowSize;
   switch (mode) {
 
   case splashModeMono1:
-    fprintf(f, "P4\n%d %d\n", width, height);
-    row = data;
-    for (y = 0; y < height; ++y) {
+    for (y = 0; y < bandH; ++y) {
       p = row;
       for (x = 0; x < width; x += 8) {
 	fputc(*p ^ 0xff, f);
@@ -120,27 +178,21 @@ SplashError SplashBitmap::writePNMFile(FILE *f) {
     break;
 
   case splashModeMono8:
-    fprintf(f, "P5\n%d %d\n255\n", width, height);
-    row = data;
-    for (y = 0; y < height; ++y) {
+    for (y = 0; y < bandH; ++y) {
       fwrite(row, 1, width, f);
       row += rowSize;
     }
     break;
 
   case splashModeRGB8:
-    fprintf(f, "P6\n%d %d\n255\n", width, height);
-    row = data;
-    for (y = 0; y < height; ++y) {
+    for (y = 0; y < bandH; ++y) {
       fwrite(row, 1, 3 * width, f);
       row += rowSize;
     }
     break;
 
   case splashModeBGR8:
-    fprintf(f, "P6\n%d %d\n255\n", width, height);
-    row = data;
-    for (y = 0; y < height; ++y) {
+    for (y = 0; y < bandH; ++y) {
       p = row;
       for (x = 0; x < width; ++x) {
 	fputc(splashBGR8R(p), f);
@@ -154,15 +206,7 @@ SplashError SplashBitmap::writePNMFile(FILE *f) {
 
 #if SPLASH_CMYK
   case splashModeCMYK8:
-    fprintf(f, "P7\n");
-    fprintf(f, "WIDTH %d\n", width);
-    fprintf(f, "HEIGHT %d\n", height);
-    fprintf(f, "DEPTH 4\n");
-    fprintf(f, "MAXVAL 255\n");
-    fprintf(f, "TUPLTYPE CMYK\n");
-    fprintf(f, "ENDHDR\n");
-    row = data;
-    for (y = 0; y < height; ++y) {
+    for (y = 0; y < bandH; ++y) {
       fwrite(row, 1, 4 * width, f);
       row += rowSize;
     }
@@ -193,7 +237,7 @@ SplashError SplashBitmap::writeAlphaPGMFile(char *fileName) {
 void SplashBitmap::getPixel(int x, int y, SplashColorPtr pixel) {
   SplashColorPtr p;
 
-  if (y < 0 || y >= height || x < 0 || x >= width) {
+  if (y < bandY || y >= bandY + bandH || x < 0 || x >= width) {
     return;
   }
   switch (mode) {
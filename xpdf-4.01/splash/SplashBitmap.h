@@ -42,9 +42,16 @@ public:
   // color mode <modeA>.  Rows will be padded out to a multiple of
   // <rowPad> bytes.  If <topDown> is false, the bitmap will be stored
   // upside-down, i.e., with the last row first in memory.
+  //
+  // If <bandHA> is non-negative, this is a band bitmap: only rows
+  // <bandYA> .. <bandYA> + <bandHA> - 1 of the <heightA>-row page are
+  // allocated, but rows are still addressed in page coordinates, i.e.,
+  // data + y * rowSize is row y of the page.  Band bitmaps are always
+  // top-down.  Rows outside the band must not be accessed.  The band
+  // may be empty (<bandHA> = 0).
   SplashBitmap(int widthA, int heightA, int rowPad,
 	       SplashColorMode modeA, GBool alphaA,
-	       GBool topDown = gTrue);
+	       GBool topDown = gTrue, int bandYA = 0, int bandHA = -1);
 
   ~SplashBitmap();
 
@@ -55,9 +62,18 @@ public:
   SplashColorMode getMode() { return mode; }
   SplashColorPtr getDataPtr() { return data; }
   Guchar *getAlphaPtr() { return alpha; }
+  GBool isBand() { return bandH != height; }
+  int getBandY() { return bandY; }
+  int getBandHeight() { return bandH; }
 
   SplashError writePNMFile(char *fileName);
   SplashError writePNMFile(FILE *f);
+
+  // Write a PNM file in pieces: the header (for the full page), then
+  // the allocated rows.  For band bitmaps, call writePNMRows with
+  // each band, top to bottom.
+  SplashError writePNMHeader(FILE *f);
+  SplashError writePNMRows(FILE *f);
   SplashError writeAlphaPGMFile(char *fileName);
 
   void getPixel(int x, int y, SplashColorPtr pixel);
@@ -65,12 +81,14 @@ public:
 
   // Caller takes ownership of the bitmap data.  The SplashBitmap
   // object is no longer valid -- the next call should be to the
-  // destructor.
+  // destructor.  Not allowed for band bitmaps.
   SplashColorPtr takeData();
 
 private:
 
   int width, height;		// size of bitmap
+  int bandY, bandH;		// allocated rows (0 and height, except
+				//   for band bitmaps)
   SplashBitmapRowSize rowSize;	// size of one row of data, in bytes
 				//   - negative for bottom-up bitmaps
   size_t alphaRowSize;		// size of one row of alpha, in bytes
@@ -44,6 +44,8 @@ SplashClip::SplashClip(int hardXMinA, int hardYMinA,
   hardYMin = hardYMinA;
   hardXMax = hardXMaxA;
   hardYMax = hardYMaxA;
+  pageYMin = hardYMin;
+  pageYMax = hardYMax;
   xMin = hardXMin;
   yMin = hardYMin;
   xMax = hardXMax;
@@ -68,6 +70,8 @@ SplashClip::SplashClip(SplashClip *clip) {
   hardYMin = clip->hardYMin;
   hardXMax = clip->hardXMax;
   hardYMax = clip->hardYMax;
+  pageYMin = clip->pageYMin;
+  pageYMax = clip->pageYMax;
   xMin = clip->xMin;
   yMin = clip->yMin;
   xMax = clip->xMax;
@@ -76,6 +80,8 @@ SplashClip::SplashClip(SplashClip *clip) {
   yMinI = clip->yMinI;
   xMaxI = clip->xMaxI;
   yMaxI = clip->yMaxI;
+  pageYMinI = clip->pageYMinI;
+  pageYMaxI = clip->pageYMaxI;
   intBoundsValid = clip->intBoundsValid;
   intBoundsStrokeAdjust = clip->intBoundsStrokeAdjust;
   paths = NULL;
@@ -118,6 +124,12 @@ void SplashClip::grow(int nPaths) {
   }
 }
 
+void SplashClip::setHardYBounds(int hardYMinA, int hardYMaxA) {
+  hardYMin = hardYMinA;
+  hardYMax = hardYMaxA;
+  intBoundsValid = gFalse;
+}
+
 void SplashClip::resetToRect(SplashCoord x0, SplashCoord y0,
 			     SplashCoord x1, SplashCoord y1) {
   int w, i;
@@ -290,14 +302,20 @@ SplashClipResult SplashClip::testRect(int rectXMin, int rectYMin,
     if ((SplashCoord)(rectXMax + 1) <= xMin ||
 	(SplashCoord)rectXMin >= xMax ||
 	(SplashCoord)(rectYMax + 1) <= yMin ||
-	(SplashCoord)rectYMin >= yMax) {
+	(SplashCoord)rectYMin >= yMax ||
+	rectYMax < hardYMin ||
+	rectYMin >= hardYMax) {
       return splashClipAllOutside;
     }
+    // NB: the hard bounds only matter for band bitmaps -- otherwise
+    // the rectangle is always inside them
     if (isSimple &&
 	(SplashCoord)rectXMin >= xMin &&
 	(SplashCoord)(rectXMax + 1) <= xMax &&
 	(SplashCoord)rectYMin >= yMin &&
-	(SplashCoord)(rectYMax + 1) <= yMax) {
+	(SplashCoord)(rectYMax + 1) <= yMax &&
+	rectYMin >= hardYMin &&
+	rectYMax < hardYMax) {
       return splashClipAllInside;
     }
   }
@@ -355,8 +373,9 @@ void SplashClip::clipSpan(Guchar *line, int y, int x0, int x1,
       line[x1a] = (Guchar)(int)((SplashCoord)line[x1a] * d);
     }
 
-    // clip top edge (yMin)
-    if (y == yMinI) {
+    // clip top edge (yMin) -- unless it was moved to the hard
+    // bounds of a band bitmap
+    if (y == yMinI && yMin >= (SplashCoord)yMinI) {
       d = (SplashCoord)(yMinI + 1) - yMin;
       for (x = x0a; x <= x1a; ++x) {
 	line[x] = (Guchar)(int)((SplashCoord)line[x] * d);
@@ -364,7 +383,7 @@ void SplashClip::clipSpan(Guchar *line, int y, int x0, int x1,
     }
 
     // clip bottom edge (yMax)
-    if (y == yMaxI) {
+    if (y == yMaxI && yMax <= (SplashCoord)(yMaxI + 1)) {
       d = yMax - (SplashCoord)yMaxI;
       for (x = x0a; x <= x1a; ++x) {
 	line[x] = (Guchar)(int)((SplashCoord)line[x] * d);
@@ -477,6 +496,16 @@ int SplashClip::getYMaxI(SplashStrokeAdjustMode strokeAdjust) {
   return yMaxI;
 }
 
+int SplashClip::getPageYMinI(SplashStrokeAdjustMode strokeAdjust) {
+  updateIntBounds(strokeAdjust);
+  return pageYMinI;
+}
+
+int SplashClip::getPageYMaxI(SplashStrokeAdjustMode strokeAdjust) {
+  updateIntBounds(strokeAdjust);
+  return pageYMaxI;
+}
+
 int SplashClip::getNumPaths() {
   SplashClip *clip;
   int n;
@@ -501,6 +530,8 @@ void SplashClip::updateIntBounds(SplashStrokeAdjustMode strokeAdjust) {
     xMaxI = splashCeil(xMax);
     yMaxI = splashCeil(yMax);
   }
+  pageYMinI = yMinI < pageYMin ? pageYMin : yMinI;
+  pageYMaxI = (yMaxI > pageYMax ? pageYMax : yMaxI) - 1;
   if (xMinI < hardXMin) {
     xMinI = hardXMin;
   }
@@ -47,6 +47,12 @@ public:
 
   ~SplashClip();
 
+  // Restrict the hard y bounds to the rows [hardYMinA, hardYMaxA),
+  // without changing the clip region itself.  This is used when
+  // drawing into a band bitmap: pixels outside the band are clipped,
+  // and pixels inside it are clipped exactly as on the full page.
+  void setHardYBounds(int hardYMinA, int hardYMaxA);
+
   // Reset the clip to a rectangle.
   void resetToRect(SplashCoord x0, SplashCoord y0,
 		   SplashCoord x1, SplashCoord y1);
@@ -97,6 +103,11 @@ public:
   int getYMinI(SplashStrokeAdjustMode strokeAdjust);
   int getYMaxI(SplashStrokeAdjustMode strokeAdjust);
 
+  // Same as getYMinI/getYMaxI, but limited to the original hard
+  // bounds, i.e., ignoring setHardYBounds.
+  int getPageYMinI(SplashStrokeAdjustMode strokeAdjust);
+  int getPageYMaxI(SplashStrokeAdjustMode strokeAdjust);
+
   // Get the number of arbitrary paths used by the clip region.
   int getNumPaths();
 
@@ -108,12 +119,14 @@ private:
 
   int hardXMin, hardYMin,	// coordinates cannot fall outside of
       hardXMax, hardYMax;	//   [hardXMin, hardXMax), [hardYMin, hardYMax)
+  int pageYMin, pageYMax;	// hard y bounds before setHardYBounds
 
   SplashCoord xMin, yMin,	// current clip bounding rectangle
               xMax, yMax;	//   (these coordinates may be adjusted if
 				//   stroke adjustment is enabled)
 
   int xMinI, yMinI, xMaxI, yMaxI;
+  int pageYMinI, pageYMaxI;
   GBool intBoundsValid;		// true if xMinI, etc. are valid
   GBool intBoundsStrokeAdjust;	// value of strokeAdjust used to compute
 				//   xMinI, etc.
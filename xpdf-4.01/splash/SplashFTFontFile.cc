@@ -148,6 +148,19 @@ SplashFTFontFile::SplashFTFontFile(SplashFTFontEngine *engineA,
   face = faceA;
   codeToGID = codeToGIDA;
   codeToGIDLen = codeToGIDLenA;
+
+  // the glyph bitmaps also depend on the face index, the
+  // code-to-GID mapping, and the hinting flags
+  if ((glyphCacheKey = hashFontData())) {
+    glyphCacheKey = SplashGlyphCache::hash(glyphCacheKey, &face->face_index,
+					   sizeof(face->face_index));
+    glyphCacheKey = SplashGlyphCache::hash(glyphCacheKey, &engine->flags,
+					   sizeof(engine->flags));
+    if (codeToGID) {
+      glyphCacheKey = SplashGlyphCache::hash(glyphCacheKey, codeToGID,
+					     codeToGIDLen * (int)sizeof(int));
+    }
+  }
 }
 
 SplashFTFontFile::~SplashFTFontFile() {
@@ -56,6 +56,7 @@ SplashFont::SplashFont(SplashFontFile *fontFileA, SplashCoord *matA,
 
   cache = NULL;
   cacheTags = NULL;
+  glyphCacheKey = 0;
 
   xMin = yMin = xMax = yMax = 0;
 }
@@ -73,6 +74,13 @@ void SplashFont::initCache() {
     // fall back to the uncached case
     glyphW = glyphH = 1;
   }
+
+  // glyphs are shared by all fonts with the same font data, matrix,
+  // and anti-aliasing setting
+  if (glyphW > 1 && (glyphCacheKey = fontFile->getGlyphCacheKey())) {
+    glyphCacheKey = SplashGlyphCache::hash(glyphCacheKey, mat, sizeof(mat));
+    glyphCacheKey = SplashGlyphCache::hash(glyphCacheKey, &aa, sizeof(aa));
+  }
   if (aa) {
     glyphSize = glyphW * glyphH;
   } else {
@@ -142,46 +150,57 @@ GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
     }
   }
 
-  // generate the glyph bitmap
-  if (!makeGlyph(c, xFrac, yFrac, &bitmap2)) {
-    return gFalse;
-  }
+  // find the least recently used glyph in the set -- it will be
+  // replaced
+  for (j = 0; (cacheTags[i+j].mru & 0x7fffffff) != cacheAssoc - 1; ++j) ;
+  p = cache + (i+j) * glyphSize;
+
+  // check the shared cache; if not found, generate the glyph bitmap
+  if (!glyphCacheKey ||
+      !SplashGlyphCache::lookup(glyphCacheKey, c, xFrac, yFrac,
+				glyphW, glyphH, p, &bitmap2)) {
+    if (!makeGlyph(c, xFrac, yFrac, &bitmap2)) {
+      return gFalse;
+    }
 
-  // if the glyph doesn't fit in the bounding box, return a temporary
-  // uncached bitmap
-  if (bitmap2.w > glyphW || bitmap2.h > glyphH) {
-    *bitmap = bitmap2;
-    return gTrue;
+    // if the glyph doesn't fit in the bounding box, return a temporary
+    // uncached bitmap
+    if (bitmap2.w > glyphW || bitmap2.h > glyphH) {
+      *bitmap = bitmap2;
+      return gTrue;
+    }
+
+    if (aa) {
+      size = bitmap2.w * bitmap2.h;
+    } else {
+      size = ((bitmap2.w + 7) >> 3) * bitmap2.h;
+    }
+    memcpy(p, bitmap2.data, size);
+    if (glyphCacheKey) {
+      SplashGlyphCache::insert(glyphCacheKey, c, xFrac, yFrac, &bitmap2);
+    }
+    if (bitmap2.freeData) {
+      gfree(bitmap2.data);
+    }
   }
 
   // insert glyph pixmap in cache
-  if (aa) {
-    size = bitmap2.w * bitmap2.h;
-  } else {
-    size = ((bitmap2.w + 7) >> 3) * bitmap2.h;
-  }
-  p = NULL; // make gcc happy
-  for (j = 0; j < cacheAssoc; ++j) {
-    if ((cacheTags[i+j].mru & 0x7fffffff) == cacheAssoc - 1) {
-      cacheTags[i+j].mru = 0x80000000;
-      cacheTags[i+j].c = c;
-      cacheTags[i+j].xFrac = (short)xFrac;
-      cacheTags[i+j].yFrac = (short)yFrac;
-      cacheTags[i+j].x = bitmap2.x;
-      cacheTags[i+j].y = bitmap2.y;
-      cacheTags[i+j].w = bitmap2.w;
-      cacheTags[i+j].h = bitmap2.h;
-      p = cache + (i+j) * glyphSize;
-      memcpy(p, bitmap2.data, size);
+  for (k = 0; k < cacheAssoc; ++k) {
+    if (k == j) {
+      cacheTags[i+k].mru = 0x80000000;
+      cacheTags[i+k].c = c;
+      cacheTags[i+k].xFrac = (short)xFrac;
+      cacheTags[i+k].yFrac = (short)yFrac;
+      cacheTags[i+k].x = bitmap2.x;
+      cacheTags[i+k].y = bitmap2.y;
+      cacheTags[i+k].w = bitmap2.w;
+      cacheTags[i+k].h = bitmap2.h;
     } else {
-      ++cacheTags[i+j].mru;
+      ++cacheTags[i+k].mru;
     }
   }
   *bitmap = bitmap2;
   bitmap->data = p;
   bitmap->freeData = gFalse;
-  if (bitmap2.freeData) {
-    gfree(bitmap2.data);
-  }
   return gTrue;
 }
@@ -18,6 +18,7 @@
 #include "gtypes.h"
 #include "SplashTypes.h"
 #include "SplashMath.h"
+#include "SplashGlyphCache.h"
 
 struct SplashGlyphBitmap;
 struct SplashFontCacheTag;
@@ -65,8 +66,9 @@ public:
 	   splashAbs(textMatA[3] - textMat[3]) < 0.0001;
   }
 
-  // Get a glyph - this does a cache lookup first, and if not found,
-  // creates a new bitmap and adds it to the cache.  The <xFrac> and
+  // Get a glyph - this does a cache lookup first (in the per-font
+  // cache, then in the shared SplashGlyphCache), and if not found,
+  // creates a new bitmap and adds it to the caches.  The <xFrac> and
   // <yFrac> values are splashFontFractionBits bits each, representing
   // the numerators of fractions in [0, 1), where the denominator is
   // splashFontFraction = 1 << splashFontFractionBits.  Subclasses
@@ -106,6 +108,8 @@ protected:
   int glyphSize;		// size of glyph bitmaps, in bytes
   int cacheSets;		// number of sets in cache
   int cacheAssoc;		// cache associativity (glyphs per set)
+  SplashGlyphCacheKey		// key for the shared glyph cache (zero
+    glyphCacheKey;		//   if not shared)
 };
 
 #endif
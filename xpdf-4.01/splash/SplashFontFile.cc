@@ -47,6 +47,7 @@ SplashFontFile::SplashFontFile(SplashFontFileID *idA,
   fileName = new GString(fileNameA);
   deleteFile = deleteFileA;
 #endif
+  glyphCacheKey = 0;
   refCnt = 0;
 }
 
@@ -62,6 +63,29 @@ SplashFontFile::~SplashFontFile() {
   delete id;
 }
 
+SplashGlyphCacheKey SplashFontFile::hashFontData() {
+  SplashGlyphCacheKey h;
+#if !LOAD_FONTS_FROM_MEM
+  FILE *f;
+  char buf[16384];
+  int n;
+#endif
+
+  h = SplashGlyphCache::hash(0, &fontType, sizeof(fontType));
+#if LOAD_FONTS_FROM_MEM
+  h = SplashGlyphCache::hash(h, fontBuf->getCString(), fontBuf->getLength());
+#else
+  if (!(f = fopen(fileName->getCString(), "rb"))) {
+    return 0;
+  }
+  while ((n = (int)fread(buf, 1, sizeof(buf), f)) > 0) {
+    h = SplashGlyphCache::hash(h, buf, n);
+  }
+  fclose(f);
+#endif
+  return h;
+}
+
 void SplashFontFile::incRefCnt() {
 #if MULTITHREADED
   gAtomicIncrement(&refCnt);
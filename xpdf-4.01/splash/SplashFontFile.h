@@ -17,6 +17,7 @@
 
 #include "gtypes.h"
 #include "SplashTypes.h"
+#include "SplashGlyphCache.h"
 
 #if MULTITHREADED
 #include "GMutex.h"
@@ -57,6 +58,10 @@ public:
   // Get the font file ID.
   SplashFontFileID *getID() { return id; }
 
+  // Get the key identifying the glyph bitmaps of this font file in
+  // the shared glyph cache (zero if the glyphs aren't shared).
+  SplashGlyphCacheKey getGlyphCacheKey() { return glyphCacheKey; }
+
   // Increment the reference count.
   void incRefCnt();
 
@@ -75,6 +80,12 @@ protected:
 #endif
 		 );
 
+  // Hash the font data and the font type.  Returns zero if the font
+  // file can't be read.  Subclasses call this from their constructor
+  // (mixing in anything else their glyph bitmaps depend on) to set
+  // glyphCacheKey.
+  SplashGlyphCacheKey hashFontData();
+
   SplashFontFileID *id;
   SplashFontType fontType;
 #if LOAD_FONTS_FROM_MEM
@@ -83,6 +94,7 @@ protected:
   GString *fileName;
   GBool deleteFile;
 #endif
+  SplashGlyphCacheKey glyphCacheKey;
 #if MULTITHREADED
   GAtomicCounter refCnt;
 #else
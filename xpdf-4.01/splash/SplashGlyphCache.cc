@@ -0,0 +1,391 @@
+//========================================================================
+//
+// SplashGlyphCache.cc
+//
+// Process-wide cache of rasterized glyphs, shared by all SplashFont
+// instances.
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "gmem.h"
+#include "gmempp.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+#include "SplashGlyphBitmap.h"
+#include "SplashGlyphCache.h"
+
+//------------------------------------------------------------------------
+
+// number of shards (must be a power of 2)
+#define splashGlyphCacheShards 16
+
+// initial number of hash buckets per shard (must be a power of 2)
+#define splashGlyphCacheInitBuckets 64
+
+//------------------------------------------------------------------------
+
+struct SplashGlyphCacheEntry {
+  SplashGlyphCacheKey fontKey;
+  Guint hashVal;
+  int c;
+  short xFrac, yFrac;
+  int x, y, w, h;		// offset and size of glyph
+  GBool aa;
+  int size;			// size of the entry, including the bitmap
+  SplashGlyphCacheEntry *next;	// next entry in the hash bucket
+  SplashGlyphCacheEntry *lruPrev, // LRU list (lruPrev = more recently
+                        *lruNext; //   used)
+  // the bitmap data follows the entry
+};
+
+struct SplashGlyphCacheShard {
+  SplashGlyphCacheShard();
+  ~SplashGlyphCacheShard();
+  SplashGlyphCacheEntry *find(SplashGlyphCacheKey fontKey, Guint hashVal,
+			      int c, int xFrac, int yFrac);
+  void unlink(SplashGlyphCacheEntry *e);
+  void evict(int limit);
+  void grow();
+
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+  SplashGlyphCacheEntry **buckets;
+  int nBuckets;
+  SplashGlyphCacheEntry *lruHead, // most recently used
+                        *lruTail; // least recently used
+  int nGlyphs;
+  int bytes;
+  int maxBytes;
+  double hits, misses, evictions;
+};
+
+static SplashGlyphCacheShard glyphCacheShards[splashGlyphCacheShards];
+
+#if MULTITHREADED
+#define lockShard(s) gLockMutex(&(s)->mutex)
+#define unlockShard(s) gUnlockMutex(&(s)->mutex)
+#else
+#define lockShard(s)
+#define unlockShard(s)
+#endif
+
+//------------------------------------------------------------------------
+// SplashGlyphCacheShard
+//------------------------------------------------------------------------
+
+SplashGlyphCacheShard::SplashGlyphCacheShard() {
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+  nBuckets = splashGlyphCacheInitBuckets;
+  buckets = (SplashGlyphCacheEntry **)
+                gmallocn(nBuckets, sizeof(SplashGlyphCacheEntry *));
+  memset(buckets, 0, nBuckets * sizeof(SplashGlyphCacheEntry *));
+  lruHead = lruTail = NULL;
+  nGlyphs = 0;
+  bytes = 0;
+  maxBytes = splashGlyphCacheDefaultSize / splashGlyphCacheShards;
+  hits = misses = evictions = 0;
+}
+
+SplashGlyphCacheShard::~SplashGlyphCacheShard() {
+  SplashGlyphCacheEntry *e, *next;
+
+  for (e = lruHead; e; e = next) {
+    next = e->lruNext;
+    gfree(e);
+  }
+  gfree(buckets);
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+SplashGlyphCacheEntry *SplashGlyphCacheShard::find(
+                           SplashGlyphCacheKey fontKey, Guint hashVal,
+			   int c, int xFrac, int yFrac) {
+  SplashGlyphCacheEntry *e;
+
+  for (e = buckets[hashVal & (nBuckets - 1)]; e; e = e->next) {
+    if (e->hashVal == hashVal && e->fontKey == fontKey && e->c == c &&
+	e->xFrac == xFrac && e->yFrac == yFrac) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+// Remove an entry from its hash bucket and from the LRU list.
+void SplashGlyphCacheShard::unlink(SplashGlyphCacheEntry *e) {
+  SplashGlyphCacheEntry **p;
+
+  for (p = &buckets[e->hashVal & (nBuckets - 1)]; *p != e; p = &(*p)->next) ;
+  *p = e->next;
+  if (e->lruPrev) {
+    e->lruPrev->lruNext = e->lruNext;
+  } else {
+    lruHead = e->lruNext;
+  }
+  if (e->lruNext) {
+    e->lruNext->lruPrev = e->lruPrev;
+  } else {
+    lruTail = e->lruPrev;
+  }
+  --nGlyphs;
+  bytes -= e->size;
+}
+
+// Drop least recently used entries until the shard fits in <limit>
+// bytes.
+void SplashGlyphCacheShard::evict(int limit) {
+  SplashGlyphCacheEntry *e;
+
+  while (bytes > limit && (e = lruTail)) {
+    unlink(e);
+    gfree(e);
+    evictions += 1;
+  }
+}
+
+void SplashGlyphCacheShard::grow() {
+  SplashGlyphCacheEntry **newBuckets;
+  SplashGlyphCacheEntry *e, *next;
+  int newNBuckets, i, j;
+
+  newNBuckets = 2 * nBuckets;
+  newBuckets = (SplashGlyphCacheEntry **)
+                   gmallocn(newNBuckets, sizeof(SplashGlyphCacheEntry *));
+  memset(newBuckets, 0, newNBuckets * sizeof(SplashGlyphCacheEntry *));
+  for (i = 0; i < nBuckets; ++i) {
+    for (e = buckets[i]; e; e = next) {
+      next = e->next;
+      j = e->hashVal & (newNBuckets - 1);
+      e->next = newBuckets[j];
+      newBuckets[j] = e;
+    }
+  }
+  gfree(buckets);
+  buckets = newBuckets;
+  nBuckets = newNBuckets;
+}
+
+//------------------------------------------------------------------------
+
+static inline SplashGlyphCacheKey mixGlyphCacheKey(SplashGlyphCacheKey h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static inline Guint glyphHash(SplashGlyphCacheKey fontKey, int c,
+			      int xFrac, int yFrac) {
+  SplashGlyphCacheKey h;
+
+  h = fontKey ^ ((SplashGlyphCacheKey)(Guint)c << 8)
+              ^ (SplashGlyphCacheKey)((xFrac << 4) | yFrac);
+  return (Guint)(mixGlyphCacheKey(h) >> 32);
+}
+
+// The low bits of the hash select the bucket, so the shard is taken
+// from the high bits.
+static inline SplashGlyphCacheShard *getShard(Guint hashVal) {
+  return &glyphCacheShards[(hashVal >> 24) & (splashGlyphCacheShards - 1)];
+}
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//------------------------------------------------------------------------
+
+SplashGlyphCacheKey SplashGlyphCache::hash(SplashGlyphCacheKey h,
+					   const void *data, int len) {
+  const Guchar *p;
+  SplashGlyphCacheKey w;
+  int i;
+
+  p = (const Guchar *)data;
+  h ^= (SplashGlyphCacheKey)(Guint)len * 0x9e3779b97f4a7c15ULL;
+  for (i = 0; i + 8 <= len; i += 8) {
+    memcpy(&w, p + i, 8);
+    h = (h ^ mixGlyphCacheKey(w)) * 0x100000001b3ULL;
+    h = (h << 27) | (h >> 37);
+  }
+  if (i < len) {
+    w = 0;
+    memcpy(&w, p + i, len - i);
+    h = (h ^ mixGlyphCacheKey(w)) * 0x100000001b3ULL;
+  }
+  h = mixGlyphCacheKey(h);
+  return h ? h : 1;
+}
+
+GBool SplashGlyphCache::lookup(SplashGlyphCacheKey fontKey, int c,
+			       int xFrac, int yFrac, int maxW, int maxH,
+			       Guchar *buf, SplashGlyphBitmap *bitmap) {
+  SplashGlyphCacheShard *shard;
+  SplashGlyphCacheEntry *e;
+  Guint hashVal;
+
+  hashVal = glyphHash(fontKey, c, xFrac, yFrac);
+  shard = getShard(hashVal);
+  lockShard(shard);
+  if (!(e = shard->find(fontKey, hashVal, c, xFrac, yFrac)) ||
+      e->w > maxW || e->h > maxH) {
+    shard->misses += 1;
+    unlockShard(shard);
+    return gFalse;
+  }
+  if (e != shard->lruHead) {
+    e->lruPrev->lruNext = e->lruNext;
+    if (e->lruNext) {
+      e->lruNext->lruPrev = e->lruPrev;
+    } else {
+      shard->lruTail = e->lruPrev;
+    }
+    e->lruPrev = NULL;
+    e->lruNext = shard->lruHead;
+    shard->lruHead->lruPrev = e;
+    shard->lruHead = e;
+  }
+  bitmap->x = e->x;
+  bitmap->y = e->y;
+  bitmap->w = e->w;
+  bitmap->h = e->h;
+  bitmap->aa = e->aa;
+  bitmap->data = buf;
+  bitmap->freeData = gFalse;
+  memcpy(buf, e + 1, e->size - sizeof(SplashGlyphCacheEntry));
+  shard->hits += 1;
+  unlockShard(shard);
+  return gTrue;
+}
+
+void SplashGlyphCache::insert(SplashGlyphCacheKey fontKey, int c,
+			      int xFrac, int yFrac,
+			      SplashGlyphBitmap *bitmap) {
+  SplashGlyphCacheShard *shard;
+  SplashGlyphCacheEntry *e;
+  Guint hashVal;
+  int dataSize, j;
+
+  if (bitmap->aa) {
+    dataSize = bitmap->w * bitmap->h;
+  } else {
+    dataSize = ((bitmap->w + 7) >> 3) * bitmap->h;
+  }
+  hashVal = glyphHash(fontKey, c, xFrac, yFrac);
+  shard = getShard(hashVal);
+
+  // allocate and fill in the entry before taking the lock
+  e = (SplashGlyphCacheEntry *)gmalloc(sizeof(SplashGlyphCacheEntry)
+				       + dataSize);
+  e->fontKey = fontKey;
+  e->hashVal = hashVal;
+  e->c = c;
+  e->xFrac = (short)xFrac;
+  e->yFrac = (short)yFrac;
+  e->x = bitmap->x;
+  e->y = bitmap->y;
+  e->w = bitmap->w;
+  e->h = bitmap->h;
+  e->aa = bitmap->aa;
+  e->size = (int)sizeof(SplashGlyphCacheEntry) + dataSize;
+  memcpy(e + 1, bitmap->data, dataSize);
+
+  lockShard(shard);
+  // another thread may have added the same glyph in the meantime
+  if (e->size > shard->maxBytes ||
+      shard->find(fontKey, hashVal, c, xFrac, yFrac)) {
+    unlockShard(shard);
+    gfree(e);
+    return;
+  }
+  shard->evict(shard->maxBytes - e->size);
+  if (shard->nGlyphs >= shard->nBuckets) {
+    shard->grow();
+  }
+  j = hashVal & (shard->nBuckets - 1);
+  e->next = shard->buckets[j];
+  shard->buckets[j] = e;
+  e->lruPrev = NULL;
+  e->lruNext = shard->lruHead;
+  if (shard->lruHead) {
+    shard->lruHead->lruPrev = e;
+  } else {
+    shard->lruTail = e;
+  }
+  shard->lruHead = e;
+  ++shard->nGlyphs;
+  shard->bytes += e->size;
+  unlockShard(shard);
+}
+
+void SplashGlyphCache::setMaxBytes(int maxBytesA) {
+  SplashGlyphCacheShard *shard;
+  int i;
+
+  if (maxBytesA < 0) {
+    maxBytesA = 0;
+  }
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &glyphCacheShards[i];
+    lockShard(shard);
+    shard->maxBytes = maxBytesA / splashGlyphCacheShards;
+    shard->evict(shard->maxBytes);
+    unlockShard(shard);
+  }
+}
+
+void SplashGlyphCache::clear() {
+  SplashGlyphCacheShard *shard;
+  int i;
+
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &glyphCacheShards[i];
+    lockShard(shard);
+    shard->evict(0);
+    unlockShard(shard);
+  }
+}
+
+void SplashGlyphCache::getStats(SplashGlyphCacheStats *stats) {
+  SplashGlyphCacheShard *shard;
+  int i;
+
+  stats->hits = stats->misses = stats->evictions = 0;
+  stats->nGlyphs = stats->bytes = stats->maxBytes = 0;
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &glyphCacheShards[i];
+    lockShard(shard);
+    stats->hits += shard->hits;
+    stats->misses += shard->misses;
+    stats->evictions += shard->evictions;
+    stats->nGlyphs += shard->nGlyphs;
+    stats->bytes += shard->bytes;
+    stats->maxBytes += shard->maxBytes;
+    unlockShard(shard);
+  }
+}
+
+void SplashGlyphCache::resetStats() {
+  SplashGlyphCacheShard *shard;
+  int i;
+
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &glyphCacheShards[i];
+    lockShard(shard);
+    shard->hits = shard->misses = shard->evictions = 0;
+    unlockShard(shard);
+  }
+}
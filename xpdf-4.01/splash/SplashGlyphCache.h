@@ -0,0 +1,93 @@
+//========================================================================
+//
+// SplashGlyphCache.h
+//
+// Process-wide cache of rasterized glyphs, shared by all SplashFont
+// instances.
+//
+//========================================================================
+
+#ifndef SPLASHGLYPHCACHE_H
+#define SPLASHGLYPHCACHE_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "gtypes.h"
+
+struct SplashGlyphBitmap;
+
+//------------------------------------------------------------------------
+
+// default size limit of the shared glyph cache, in bytes
+#define splashGlyphCacheDefaultSize (8*1024*1024)
+
+// Identifies everything that determines a glyph bitmap, except for
+// the glyph code and the fractional offsets: the font data, the
+// rasterizer settings, the font matrix, and anti-aliasing.  Zero
+// means "don't share".
+typedef unsigned long long SplashGlyphCacheKey;
+
+//------------------------------------------------------------------------
+
+struct SplashGlyphCacheStats {
+  double hits;			// lookups that found a glyph
+  double misses;		// lookups that didn't
+  double evictions;		// glyphs dropped to stay within the limit
+  int nGlyphs;			// glyphs currently in the cache
+  int bytes;			// current size, in bytes
+  int maxBytes;			// size limit, in bytes
+};
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//------------------------------------------------------------------------
+
+// SplashFont keeps its small per-instance cache as the first level;
+// glyphs missing from it are looked up here before they are
+// rasterized, so separate renders (e.g., the threads of a
+// SplashBandRenderer, or a series of documents using the same
+// embedded font) rasterize each glyph only once.
+//
+// The cache is split into shards, each with its own lock and LRU
+// list; glyph bitmaps are copied in and out while holding the shard
+// lock, so no references to cache memory escape.
+
+class SplashGlyphCache {
+public:
+
+  // Mix <len> bytes at <data> into the hash value <h>.  Never returns
+  // zero.
+  static SplashGlyphCacheKey hash(SplashGlyphCacheKey h,
+				  const void *data, int len);
+
+  // Look up a glyph.  If found, and it fits in <maxW> x <maxH> pixels,
+  // copy the bitmap into <buf> (which must be large enough for a
+  // <maxW> x <maxH> bitmap), set <bitmap> (with data = <buf>), and
+  // return true.
+  static GBool lookup(SplashGlyphCacheKey fontKey, int c,
+		      int xFrac, int yFrac, int maxW, int maxH,
+		      Guchar *buf, SplashGlyphBitmap *bitmap);
+
+  // Add a glyph.  The bitmap data is copied.
+  static void insert(SplashGlyphCacheKey fontKey, int c,
+		     int xFrac, int yFrac, SplashGlyphBitmap *bitmap);
+
+  // Set the size limit, in bytes, and evict glyphs as needed.  Zero
+  // disables the cache.
+  static void setMaxBytes(int maxBytesA);
+
+  // Drop all glyphs.
+  static void clear();
+
+  // Get the hit/miss counts and the current size.
+  static void getStats(SplashGlyphCacheStats *stats);
+
+  // Reset the hit/miss/eviction counts.
+  static void resetStats();
+};
+
+#endif
@@ -242,9 +242,13 @@ void SplashScreen::buildSCDMatrix(int r) {
   char *grid;
   int *region, *dist;
   int x, y, xx, yy, x0, x1, y0, y1, i, j, d, iMin, dMin, n;
+  Guint seed;
 
-  //~ this should probably happen somewhere else
-  srand(123);
+  // this uses a local generator instead of srand/rand, which share
+  // their state with every other thread (e.g., the band rendering
+  // threads each build their own screen) -- it is the same LCG as the
+  // MSVC rand(), so the matrix is unchanged on Windows
+  seed = 123;
 
   // generate the random space-filling curve
   pts = (SplashScreenPoint *)gmallocn(size * size, sizeof(SplashScreenPoint));
@@ -257,8 +261,9 @@ void SplashScreen::buildSCDMatrix(int r) {
     }
   }
   for (i = 0; i < size * size; ++i) {
+    seed = seed * 214013 + 2531011;
     j = i + (int)((double)(size * size - i) *
-		  (double)rand() / ((double)RAND_MAX + 1.0));
+		  (double)((seed >> 16) & 0x7fff) / 32768.0);
     x = pts[i].x;
     y = pts[i].y;
     pts[i].x = pts[j].x;
@@ -75,6 +75,7 @@ SplashState::SplashState(int width, int height, GBool vectorAntialias,
     cmykTransferK[i] = (Guchar)i;
 #endif
   }
+  transferIsIdentity = gTrue;
   overprintMask = 0xffffffff;
   enablePathSimplification = gFalse;
   next = NULL;
@@ -122,6 +123,7 @@ SplashState::SplashState(int width, int height, GBool vectorAntialias,
     cmykTransferK[i] = (Guchar)i;
 #endif
   }
+  transferIsIdentity = gTrue;
   overprintMask = 0xffffffff;
   enablePathSimplification = gFalse;
   next = NULL;
@@ -166,6 +168,7 @@ SplashState::SplashState(SplashState *state) {
   memcpy(cmykTransferY, state->cmykTransferY, 256);
   memcpy(cmykTransferK, state->cmykTransferK, 256);
 #endif
+  transferIsIdentity = state->transferIsIdentity;
   overprintMask = state->overprintMask;
   enablePathSimplification = state->enablePathSimplification;
   next = NULL;
@@ -275,9 +278,7 @@ void SplashState::setSoftMask(SplashBitmap *softMaskA) {
 
 void SplashState::setTransfer(Guchar *red, Guchar *green, Guchar *blue,
 			      Guchar *gray) {
-#if SPLASH_CMYK
   int i;
-#endif
 
   memcpy(rgbTransferR, red, 256);
   memcpy(rgbTransferG, green, 256);
@@ -291,5 +292,13 @@ void SplashState::setTransfer(Guchar *red, Guchar *green, Guchar *blue,
     cmykTransferK[i] = (Guchar)(255 - grayTransfer[255 - i]);
   }
 #endif
+  transferIsIdentity = gTrue;
+  for (i = 0; i < 256; ++i) {
+    if (rgbTransferR[i] != i || rgbTransferG[i] != i ||
+	rgbTransferB[i] != i || grayTransfer[i] != i) {
+      transferIsIdentity = gFalse;
+      break;
+    }
+  }
 }
 
@@ -123,6 +123,8 @@ private:
          cmykTransferY[256],
          cmykTransferK[256];
 #endif
+  GBool transferIsIdentity;	// all of the transfer functions are
+				//   identity functions
   Guint overprintMask;
   GBool enablePathSimplification;
 
@@ -80,9 +80,14 @@ SplashXPathScanner::SplashXPathScanner(SplashXPath *xPathA, GBool eo,
 
   resetDone = gFalse;
   resetAA = gFalse;
+
+  cellCover = cellDelta = NULL;
+  cellX0 = 0;
+  cellX1 = -1;
 }
 
 SplashXPathScanner::~SplashXPathScanner() {
+  gfree(cellCover);
 }
 
 void SplashXPathScanner::insertSegmentBefore(SplashXPathSeg *s,
@@ -326,8 +331,50 @@ void SplashXPathScanner::advance(GBool aa) {
   }
 }
 
-void SplashXPathScanner::generatePixels(int x0, int x1, Guchar *line,
-					int *xMin, int *xMax) {
+// Make sure the cell arrays cover [x0, x1].
+void SplashXPathScanner::setupCells(int x0, int x1) {
+  int n;
+
+  if (x0 >= cellX0 && x1 <= cellX1) {
+    return;
+  }
+  if (cellX0 <= cellX1) {
+    if (cellX0 < x0) {
+      x0 = cellX0;
+    }
+    if (cellX1 > x1) {
+      x1 = cellX1;
+    }
+  }
+  gfree(cellCover);
+  n = x1 - x0 + 2;
+  cellCover = (int *)gmallocn(2 * n, sizeof(int));
+  memset(cellCover, 0, 2 * n * sizeof(int));
+  cellDelta = cellCover + n;
+  cellX0 = x0;
+  cellX1 = x1;
+}
+
+// Add the sub-pixel run [ix0, ix1] (ix0 <= ix1) to the cells.
+inline void SplashXPathScanner::addCellRun(int ix0, int ix1) {
+  int px0, px1;
+
+  px0 = ix0 / aaHoriz - cellX0;
+  px1 = ix1 / aaHoriz - cellX0;
+  if (px0 == px1) {
+    cellCover[px0] += ix1 - ix0 + 1;
+  } else {
+    cellCover[px0] += aaHoriz - ix0 % aaHoriz;
+    cellCover[px1] += ix1 % aaHoriz + 1;
+    if (px1 > px0 + 1) {
+      cellDelta[px0 + 1] += aaHoriz;
+      cellDelta[px1] -= aaHoriz;
+    }
+  }
+}
+
+void SplashXPathScanner::generateCells(int x0, int x1,
+				       int *xMin, int *xMax) {
   SplashXPathSeg *s;
   int fillCount, x, xEnd, ix0, ix1, t;
 
@@ -354,8 +401,9 @@ void SplashXPathScanner::generatePixels(int x0, int x1, Guchar *line,
     if (ix1 / aaHoriz > *xMax) {
       *xMax = ix1 / aaHoriz;
     }
-    for (; x <= ix1; ++x) {
-      ++line[x / aaHoriz];
+    if (x <= ix1) {
+      addCellRun(x, ix1);
+      x = ix1 + 1;
     }
     if (s->y0 <= yTop && s->y1 > yTop) {
       fillCount += s->count;
@@ -366,11 +414,14 @@ void SplashXPathScanner::generatePixels(int x0, int x1, Guchar *line,
 void SplashXPathScanner::generatePixelsBinary(int x0, int x1, Guchar *line,
 					      int *xMin, int *xMax) {
   SplashXPathSeg *s;
-  int fillCount, x, xEnd, ix0, ix1, t;
+  int fillCount, x, xEnd, ix0, ix1, t, xClear;
 
   fillCount = 0;
   x = x0;
   xEnd = x1 + 1;
+  // x never decreases, so line[] is written left to right: the gaps
+  // between runs are cleared as they are passed
+  xClear = xEnd;
   for (s = pre->next; s != post && x < xEnd; s = s->next) {
     ix0 = splashFloor(s->sx0);
     ix1 = splashFloor(s->sx1);
@@ -387,17 +438,26 @@ void SplashXPathScanner::generatePixelsBinary(int x0, int x1, Guchar *line,
     }
     if (x < *xMin) {
       *xMin = x;
+      xClear = x;
     }
     if (ix1 > *xMax) {
       *xMax = ix1;
     }
-    for (; x <= ix1; ++x) {
-      line[x] = 255;
+    if (x <= ix1) {
+      if (xClear < x) {
+	memset(line + xClear, 0, x - xClear);
+      }
+      memset(line + x, 255, ix1 - x + 1);
+      x = ix1 + 1;
+      xClear = x;
     }
     if (s->y0 <= yTop && s->y1 > yTop) {
       fillCount += s->count;
     }
   }
+  if (xClear <= *xMax) {
+    memset(line + xClear, 0, *xMax - xClear + 1);
+  }
 }
 
 void SplashXPathScanner::drawRectangleSpan(Guchar *line, int y,
@@ -559,7 +619,7 @@ void SplashXPathScanner::drawRectangleSpanBinary(Guchar *line, int y,
 
 void SplashXPathScanner::getSpan(Guchar *line, int y, int x0, int x1,
 				 int *xMin, int *xMax) {
-  int iy, x, k;
+  int iy, x, k, cover;
 
   iy = y * aaVert;
   if (!resetDone || !resetAA) {
@@ -567,12 +627,12 @@ void SplashXPathScanner::getSpan(Guchar *line, int y, int x0, int x1,
   } else if (yBottomI > iy) {
     reset(gTrue, gFalse);
   }
-  memset(line + x0, 0, x1 - x0 + 1);
 
   *xMin = x1 + 1;
   *xMax = x0 - 1;
 
   if (xPath->isRect) {
+    memset(line + x0, 0, x1 - x0 + 1);
     drawRectangleSpan(line, y, x0, x1, xMin, xMax);
     return;
   }
@@ -580,16 +640,24 @@ void SplashXPathScanner::getSpan(Guchar *line, int y, int x0, int x1,
   if (yBottomI < iy) {
     skip(iy, gTrue);
   }
+  setupCells(x0, x1);
   for (k = 0; k < aaVert; ++k, ++iy) {
     advance(gTrue);
-    generatePixels(x0, x1, line, xMin, xMax);
+    generateCells(x0, x1, xMin, xMax);
   }
 
-#if !ANTIALIAS_256
+  //--- convert the cells to shape values, and clear them
+  cover = 0;
   for (x = *xMin; x <= *xMax; ++x) {
-    line[x] = map16to255[line[x]];
-  }
+    cover += cellDelta[x - cellX0];
+#if ANTIALIAS_256
+    line[x] = (Guchar)(cover + cellCover[x - cellX0]);
+#else
+    line[x] = map16to255[cover + cellCover[x - cellX0]];
 #endif
+    cellCover[x - cellX0] = 0;
+    cellDelta[x - cellX0] = 0;
+  }
 }
 
 void SplashXPathScanner::getSpanBinary(Guchar *line, int y, int x0, int x1,
@@ -602,12 +670,12 @@ void SplashXPathScanner::getSpanBinary(Guchar *line, int y, int x0, int x1,
   } else if (yBottomI > iy) {
     reset(gFalse, gFalse);
   }
-  memset(line + x0, 0, x1 - x0 + 1);
 
   *xMin = x1 + 1;
   *xMax = x0 - 1;
 
   if (xPath->isRect) {
+    memset(line + x0, 0, x1 - x0 + 1);
     drawRectangleSpanBinary(line, y, x0, x1, xMin, xMax);
     return;
   }
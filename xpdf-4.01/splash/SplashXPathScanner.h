@@ -39,10 +39,10 @@ public:
 
   ~SplashXPathScanner();
 
-  // Compute shape values for a scan line.  Fills in line[] with shape
-  // values for one scan line: ([x0, x1], y).  The values are in [0,
-  // 255].  Also returns the min/max x positions with non-zero shape
-  // values.
+  // Compute shape values for a scan line: ([x0, x1], y).  Returns
+  // the min/max x positions with non-zero shape values, and fills in
+  // line[xMin .. xMax] with the shape values, in [0, 255].  Entries
+  // of line[] outside [xMin, xMax] are not written.
   void getSpan(Guchar *line, int y, int x0, int x1, int *xMin, int *xMax);
 
   // Like getSpan(), but uses the values 0 and 255 only.  Writes 255
@@ -58,7 +58,9 @@ private:
   void reset(GBool aa, GBool aaChanged);
   void skip(int newYBottomI, GBool aa);
   void advance(GBool aa);
-  void generatePixels(int x0, int x1, Guchar *line, int *xMin, int *xMax);
+  void setupCells(int x0, int x1);
+  void addCellRun(int ix0, int ix1);
+  void generateCells(int x0, int x1, int *xMin, int *xMax);
   void generatePixelsBinary(int x0, int x1, Guchar *line,
 			    int *xMin, int *xMax);
   void drawRectangleSpan(Guchar *line, int y, int x0, int x1,
@@ -79,6 +81,15 @@ private:
   int nextSeg;
   int yTopI, yBottomI;
   SplashCoord yTop, yBottom;
+
+  // Coverage accumulation for getSpan: the coverage of pixel x, in
+  // sub-pixels, is the sum of cellCover[x] and cellDelta[x0 .. x].
+  // Runs of fully covered pixels only update cellDelta at their ends.
+  // Both arrays cover [cellX0, cellX1], and are all zero between
+  // calls to getSpan.
+  int *cellCover;
+  int *cellDelta;
+  int cellX0, cellX1;
 };
 
 #endif
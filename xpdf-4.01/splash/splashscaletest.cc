@@ -0,0 +1,423 @@
+//========================================================================
+//
+// splashscaletest.cc
+//
+// Checks the image and mask scalers (Splash::scaleImage and
+// Splash::scaleMask, through drawImage and fillImageMask) against a
+// plain transcription of the original scalar box filter.  The output
+// must be bit-exact for every color mode, with and without alpha, on
+// each of the down-scaling paths.
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gtypes.h"
+#include "gmem.h"
+#include "gmempp.h"
+#include "SplashBitmap.h"
+#include "SplashPattern.h"
+#include "Splash.h"
+
+//------------------------------------------------------------------------
+
+// Source and scaled sizes.  Each case hits one of the scaler paths
+// (the path is chosen by comparing the sizes), and the widths are
+// picked to cover the tails of the 16-byte row kernels.
+static struct {
+  int srcWidth, srcHeight;
+  int scaledWidth, scaledHeight;
+} testSizes[] = {
+  // YdXd
+  {   97,  61,  33,  20 },
+  {  300, 200, 100, 100 },
+  {  256, 256, 255,  17 },
+  {   40,  40,   1,   1 },
+  { 1000,   3, 999,   1 },
+  {   17, 500,   5, 499 },
+  // YdXu
+  {   50,  90,  77,  31 },
+  {   17, 300, 170,   7 },
+  {    3,   3, 100,   2 },
+  {   33,  70,  33,  69 },
+  // YuXd
+  {   90,  40,  31,  77 },
+  {  300,  17,   7, 170 },
+  {    3,   3,   2, 100 },
+  {   70,  33,  69,  33 },
+  // YuXu
+  {   20,  20,  45,  50 },
+  {    7,  11,   7,  11 }
+};
+#define nTestSizes ((int)(sizeof(testSizes) / sizeof(testSizes[0])))
+
+static struct {
+  const char *name;
+  SplashColorMode mode;
+  SplashColorMode srcMode;
+  int nComps;
+  Guchar paper;			// value of each component in white
+  GBool subtractive;		// set for CMYK
+} testModes[] = {
+  { "mono8", splashModeMono8, splashModeMono8, 1, 0xff, gFalse },
+  { "rgb8",  splashModeRGB8,  splashModeRGB8,  3, 0xff, gFalse },
+  { "bgr8",  splashModeBGR8,  splashModeRGB8,  3, 0xff, gFalse }
+#if SPLASH_CMYK
+  ,
+  { "cmyk8", splashModeCMYK8, splashModeCMYK8, 4, 0x00, gTrue }
+#endif
+};
+#define nTestModes ((int)(sizeof(testModes) / sizeof(testModes[0])))
+
+// offset of the image in the page bitmap
+#define testOffset 2
+
+//------------------------------------------------------------------------
+// image sources
+//------------------------------------------------------------------------
+
+struct TestImage {
+  Guchar *data;			// nComps bytes per pixel
+  Guchar *alpha;		// one byte per pixel, or NULL
+  int width, height;
+  int nComps;
+  int y;			// next row
+};
+
+static GBool testImageSource(void *data, SplashColorPtr colorLine,
+			     Guchar *alphaLine) {
+  TestImage *img = (TestImage *)data;
+
+  if (img->y >= img->height) {
+    return gFalse;
+  }
+  memcpy(colorLine, img->data + img->y * img->width * img->nComps,
+	 img->width * img->nComps);
+  if (img->alpha && alphaLine) {
+    memcpy(alphaLine, img->alpha + img->y * img->width, img->width);
+  }
+  ++img->y;
+  return gTrue;
+}
+
+static GBool testMaskSource(void *data, Guchar *pixel) {
+  TestImage *img = (TestImage *)data;
+
+  if (img->y >= img->height) {
+    return gFalse;
+  }
+  memcpy(pixel, img->data + img->y * img->width, img->width);
+  ++img->y;
+  return gTrue;
+}
+
+// Fill [n] bytes with random values below [max].  Runs of equal
+// values are mixed in, so the sums aren't all near the mean.
+static void fillRandom(Guchar *p, int n, int max) {
+  int i, v, run;
+
+  i = 0;
+  while (i < n) {
+    v = rand() % max;
+    run = (rand() & 3) ? 1 : 1 + rand() % 64;
+    for (; run > 0 && i < n; --run) {
+      p[i++] = (Guchar)v;
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+// reference scaler
+//------------------------------------------------------------------------
+
+// The box filter of the original scalar code.  Each output pixel is
+// the sum of a yStep x xStep box of source pixels (a 1-pixel box in a
+// direction that is scaled up, where the pixel is replicated
+// instead), normalized with ((max << 23) / (yStep * xStep)) and a
+// 23-bit shift.  The steps come from the same Bresenham sequences as
+// in Splash.  [max] is 1 for images and 255 for masks (whose source
+// pixels are 0 or 1).
+static void refScale(Guchar *src, int srcWidth, int srcHeight, int nComps,
+		     int max, int scaledWidth, int scaledHeight,
+		     Guchar *dest) {
+  int *yBox, *yRep, *xBox, *xRep;
+  int nY, nX, yp, yq, yt, xp, xq, xt, step;
+  int sy, sx, dy, dx, by, bx, i, j, c;
+  Guint sum, d;
+
+  // y steps: down-scaling makes scaledHeight boxes, up-scaling makes
+  // srcHeight replicated rows
+  yBox = (int *)gmallocn(srcHeight + scaledHeight, sizeof(int));
+  yRep = (int *)gmallocn(srcHeight + scaledHeight, sizeof(int));
+  if (scaledHeight < srcHeight) {
+    nY = scaledHeight;
+    yp = srcHeight / scaledHeight;
+    yq = srcHeight % scaledHeight;
+  } else {
+    nY = srcHeight;
+    yp = scaledHeight / srcHeight;
+    yq = scaledHeight % srcHeight;
+  }
+  yt = 0;
+  for (i = 0; i < nY; ++i) {
+    if ((yt += yq) >= nY) {
+      yt -= nY;
+      step = yp + 1;
+    } else {
+      step = yp;
+    }
+    yBox[i] = scaledHeight < srcHeight ? step : 1;
+    yRep[i] = scaledHeight < srcHeight ? 1 : step;
+  }
+
+  xBox = (int *)gmallocn(srcWidth + scaledWidth, sizeof(int));
+  xRep = (int *)gmallocn(srcWidth + scaledWidth, sizeof(int));
+  if (scaledWidth < srcWidth) {
+    nX = scaledWidth;
+    xp = srcWidth / scaledWidth;
+    xq = srcWidth % scaledWidth;
+  } else {
+    nX = srcWidth;
+    xp = scaledWidth / srcWidth;
+    xq = scaledWidth % srcWidth;
+  }
+  xt = 0;
+  for (i = 0; i < nX; ++i) {
+    if ((xt += xq) >= nX) {
+      xt -= nX;
+      step = xp + 1;
+    } else {
+      step = xp;
+    }
+    xBox[i] = scaledWidth < srcWidth ? step : 1;
+    xRep[i] = scaledWidth < srcWidth ? 1 : step;
+  }
+
+  sy = dy = 0;
+  for (by = 0; by < nY; ++by) {
+    sx = dx = 0;
+    for (bx = 0; bx < nX; ++bx) {
+      d = (Guint)((max << 23) / (yBox[by] * xBox[bx]));
+      for (c = 0; c < nComps; ++c) {
+	sum = 0;
+	for (i = 0; i < yBox[by]; ++i) {
+	  for (j = 0; j < xBox[bx]; ++j) {
+	    sum += src[((sy + i) * srcWidth + sx + j) * nComps + c];
+	  }
+	}
+	sum = (sum * d) >> 23;
+	for (i = 0; i < yRep[by]; ++i) {
+	  for (j = 0; j < xRep[bx]; ++j) {
+	    dest[((dy + i) * scaledWidth + dx + j) * nComps + c] =
+		(Guchar)sum;
+	  }
+	}
+      }
+      sx += xBox[bx];
+      dx += xRep[bx];
+    }
+    sy += yBox[by];
+    dy += yRep[by];
+  }
+
+  gfree(yBox);
+  gfree(yRep);
+  gfree(xBox);
+  gfree(xRep);
+}
+
+//------------------------------------------------------------------------
+
+static Guchar div255(int x) {
+  return (Guchar)((x + (x >> 8) + 0x80) >> 8);
+}
+
+// Compare the image area of [bitmap] with [expected] (in the source
+// color order, with nComps bytes per pixel).
+static GBool checkBitmap(SplashBitmap *bitmap, int nComps, Guchar *expected,
+			 int width, int height, const char *what) {
+  Guchar *p, *q;
+  int x, y, c, cc;
+
+  for (y = 0; y < height; ++y) {
+    p = bitmap->getDataPtr() + (y + testOffset) * bitmap->getRowSize()
+        + testOffset * nComps;
+    q = expected + y * width * nComps;
+    for (x = 0; x < width; ++x) {
+      for (c = 0; c < nComps; ++c) {
+	// BGR8 bitmaps store the components in reverse order
+	cc = bitmap->getMode() == splashModeBGR8 ? 2 - c : c;
+	if (p[x * nComps + cc] != q[x * nComps + c]) {
+	  printf("%s: mismatch at x=%d y=%d comp=%d: got %d, expected %d\n",
+		 what, x, y, c, p[x * nComps + cc], q[x * nComps + c]);
+	  return gFalse;
+	}
+      }
+    }
+  }
+  return gTrue;
+}
+
+static SplashBitmap *makePage(int mode, int width, int height,
+			      Splash **splash) {
+  SplashBitmap *bitmap;
+  SplashColor white;
+
+  bitmap = new SplashBitmap(width + 2 * testOffset, height + 2 * testOffset,
+			    1, testModes[mode].mode, gFalse);
+  *splash = new Splash(bitmap, gFalse);
+  (*splash)->setStrokeAdjust(splashStrokeAdjustOff);
+  memset(white, testModes[mode].paper, sizeof(white));
+  (*splash)->clear(white);
+  return bitmap;
+}
+
+// Draw a random image with drawImage, and check it.
+static GBool testImage(int size, int mode, GBool srcAlpha) {
+  TestImage img;
+  SplashBitmap *bitmap;
+  Splash *splash;
+  SplashCoord mat[6];
+  Guchar *expected, *expectedAlpha;
+  char what[256];
+  GBool ok;
+  int w, h, nComps, i, c;
+
+  w = testSizes[size].scaledWidth;
+  h = testSizes[size].scaledHeight;
+  nComps = testModes[mode].nComps;
+  img.width = testSizes[size].srcWidth;
+  img.height = testSizes[size].srcHeight;
+  img.nComps = nComps;
+  img.y = 0;
+  img.data = (Guchar *)gmallocn(img.width * img.height, nComps);
+  fillRandom(img.data, img.width * img.height * nComps, 256);
+  img.alpha = NULL;
+  if (srcAlpha) {
+    img.alpha = (Guchar *)gmallocn(img.width, img.height);
+    fillRandom(img.alpha, img.width * img.height, 256);
+  }
+
+  expected = (Guchar *)gmallocn(w * h, nComps);
+  refScale(img.data, img.width, img.height, nComps, 1, w, h, expected);
+  if (srcAlpha) {
+    // composite onto the paper color of the page
+    expectedAlpha = (Guchar *)gmallocn(w, h);
+    refScale(img.alpha, img.width, img.height, 1, 1, w, h, expectedAlpha);
+    for (i = 0; i < w * h; ++i) {
+      for (c = 0; c < nComps; ++c) {
+	expected[i * nComps + c] =
+	    (Guchar)(((255 - expectedAlpha[i]) * testModes[mode].paper +
+		      expectedAlpha[i] * expected[i * nComps + c]) / 255);
+      }
+    }
+    gfree(expectedAlpha);
+  }
+
+  bitmap = makePage(mode, w, h, &splash);
+  mat[0] = w;
+  mat[1] = 0;
+  mat[2] = 0;
+  mat[3] = h;
+  mat[4] = testOffset;
+  mat[5] = testOffset;
+  splash->drawImage(&testImageSource, &img, testModes[mode].srcMode,
+		    srcAlpha, img.width, img.height, mat, gFalse);
+  sprintf(what, "image %s%s %dx%d -> %dx%d", testModes[mode].name,
+	  srcAlpha ? "+alpha" : "", img.width, img.height, w, h);
+  ok = checkBitmap(bitmap, nComps, expected, w, h, what);
+
+  delete splash;
+  delete bitmap;
+  gfree(expected);
+  gfree(img.data);
+  gfree(img.alpha);
+  return ok;
+}
+
+// Fill a random mask with black using fillImageMask, and check it.
+static GBool testMask(int size, int mode) {
+  TestImage img;
+  SplashBitmap *bitmap;
+  Splash *splash;
+  SplashColor black;
+  SplashCoord mat[6];
+  Guchar *scaled, *expected;
+  char what[256];
+  GBool ok;
+  int w, h, nComps, i, c;
+
+  w = testSizes[size].scaledWidth;
+  h = testSizes[size].scaledHeight;
+  nComps = testModes[mode].nComps;
+  img.width = testSizes[size].srcWidth;
+  img.height = testSizes[size].srcHeight;
+  img.nComps = 1;
+  img.y = 0;
+  img.data = (Guchar *)gmallocn(img.width, img.height);
+  fillRandom(img.data, img.width * img.height, 2);
+  img.alpha = NULL;
+
+  // black on white: each component is 255 - mask value (or the mask
+  // value itself for the K component in CMYK)
+  scaled = (Guchar *)gmallocn(w, h);
+  refScale(img.data, img.width, img.height, 1, 255, w, h, scaled);
+  expected = (Guchar *)gmallocn(w * h, nComps);
+  for (i = 0; i < w * h; ++i) {
+    for (c = 0; c < nComps; ++c) {
+      if (testModes[mode].subtractive) {
+	expected[i * nComps + c] = c == 3 ? div255(255 * scaled[i]) : 0;
+      } else {
+	expected[i * nComps + c] = div255(255 * (255 - scaled[i]));
+      }
+    }
+  }
+
+  bitmap = makePage(mode, w, h, &splash);
+  memset(black, 0, sizeof(black));
+#if SPLASH_CMYK
+  if (testModes[mode].subtractive) {
+    black[3] = 0xff;
+  }
+#endif
+  splash->setFillPattern(new SplashSolidColor(black));
+  mat[0] = w;
+  mat[1] = 0;
+  mat[2] = 0;
+  mat[3] = h;
+  mat[4] = testOffset;
+  mat[5] = testOffset;
+  splash->fillImageMask(&testMaskSource, &img, img.width, img.height, mat,
+			gFalse, gFalse);
+  sprintf(what, "mask %s %dx%d -> %dx%d", testModes[mode].name,
+	  img.width, img.height, w, h);
+  ok = checkBitmap(bitmap, nComps, expected, w, h, what);
+
+  delete splash;
+  delete bitmap;
+  gfree(scaled);
+  gfree(expected);
+  gfree(img.data);
+  return ok;
+}
+
+//------------------------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+  int size, mode, nFailed, nTests;
+
+  srand(1);
+  nFailed = nTests = 0;
+  for (size = 0; size < nTestSizes; ++size) {
+    for (mode = 0; mode < nTestModes; ++mode) {
+      nFailed += !testImage(size, mode, gFalse);
+      nFailed += !testImage(size, mode, gTrue);
+      nFailed += !testMask(size, mode);
+      nTests += 3;
+    }
+  }
+  printf("%d of %d tests failed\n", nFailed, nTests);
+  return nFailed ? 1 : 0;
+}
@@ -43,8 +43,28 @@ static int getCharFromFile(void *data) {
   return fgetc((FILE *)data);
 }
 
+// Embedded CMap streams are read a block at a time, rather than
+// making a virtual getChar call (through the whole filter chain) for
+// every char.
+struct CMapStreamReader {
+  Stream *str;
+  char buf[4096];
+  int pos, len;
+};
+
 static int getCharFromStream(void *data) {
-  return ((Stream *)data)->getChar();
+  CMapStreamReader *reader;
+
+  reader = (CMapStreamReader *)data;
+  if (reader->pos >= reader->len) {
+    reader->len = reader->str->getBlock(reader->buf, sizeof(reader->buf));
+    reader->pos = 0;
+    if (reader->len <= 0) {
+      reader->len = 0;
+      return EOF;
+    }
+  }
+  return reader->buf[reader->pos++] & 0xff;
 }
 
 //------------------------------------------------------------------------
@@ -104,6 +124,7 @@ CMap *CMap::parse(CMapCache *cache, GString *collectionA,
 CMap *CMap::parse(CMapCache *cache, GString *collectionA, Stream *str) {
   Object obj1;
   CMap *cMap;
+  CMapStreamReader *reader;
 
   cMap = new CMap(collectionA->copy(), NULL);
 
@@ -113,7 +134,11 @@ CMap *CMap::parse(CMapCache *cache, GString *collectionA, Stream *str) {
   obj1.free();
 
   str->reset();
-  cMap->parse2(cache, &getCharFromStream, str);
+  reader = new CMapStreamReader;
+  reader->str = str;
+  reader->pos = reader->len = 0;
+  cMap->parse2(cache, &getCharFromStream, reader);
+  delete reader;
   str->close();
   return cMap;
 }
@@ -0,0 +1,299 @@
+//========================================================================
+//
+// ContentStreamCache.cc
+//
+// Per-document cache of pre-tokenized content streams.
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "gmem.h"
+#include "gmempp.h"
+#include "GString.h"
+#include "GHash.h"
+#include "Object.h"
+#include "Array.h"
+#include "Dict.h"
+#include "ContentStreamCache.h"
+
+//------------------------------------------------------------------------
+
+// Marker stored in the hash for streams that can't be compiled.
+static char uncacheableEntry;
+
+//------------------------------------------------------------------------
+// CompiledContentStream
+//------------------------------------------------------------------------
+
+CompiledContentStream::CompiledContentStream() {
+  ops = NULL;
+  nOps = opsSize = 0;
+  args = NULL;
+  nArgs = argsSize = 0;
+  size = (int)sizeof(CompiledContentStream);
+  refCnt = 1;
+  key = NULL;
+  prev = next = NULL;
+}
+
+CompiledContentStream::~CompiledContentStream() {
+  int i;
+
+  for (i = 0; i < nArgs; ++i) {
+    args[i].free();
+  }
+  gfree(args);
+  gfree(ops);
+}
+
+void CompiledContentStream::incRefCnt() {
+#if MULTITHREADED
+  gAtomicIncrement(&refCnt);
+#else
+  ++refCnt;
+#endif
+}
+
+void CompiledContentStream::decRefCnt() {
+  GBool done;
+
+#if MULTITHREADED
+  done = gAtomicDecrement(&refCnt) == 0;
+#else
+  done = --refCnt == 0;
+#endif
+  if (done) {
+    delete this;
+  }
+}
+
+void CompiledContentStream::addOp(int opIdx, Object *argsA, int numArgsA,
+				  Object *cmd) {
+  int i;
+
+  if (nOps == opsSize) {
+    opsSize = opsSize ? 2 * opsSize : 64;
+    ops = (CompiledContentOp *)greallocn(ops, opsSize,
+					 sizeof(CompiledContentOp));
+  }
+  if (nArgs + numArgsA + 1 > argsSize) {
+    while (nArgs + numArgsA + 1 > argsSize) {
+      argsSize = argsSize ? 2 * argsSize : 256;
+    }
+    args = (Object *)greallocn(args, argsSize, sizeof(Object));
+  }
+  ops[nOps].opIdx = opIdx;
+  ops[nOps].firstArg = nArgs;
+  ops[nOps].numArgs = numArgsA;
+  ++nOps;
+  size += (int)sizeof(CompiledContentOp);
+  for (i = 0; i < numArgsA; ++i) {
+    args[nArgs++] = argsA[i];
+    size += getObjectSize(&argsA[i]);
+  }
+  if (opIdx < 0) {
+    args[nArgs++] = *cmd;
+    size += getObjectSize(cmd);
+  } else {
+    cmd->free();
+  }
+}
+
+int CompiledContentStream::getObjectSize(Object *obj) {
+  Object elem;
+  int n, i;
+
+  n = (int)sizeof(Object);
+  switch (obj->getType()) {
+  case objString:
+    n += (int)sizeof(GString) + obj->getString()->getLength() + 1;
+    break;
+  case objName:
+    n += (int)strlen(obj->getName()) + 1;
+    break;
+  case objCmd:
+    n += (int)strlen(obj->getCmd()) + 1;
+    break;
+  case objArray:
+    n += (int)sizeof(Array);
+    for (i = 0; i < obj->arrayGetLength(); ++i) {
+      n += getObjectSize(obj->arrayGetNF(i, &elem));
+      elem.free();
+    }
+    break;
+  case objDict:
+    // inline dictionaries (BDC/DP properties) are rare and small
+    n += 64 * obj->dictGetLength();
+    break;
+  default:
+    break;
+  }
+  return n;
+}
+
+//------------------------------------------------------------------------
+// ContentStreamCache
+//------------------------------------------------------------------------
+
+ContentStreamCache::ContentStreamCache(int maxSizeA) {
+  maxSize = maxSizeA;
+  curSize = 0;
+  hash = new GHash(gTrue);
+  head = tail = NULL;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+ContentStreamCache::~ContentStreamCache() {
+  CompiledContentStream *content;
+
+  while ((content = head)) {
+    unlink(content);
+    content->decRefCnt();
+  }
+  delete hash;
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+GString *ContentStreamCache::makeKey(Object *strRef) {
+  Object obj;
+  GString *key;
+  int i;
+
+  if (strRef->isRef()) {
+    return GString::format("{0:d} {1:d}", strRef->getRefNum(),
+			   strRef->getRefGen());
+  }
+  if (!strRef->isArray() || strRef->arrayGetLength() == 0) {
+    return NULL;
+  }
+  key = new GString();
+  for (i = 0; i < strRef->arrayGetLength(); ++i) {
+    strRef->arrayGetNF(i, &obj);
+    if (!obj.isRef()) {
+      obj.free();
+      delete key;
+      return NULL;
+    }
+    key->appendf("{0:s}{1:d} {2:d}", i ? "," : "",
+		 obj.getRefNum(), obj.getRefGen());
+    obj.free();
+  }
+  return key;
+}
+
+CompiledContentStream *ContentStreamCache::lookup(GString *key,
+						  GBool *uncacheable) {
+  CompiledContentStream *content;
+  void *p;
+
+  *uncacheable = gFalse;
+  content = NULL;
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  p = hash->lookup(key);
+  if (p == &uncacheableEntry) {
+    *uncacheable = gTrue;
+  } else if (p) {
+    content = (CompiledContentStream *)p;
+    // move to the most-recently-used position
+    if (content != head) {
+      unlink(content);
+      content->next = head;
+      if (head) {
+	head->prev = content;
+      }
+      head = content;
+      if (!tail) {
+	tail = content;
+      }
+    }
+    content->incRefCnt();
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return content;
+}
+
+void ContentStreamCache::add(GString *key, CompiledContentStream *content) {
+  if (content->getSize() > maxSize) {
+    return;
+  }
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  // another thread may have compiled the same stream in the meantime
+  if (!hash->lookup(key)) {
+    evict(content->getSize());
+    content->key = key->copy();
+    content->prev = NULL;
+    content->next = head;
+    if (head) {
+      head->prev = content;
+    }
+    head = content;
+    if (!tail) {
+      tail = content;
+    }
+    curSize += content->getSize();
+    hash->add(content->key, content);
+    content->incRefCnt();
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+}
+
+void ContentStreamCache::setUncacheable(GString *key) {
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  if (!hash->lookup(key)) {
+    hash->add(key->copy(), &uncacheableEntry);
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+}
+
+// NB: mutex must be locked when calling this function.
+void ContentStreamCache::unlink(CompiledContentStream *content) {
+  if (content->prev) {
+    content->prev->next = content->next;
+  } else {
+    head = content->next;
+  }
+  if (content->next) {
+    content->next->prev = content->prev;
+  } else {
+    tail = content->prev;
+  }
+  content->prev = content->next = NULL;
+}
+
+// Drop least-recently-used entries until <neededSize> more bytes fit
+// in the budget.  NB: mutex must be locked when calling this function.
+void ContentStreamCache::evict(int neededSize) {
+  CompiledContentStream *content;
+
+  while (tail && curSize + neededSize > maxSize) {
+    content = tail;
+    unlink(content);
+    curSize -= content->getSize();
+    // this deletes content->key
+    hash->remove(content->key);
+    content->key = NULL;
+    content->decRefCnt();
+  }
+}
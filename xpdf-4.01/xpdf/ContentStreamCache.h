@@ -0,0 +1,144 @@
+//========================================================================
+//
+// ContentStreamCache.h
+//
+// Per-document cache of pre-tokenized content streams.
+//
+//========================================================================
+
+#ifndef CONTENTSTREAMCACHE_H
+#define CONTENTSTREAMCACHE_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "gtypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+#include "Object.h"
+
+class GString;
+class GHash;
+
+//------------------------------------------------------------------------
+
+// Default byte budget for the per-document content stream cache.
+#define contentStreamCacheSize (4 * 1024 * 1024)
+
+//------------------------------------------------------------------------
+// CompiledContentStream
+//------------------------------------------------------------------------
+
+struct CompiledContentOp {
+  int opIdx;			// index into Gfx::opTab, or -1 if the
+				//   operator is undefined
+  int firstArg;			// index of the first arg in args[]
+  int numArgs;			// number of args -- for undefined
+				//   operators, the command object itself
+				//   is stored in args[firstArg + numArgs]
+};
+
+// A content stream which has been run through the parser once, and
+// stored as a list of operator indexes plus a flat array of operands.
+// Page contents, form XObjects, patterns, and Type 3 glyphs can then
+// be executed without re-decoding and re-tokenizing the stream, and
+// without looking up the operators again.
+class CompiledContentStream {
+public:
+
+  // Sets the initial reference count to 1.
+  CompiledContentStream();
+  ~CompiledContentStream();
+
+  void incRefCnt();
+  void decRefCnt();
+
+  // Append an operator.  Takes ownership of the <numArgsA> objects
+  // in <argsA> and of <cmd>.  The command object is only kept (for
+  // error messages) if <opIdx> is -1.
+  void addOp(int opIdx, Object *argsA, int numArgsA, Object *cmd);
+
+  int getNumOps() { return nOps; }
+  CompiledContentOp *getOp(int i) { return &ops[i]; }
+  Object *getArgs(CompiledContentOp *op) { return &args[op->firstArg]; }
+  char *getCmdName(CompiledContentOp *op)
+    { return args[op->firstArg + op->numArgs].getCmd(); }
+
+  // Approximate memory used by this object, in bytes.
+  int getSize() { return size; }
+
+private:
+
+  static int getObjectSize(Object *obj);
+
+  CompiledContentOp *ops;
+  int nOps, opsSize;
+  Object *args;
+  int nArgs, argsSize;
+  int size;
+#if MULTITHREADED
+  GAtomicCounter refCnt;
+#else
+  int refCnt;
+#endif
+
+  // hash key and LRU list links, managed by ContentStreamCache
+  GString *key;
+  CompiledContentStream *prev, *next;
+
+  friend class ContentStreamCache;
+};
+
+//------------------------------------------------------------------------
+// ContentStreamCache
+//------------------------------------------------------------------------
+
+class ContentStreamCache {
+public:
+
+  ContentStreamCache(int maxSizeA = contentStreamCacheSize);
+  ~ContentStreamCache();
+
+  // Build the cache key for a content stream reference, or for an
+  // array of content stream references (page contents).  Returns
+  // NULL if <strRef> isn't something that can be cached.  The caller
+  // owns the returned string.
+  static GString *makeKey(Object *strRef);
+
+  // Look up the compiled stream for <key>.  Increments its reference
+  // count; the caller must call decRefCnt() when done with it.
+  // Returns NULL if <key> isn't in the cache.  Sets *<uncacheable> if
+  // <key> was previously marked with setUncacheable().
+  CompiledContentStream *lookup(GString *key, GBool *uncacheable);
+
+  // Insert <content> into the cache, in the most-recently-used
+  // position, evicting older entries as needed to stay within the
+  // byte budget.  The cache takes its own reference.
+  void add(GString *key, CompiledContentStream *content);
+
+  // Remember that <key> can't be compiled (e.g., it contains inline
+  // image data), so it isn't parsed twice on every use.
+  void setUncacheable(GString *key);
+
+private:
+
+  void unlink(CompiledContentStream *content);
+  void evict(int neededSize);
+
+  int maxSize;			// byte budget
+  int curSize;			// bytes used by cached streams
+  GHash *hash;			// map from makeKey() strings to
+				//   CompiledContentStream, or to
+				//   &uncacheableEntry
+  CompiledContentStream *head,	// LRU list, most recently used first
+                        *tail;
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+};
+
+#endif
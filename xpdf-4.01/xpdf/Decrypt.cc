@@ -20,6 +20,10 @@
 static void aes256KeyExpansion(DecryptAES256State *s,
 			       Guchar *objKey, int objKeyLen);
 static void aes256DecryptBlock(DecryptAES256State *s, Guchar *in, GBool last);
+static void rc4DecryptBlock(Guchar *state, Guchar *x, Guchar *y,
+			    Guchar *buf, int len);
+static void aesDecryptBlockCBC(Guint *w, int nRounds, Guchar *cbc,
+			       Guchar *in, Guchar *out);
 static void sha256(Guchar *msg, int msgLen, Guchar *hash);
 static void sha384(Guchar *msg, int msgLen, Guchar *hash);
 static void sha512(Guchar *msg, int msgLen, Guchar *hash);
@@ -325,6 +329,87 @@ GBool Decrypt::makeFileKey2(int encVersion, int encRevision, int keyLength,
   return ok;
 }
 
+void Decrypt::makeFileKeyDigest(int encRevision,
+				GString *ownerKey, GString *userKey,
+				GString *ownerEnc, GString *userEnc,
+				int permissions, GBool encryptMetadata,
+				GString *ownerPassword, GString *userPassword,
+				Guchar *digest) {
+  GString *buf;
+  GString *s[6];
+  int i;
+
+  // each string is prefixed with its length, and a missing password
+  // (which skips the owner password check) is distinct from an empty
+  // one
+  buf = GString::format("{0:d} {1:d} {2:d}", encRevision, permissions,
+			encryptMetadata ? 1 : 0);
+  s[0] = ownerKey;
+  s[1] = userKey;
+  s[2] = ownerEnc;
+  s[3] = userEnc;
+  s[4] = ownerPassword;
+  s[5] = userPassword;
+  for (i = 0; i < 6; ++i) {
+    if (s[i]) {
+      buf->appendf(" {0:d}:", s[i]->getLength());
+      buf->append(s[i]);
+    } else {
+      buf->append(" -");
+    }
+  }
+  sha256((Guchar *)buf->getCString(), buf->getLength(), digest);
+  delete buf;
+}
+
+//------------------------------------------------------------------------
+// FileKeyCache
+//------------------------------------------------------------------------
+
+FileKeyCache::FileKeyCache() {
+  nEntries = 0;
+}
+
+FileKeyCache::~FileKeyCache() {
+  // don't leave keys behind in freed memory
+  memset(cache, 0, sizeof(cache));
+}
+
+GBool FileKeyCache::lookup(Guchar *digest, Guchar *fileKey,
+			   GBool *ownerPasswordOk) {
+  FileKeyCacheEntry entry;
+  int i, j;
+
+  for (i = 0; i < nEntries; ++i) {
+    if (!memcmp(cache[i].digest, digest, 32)) {
+      entry = cache[i];
+      for (j = i; j >= 1; --j) {
+	cache[j] = cache[j - 1];
+      }
+      cache[0] = entry;
+      memcpy(fileKey, entry.fileKey, 32);
+      *ownerPasswordOk = entry.ownerPasswordOk;
+      return gTrue;
+    }
+  }
+  return gFalse;
+}
+
+void FileKeyCache::add(Guchar *digest, Guchar *fileKey,
+		       GBool ownerPasswordOk) {
+  int j;
+
+  if (nEntries < fileKeyCacheSize) {
+    ++nEntries;
+  }
+  for (j = nEntries - 1; j >= 1; --j) {
+    cache[j] = cache[j - 1];
+  }
+  memcpy(cache[0].digest, digest, 32);
+  memcpy(cache[0].fileKey, fileKey, 32);
+  cache[0].ownerPasswordOk = ownerPasswordOk;
+}
+
 //------------------------------------------------------------------------
 // DecryptStream
 //------------------------------------------------------------------------
@@ -502,6 +587,117 @@ int DecryptStream::lookChar() {
   return c;
 }
 
+// Decrypts straight into the caller's buffer: RC4 runs over the whole
+// block, and AES decrypts whole 16-byte blocks in place.  Only the
+// final AES block (which carries the padding) and requests shorter
+// than 16 bytes go through state.aes[256].buf.
+int DecryptStream::getBlock(char *blk, int size) {
+  Guchar in[16];
+  Guchar *p;
+  int *bufIdx;
+  Guchar *buf;
+  Guint *w;
+  Guchar *cbc;
+  GBool last, eof;
+  int nRounds, n, m, nBytes, nBlocks, i;
+
+  if (size <= 0) {
+    return 0;
+  }
+
+  if (algo == cryptRC4) {
+    n = 0;
+    if (state.rc4.buf != EOF) {
+      blk[n++] = (char)state.rc4.buf;
+      state.rc4.buf = EOF;
+    }
+    m = str->getBlock(blk + n, size - n);
+    rc4DecryptBlock(state.rc4.state, &state.rc4.x, &state.rc4.y,
+		    (Guchar *)blk + n, m);
+    return n + m;
+  }
+
+  if (algo == cryptAES) {
+    bufIdx = &state.aes.bufIdx;
+    buf = state.aes.buf;
+    w = state.aes.w;
+    cbc = state.aes.cbc;
+    nRounds = 10;
+  } else {
+    bufIdx = &state.aes256.bufIdx;
+    buf = state.aes256.buf;
+    w = state.aes256.w;
+    cbc = state.aes256.cbc;
+    nRounds = 14;
+  }
+  n = 0;
+  eof = gFalse;
+  while (n < size) {
+
+    // bytes left over from lookChar(), a short request, or the
+    // final block
+    if (*bufIdx < 16) {
+      m = 16 - *bufIdx;
+      if (m > size - n) {
+	m = size - n;
+      }
+      memcpy(blk + n, buf + *bufIdx, m);
+      *bufIdx += m;
+      n += m;
+      continue;
+    }
+    if (eof) {
+      break;
+    }
+
+    // less than one block wanted -- decrypt into buf
+    nBytes = (size - n) & ~15;
+    if (nBytes == 0) {
+      if (str->getBlock((char *)in, 16) != 16) {
+	break;
+      }
+      last = str->lookChar() == EOF;
+      if (algo == cryptAES) {
+	aesDecryptBlock(&state.aes, in, last);
+      } else {
+	aes256DecryptBlock(&state.aes256, in, last);
+      }
+      continue;
+    }
+
+    // read as many whole blocks as fit and decrypt them in place;
+    // the last block of the stream is held back so its padding can
+    // be removed
+    p = (Guchar *)blk + n;
+    m = str->getBlock((char *)p, nBytes);
+    if (m < nBytes) {
+      eof = gTrue;
+    }
+    nBlocks = m / 16;
+    if (nBlocks == 0) {
+      break;
+    }
+    last = !(m & 15) && str->lookChar() == EOF;
+    if (last) {
+      --nBlocks;
+    }
+    for (i = 0; i < nBlocks; ++i) {
+      aesDecryptBlockCBC(w, nRounds, cbc, p + 16 * i, p + 16 * i);
+    }
+    n += 16 * nBlocks;
+    if (last) {
+      memcpy(in, p + 16 * nBlocks, 16);
+      if (algo == cryptAES) {
+	aesDecryptBlock(&state.aes, in, gTrue);
+      } else {
+	aes256DecryptBlock(&state.aes256, in, gTrue);
+      }
+      eof = gTrue;
+    }
+  }
+  return n;
+}
+
 GBool DecryptStream::isBinary(GBool last) {
   return str->isBinary(last);
 }
@@ -539,6 +735,27 @@ Guchar rc4DecryptByte(Guchar *state, Guchar *x, Guchar *y, Guchar c) {
   return c ^ state[(tx + ty) % 256];
 }
 
+// Decrypt <len> bytes of <buf> in place.
+static void rc4DecryptBlock(Guchar *state, Guchar *x, Guchar *y,
+			    Guchar *buf, int len) {
+  Guchar x1, y1, tx, ty;
+  int i;
+
+  x1 = *x;
+  y1 = *y;
+  for (i = 0; i < len; ++i) {
+    x1 = (Guchar)(x1 + 1);
+    tx = state[x1];
+    y1 = (Guchar)(tx + y1);
+    ty = state[y1];
+    state[x1] = ty;
+    state[y1] = tx;
+    buf[i] ^= state[(Guchar)(tx + ty)];
+  }
+  *x = x1;
+  *y = y1;
+}
+
 //------------------------------------------------------------------------
 // AES decryption
 //------------------------------------------------------------------------
@@ -581,6 +798,45 @@ static Guchar invSbox[256] = {
   0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
 };
 
+// InvSubBytes followed by InvMixColumns for a byte in row 0 of a
+// column: {0e, 09, 0d, 0b} * invSbox[x], row 0 in the high byte.  The
+// entries for rows 1-3 are the same words rotated right by 8, 16, and
+// 24 bits.
+static Guint invTab[256] = {
+  0x51f4a750, 0x7e416553, 0x1a17a4c3, 0x3a275e96, 0x3bab6bcb, 0x1f9d45f1, 0xacfa58ab, 0x4be30393,
+  0x2030fa55, 0xad766df6, 0x88cc7691, 0xf5024c25, 0x4fe5d7fc, 0xc52acbd7, 0x26354480, 0xb562a38f,
+  0xdeb15a49, 0x25ba1b67, 0x45ea0e98, 0x5dfec0e1, 0xc32f7502, 0x814cf012, 0x8d4697a3, 0x6bd3f9c6,
+  0x038f5fe7, 0x15929c95, 0xbf6d7aeb, 0x955259da, 0xd4be832d, 0x587421d3, 0x49e06929, 0x8ec9c844,
+  0x75c2896a, 0xf48e7978, 0x99583e6b, 0x27b971dd, 0xbee14fb6, 0xf088ad17, 0xc920ac66, 0x7dce3ab4,
+  0x63df4a18, 0xe51a3182, 0x97513360, 0x62537f45, 0xb16477e0, 0xbb6bae84, 0xfe81a01c, 0xf9082b94,
+  0x70486858, 0x8f45fd19, 0x94de6c87, 0x527bf8b7, 0xab73d323, 0x724b02e2, 0xe31f8f57, 0x6655ab2a,
+  0xb2eb2807, 0x2fb5c203, 0x86c57b9a, 0xd33708a5, 0x302887f2, 0x23bfa5b2, 0x02036aba, 0xed16825c,
+  0x8acf1c2b, 0xa779b492, 0xf307f2f0, 0x4e69e2a1, 0x65daf4cd, 0x0605bed5, 0xd134621f, 0xc4a6fe8a,
+  0x342e539d, 0xa2f355a0, 0x058ae132, 0xa4f6eb75, 0x0b83ec39, 0x4060efaa, 0x5e719f06, 0xbd6e1051,
+  0x3e218af9, 0x96dd063d, 0xdd3e05ae, 0x4de6bd46, 0x91548db5, 0x71c45d05, 0x0406d46f, 0x605015ff,
+  0x1998fb24, 0xd6bde997, 0x894043cc, 0x67d99e77, 0xb0e842bd, 0x07898b88, 0xe7195b38, 0x79c8eedb,
+  0xa17c0a47, 0x7c420fe9, 0xf8841ec9, 0x00000000, 0x09808683, 0x322bed48, 0x1e1170ac, 0x6c5a724e,
+  0xfd0efffb, 0x0f853856, 0x3daed51e, 0x362d3927, 0x0a0fd964, 0x685ca621, 0x9b5b54d1, 0x24362e3a,
+  0x0c0a67b1, 0x9357e70f, 0xb4ee96d2, 0x1b9b919e, 0x80c0c54f, 0x61dc20a2, 0x5a774b69, 0x1c121a16,
+  0xe293ba0a, 0xc0a02ae5, 0x3c22e043, 0x121b171d, 0x0e090d0b, 0xf28bc7ad, 0x2db6a8b9, 0x141ea9c8,
+  0x57f11985, 0xaf75074c, 0xee99ddbb, 0xa37f60fd, 0xf701269f, 0x5c72f5bc, 0x44663bc5, 0x5bfb7e34,
+  0x8b432976, 0xcb23c6dc, 0xb6edfc68, 0xb8e4f163, 0xd731dcca, 0x42638510, 0x13972240, 0x84c61120,
+  0x854a247d, 0xd2bb3df8, 0xaef93211, 0xc729a16d, 0x1d9e2f4b, 0xdcb230f3, 0x0d8652ec, 0x77c1e3d0,
+  0x2bb3166c, 0xa970b999, 0x119448fa, 0x47e96422, 0xa8fc8cc4, 0xa0f03f1a, 0x567d2cd8, 0x223390ef,
+  0x87494ec7, 0xd938d1c1, 0x8ccaa2fe, 0x98d40b36, 0xa6f581cf, 0xa57ade28, 0xdab78e26, 0x3fadbfa4,
+  0x2c3a9de4, 0x5078920d, 0x6a5fcc9b, 0x547e4662, 0xf68d13c2, 0x90d8b8e8, 0x2e39f75e, 0x82c3aff5,
+  0x9f5d80be, 0x69d0937c, 0x6fd52da9, 0xcf2512b3, 0xc8ac993b, 0x10187da7, 0xe89c636e, 0xdb3bbb7b,
+  0xcd267809, 0x6e5918f4, 0xec9ab701, 0x834f9aa8, 0xe6956e65, 0xaaffe67e, 0x21bccf08, 0xef15e8e6,
+  0xbae79bd9, 0x4a6f36ce, 0xea9f09d4, 0x29b07cd6, 0x31a4b2af, 0x2a3f2331, 0xc6a59430, 0x35a266c0,
+  0x744ebc37, 0xfc82caa6, 0xe090d0b0, 0x33a7d815, 0xf104984a, 0x41ecdaf7, 0x7fcd500e, 0x1791f62f,
+  0x764dd68d, 0x43efb04d, 0xccaa4d54, 0xe49604df, 0x9ed1b5e3, 0x4c6a881b, 0xc12c1fb8, 0x4665517f,
+  0x9d5eea04, 0x018c355d, 0xfa877473, 0xfb0b412e, 0xb3671d5a, 0x92dbd252, 0xe9105633, 0x6dd64713,
+  0x9ad7618c, 0x37a10c7a, 0x59f8148e, 0xeb133c89, 0xcea927ee, 0xb761c935, 0xe11ce5ed, 0x7a47b13c,
+  0x9cd2df59, 0x55f2733f, 0x1814ce79, 0x73c737bf, 0x53f7cdea, 0x5ffdaa5b, 0xdf3d6f14, 0x7844db86,
+  0xcaaff381, 0xb968c43e, 0x3824342c, 0xc2a3405f, 0x161dc372, 0xbce2250c, 0x283c498b, 0xff0d9541,
+  0x39a80171, 0x080cb3de, 0xd8b4e49c, 0x6456c190, 0x7bcb8461, 0xd532b670, 0x486c5c74, 0xd0b85742
+};
+
 static Guint rcon[11] = {
   0x00000000, // unused
   0x01000000,
@@ -614,14 +870,6 @@ static inline void subBytes(Guchar *state) {
   }
 }
 
-static inline void invSubBytes(Guchar *state) {
-  int i;
-
-  for (i = 0; i < 16; ++i) {
-    state[i] = invSbox[state[i]];
-  }
-}
-
 static inline void shiftRows(Guchar *state) {
   Guchar t;
 
@@ -645,29 +893,6 @@ static inline void shiftRows(Guchar *state) {
   state[12] = t;
 }
 
-static inline void invShiftRows(Guchar *state) {
-  Guchar t;
-
-  t = state[7];
-  state[7] = state[6];
-  state[6] = state[5];
-  state[5] = state[4];
-  state[4] = t;
-
-  t = state[8];
-  state[8] = state[10];
-  state[10] = t;
-  t = state[9];
-  state[9] = state[11];
-  state[11] = t;
-
-  t = state[12];
-  state[12] = state[13];
-  state[13] = state[14];
-  state[14] = state[15];
-  state[15] = t;
-}
-
 // {02} \cdot s
 static inline Guchar mul02(Guchar s) {
   Guchar s2;
@@ -740,22 +965,6 @@ static inline void mixColumns(Guchar *state) {
   }
 }
 
-static inline void invMixColumns(Guchar *state) {
-  int c;
-  Guchar s0, s1, s2, s3;
-
-  for (c = 0; c < 4; ++c) {
-    s0 = state[c];
-    s1 = state[4+c];
-    s2 = state[8+c];
-    s3 = state[12+c];
-    state[c] =    mul0e(s0) ^ mul0b(s1) ^ mul0d(s2) ^ mul09(s3);
-    state[4+c] =  mul09(s0) ^ mul0e(s1) ^ mul0b(s2) ^ mul0d(s3);
-    state[8+c] =  mul0d(s0) ^ mul09(s1) ^ mul0e(s2) ^ mul0b(s3);
-    state[12+c] = mul0b(s0) ^ mul0d(s1) ^ mul09(s2) ^ mul0e(s3);
-  }
-}
-
 static inline void invMixColumnsW(Guint *w) {
   int c;
   Guchar s0, s1, s2, s3;
@@ -783,6 +992,97 @@ static inline void addRoundKey(Guchar *state, Guint *w) {
   }
 }
 
+static inline Guint getColumn(Guchar *p) {
+  return ((Guint)p[0] << 24) | ((Guint)p[1] << 16)
+         | ((Guint)p[2] << 8) | (Guint)p[3];
+}
+
+static inline void putColumn(Guchar *p, Guint x) {
+  p[0] = (Guchar)(x >> 24);
+  p[1] = (Guchar)(x >> 16);
+  p[2] = (Guchar)(x >> 8);
+  p[3] = (Guchar)x;
+}
+
+// One inner decryption round (InvShiftRows, InvSubBytes, InvMixColumns)
+// for one output column; <a>, <b>, <c>, <d> are the rows 0-3 input
+// bytes after InvShiftRows.
+static inline Guint invRound(Guint a, Guint b, Guint c, Guint d) {
+  Guint tb, tc, td;
+
+  tb = invTab[b];
+  tc = invTab[c];
+  td = invTab[d];
+  return invTab[a] ^ ((tb >> 8) | (tb << 24)) ^ ((tc >> 16) | (tc << 16))
+         ^ ((td >> 24) | (td << 8));
+}
+
+static inline Guint invLastRound(Guint a, Guint b, Guint c, Guint d) {
+  return ((Guint)invSbox[a] << 24) | ((Guint)invSbox[b] << 16)
+         | ((Guint)invSbox[c] << 8) | (Guint)invSbox[d];
+}
+
+// Decrypt one AES-CBC block, working on 32-bit columns with the
+// invTab lookup table.  <w> is the decryption key schedule, with
+// InvMixColumns already applied to the inner round keys; <nRounds> is
+// 10 for AES-128 and 14 for AES-256.  <in> and <out> may be the same
+// buffer.  <cbc> is replaced with the input block.
+static void aesDecryptBlockCBC(Guint *w, int nRounds, Guchar *cbc,
+			       Guchar *in, Guchar *out) {
+  Guint c0, c1, c2, c3, s0, s1, s2, s3, t0, t1, t2, t3;
+  Guint *rk;
+  int round;
+
+  c0 = getColumn(in);
+  c1 = getColumn(in + 4);
+  c2 = getColumn(in + 8);
+  c3 = getColumn(in + 12);
+
+  // round 0
+  rk = &w[nRounds * 4];
+  s0 = c0 ^ rk[0];
+  s1 = c1 ^ rk[1];
+  s2 = c2 ^ rk[2];
+  s3 = c3 ^ rk[3];
+
+  // rounds nRounds-1 .. 1
+  for (round = nRounds - 1; round >= 1; --round) {
+    rk = &w[round * 4];
+    t0 = invRound(s0 >> 24, (s3 >> 16) & 0xff, (s2 >> 8) & 0xff, s1 & 0xff)
+         ^ rk[0];
+    t1 = invRound(s1 >> 24, (s0 >> 16) & 0xff, (s3 >> 8) & 0xff, s2 & 0xff)
+         ^ rk[1];
+    t2 = invRound(s2 >> 24, (s1 >> 16) & 0xff, (s0 >> 8) & 0xff, s3 & 0xff)
+         ^ rk[2];
+    t3 = invRound(s3 >> 24, (s2 >> 16) & 0xff, (s1 >> 8) & 0xff, s0 & 0xff)
+         ^ rk[3];
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  // last round + CBC
+  t0 = invLastRound(s0 >> 24, (s3 >> 16) & 0xff, (s2 >> 8) & 0xff, s1 & 0xff)
+       ^ w[0];
+  t1 = invLastRound(s1 >> 24, (s0 >> 16) & 0xff, (s3 >> 8) & 0xff, s2 & 0xff)
+       ^ w[1];
+  t2 = invLastRound(s2 >> 24, (s1 >> 16) & 0xff, (s0 >> 8) & 0xff, s3 & 0xff)
+       ^ w[2];
+  t3 = invLastRound(s3 >> 24, (s2 >> 16) & 0xff, (s1 >> 8) & 0xff, s0 & 0xff)
+       ^ w[3];
+  putColumn(out, t0 ^ getColumn(cbc));
+  putColumn(out + 4, t1 ^ getColumn(cbc + 4));
+  putColumn(out + 8, t2 ^ getColumn(cbc + 8));
+  putColumn(out + 12, t3 ^ getColumn(cbc + 12));
+
+  // save the input block for the next CBC
+  putColumn(cbc, c0);
+  putColumn(cbc + 4, c1);
+  putColumn(cbc + 8, c2);
+  putColumn(cbc + 12, c3);
+}
+
 void aesKeyExpansion(DecryptAESState *s,
 		     Guchar *objKey, int objKeyLen,
 		     GBool decrypt) {
@@ -846,44 +1146,9 @@ void aesEncryptBlock(DecryptAESState *s, Guchar *in) {
 }
 
 void aesDecryptBlock(DecryptAESState *s, Guchar *in, GBool last) {
-  int c, round, n, i;
-
-  // initial state
-  for (c = 0; c < 4; ++c) {
-    s->state[c] = in[4*c];
-    s->state[4+c] = in[4*c+1];
-    s->state[8+c] = in[4*c+2];
-    s->state[12+c] = in[4*c+3];
-  }
-
-  // round 0
-  addRoundKey(s->state, &s->w[10 * 4]);
-
-  // rounds 1-9
-  for (round = 9; round >= 1; --round) {
-    invSubBytes(s->state);
-    invShiftRows(s->state);
-    invMixColumns(s->state);
-    addRoundKey(s->state, &s->w[round * 4]);
-  }
+  int n, i;
 
-  // round 10
-  invSubBytes(s->state);
-  invShiftRows(s->state);
-  addRoundKey(s->state, &s->w[0]);
-
-  // CBC
-  for (c = 0; c < 4; ++c) {
-    s->buf[4*c] = s->state[c] ^ s->cbc[4*c];
-    s->buf[4*c+1] = s->state[4+c] ^ s->cbc[4*c+1];
-    s->buf[4*c+2] = s->state[8+c] ^ s->cbc[4*c+2];
-    s->buf[4*c+3] = s->state[12+c] ^ s->cbc[4*c+3];
-  }
-
-  // save the input block for the next CBC
-  for (i = 0; i < 16; ++i) {
-    s->cbc[i] = in[i];
-  }
+  aesDecryptBlockCBC(s->w, 10, s->cbc, in, s->buf);
 
   // remove padding
   s->bufIdx = 0;
@@ -929,44 +1194,9 @@ static void aes256KeyExpansion(DecryptAES256State *s,
 }
 
 static void aes256DecryptBlock(DecryptAES256State *s, Guchar *in, GBool last) {
-  int c, round, n, i;
-
-  // initial state
-  for (c = 0; c < 4; ++c) {
-    s->state[c] = in[4*c];
-    s->state[4+c] = in[4*c+1];
-    s->state[8+c] = in[4*c+2];
-    s->state[12+c] = in[4*c+3];
-  }
-
-  // round 0
-  addRoundKey(s->state, &s->w[14 * 4]);
-
-  // rounds 13-1
-  for (round = 13; round >= 1; --round) {
-    invSubBytes(s->state);
-    invShiftRows(s->state);
-    invMixColumns(s->state);
-    addRoundKey(s->state, &s->w[round * 4]);
-  }
+  int n, i;
 
-  // round 14
-  invSubBytes(s->state);
-  invShiftRows(s->state);
-  addRoundKey(s->state, &s->w[0]);
-
-  // CBC
-  for (c = 0; c < 4; ++c) {
-    s->buf[4*c] = s->state[c] ^ s->cbc[4*c];
-    s->buf[4*c+1] = s->state[4+c] ^ s->cbc[4*c+1];
-    s->buf[4*c+2] = s->state[8+c] ^ s->cbc[4*c+2];
-    s->buf[4*c+3] = s->state[12+c] ^ s->cbc[4*c+3];
-  }
-
-  // save the input block for the next CBC
-  for (i = 0; i < 16; ++i) {
-    s->cbc[i] = in[i];
-  }
+  aesDecryptBlockCBC(s->w, 14, s->cbc, in, s->buf);
 
   // remove padding
   s->bufIdx = 0;
@@ -40,6 +40,17 @@ public:
 			   Guchar *fileKey, GBool encryptMetadata,
 			   GBool *ownerPasswordOk);
 
+  // Compute a SHA-256 digest of everything that goes into an AES-256
+  // (revision 5 or 6) file key, including the passwords, for use as a
+  // FileKeyCache key.  The <digest> buffer must have space for 32
+  // bytes.
+  static void makeFileKeyDigest(int encRevision,
+				GString *ownerKey, GString *userKey,
+				GString *ownerEnc, GString *userEnc,
+				int permissions, GBool encryptMetadata,
+				GString *ownerPassword, GString *userPassword,
+				Guchar *digest);
+
 private:
 
   static void r6Hash(Guchar *key, int keyLen, const char *pwd, int pwdLen,
@@ -51,6 +62,45 @@ private:
 			    GBool encryptMetadata);
 };
 
+//------------------------------------------------------------------------
+// FileKeyCache
+//------------------------------------------------------------------------
+
+#define fileKeyCacheSize 8
+
+struct FileKeyCacheEntry {
+  Guchar digest[32];		// Decrypt::makeFileKeyDigest
+  Guchar fileKey[32];
+  GBool ownerPasswordOk;
+};
+
+// Validated file keys of recently opened AES-256 documents.  Deriving
+// a revision 6 key runs the (deliberately slow) r6Hash loop for each
+// password check, so re-opening the same document with the same
+// passwords looks the key up here instead.  Access is serialized by
+// GlobalParams.
+class FileKeyCache {
+public:
+
+  FileKeyCache();
+  ~FileKeyCache();
+
+  // Look up <digest>.  If found, copies the key to <fileKey> (which
+  // must have space for 32 bytes), sets <ownerPasswordOk>, and
+  // returns true.
+  GBool lookup(Guchar *digest, Guchar *fileKey, GBool *ownerPasswordOk);
+
+  // Add a key, dropping the least recently used one if the cache is
+  // full.
+  void add(Guchar *digest, Guchar *fileKey, GBool ownerPasswordOk);
+
+private:
+
+  FileKeyCacheEntry cache[fileKeyCacheSize];	// most recently used
+						//   first
+  int nEntries;
+};
+
 //------------------------------------------------------------------------
 // DecryptStream
 //------------------------------------------------------------------------
@@ -89,6 +139,7 @@ public:
   virtual void reset();
   virtual int getChar();
   virtual int lookChar();
+  virtual int getBlock(char *blk, int size);
   virtual GBool isBinary(GBool last);
   virtual Stream *getUndecodedStream() { return this; }
 
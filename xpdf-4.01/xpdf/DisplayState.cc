@@ -27,13 +27,15 @@
 //------------------------------------------------------------------------
 
 DisplayState::DisplayState(int maxTileWidthA, int maxTileHeightA,
-			   int tileCacheSizeA, int nWorkerThreadsA,
+			   int tileCacheSizeA, int tileCacheMemoryA,
+			   int nWorkerThreadsA,
 			   SplashColorMode colorModeA, int bitmapRowPadA) {
   int i;
 
   maxTileWidth = maxTileWidthA;
   maxTileHeight = maxTileHeightA;
   tileCacheSize = tileCacheSizeA;
+  tileCacheMemory = tileCacheMemoryA;
   nWorkerThreads = nWorkerThreadsA;
   colorMode = colorModeA;
   bitmapRowPad = bitmapRowPadA;
@@ -77,7 +77,8 @@ class DisplayState {
 public:
 
   DisplayState(int maxTileWidthA, int maxTileHeightA,
-	       int tileCacheSizeA, int nWorkerThreadsA,
+	       int tileCacheSizeA, int tileCacheMemoryA,
+	       int nWorkerThreadsA,
 	       SplashColorMode colorModeA, int bitmapRowPadA);
   ~DisplayState();
 
@@ -107,6 +108,7 @@ public:
   int getMaxTileWidth() { return maxTileWidth; }
   int getMaxTileHeight() { return maxTileHeight; }
   int getTileCacheSize() { return tileCacheSize; }
+  int getTileCacheMemory() { return tileCacheMemory; }
   int getNWorkerThreads() { return nWorkerThreads; }
   SplashColorMode getColorMode() { return colorMode; }
   int getBitmapRowPad() { return bitmapRowPad; }
@@ -140,6 +142,7 @@ private:
 
   int maxTileWidth, maxTileHeight;
   int tileCacheSize;
+  int tileCacheMemory;		// in MB; 0 = no prefetching, no limit
   int nWorkerThreads;
 
   SplashColorMode colorMode;
@@ -36,11 +36,13 @@
 //------------------------------------------------------------------------
 
 Function::Function()
-	: m(0), n(0), domain(), range(), hasRange(gFalse)
+	: m(0), n(0), domain(), range(), hasRange(gFalse), cache(NULL),
+	  cacheMul(0)
 {
 }
 
 Function::~Function() {
+  gfree(cache);
 }
 
 Function *Function::parse(Object *funcObj, int recursion) {
@@ -173,6 +175,85 @@ GBool Function::init(Dict *dict) {
   return gFalse;
 }
 
+void Function::transformSpan(double *in, double *out, int count) {
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    transform(in + i * m, out + i * n);
+  }
+}
+
+// Set up the output cache, with all entries holding the result <out>
+// for the input value <in>.
+void Function::initCache(double in, double *out) {
+  double *e;
+  int i, j;
+
+  if (domain[0][1] > domain[0][0]) {
+    cacheMul = (funcCacheSize - 1) / (domain[0][1] - domain[0][0]);
+  } else {
+    cacheMul = 0;
+  }
+  cache = (double *)gmallocn(funcCacheSize * (n + 1), sizeof(double));
+  e = cache;
+  for (i = 0; i < funcCacheSize; ++i) {
+    e[0] = in;
+    for (j = 0; j < n; ++j) {
+      e[1 + j] = out[j];
+    }
+    e += n + 1;
+  }
+}
+
+// Copy the output cache of <func> (called by the copy constructors,
+// after copying the object).
+void Function::copyCache(Function *func) {
+  if (func->cache) {
+    cache = (double *)gmallocn(funcCacheSize * (n + 1), sizeof(double));
+    memcpy(cache, func->cache, funcCacheSize * (n + 1) * sizeof(double));
+  } else {
+    cache = NULL;
+  }
+}
+
+// Map an input value to an output cache entry.
+inline double *Function::getCacheEntry(double in) {
+  double x;
+
+  x = (in - domain[0][0]) * cacheMul + 0.5;
+  if (!(x >= 0)) {	// this also catches NaNs
+    x = 0;
+  } else if (x > funcCacheSize - 1) {
+    x = funcCacheSize - 1;
+  }
+  return cache + (int)x * (n + 1);
+}
+
+GBool Function::lookupCache(double in, double *out) {
+  double *e;
+  int i;
+
+  e = getCacheEntry(in);
+  if (memcmp(e, &in, sizeof(double))) {
+    return gFalse;
+  }
+  for (i = 0; i < n; ++i) {
+    out[i] = e[1 + i];
+  }
+  return gTrue;
+}
+
+void Function::saveCache(double in, double *out) {
+  double *e;
+  int i;
+
+  e = getCacheEntry(in);
+  e[0] = in;
+  for (i = 0; i < n; ++i) {
+    e[1 + i] = out[i];
+  }
+}
+
 //------------------------------------------------------------------------
 // IdentityFunction
 //------------------------------------------------------------------------
@@ -396,6 +477,9 @@ SampledFunction::SampledFunction(Object *funcObj, Dict *dict) {
     cacheIn[i] = in[i] - 1;
   }
   transform(in, cacheOut);
+  if (m == 1) {
+    initCache(in[0], cacheOut);
+  }
 
   ok = gTrue;
   return;
@@ -427,6 +511,7 @@ SampledFunction::SampledFunction(SampledFunction *func) {
   samples = (double *)gmallocn(nSamples, sizeof(double));
   memcpy(samples, func->samples, nSamples * sizeof(double));
   sBuf = (double *)gmallocn(1 << m, sizeof(double));
+  copyCache(func);
 }
 
 void SampledFunction::transform(double *in, double *out) {
@@ -437,16 +522,22 @@ void SampledFunction::transform(double *in, double *out) {
   int i, j, k, idx0, t;
 
   // check the cache
-  for (i = 0; i < m; ++i) {
-    if (in[i] != cacheIn[i]) {
-      break;
+  if (cache) {
+    if (lookupCache(in[0], out)) {
+      return;
     }
-  }
-  if (i == m) {
-    for (i = 0; i < n; ++i) {
-      out[i] = cacheOut[i];
+  } else {
+    for (i = 0; i < m; ++i) {
+      if (in[i] != cacheIn[i]) {
+	break;
+      }
+    }
+    if (i == m) {
+      for (i = 0; i < n; ++i) {
+	out[i] = cacheOut[i];
+      }
+      return;
     }
-    return;
   }
 
   // map input values into sample array
@@ -498,11 +589,59 @@ void SampledFunction::transform(double *in, double *out) {
   }
 
   // save current result in the cache
-  for (i = 0; i < m; ++i) {
-    cacheIn[i] = in[i];
+  if (cache) {
+    saveCache(in[0], out);
+  } else {
+    for (i = 0; i < m; ++i) {
+      cacheIn[i] = in[i];
+    }
+    for (i = 0; i < n; ++i) {
+      cacheOut[i] = out[i];
+    }
   }
-  for (i = 0; i < n; ++i) {
-    cacheOut[i] = out[i];
+}
+
+// This does the same computation as transform(), but the common
+// one-input case is done without the per-call overhead.
+void SampledFunction::transformSpan(double *in, double *out, int count) {
+  double x, efrac0, efrac1, y;
+  double *s0, *s1;
+  int e, i, j;
+
+  if (m != 1) {
+    Function::transformSpan(in, out, count);
+    return;
+  }
+  for (j = 0; j < count; ++j) {
+
+    // map input value into sample array
+    x = (in[j] - domain[0][0]) * inputMul[0] + encode[0][0];
+    if (x < 0 || x != x) {
+      x = 0;
+    } else if (x > sampleSize[0] - 1) {
+      x = sampleSize[0] - 1;
+    }
+    e = (int)x;
+    if (e == sampleSize[0] - 1 && sampleSize[0] > 1) {
+      e = sampleSize[0] - 2;
+    }
+    efrac1 = x - e;
+    efrac0 = 1 - efrac1;
+
+    // interpolate, and map output values to range
+    s0 = samples + e * n + idxOffset[0];
+    s1 = samples + e * n + idxOffset[1];
+    for (i = 0; i < n; ++i) {
+      y = efrac0 * s0[i] + efrac1 * s1[i];
+      y = y * (decode[i][1] - decode[i][0]) + decode[i][0];
+      if (y < range[i][0]) {
+	y = range[i][0];
+      } else if (y > range[i][1]) {
+	y = range[i][1];
+      }
+      out[i] = y;
+    }
+    out += n;
   }
 }
 
@@ -847,6 +986,8 @@ void StitchingFunction::transform(double *in, double *out) {
 #define psOpPush     40
 #define psOpJ        41
 #define psOpJz       42
+// the move op is only used in compiled code
+#define psOpMove     43
 
 #define nPSOps (sizeof(psOpNames) / sizeof(const char *))
 
@@ -907,16 +1048,528 @@ struct PSCode {
 
 #define psStackSize 100
 
+// Evaluate an op (other than the stack, push, and jump ops), with
+// operands <a> and <b> (where <b> is the top of the stack).  Unary
+// ops only use <a>.  This is shared by the compiler (for constant
+// folding) and the compiled code, and computes the same results as
+// PostScriptFunction::exec().
+static inline double psEval(int op, double a, double b) {
+  int k, nn;
+
+  switch (op) {
+  case psOpAbs:
+    return fabs(a);
+  case psOpAdd:
+    return a + b;
+  case psOpAnd:
+    return (int)a & (int)b;
+  case psOpAtan:
+    return atan2(a, b);
+  case psOpBitshift:
+    k = (int)a;
+    nn = (int)b;
+    if (nn > 0) {
+      return k << nn;
+    } else if (nn < 0) {
+      return k >> -nn;
+    } else {
+      return k;
+    }
+  case psOpCeiling:
+    return ceil(a);
+  case psOpCos:
+    return cos(a);
+  case psOpCvi:
+    return (int)a;
+  case psOpDiv:
+    return a / b;
+  case psOpEq:
+    return a == b ? 1 : 0;
+  case psOpExp:
+    return pow(a, b);
+  case psOpFloor:
+    return floor(a);
+  case psOpGe:
+    return a >= b ? 1 : 0;
+  case psOpGt:
+    return a > b ? 1 : 0;
+  case psOpIdiv:
+    // (avoid the overflow trap on INT_MIN / -1)
+    k = (int)b;
+    return k == -1 ? -(double)(int)a : (int)a / k;
+  case psOpLe:
+    return a <= b ? 1 : 0;
+  case psOpLn:
+    return log(a);
+  case psOpLog:
+    return log10(a);
+  case psOpLt:
+    return a < b ? 1 : 0;
+  case psOpMod:
+    k = (int)b;
+    return k == -1 ? 0 : (int)a % k;
+  case psOpMul:
+    return a * b;
+  case psOpNe:
+    return a != b ? 1 : 0;
+  case psOpNeg:
+    return -a;
+  case psOpNot:
+    return a == 0 ? 1 : 0;
+  case psOpOr:
+    return (int)a | (int)b;
+  case psOpRound:
+    return (a >= 0) ? floor(a + 0.5) : ceil(a - 0.5);
+  case psOpSin:
+    return sin(a);
+  case psOpSqrt:
+    return sqrt(a);
+  case psOpSub:
+    return a - b;
+  case psOpTruncate:
+    return (a >= 0) ? floor(a) : ceil(a);
+  case psOpXor:
+    return (int)a ^ (int)b;
+  default:
+    return 0;
+  }
+}
+
+//------------------------------------------------------------------------
+// PSCompiler
+//------------------------------------------------------------------------
+
+// The compiled code works on a register file instead of a stack.
+// The compiler tracks the stack contents as a list of registers:
+// the stack manipulation ops (dup, exch, copy, index, roll, pop)
+// only rearrange this list, and ops with constant operands (and
+// 'if'/'ifelse' with a constant condition) are evaluated at compile
+// time.  Registers 0 .. psStackSize-1 hold the stack slots (bottom
+// first) on entry, where they hold the inputs, and wherever two
+// branches join.  The constants are stored in the register file by
+// the compiler.
+//
+// Code that could fail at run time -- stack underflow or overflow,
+// copy/index/roll with non-constant args, or idiv/mod with a
+// non-constant divisor -- isn't compiled, so it still gets the
+// interpreter's error handling.
+
+struct PSInstr {
+  int op;			// psOpXXX, including psOpMove
+  int dst;			// destination register, or jump target
+  int a, b;			// source registers
+};
+
+class PSCompiler {
+public:
+
+  PSCompiler(PSCode *codeA, int codeLenA);
+  ~PSCompiler();
+
+  // Compile the code for a function with <m> inputs and <n> outputs.
+  // Returns false if the code can't be compiled.
+  GBool compile(int m, int n);
+
+  PSInstr *prog;		// compiled code
+  int progLen;
+  double *regs;			// register file
+  int nRegs;
+  int out[funcMaxOutputs];	// output registers
+
+private:
+
+  GBool compileBlock(int start, int end, int *stk, int *depth);
+  int newReg();
+  int newConst(double x);
+  int emit(int op, int dst, int a, int b);
+  void materialize(int *stk, int depth);
+
+  PSCode *code;
+  int codeLen;
+  int progSize;
+  GBool *isConst;		// set for registers holding constants
+  int regsSize;
+};
+
+PSCompiler::PSCompiler(PSCode *codeA, int codeLenA) {
+  code = codeA;
+  codeLen = codeLenA;
+  prog = NULL;
+  progLen = progSize = 0;
+  regsSize = 2 * psStackSize;
+  regs = (double *)gmallocn(regsSize, sizeof(double));
+  isConst = (GBool *)gmallocn(regsSize, sizeof(GBool));
+  memset(regs, 0, psStackSize * sizeof(double));
+  memset(isConst, 0, psStackSize * sizeof(GBool));
+  nRegs = psStackSize;
+}
+
+PSCompiler::~PSCompiler() {
+  gfree(prog);
+  gfree(regs);
+  gfree(isConst);
+}
+
+GBool PSCompiler::compile(int m, int n) {
+  int stk[psStackSize];
+  int depth, i;
+
+  for (i = 0; i < m; ++i) {
+    stk[i] = i;
+  }
+  depth = m;
+  if (!compileBlock(0, codeLen, stk, &depth) || depth < n) {
+    return gFalse;
+  }
+  for (i = 0; i < n; ++i) {
+    out[i] = stk[depth - n + i];
+  }
+  return gTrue;
+}
+
+// Compile code[start .. end-1], with the stack contents <stk>[0 ..
+// *<depth>-1] (bottom first).  Updates <stk> and <depth>.
+GBool PSCompiler::compileBlock(int start, int end, int *stk, int *depth) {
+  PSCode *c;
+  int tmp[psStackSize], stk1[psStackSize], stk2[psStackSize];
+  int ip, a, b, r, k, nn, i;
+  int target, thenEnd, elseEnd, depth1, depth2, jz, j;
+
+  ip = start;
+  while (ip < end) {
+    c = &code[ip++];
+    switch (c->op) {
+
+    case psOpPush:
+    case psOpTrue:
+    case psOpFalse:
+      if (*depth >= psStackSize) {
+	return gFalse;
+      }
+      stk[(*depth)++] = newConst(c->op == psOpPush ? c->val.d :
+				 c->op == psOpTrue ? 1 : 0);
+      break;
+
+    case psOpDup:
+      if (*depth < 1 || *depth >= psStackSize) {
+	return gFalse;
+      }
+      stk[*depth] = stk[*depth - 1];
+      ++*depth;
+      break;
+
+    case psOpExch:
+      if (*depth < 2) {
+	return gFalse;
+      }
+      r = stk[*depth - 1];
+      stk[*depth - 1] = stk[*depth - 2];
+      stk[*depth - 2] = r;
+      break;
+
+    case psOpPop:
+      if (*depth < 1) {
+	return gFalse;
+      }
+      --*depth;
+      break;
+
+    case psOpCvr:
+      if (*depth < 1) {
+	return gFalse;
+      }
+      break;
+
+    case psOpCopy:
+      if (*depth < 1 || !isConst[stk[*depth - 1]]) {
+	return gFalse;
+      }
+      nn = (int)regs[stk[--*depth]];
+      if (nn < 0 || nn > *depth || *depth + nn > psStackSize) {
+	return gFalse;
+      }
+      for (i = 0; i < nn; ++i) {
+	stk[*depth + i] = stk[*depth - nn + i];
+      }
+      *depth += nn;
+      break;
+
+    case psOpIndex:
+      if (*depth < 1 || !isConst[stk[*depth - 1]]) {
+	return gFalse;
+      }
+      k = (int)regs[stk[*depth - 1]];
+      if (k < 0 || k >= *depth - 1) {
+	return gFalse;
+      }
+      stk[*depth - 1] = stk[*depth - 2 - k];
+      break;
+
+    case psOpRoll:
+      if (*depth < 2 ||
+	  !isConst[stk[*depth - 1]] || !isConst[stk[*depth - 2]]) {
+	return gFalse;
+      }
+      k = (int)regs[stk[*depth - 1]];
+      nn = (int)regs[stk[*depth - 2]];
+      *depth -= 2;
+      if (nn < 0 || nn > *depth) {
+	return gFalse;
+      }
+      if (nn == 0) {
+	break;
+      }
+      if (k >= 0) {
+	k %= nn;
+      } else {
+	k = -k % nn;
+	if (k) {
+	  k = nn - k;
+	}
+      }
+      // stk[*depth - 1 - i] is the i-th entry from the top
+      for (i = 0; i < nn; ++i) {
+	tmp[i] = stk[*depth - 1 - i];
+      }
+      for (i = 0; i < nn; ++i) {
+	stk[*depth - 1 - i] = tmp[(i + k) % nn];
+      }
+      break;
+
+    case psOpAbs:
+    case psOpCeiling:
+    case psOpCos:
+    case psOpCvi:
+    case psOpFloor:
+    case psOpLn:
+    case psOpLog:
+    case psOpNeg:
+    case psOpNot:
+    case psOpRound:
+    case psOpSin:
+    case psOpSqrt:
+    case psOpTruncate:
+      if (*depth < 1) {
+	return gFalse;
+      }
+      a = stk[*depth - 1];
+      if (isConst[a]) {
+	r = newConst(psEval(c->op, regs[a], 0));
+      } else {
+	r = newReg();
+	emit(c->op, r, a, a);
+      }
+      stk[*depth - 1] = r;
+      break;
+
+    case psOpAdd:
+    case psOpAnd:
+    case psOpAtan:
+    case psOpBitshift:
+    case psOpDiv:
+    case psOpEq:
+    case psOpExp:
+    case psOpGe:
+    case psOpGt:
+    case psOpIdiv:
+    case psOpLe:
+    case psOpLt:
+    case psOpMod:
+    case psOpMul:
+    case psOpNe:
+    case psOpOr:
+    case psOpSub:
+    case psOpXor:
+      if (*depth < 2) {
+	return gFalse;
+      }
+      a = stk[*depth - 2];
+      b = stk[*depth - 1];
+      // integer division by zero is an error
+      if ((c->op == psOpIdiv || c->op == psOpMod) &&
+	  (!isConst[b] || (int)regs[b] == 0)) {
+	return gFalse;
+      }
+      if (isConst[a] && isConst[b]) {
+	r = newConst(psEval(c->op, regs[a], regs[b]));
+      } else {
+	r = newReg();
+	emit(c->op, r, a, b);
+      }
+      --*depth;
+      stk[*depth - 1] = r;
+      break;
+
+    case psOpJ:
+      // 'ifelse' is handled below, so this can only be a jump to the
+      // next op (from an empty 'else' block)
+      if (c->val.i != ip) {
+	return gFalse;
+      }
+      break;
+
+    case psOpJz:
+      if (*depth < 1) {
+	return gFalse;
+      }
+      r = stk[--*depth];
+
+      // 'if' is compiled to:      Jz L1; <then>; L1:
+      // 'ifelse' is compiled to:  Jz L1; <then>; J L2; L1: <else>; L2:
+      target = c->val.i;
+      if (target < ip || target > end) {
+	return gFalse;
+      }
+      if (target > ip && code[target - 1].op == psOpJ &&
+	  code[target - 1].val.i > target) {
+	thenEnd = target - 1;
+	elseEnd = code[target - 1].val.i;
+	if (elseEnd > end) {
+	  return gFalse;
+	}
+      } else {
+	thenEnd = elseEnd = target;
+      }
+
+      if (isConst[r]) {
+	if ((int)regs[r] != 0) {
+	  if (!compileBlock(ip, thenEnd, stk, depth)) {
+	    return gFalse;
+	  }
+	} else {
+	  if (!compileBlock(target, elseEnd, stk, depth)) {
+	    return gFalse;
+	  }
+	}
+
+      } else {
+	// the condition register must survive materialize()
+	if (r < *depth && stk[r] != r) {
+	  a = newReg();
+	  emit(psOpMove, a, r, r);
+	  r = a;
+	}
+	materialize(stk, *depth);
+	jz = emit(psOpJz, 0, r, r);
+	depth1 = *depth;
+	for (i = 0; i < depth1; ++i) {
+	  stk1[i] = i;
+	}
+	if (!compileBlock(ip, thenEnd, stk1, &depth1)) {
+	  return gFalse;
+	}
+	materialize(stk1, depth1);
+	if (elseEnd > target) {
+	  j = emit(psOpJ, 0, 0, 0);
+	  prog[jz].dst = progLen;
+	  depth2 = *depth;
+	  for (i = 0; i < depth2; ++i) {
+	    stk2[i] = i;
+	  }
+	  if (!compileBlock(target, elseEnd, stk2, &depth2)) {
+	    return gFalse;
+	  }
+	  materialize(stk2, depth2);
+	  if (depth2 != depth1) {
+	    return gFalse;
+	  }
+	  prog[j].dst = progLen;
+	} else {
+	  if (depth1 != *depth) {
+	    return gFalse;
+	  }
+	  prog[jz].dst = progLen;
+	}
+	*depth = depth1;
+	for (i = 0; i < *depth; ++i) {
+	  stk[i] = i;
+	}
+      }
+      ip = elseEnd;
+      break;
+
+    default:
+      return gFalse;
+    }
+  }
+  return gTrue;
+}
+
+int PSCompiler::newReg() {
+  if (nRegs >= regsSize) {
+    regsSize *= 2;
+    regs = (double *)greallocn(regs, regsSize, sizeof(double));
+    isConst = (GBool *)greallocn(isConst, regsSize, sizeof(GBool));
+  }
+  regs[nRegs] = 0;
+  isConst[nRegs] = gFalse;
+  return nRegs++;
+}
+
+int PSCompiler::newConst(double x) {
+  int r;
+
+  r = newReg();
+  regs[r] = x;
+  isConst[r] = gTrue;
+  return r;
+}
+
+int PSCompiler::emit(int op, int dst, int a, int b) {
+  if (progLen >= progSize) {
+    if (progSize) {
+      progSize *= 2;
+    } else {
+      progSize = 16;
+    }
+    prog = (PSInstr *)greallocn(prog, progSize, sizeof(PSInstr));
+  }
+  prog[progLen].op = op;
+  prog[progLen].dst = dst;
+  prog[progLen].a = a;
+  prog[progLen].b = b;
+  return progLen++;
+}
+
+// Emit moves so that stack slot i is held in register i, and update
+// <stk> accordingly.
+void PSCompiler::materialize(int *stk, int depth) {
+  int i, r;
+
+  // first, save the slot registers that are used in other slots and
+  // are about to be overwritten
+  for (i = 0; i < depth; ++i) {
+    r = stk[i];
+    if (r != i && r < depth && stk[r] != r) {
+      stk[i] = newReg();
+      emit(psOpMove, stk[i], r, r);
+    }
+  }
+  for (i = 0; i < depth; ++i) {
+    if (stk[i] != i) {
+      emit(psOpMove, i, stk[i], stk[i]);
+      stk[i] = i;
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
 PostScriptFunction::PostScriptFunction(Object *funcObj, Dict *dict) {
   Stream *str;
   GList *tokens;
   GString *tok;
+  PSCompiler *compiler;
   double in[funcMaxInputs] = { 0 };
   int tokPtr, codePtr, i;
 
   codeString = NULL;
   code = NULL;
   codeSize = 0;
+  prog = NULL;
+  progLen = 0;
+  regs = NULL;
+  nRegs = 0;
   ok = gFalse;
 
   //----- initialize the generic stuff
@@ -952,17 +1605,39 @@ PostScriptFunction::PostScriptFunction(Object *funcObj, Dict *dict) {
   }
   tokPtr = 1;
   codePtr = 0;
+  // parseCode() stops if the code array is missing, so allocate it
+  // up front
+  codeSize = 16;
+  code = (PSCode *)gmallocn(codeSize, sizeof(PSCode));
   if (!parseCode(tokens, &tokPtr, &codePtr)) {
     goto err2;
   }
   codeLen = codePtr;
 
+  //----- compile the function
+  compiler = new PSCompiler(code, codeLen);
+  if (compiler->compile(m, n)) {
+    prog = compiler->prog;
+    progLen = compiler->progLen;
+    compiler->prog = NULL;
+    regs = compiler->regs;
+    nRegs = compiler->nRegs;
+    compiler->regs = NULL;
+    for (i = 0; i < n; ++i) {
+      progOut[i] = compiler->out[i];
+    }
+  }
+  delete compiler;
+
   //----- set up the cache
   for (i = 0; i < m; ++i) {
     in[i] = domain[i][0];
     cacheIn[i] = in[i] - 1;
   }
   transform(in, cacheOut);
+  if (m == 1) {
+    initCache(in[0], cacheOut);
+  }
 
   ok = gTrue;
 
@@ -975,6 +1650,10 @@ PostScriptFunction::PostScriptFunction(PostScriptFunction *func)
   : codeString(NULL)
   , code(NULL)
   , codeSize(0)
+  , prog(NULL)
+  , progLen(0)
+  , regs(NULL)
+  , nRegs(0)
   , ok(gFalse)
 {
   if (func && (func != this))
@@ -983,11 +1662,20 @@ PostScriptFunction::PostScriptFunction(PostScriptFunction *func)
     codeString = func->codeString->copy();
     code = (PSCode *)gmallocn(codeSize, sizeof(PSCode));
     memcpy(code, func->code, codeSize * sizeof(PSCode));
+    if (func->regs) {
+      prog = (PSInstr *)gmallocn(progLen, sizeof(PSInstr));
+      memcpy(prog, func->prog, progLen * sizeof(PSInstr));
+      regs = (double *)gmallocn(nRegs, sizeof(double));
+      memcpy(regs, func->regs, nRegs * sizeof(double));
+    }
+    copyCache(func);
   }
 }
 
 PostScriptFunction::~PostScriptFunction() {
   gfree(code);
+  gfree(prog);
+  gfree(regs);
   if (codeString) {
     delete codeString;
   }
@@ -999,32 +1687,107 @@ void PostScriptFunction::transform(double *in, double *out) {
   int sp, i;
 
   // check the cache
-  for (i = 0; i < m; ++i) {
-    if (in[i] != cacheIn[i]) {
-      break;
+  if (cache) {
+    if (lookupCache(in[0], out)) {
+      return;
+    }
+  } else {
+    for (i = 0; i < m; ++i) {
+      if (in[i] != cacheIn[i]) {
+	break;
+      }
+    }
+    if (i == m) {
+      for (i = 0; i < n; ++i) {
+	out[i] = cacheOut[i];
+      }
+      return;
     }
   }
-  if (i == m) {
+
+  if (regs) {
+    run(in, out);
+  } else {
+    for (i = 0; i < m; ++i) {
+      stack[psStackSize - 1 - i] = in[i];
+    }
+    sp = exec(stack, psStackSize - m);
+    // if (sp < psStackSize - n) {
+    //   error(errSyntaxWarning, -1,
+    // 	    "Extra values on stack at end of PostScript function");
+    // }
+    if (sp > psStackSize - n) {
+      error(errSyntaxError, -1, "Stack underflow in PostScript function");
+      sp = psStackSize - n;
+    }
     for (i = 0; i < n; ++i) {
-      out[i] = cacheOut[i];
+      x = stack[sp + n - 1 - i];
+      if (x < range[i][0]) {
+	out[i] = range[i][0];
+      } else if (x > range[i][1]) {
+	out[i] = range[i][1];
+      } else {
+	out[i] = x;
+      }
     }
+  }
+
+  // save current result in the cache
+  if (cache) {
+    saveCache(in[0], out);
+  } else {
+    for (i = 0; i < m; ++i) {
+      cacheIn[i] = in[i];
+    }
+    for (i = 0; i < n; ++i) {
+      cacheOut[i] = out[i];
+    }
+  }
+}
+
+void PostScriptFunction::transformSpan(double *in, double *out, int count) {
+  int i;
+
+  if (!regs) {
+    Function::transformSpan(in, out, count);
     return;
   }
+  for (i = 0; i < count; ++i) {
+    run(in + i * m, out + i * n);
+  }
+}
+
+// Run the compiled code.
+void PostScriptFunction::run(double *in, double *out) {
+  PSInstr *p;
+  double x;
+  int ip, i;
 
   for (i = 0; i < m; ++i) {
-    stack[psStackSize - 1 - i] = in[i];
+    regs[i] = in[i];
   }
-  sp = exec(stack, psStackSize - m);
-  // if (sp < psStackSize - n) {
-  //   error(errSyntaxWarning, -1,
-  // 	  "Extra values on stack at end of PostScript function");
-  // }
-  if (sp > psStackSize - n) {
-    error(errSyntaxError, -1, "Stack underflow in PostScript function");
-    sp = psStackSize - n;
+  ip = 0;
+  while (ip < progLen) {
+    p = &prog[ip++];
+    switch (p->op) {
+    case psOpMove:
+      regs[p->dst] = regs[p->a];
+      break;
+    case psOpJ:
+      ip = p->dst;
+      break;
+    case psOpJz:
+      if ((int)regs[p->a] == 0) {
+	ip = p->dst;
+      }
+      break;
+    default:
+      regs[p->dst] = psEval(p->op, regs[p->a], regs[p->b]);
+      break;
+    }
   }
   for (i = 0; i < n; ++i) {
-    x = stack[sp + n - 1 - i];
+    x = regs[progOut[i]];
     if (x < range[i][0]) {
       out[i] = range[i][0];
     } else if (x > range[i][1]) {
@@ -1033,14 +1796,6 @@ void PostScriptFunction::transform(double *in, double *out) {
       out[i] = x;
     }
   }
-
-  // save current result in the cache
-  for (i = 0; i < m; ++i) {
-    cacheIn[i] = in[i];
-  }
-  for (i = 0; i < n; ++i) {
-    cacheOut[i] = out[i];
-  }
 }
 
 GBool PostScriptFunction::parseCode(GList *tokens, int *tokPtr, int *codePtr) {
@@ -1295,7 +2050,7 @@ int PostScriptFunction::exec(double *stack, int sp0) {
       if (nn < 0) {
 	goto invalidArg;
       }
-      if (sp + nn > psStackSize) {
+      if (nn > psStackSize - sp) {
 	goto underflow;
       }
       if (sp - nn < 0) {
@@ -1393,7 +2148,13 @@ int PostScriptFunction::exec(double *stack, int sp0) {
       if (sp + 1 >= psStackSize) {
 	goto underflow;
       }
-      stack[sp + 1] = (int)stack[sp + 1] / (int)stack[sp];
+      k = (int)stack[sp];
+      if (k == 0) {
+	goto invalidArg;
+      }
+      // (avoid the overflow trap on INT_MIN / -1)
+      stack[sp + 1] = k == -1 ? -(double)(int)stack[sp + 1]
+	                      : (int)stack[sp + 1] / k;
       ++sp;
       break;
     case psOpIndex:
@@ -1404,7 +2165,7 @@ int PostScriptFunction::exec(double *stack, int sp0) {
       if (k < 0) {
 	goto invalidArg;
       }
-      if (sp + 1 + k >= psStackSize) {
+      if (k >= psStackSize - sp - 1) {
 	goto underflow;
       }
       stack[sp] = stack[sp + 1 + k];
@@ -1439,7 +2200,11 @@ int PostScriptFunction::exec(double *stack, int sp0) {
       if (sp + 1 >= psStackSize) {
 	goto underflow;
       }
-      stack[sp + 1] = (int)stack[sp + 1] % (int)stack[sp];
+      k = (int)stack[sp];
+      if (k == 0) {
+	goto invalidArg;
+      }
+      stack[sp + 1] = k == -1 ? 0 : (int)stack[sp + 1] % k;
       ++sp;
       break;
     case psOpMul:
@@ -1490,9 +2255,12 @@ int PostScriptFunction::exec(double *stack, int sp0) {
       if (nn < 0) {
 	goto invalidArg;
       }
-      if (sp + nn > psStackSize) {
+      if (nn > psStackSize - sp) {
 	goto underflow;
       }
+      if (nn == 0) {
+	break;
+      }
       if (k >= 0) {
 	k %= nn;
       } else {
@@ -22,6 +22,7 @@ class GList;
 class Dict;
 class Stream;
 struct PSCode;
+struct PSInstr;
 
 //------------------------------------------------------------------------
 // Function
@@ -31,6 +32,9 @@ struct PSCode;
 #define funcMaxOutputs       32
 #define sampledFuncMaxInputs 16
 
+// number of entries in the output cache of one-input functions
+#define funcCacheSize        256
+
 class Function {
 public:
 
@@ -67,16 +71,36 @@ public:
   // Transform an input tuple into an output tuple.
   virtual void transform(double *in, double *out) = 0;
 
+  // Transform <count> input tuples into output tuples.  The tuples
+  // are packed, i.e., <in> holds <count> * m values and <out> holds
+  // <count> * n values.  The results are the same as calling
+  // transform() on each tuple.
+  virtual void transformSpan(double *in, double *out, int count);
+
   virtual GBool isOk() = 0;
 
 protected:
 
+  // The output cache for one-input functions is a table over the
+  // domain, with funcCacheSize entries, each holding an input value
+  // and the n output values.  Inputs that come from 8-bit values
+  // (image samples, lookup tables) get one entry per level.  Inputs
+  // are compared bitwise, so a hit always returns exactly what
+  // transform() would compute.
+  void initCache(double in, double *out);
+  void copyCache(Function *func);
+  double *getCacheEntry(double in);
+  GBool lookupCache(double in, double *out);
+  void saveCache(double in, double *out);
+
   int m, n;			// size of input and output tuples
   double			// min and max values for function domain
     domain[funcMaxInputs][2];
   double			// min and max values for function range
     range[funcMaxOutputs][2];
   GBool hasRange;		// set if range is defined
+  double *cache;		// output cache (NULL if not used)
+  double cacheMul;		// maps the domain to the cache entries
 };
 
 //------------------------------------------------------------------------
@@ -108,6 +132,7 @@ public:
   virtual Function *copy() { return new SampledFunction(this); }
   virtual int getType() { return 0; }
   virtual void transform(double *in, double *out);
+  virtual void transformSpan(double *in, double *out, int count);
   virtual GBool isOk() { return ok; }
 
   int getSampleSize(int i) { return sampleSize[i]; }
@@ -210,6 +235,7 @@ public:
   virtual Function *copy() { return new PostScriptFunction(this); }
   virtual int getType() { return 4; }
   virtual void transform(double *in, double *out);
+  virtual void transformSpan(double *in, double *out, int count);
   virtual GBool isOk() { return ok; }
 
   GString *getCodeString() { return codeString; }
@@ -223,11 +249,22 @@ private:
   void addCodeD(int *codePtr, int op, double x);
   GString *getToken(Stream *str);
   int exec(double *stack, int sp0);
+  void run(double *in, double *out);
 
   GString *codeString;
   PSCode *code;
   int codeLen;
   int codeSize;
+
+  // The code is compiled (see PSCompiler) into register code, with
+  // constant folding, if it can't fail at run time; otherwise, regs
+  // is NULL and the code is interpreted by exec().
+  PSInstr *prog;		// compiled code
+  int progLen;
+  double *regs;			// register file, including the constants
+  int nRegs;
+  int progOut[funcMaxOutputs];	// registers holding the outputs
+
   double cacheIn[funcMaxInputs];
   double cacheOut[funcMaxOutputs];
   GBool ok;
@@ -38,6 +38,7 @@
 #include "OptionalContent.h"
 #include "Error.h"
 #include "TextString.h"
+#include "ContentStreamCache.h"
 #include "Gfx.h"
 
 // the MSVC math.h doesn't define this
@@ -268,6 +269,35 @@ Operator Gfx::opTab[] = {
 
 #define numOps (sizeof(opTab) / sizeof(Operator))
 
+// Perfect hash for the operator names in opTab.  All operator names
+// are one to three chars long; they are packed into an integer (first
+// char in the low byte), multiplied by opHashMul, and the top eight
+// bits of the product are used to index opHashTab, which gives the
+// index into opTab (or opHashEmpty).  opHashTab must be regenerated
+// (by searching for a multiplier with no collisions) whenever opTab
+// is changed.
+#define opHashMul   0x7f4ce3af
+#define opHashEmpty 255
+
+static Guchar opHashTab[256] = {
+  255,255, 37,255,255,255, 63, 13,255,255,255,255,  7,255,255,255,
+  255,255,255,255,255,255,255,255,255, 24,255,255,255,255,255,255,
+  255,255,255,255, 49,255,255, 11,255,255,255, 72, 71,255,255, 66,
+   62, 29,255, 60,255, 58, 56, 53,255, 65, 45,255, 12,255,  9,255,
+    8,255,255, 41,255, 25,255, 23,255,255, 21, 20,255,255, 17, 38,
+  255, 22,255,255,255, 52,255,255, 44,255,255,255,255,255,255,255,
+  255,255, 28,255,  1, 26,255, 34,255, 40,255,255, 69,255,255,  3,
+  255, 50,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+  255, 32, 36, 39,255,255,255,255,255,  6, 14,255,255,255,255,255,
+  255,255,255,255,255,255,255,255, 31,255,255, 35,255,255,255, 64,
+  255,255,255,255,255,255,255,255,255,255,255,255,255, 70,255,255,
+  255,255,255, 61, 59, 57,255, 55, 51, 18, 48, 43,255, 15,  5,255,
+   68,255, 54,255, 27, 47,255,255,255,255,255,255, 19,255, 33, 16,
+  255,  2,255,255,255,  4,255, 10,255,255,255,255,255,255,255,255,
+   42,255,255,255,255,255,255,255,  0,255,255, 67,255,255,255,255,
+  255,255,255,255,255,255,255, 46,255,255,255,255,255,255,255, 30
+};
+
 //------------------------------------------------------------------------
 // GfxResources
 //------------------------------------------------------------------------
@@ -504,6 +534,7 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, int pageNum, Dict *resDict,
   xref = doc->getXRef();
   subPage = gFalse;
   printCommands = globalParams->getPrintCommands();
+  cachePageContent = globalParams->getCachePageContent();
 
   // start the resource stack
   res = new GfxResources(xref, resDict, NULL);
@@ -551,6 +582,7 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, Dict *resDict,
   xref = doc->getXRef();
   subPage = gTrue;
   printCommands = globalParams->getPrintCommands();
+  cachePageContent = globalParams->getCachePageContent();
 
   // start the resource stack
   res = new GfxResources(xref, resDict, NULL);
@@ -601,6 +633,7 @@ Gfx::~Gfx() {
 }
 
 void Gfx::display(Object *objRef, GBool topLevel) {
+  CompiledContentStream *content;
   Object obj1, obj2;
   int i;
 
@@ -637,10 +670,19 @@ void Gfx::display(Object *objRef, GBool topLevel) {
     obj1.free();
     return;
   }
-  parser = new Parser(xref, new Lexer(xref, &obj1), gFalse);
-  go(topLevel);
-  delete parser;
-  parser = NULL;
+  // forms, patterns, etc. are run from the pre-tokenized cache; the
+  // page content is parsed directly unless cachePageContent is set
+  if ((!topLevel || cachePageContent) &&
+      (content = getCompiledContentStream(objRef, &obj1))) {
+    parser = NULL;
+    goCompiled(content);
+    content->decRefCnt();
+  } else {
+    parser = new Parser(xref, new Lexer(xref, &obj1), gFalse);
+    go(topLevel);
+    delete parser;
+    parser = NULL;
+  }
   contentStreamStack->del(contentStreamStack->getLength() - 1);
   obj1.free();
 }
@@ -772,16 +814,136 @@ void Gfx::go(GBool topLevel) {
   }
 }
 
+// Return the pre-tokenized version of the content stream (or array
+// of content streams) <str>, compiling it and adding it to the
+// document's cache if needed.  Returns NULL if the stream has to be
+// parsed directly.
+CompiledContentStream *Gfx::getCompiledContentStream(Object *strRef,
+						     Object *str) {
+  ContentStreamCache *cache;
+  CompiledContentStream *content;
+  GString *key;
+  GBool uncacheable;
+
+  if (printCommands || !(cache = doc->getContentStreamCache()) ||
+      !(key = ContentStreamCache::makeKey(strRef))) {
+    return NULL;
+  }
+  if (!(content = cache->lookup(key, &uncacheable)) && !uncacheable) {
+    if ((content = compileContentStream(str))) {
+      cache->add(key, content);
+    } else {
+      cache->setUncacheable(key);
+    }
+  }
+  delete key;
+  return content;
+}
+
+// Tokenize the content stream <str> into a CompiledContentStream.
+// Returns NULL if the stream contains inline images (whose data can't
+// be tokenized).
+CompiledContentStream *Gfx::compileContentStream(Object *str) {
+  CompiledContentStream *content;
+  Object obj;
+  Object args[maxArgs];
+  int numArgs, i;
+
+  content = new CompiledContentStream();
+  parser = new Parser(xref, new Lexer(xref, str), gFalse);
+  numArgs = 0;
+  parser->getObj(&obj);
+  while (!obj.isEOF()) {
+    if (obj.isCmd()) {
+      if (obj.isCmd("BI")) {
+	obj.free();
+	for (i = 0; i < numArgs; ++i) {
+	  args[i].free();
+	}
+	delete parser;
+	parser = NULL;
+	delete content;
+	return NULL;
+      }
+      content->addOp(findOpIdx(obj.getCmd()), args, numArgs, &obj);
+      numArgs = 0;
+    } else if (numArgs < maxArgs) {
+      args[numArgs++] = obj;
+    } else {
+      error(errSyntaxError, getPos(), "Too many args in content stream");
+      obj.free();
+    }
+    parser->getObj(&obj);
+  }
+  obj.free();
+  if (numArgs > 0) {
+    error(errSyntaxError, getPos(), "Leftover args in content stream");
+    for (i = 0; i < numArgs; ++i) {
+      args[i].free();
+    }
+  }
+  delete parser;
+  parser = NULL;
+  return content;
+}
+
+// Execute a pre-tokenized content stream.  This is the equivalent of
+// go() for a CompiledContentStream.
+void Gfx::goCompiled(CompiledContentStream *content) {
+  CompiledContentOp *op;
+  Operator *opPtr;
+  char *name;
+  int errCount, i;
+
+  opCounter = 0;
+  errCount = 0;
+  for (i = 0; i < content->getNumOps(); ++i) {
+
+    // check for an abort
+    ++opCounter;
+    if (abortCheckCbk && opCounter > 100) {
+      if ((*abortCheckCbk)(abortCheckCbkData)) {
+	break;
+      }
+      opCounter = 0;
+    }
+
+    op = content->getOp(i);
+    if (op->opIdx >= 0) {
+      opPtr = &opTab[op->opIdx];
+      name = opPtr->name;
+    } else {
+      opPtr = NULL;
+      name = content->getCmdName(op);
+    }
+    if (!execOp(opPtr, name, content->getArgs(op), op->numArgs)) {
+      ++errCount;
+    }
+
+    // check for too many errors
+    if (errCount > contentStreamErrorLimit) {
+      error(errSyntaxError, -1,
+	    "Too many errors - giving up on this content stream");
+      break;
+    }
+  }
+}
+
 // Returns true if successful, false on error.
 GBool Gfx::execOp(Object *cmd, Object args[], int numArgs) {
-  Operator *op;
   char *name;
-  Object *argPtr;
-  int i;
 
   // find operator
   name = cmd->getCmd();
-  if (!(op = findOp(name))) {
+  return execOp(findOp(name), name, args, numArgs);
+}
+
+// Returns true if successful, false on error.
+GBool Gfx::execOp(Operator *op, char *name, Object args[], int numArgs) {
+  Object *argPtr;
+  int i;
+
+  if (!op) {
     if (ignoreUndef > 0) {
       return gTrue;
     }
@@ -829,25 +991,35 @@ GBool Gfx::execOp(Object *cmd, Object args[], int numArgs) {
 }
 
 Operator *Gfx::findOp(char *name) {
-  int a, b, m, cmp;
-
-  a = -1;
-  b = numOps;
-  cmp = 0; // make gcc happy
-  // invariant: opTab[a] < name < opTab[b]
-  while (b - a > 1) {
-    m = (a + b) / 2;
-    cmp = strcmp(opTab[m].name, name);
-    if (cmp < 0)
-      a = m;
-    else if (cmp > 0)
-      b = m;
-    else
-      a = b = m;
-  }
-  if (cmp != 0)
+  int idx;
+
+  if ((idx = findOpIdx(name)) < 0) {
     return NULL;
-  return &opTab[a];
+  }
+  return &opTab[idx];
+}
+
+// Returns the index of operator <name> in opTab, or -1 if it isn't
+// defined.
+int Gfx::findOpIdx(char *name) {
+  Guint key;
+  int idx;
+
+  key = (Guchar)name[0];
+  if (name[0] && name[1]) {
+    key |= (Guint)(Guchar)name[1] << 8;
+    if (name[2]) {
+      if (name[3]) {
+	return -1;
+      }
+      key |= (Guint)(Guchar)name[2] << 16;
+    }
+  }
+  idx = opHashTab[(Guint)(key * opHashMul) >> 24];
+  if (idx == opHashEmpty || strcmp(opTab[idx].name, name)) {
+    return -1;
+  }
+  return idx;
 }
 
 GBool Gfx::checkArg(Object *arg, TchkType type) {
@@ -34,6 +34,7 @@ class GfxFont;
 class Gfx;
 class PDFRectangle;
 class AnnotBorderStyle;
+class CompiledContentStream;
 
 //------------------------------------------------------------------------
 
@@ -187,6 +188,8 @@ private:
   OutputDev *out;		// output device
   GBool subPage;		// is this a sub-page object?
   GBool printCommands;		// print the drawing commands (for debugging)
+  GBool cachePageContent;	// run page contents from the pre-tokenized
+				//   content stream cache
   GfxResources *res;		// resource stack
   int opCounter;		// operation counter (used to decide when
 				//   to check for an abort)
@@ -214,8 +217,14 @@ private:
 
   GBool checkForContentStreamLoop(Object *ref);
   void go(GBool topLevel);
+  CompiledContentStream *getCompiledContentStream(Object *strRef,
+						  Object *str);
+  CompiledContentStream *compileContentStream(Object *str);
+  void goCompiled(CompiledContentStream *content);
   GBool execOp(Object *cmd, Object args[], int numArgs);
+  GBool execOp(Operator *op, char *name, Object args[], int numArgs);
   Operator *findOp(char *name);
+  int findOpIdx(char *name);
   GBool checkArg(Object *arg, TchkType type);
   GFileOffset getPos();
 
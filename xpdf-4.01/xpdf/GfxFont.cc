@@ -207,6 +207,7 @@ GfxFont::GfxFont(char *tagA, Ref idA, GString *nameA,
   embFontID = embFontIDA;
   embFontName = NULL;
   hasToUnicode = gFalse;
+  refCnt = 1;
 }
 
 GfxFont::~GfxFont() {
@@ -219,6 +220,27 @@ GfxFont::~GfxFont() {
   }
 }
 
+void GfxFont::incRefCnt() {
+#if MULTITHREADED
+  gAtomicIncrement(&refCnt);
+#else
+  ++refCnt;
+#endif
+}
+
+void GfxFont::decRefCnt() {
+  GBool done;
+
+#if MULTITHREADED
+  done = gAtomicDecrement(&refCnt) == 0;
+#else
+  done = --refCnt == 0;
+#endif
+  if (done) {
+    delete this;
+  }
+}
+
 // This function extracts three pieces of information:
 // 1. the "expected" font type, i.e., the font type implied by
 //    Font.Subtype, DescendantFont.Subtype, and
@@ -2087,7 +2109,7 @@ GfxFontDict::GfxFontDict(XRef *xref, Ref *fontDictRef, Dict *fontDict) {
       }
       if ((font = GfxFont::makeFont(xref, tag, r, obj2.getDict()))) {
 	if (!font->isOk()) {
-	  delete font;
+	  font->decRefCnt();
 	} else {
 	  uniqueFonts->append(font);
 	  fonts->add(new GString(tag), font);
@@ -2100,7 +2122,12 @@ GfxFontDict::GfxFontDict(XRef *xref, Ref *fontDictRef, Dict *fontDict) {
 }
 
 GfxFontDict::~GfxFontDict() {
-  deleteGList(uniqueFonts, GfxFont);
+  int i;
+
+  for (i = 0; i < uniqueFonts->getLength(); ++i) {
+    ((GfxFont *)uniqueFonts->get(i))->decRefCnt();
+  }
+  delete uniqueFonts;
   delete fonts;
 }
 
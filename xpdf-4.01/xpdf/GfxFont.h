@@ -19,6 +19,9 @@
 #include "GString.h"
 #include "Object.h"
 #include "CharTypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
 
 class GList;
 class GHash;
@@ -138,6 +141,11 @@ public:
 
   virtual ~GfxFont();
 
+  // The font is deleted when the last reference is dropped (the
+  // GfxFontDict holds one reference).
+  void incRefCnt();
+  void decRefCnt();
+
   GBool isOk() { return ok; }
 
   // Get font tag.
@@ -234,6 +242,11 @@ protected:
   double descent;		// max depth below baseline
   GBool hasToUnicode;		// true if the font has a ToUnicode map
   GBool ok;
+#if MULTITHREADED
+  GAtomicCounter refCnt;
+#else
+  int refCnt;
+#endif
 };
 
 //------------------------------------------------------------------------
@@ -31,6 +31,18 @@
 // loops in the color space object structure.
 #define colorSpaceRecursionLimit 8
 
+// Number of colors converted at a time by the get*Line functions of
+// the Indexed, Separation, and DeviceN color spaces.
+#define colorLineChunk 32
+
+// Number of entries in the GfxImageColorMap pixel cache (must be a
+// power of two).
+#define pixelCacheSize 4096
+
+// Number of lines converted without the pixel cache after a line with
+// a low hit rate.
+#define pixelCacheSkipLines 16
+
 
 //------------------------------------------------------------------------
 
@@ -191,6 +203,33 @@ void GfxColorSpace::getDefaultRanges(double *decodeLow, double *decodeRange,
   }
 }
 
+void GfxColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+				GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    getGray(&in[i], &out[i], ri);
+  }
+}
+
+void GfxColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			       GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    getRGB(&in[i], &out[i], ri);
+  }
+}
+
+void GfxColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+				GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    getCMYK(&in[i], &out[i], ri);
+  }
+}
+
 int GfxColorSpace::getNumColorSpaceModes() {
   return nGfxColorSpaceModes;
 }
@@ -233,6 +272,33 @@ void GfxDeviceGrayColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = clip01(gfxColorComp1 - color->c[0]);
 }
 
+void GfxDeviceGrayColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+					  GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxDeviceGrayColorSpace::getGray(&in[i], &out[i], ri);
+  }
+}
+
+void GfxDeviceGrayColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+					 GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxDeviceGrayColorSpace::getRGB(&in[i], &out[i], ri);
+  }
+}
+
+void GfxDeviceGrayColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+					  GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxDeviceGrayColorSpace::getCMYK(&in[i], &out[i], ri);
+  }
+}
+
 
 
 void GfxDeviceGrayColorSpace::getDefaultColor(GfxColor *color) {
@@ -332,6 +398,33 @@ void GfxCalGrayColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = clip01(gfxColorComp1 - color->c[0]);
 }
 
+void GfxCalGrayColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+				       GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxCalGrayColorSpace::getGray(&in[i], &out[i], ri);
+  }
+}
+
+void GfxCalGrayColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+				      GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxCalGrayColorSpace::getRGB(&in[i], &out[i], ri);
+  }
+}
+
+void GfxCalGrayColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+				       GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxCalGrayColorSpace::getCMYK(&in[i], &out[i], ri);
+  }
+}
+
 
 
 void GfxCalGrayColorSpace::getDefaultColor(GfxColor *color) {
@@ -390,6 +483,33 @@ void GfxDeviceRGBColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = k;
 }
 
+void GfxDeviceRGBColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+					 GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxDeviceRGBColorSpace::getGray(&in[i], &out[i], ri);
+  }
+}
+
+void GfxDeviceRGBColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+					GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxDeviceRGBColorSpace::getRGB(&in[i], &out[i], ri);
+  }
+}
+
+void GfxDeviceRGBColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+					 GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxDeviceRGBColorSpace::getCMYK(&in[i], &out[i], ri);
+  }
+}
+
 
 
 void GfxDeviceRGBColorSpace::getDefaultColor(GfxColor *color) {
@@ -537,6 +657,33 @@ void GfxCalRGBColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = k;
 }
 
+void GfxCalRGBColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+				      GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxCalRGBColorSpace::getGray(&in[i], &out[i], ri);
+  }
+}
+
+void GfxCalRGBColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+				     GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxCalRGBColorSpace::getRGB(&in[i], &out[i], ri);
+  }
+}
+
+void GfxCalRGBColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+				      GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxCalRGBColorSpace::getCMYK(&in[i], &out[i], ri);
+  }
+}
+
 
 
 void GfxCalRGBColorSpace::getDefaultColor(GfxColor *color) {
@@ -642,6 +789,33 @@ void GfxDeviceCMYKColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = clip01(color->c[3]);
 }
 
+void GfxDeviceCMYKColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+					  GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxDeviceCMYKColorSpace::getGray(&in[i], &out[i], ri);
+  }
+}
+
+void GfxDeviceCMYKColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+					 GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxDeviceCMYKColorSpace::getRGB(&in[i], &out[i], ri);
+  }
+}
+
+void GfxDeviceCMYKColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+					  GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxDeviceCMYKColorSpace::getCMYK(&in[i], &out[i], ri);
+  }
+}
+
 
 
 void GfxDeviceCMYKColorSpace::getDefaultColor(GfxColor *color) {
@@ -839,6 +1013,33 @@ void GfxLabColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = k;
 }
 
+void GfxLabColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+				   GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxLabColorSpace::getGray(&in[i], &out[i], ri);
+  }
+}
+
+void GfxLabColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+				  GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxLabColorSpace::getRGB(&in[i], &out[i], ri);
+  }
+}
+
+void GfxLabColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+				   GfxRenderingIntent ri) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    GfxLabColorSpace::getCMYK(&in[i], &out[i], ri);
+  }
+}
+
 
 
 void GfxLabColorSpace::getDefaultColor(GfxColor *color) {
@@ -995,6 +1196,21 @@ void GfxICCBasedColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   alt->getCMYK(color, cmyk, ri);
 }
 
+void GfxICCBasedColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+					GfxRenderingIntent ri) {
+  alt->getGrayLine(in, out, n, ri);
+}
+
+void GfxICCBasedColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+				       GfxRenderingIntent ri) {
+  alt->getRGBLine(in, out, n, ri);
+}
+
+void GfxICCBasedColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+					GfxRenderingIntent ri) {
+  alt->getCMYKLine(in, out, n, ri);
+}
+
 
 
 void GfxICCBasedColorSpace::getDefaultColor(GfxColor *color) {
@@ -1186,6 +1402,48 @@ void GfxIndexedColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   base->getCMYK(mapColorToBase(color, &color2), cmyk, ri);
 }
 
+void GfxIndexedColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+				       GfxRenderingIntent ri) {
+  GfxColor color2[colorLineChunk];
+  int i, j, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    for (j = 0; j < m; ++j) {
+      mapColorToBase(&in[i + j], &color2[j]);
+    }
+    base->getGrayLine(color2, out + i, m, ri);
+  }
+}
+
+void GfxIndexedColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+				      GfxRenderingIntent ri) {
+  GfxColor color2[colorLineChunk];
+  int i, j, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    for (j = 0; j < m; ++j) {
+      mapColorToBase(&in[i + j], &color2[j]);
+    }
+    base->getRGBLine(color2, out + i, m, ri);
+  }
+}
+
+void GfxIndexedColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+				       GfxRenderingIntent ri) {
+  GfxColor color2[colorLineChunk];
+  int i, j, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    for (j = 0; j < m; ++j) {
+      mapColorToBase(&in[i + j], &color2[j]);
+    }
+    base->getCMYKLine(color2, out + i, m, ri);
+  }
+}
+
 
 
 void GfxIndexedColorSpace::getDefaultColor(GfxColor *color) {
@@ -1344,6 +1602,67 @@ void GfxSeparationColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   alt->getCMYK(&color2, cmyk, ri);
 }
 
+void GfxSeparationColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+					  GfxRenderingIntent ri) {
+  GfxColor color2[colorLineChunk];
+  int i, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    mapLineToAlt(in + i, color2, m);
+    alt->getGrayLine(color2, out + i, m, ri);
+  }
+}
+
+void GfxSeparationColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+					 GfxRenderingIntent ri) {
+  GfxColor color2[colorLineChunk];
+  int i, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    mapLineToAlt(in + i, color2, m);
+    alt->getRGBLine(color2, out + i, m, ri);
+  }
+}
+
+void GfxSeparationColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+					  GfxRenderingIntent ri) {
+  GfxColor color2[colorLineChunk];
+  int i, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    mapLineToAlt(in + i, color2, m);
+    alt->getCMYKLine(color2, out + i, m, ri);
+  }
+}
+
+// Apply the tint transform to <n> (<= colorLineChunk) colors.  Unused
+// function inputs and missing outputs are set to zero.
+void GfxSeparationColorSpace::mapLineToAlt(GfxColor *in, GfxColor *out,
+					   int n) {
+  double x[colorLineChunk * funcMaxInputs];
+  double c[colorLineChunk * funcMaxOutputs];
+  int m, nOut, nAlt, i, j;
+
+  m = func->getInputSize();
+  nOut = func->getOutputSize();
+  nAlt = alt->getNComps();
+  for (j = 0; j < n; ++j) {
+    x[j * m] = colToDbl(in[j].c[0]);
+    for (i = 1; i < m; ++i) {
+      x[j * m + i] = 0;
+    }
+  }
+  func->transformSpan(x, c, n);
+  for (j = 0; j < n; ++j) {
+    for (i = 0; i < nAlt; ++i) {
+      out[j].c[i] = (i < nOut) ? dblToCol(c[j * nOut + i]) : 0;
+    }
+  }
+}
+
 
 
 void GfxSeparationColorSpace::getDefaultColor(GfxColor *color) {
@@ -1550,6 +1869,66 @@ void GfxDeviceNColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   alt->getCMYK(&color2, cmyk, ri);
 }
 
+void GfxDeviceNColorSpace::getGrayLine(GfxColor *in, GfxGray *out, int n,
+				       GfxRenderingIntent ri) {
+  GfxColor color2[colorLineChunk];
+  int i, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    mapLineToAlt(in + i, color2, m);
+    alt->getGrayLine(color2, out + i, m, ri);
+  }
+}
+
+void GfxDeviceNColorSpace::getRGBLine(GfxColor *in, GfxRGB *out, int n,
+				      GfxRenderingIntent ri) {
+  GfxColor color2[colorLineChunk];
+  int i, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    mapLineToAlt(in + i, color2, m);
+    alt->getRGBLine(color2, out + i, m, ri);
+  }
+}
+
+void GfxDeviceNColorSpace::getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+				       GfxRenderingIntent ri) {
+  GfxColor color2[colorLineChunk];
+  int i, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    mapLineToAlt(in + i, color2, m);
+    alt->getCMYKLine(color2, out + i, m, ri);
+  }
+}
+
+// Apply the tint transform to <n> (<= colorLineChunk) colors.  See
+// GfxSeparationColorSpace::mapLineToAlt.
+void GfxDeviceNColorSpace::mapLineToAlt(GfxColor *in, GfxColor *out,
+					int n) {
+  double x[colorLineChunk * funcMaxInputs];
+  double c[colorLineChunk * funcMaxOutputs];
+  int m, nOut, nAlt, i, j;
+
+  m = func->getInputSize();
+  nOut = func->getOutputSize();
+  nAlt = alt->getNComps();
+  for (j = 0; j < n; ++j) {
+    for (i = 0; i < m; ++i) {
+      x[j * m + i] = (i < nComps) ? colToDbl(in[j].c[i]) : 0;
+    }
+  }
+  func->transformSpan(x, c, n);
+  for (j = 0; j < n; ++j) {
+    for (i = 0; i < nAlt; ++i) {
+      out[j].c[i] = (i < nOut) ? dblToCol(c[j * nOut + i]) : 0;
+    }
+  }
+}
+
 
 
 void GfxDeviceNColorSpace::getDefaultColor(GfxColor *color) {
@@ -2169,6 +2548,38 @@ void GfxFunctionShading::getColor(double x, double y, GfxColor *color) {
   }
 }
 
+//------------------------------------------------------------------------
+
+// Evaluate the functions of an axial or radial shading at <count>
+// values of t, with the same results as the getColor() functions.
+static void getShadingColors(Function **funcs, int nFuncs,
+			     double *t, GfxColor *colors, int count) {
+  double *buf;
+  int nOut, nMax, i, j, k;
+
+  // NB: there can be one function with n outputs or n functions with
+  // one output each (where n = number of color components)
+  nMax = 0;
+  for (i = 0; i < nFuncs; ++i) {
+    if (funcs[i]->getOutputSize() > nMax) {
+      nMax = funcs[i]->getOutputSize();
+    }
+  }
+  buf = (double *)gmallocn(count, nMax * sizeof(double));
+  // the unused components are zero (dblToCol(0) == 0)
+  memset(colors, 0, count * sizeof(GfxColor));
+  for (i = 0; i < nFuncs; ++i) {
+    funcs[i]->transformSpan(t, buf, count);
+    nOut = funcs[i]->getOutputSize();
+    for (j = 0; j < count; ++j) {
+      for (k = 0; k < nOut && i + k < gfxColorMaxComps; ++k) {
+	colors[j].c[i + k] = dblToCol(buf[j * nOut + k]);
+      }
+    }
+  }
+  gfree(buf);
+}
+
 //------------------------------------------------------------------------
 // GfxAxialShading
 //------------------------------------------------------------------------
@@ -2334,6 +2745,10 @@ void GfxAxialShading::getColor(double t, GfxColor *color) {
   }
 }
 
+void GfxAxialShading::getColors(double *t, GfxColor *colors, int count) {
+  getShadingColors(funcs, nFuncs, t, colors, count);
+}
+
 //------------------------------------------------------------------------
 // GfxRadialShading
 //------------------------------------------------------------------------
@@ -2506,6 +2921,10 @@ void GfxRadialShading::getColor(double t, GfxColor *color) {
   }
 }
 
+void GfxRadialShading::getColors(double *t, GfxColor *colors, int count) {
+  getShadingColors(funcs, nFuncs, t, colors, count);
+}
+
 //------------------------------------------------------------------------
 // GfxShadingBitBuf
 //------------------------------------------------------------------------
@@ -3483,11 +3902,62 @@ void GfxPatchMeshShading::getColor(double *in, GfxColor *out) {
 // GfxImageColorMap
 //------------------------------------------------------------------------
 
+// Returns true if converting colors in <cs> involves a function or
+// other costly computation.
+static GBool hasCostlyConversion(GfxColorSpace *cs) {
+  switch (cs->getMode()) {
+  case csLab:
+  case csDeviceN:
+    return gTrue;
+  case csICCBased:
+    return hasCostlyConversion(((GfxICCBasedColorSpace *)cs)->getAlt());
+  default:
+    return gFalse;
+  }
+}
+
+// Convert <n> colors in <cs> to 8-bit gray, RGB, or CMYK (<nOutComps>
+// = 1, 3, or 4).  <n> must be at most colorLineChunk.
+static void convertColorLine(GfxColorSpace *cs, GfxColor *in, Guchar *out,
+			     int n, int nOutComps, GfxRenderingIntent ri) {
+  GfxGray gray[colorLineChunk];
+  GfxRGB rgb[colorLineChunk];
+  GfxCMYK cmyk[colorLineChunk];
+  int i;
+
+  switch (nOutComps) {
+  case 1:
+    cs->getGrayLine(in, gray, n, ri);
+    for (i = 0; i < n; ++i) {
+      out[i] = colToByte(gray[i]);
+    }
+    break;
+  case 3:
+    cs->getRGBLine(in, rgb, n, ri);
+    for (i = 0; i < n; ++i) {
+      out[i*3] = colToByte(rgb[i].r);
+      out[i*3 + 1] = colToByte(rgb[i].g);
+      out[i*3 + 2] = colToByte(rgb[i].b);
+    }
+    break;
+  case 4:
+    cs->getCMYKLine(in, cmyk, n, ri);
+    for (i = 0; i < n; ++i) {
+      out[i*4] = colToByte(cmyk[i].c);
+      out[i*4 + 1] = colToByte(cmyk[i].m);
+      out[i*4 + 2] = colToByte(cmyk[i].y);
+      out[i*4 + 3] = colToByte(cmyk[i].k);
+    }
+    break;
+  }
+}
+
 GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode,
 				   GfxColorSpace *colorSpaceA,
 				   int maxAllowedBits) {
   GfxIndexedColorSpace *indexedCS;
   GfxSeparationColorSpace *sepCS;
+  GfxDeviceNColorSpace *devNCS;
   int maxPixel, indexHigh;
   Guchar *indexedLookup;
   Function *sepFunc;
@@ -3512,6 +3982,10 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode,
     lookup[k] = NULL;
     lookup2[k] = NULL;
   }
+  usePixelCache = gFalse;
+  pixelCache = NULL;
+  pixelCacheSkip = 0;
+  pixelCacheRI = gfxRenderingIntentRelativeColorimetric;
 
   // get decode map
   colorSpace->getDefaultRanges(defaultLow, defaultRange, maxPixel);
@@ -3618,8 +4092,35 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode,
 	lookup2[k][i] = dblToCol(y[k]);
       }
     }
+  } else if (colorSpace->getMode() == csDeviceN && nComps == 1) {
+    // this uses the decoded values from the first lookup table, to
+    // match GfxDeviceNColorSpace::getRGB, etc.
+    devNCS = (GfxDeviceNColorSpace *)colorSpace;
+    colorSpace2 = devNCS->getAlt();
+    nComps2 = colorSpace2->getNComps();
+    sepFunc = devNCS->getTintTransformFunc();
+    for (k = 0; k < nComps2; ++k) {
+      lookup2[k] = (GfxColorComp *)gmallocn(maxPixel + 1,
+					    sizeof(GfxColorComp));
+    }
+    for (i = 0; i < funcMaxInputs; ++i) {
+      x[i] = 0;
+    }
+    for (i = 0; i <= maxPixel; ++i) {
+      x[0] = colToDbl(lookup[0][i]);
+      sepFunc->transform(x, y);
+      for (k = 0; k < nComps2; ++k) {
+	lookup2[k][i] = (k < sepFunc->getOutputSize()) ? dblToCol(y[k]) : 0;
+      }
+    }
   }
 
+  // Multi-component images in color spaces with costly conversions
+  // (tint transform functions, Lab) are converted through a cache,
+  // which is keyed by the 8-bit pixel values.
+  usePixelCache = !colorSpace2 && nComps > 1 &&
+                  hasCostlyConversion(colorSpace);
+
   return;
 
  err2:
@@ -3640,6 +4141,10 @@ GfxImageColorMap::GfxImageColorMap(GfxImageColorMap *colorMap) {
     lookup[k] = NULL;
     lookup2[k] = NULL;
   }
+  usePixelCache = colorMap->usePixelCache;
+  pixelCache = NULL;
+  pixelCacheSkip = 0;
+  pixelCacheRI = colorMap->pixelCacheRI;
   if (bits <= 8) {
     n = 1 << bits;
   } else {
@@ -3661,6 +4166,12 @@ GfxImageColorMap::GfxImageColorMap(GfxImageColorMap *colorMap) {
       lookup2[k] = (GfxColorComp *)gmallocn(n, sizeof(GfxColorComp));
       memcpy(lookup2[k], colorMap->lookup2[k], n * sizeof(GfxColorComp));
     }
+  } else if (colorSpace->getMode() == csDeviceN && colorMap->colorSpace2) {
+    colorSpace2 = ((GfxDeviceNColorSpace *)colorSpace)->getAlt();
+    for (k = 0; k < nComps2; ++k) {
+      lookup2[k] = (GfxColorComp *)gmallocn(n, sizeof(GfxColorComp));
+      memcpy(lookup2[k], colorMap->lookup2[k], n * sizeof(GfxColorComp));
+    }
   }
   for (i = 0; i < nComps; ++i) {
     decodeLow[i] = colorMap->decodeLow[i];
@@ -3677,6 +4188,7 @@ GfxImageColorMap::~GfxImageColorMap() {
     gfree(lookup[i]);
     gfree(lookup2[i]);
   }
+  gfree(pixelCache);
 }
 
 void GfxImageColorMap::getGray(Guchar *x, GfxGray *gray,
@@ -3743,87 +4255,128 @@ void GfxImageColorMap::getColor(Guchar *x, GfxColor *color) {
 
 void GfxImageColorMap::getGrayByteLine(Guchar *in, Guchar *out, int n,
 				       GfxRenderingIntent ri) {
-  GfxColor color;
-  GfxGray gray;
-  int i, j;
-
-  if (colorSpace2) {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps2; ++i) {
-	color.c[i] = lookup2[i][in[j]];
-      }
-      colorSpace2->getGray(&color, &gray, ri);
-      out[j] = colToByte(gray);
-    }
+  if (usePixelCache) {
+    getCachedByteLine(in, out, n, 1, ri);
   } else {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps; ++i) {
-	color.c[i] = lookup[i][in[j * nComps + i]];
-      }
-      colorSpace->getGray(&color, &gray, ri);
-      out[j] = colToByte(gray);
-    }
+    getByteLine(in, out, n, 1, ri);
   }
 }
 
 void GfxImageColorMap::getRGBByteLine(Guchar *in, Guchar *out, int n,
 				      GfxRenderingIntent ri) {
-  GfxColor color;
-  GfxRGB rgb;
-  int i, j;
+  if (usePixelCache) {
+    getCachedByteLine(in, out, n, 3, ri);
+  } else {
+    getByteLine(in, out, n, 3, ri);
+  }
+}
 
-  if (colorSpace2) {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps2; ++i) {
-	color.c[i] = lookup2[i][in[j]];
-      }
-      colorSpace2->getRGB(&color, &rgb, ri);
-      out[j*3] = colToByte(rgb.r);
-      out[j*3 + 1] = colToByte(rgb.g);
-      out[j*3 + 2] = colToByte(rgb.b);
-    }
+void GfxImageColorMap::getCMYKByteLine(Guchar *in, Guchar *out, int n,
+				       GfxRenderingIntent ri) {
+  if (usePixelCache) {
+    getCachedByteLine(in, out, n, 4, ri);
   } else {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps; ++i) {
-	color.c[i] = lookup[i][in[j * nComps + i]];
+    getByteLine(in, out, n, 4, ri);
+  }
+}
+
+// Convert a line of <n> pixels to gray, RGB, or CMYK (<nOutComps> =
+// 1, 3, or 4), in chunks of colorLineChunk pixels.
+void GfxImageColorMap::getByteLine(Guchar *in, Guchar *out, int n,
+				   int nOutComps, GfxRenderingIntent ri) {
+  GfxColor color[colorLineChunk];
+  int i, j, k, m;
+
+  for (i = 0; i < n; i += m) {
+    m = (n - i < colorLineChunk) ? n - i : colorLineChunk;
+    if (colorSpace2) {
+      for (j = 0; j < m; ++j) {
+	for (k = 0; k < nComps2; ++k) {
+	  color[j].c[k] = lookup2[k][in[i + j]];
+	}
+      }
+      convertColorLine(colorSpace2, color, out + i * nOutComps, m,
+		       nOutComps, ri);
+    } else {
+      for (j = 0; j < m; ++j) {
+	for (k = 0; k < nComps; ++k) {
+	  color[j].c[k] = lookup[k][in[(i + j) * nComps + k]];
+	}
       }
-      colorSpace->getRGB(&color, &rgb, ri);
-      out[j*3] = colToByte(rgb.r);
-      out[j*3 + 1] = colToByte(rgb.g);
-      out[j*3 + 2] = colToByte(rgb.b);
+      convertColorLine(colorSpace, color, out + i * nOutComps, m,
+		       nOutComps, ri);
     }
   }
 }
 
-void GfxImageColorMap::getCMYKByteLine(Guchar *in, Guchar *out, int n,
-				       GfxRenderingIntent ri) {
-  GfxColor color;
-  GfxCMYK cmyk;
-  int i, j;
+// Same as getByteLine, but through the pixel cache.  Each entry holds
+// the output type (nOutComps, or zero if the entry is unused), the
+// pixel's nComps input bytes, and four output bytes.  The pixels that
+// miss are queued, and converted colorLineChunk at a time.  If most
+// pixels miss (e.g., in photos), the cache is bypassed for the next
+// pixelCacheSkipLines lines.
+void GfxImageColorMap::getCachedByteLine(Guchar *in, Guchar *out, int n,
+					 int nOutComps,
+					 GfxRenderingIntent ri) {
+  GfxColor color[colorLineChunk];
+  Guchar buf[colorLineChunk * 4];
+  Guchar *entry[colorLineChunk];
+  int idx[colorLineChunk];
+  Guchar *p, *e;
+  Guint h;
+  int entrySize, nQueued, nHits, i, j, k;
+
+  if (pixelCacheSkip > 0) {
+    --pixelCacheSkip;
+    getByteLine(in, out, n, nOutComps, ri);
+    return;
+  }
+  entrySize = 1 + nComps + 4;
+  if (!pixelCache || ri != pixelCacheRI) {
+    if (!pixelCache) {
+      pixelCache = (Guchar *)gmallocn(pixelCacheSize, entrySize);
+    }
+    memset(pixelCache, 0, pixelCacheSize * entrySize);
+    pixelCacheRI = ri;
+  }
 
-  if (colorSpace2) {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps2; ++i) {
-	color.c[i] = lookup2[i][in[j]];
+  nQueued = nHits = 0;
+  for (i = 0, p = in; i < n; ++i, p += nComps) {
+    h = 2166136261U;
+    for (k = 0; k < nComps; ++k) {
+      h = (h ^ p[k]) * 16777619U;
+    }
+    e = pixelCache + ((h ^ (h >> 16)) & (pixelCacheSize - 1)) * entrySize;
+    if (e[0] == nOutComps && !memcmp(e + 1, p, nComps)) {
+      for (k = 0; k < nOutComps; ++k) {
+	out[i * nOutComps + k] = e[1 + nComps + k];
       }
-      colorSpace2->getCMYK(&color, &cmyk, ri);
-      out[j*4] = colToByte(cmyk.c);
-      out[j*4 + 1] = colToByte(cmyk.m);
-      out[j*4 + 2] = colToByte(cmyk.y);
-      out[j*4 + 3] = colToByte(cmyk.k);
+      ++nHits;
+    } else {
+      for (k = 0; k < nComps; ++k) {
+	color[nQueued].c[k] = lookup[k][p[k]];
+      }
+      entry[nQueued] = e;
+      idx[nQueued] = i;
+      ++nQueued;
     }
-  } else {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps; ++i) {
-	color.c[i] = lookup[i][in[j * nComps + i]];
+    if (nQueued == colorLineChunk || (nQueued > 0 && i == n - 1)) {
+      convertColorLine(colorSpace, color, buf, nQueued, nOutComps, ri);
+      for (j = 0; j < nQueued; ++j) {
+	e = entry[j];
+	e[0] = (Guchar)nOutComps;
+	memcpy(e + 1, in + idx[j] * nComps, nComps);
+	for (k = 0; k < nOutComps; ++k) {
+	  e[1 + nComps + k] = out[idx[j] * nOutComps + k]
+	                    = buf[j * nOutComps + k];
+	}
       }
-      colorSpace->getCMYK(&color, &cmyk, ri);
-      out[j*4] = colToByte(cmyk.c);
-      out[j*4 + 1] = colToByte(cmyk.m);
-      out[j*4 + 2] = colToByte(cmyk.y);
-      out[j*4 + 3] = colToByte(cmyk.k);
+      nQueued = 0;
     }
   }
+  if (nHits < n / 4) {
+    pixelCacheSkip = pixelCacheSkipLines;
+  }
 }
 
 
@@ -188,6 +188,17 @@ public:
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk,
 		       GfxRenderingIntent ri) = 0;
 
+  // Convert <n> colors to gray, RGB, or CMYK.  These give the same
+  // results as calling getGray, getRGB, or getCMYK on each color, but
+  // the subclasses avoid the per-color virtual calls, and evaluate
+  // tint transform functions over the whole line.
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
+
   // Return the number of color components.
   virtual int getNComps() = 0;
 
@@ -233,6 +244,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 1; }
   virtual void getDefaultColor(GfxColor *color);
@@ -258,6 +275,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 1; }
   virtual void getDefaultColor(GfxColor *color);
@@ -293,6 +316,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 3; }
   virtual void getDefaultColor(GfxColor *color);
@@ -318,6 +347,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 3; }
   virtual void getDefaultColor(GfxColor *color);
@@ -357,6 +392,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 4; }
   virtual void getDefaultColor(GfxColor *color);
@@ -383,6 +424,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 3; }
   virtual void getDefaultColor(GfxColor *color);
@@ -430,6 +477,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return nComps; }
   virtual void getDefaultColor(GfxColor *color);
@@ -470,6 +523,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 1; }
   virtual void getDefaultColor(GfxColor *color);
@@ -510,6 +569,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 1; }
   virtual void getDefaultColor(GfxColor *color);
@@ -526,6 +591,7 @@ private:
   GfxSeparationColorSpace(GString *nameA, GfxColorSpace *altA,
 			  Function *funcA, GBool nonMarkingA,
 			  Guint overprintMaskA);
+  void mapLineToAlt(GfxColor *in, GfxColor *out, int n);
 
   GString *name;		// colorant name
   GfxColorSpace *alt;		// alternate color space
@@ -554,6 +620,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColor *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColor *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColor *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return nComps; }
   virtual void getDefaultColor(GfxColor *color);
@@ -572,6 +644,7 @@ private:
 		       GfxColorSpace *alt, Function *func,
 		       Object *attrsA,
 		       GBool nonMarkingA, Guint overprintMaskA);
+  void mapLineToAlt(GfxColor *in, GfxColor *out, int n);
 
   int nComps;			// number of components
   GString			// colorant names
@@ -799,6 +872,11 @@ public:
   Function *getFunc(int i) { return funcs[i]; }
   void getColor(double t, GfxColor *color);
 
+  // Get the colors at <count> values of t -- this is the same as
+  // calling getColor() for each value, but the functions are
+  // evaluated in one batch.
+  void getColors(double *t, GfxColor *colors, int count);
+
 private:
 
   double x0, y0, x1, y1;
@@ -839,6 +917,11 @@ public:
   Function *getFunc(int i) { return funcs[i]; }
   void getColor(double t, GfxColor *color);
 
+  // Get the colors at <count> values of t -- this is the same as
+  // calling getColor() for each value, but the functions are
+  // evaluated in one batch.
+  void getColors(double *t, GfxColor *colors, int count);
+
 private:
 
   double x0, y0, r0, x1, y1, r1;
@@ -972,6 +1055,10 @@ public:
 private:
 
   GfxImageColorMap(GfxImageColorMap *colorMap);
+  void getByteLine(Guchar *in, Guchar *out, int n, int nOutComps,
+		   GfxRenderingIntent ri);
+  void getCachedByteLine(Guchar *in, Guchar *out, int n, int nOutComps,
+			 GfxRenderingIntent ri);
 
   GfxColorSpace *colorSpace;	// the image color space
   int bits;			// bits per component
@@ -986,6 +1073,13 @@ private:
     decodeLow[gfxColorMaxComps];
   double			// max - min value for each component
     decodeRange[gfxColorMaxComps];
+  GBool usePixelCache;		// cache converted pixels (for color
+				//   spaces with costly conversions)
+  Guchar *pixelCache;		// converted pixel cache (allocated on
+				//   first use)
+  GfxRenderingIntent pixelCacheRI;	// rendering intent of the cache
+  int pixelCacheSkip;		// number of lines to convert without
+				//   the cache
   GBool ok;
 };
 
@@ -35,6 +35,10 @@
 #include "UnicodeRemapping.h"
 #include "UnicodeMap.h"
 #include "CMap.h"
+#include "Decrypt.h"
+#ifndef NO_JBIG_STREAM
+#include "JBIG2Stream.h"
+#endif
 #include "BuiltinFontTables.h"
 #include "FontEncodingTables.h"
 #include "GlobalParams.h"
@@ -48,16 +52,24 @@
 #  define lockGlobalParams            gLockMutex(&mutex)
 #  define lockUnicodeMapCache         gLockMutex(&unicodeMapCacheMutex)
 #  define lockCMapCache               gLockMutex(&cMapCacheMutex)
+#  define lockFileKeyCache            gLockMutex(&fileKeyCacheMutex)
+#  define lockJBIG2GlobalsCache       gLockMutex(&jbig2GlobalsCacheMutex)
 #  define unlockGlobalParams          gUnlockMutex(&mutex)
 #  define unlockUnicodeMapCache       gUnlockMutex(&unicodeMapCacheMutex)
 #  define unlockCMapCache             gUnlockMutex(&cMapCacheMutex)
+#  define unlockFileKeyCache          gUnlockMutex(&fileKeyCacheMutex)
+#  define unlockJBIG2GlobalsCache     gUnlockMutex(&jbig2GlobalsCacheMutex)
 #else
 #  define lockGlobalParams
 #  define lockUnicodeMapCache
 #  define lockCMapCache
+#  define lockFileKeyCache
+#  define lockJBIG2GlobalsCache
 #  define unlockGlobalParams
 #  define unlockUnicodeMapCache
 #  define unlockCMapCache
+#  define unlockFileKeyCache
+#  define unlockJBIG2GlobalsCache
 #endif
 
 #include "NameToUnicodeTable.h"
@@ -520,6 +532,10 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
   gInitMutex(&mutex);
   gInitMutex(&unicodeMapCacheMutex);
   gInitMutex(&cMapCacheMutex);
+  gInitMutex(&fileKeyCacheMutex);
+#ifndef NO_JBIG_STREAM
+  gInitMutex(&jbig2GlobalsCacheMutex);
+#endif
 #endif
 
 #ifdef _WIN32
@@ -617,7 +633,9 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
   maxTileWidth = 1500;
   maxTileHeight = 1500;
   tileCacheSize = 10;
+  tileCacheMemory = 128;
   workerThreads = 1;
+  jpxDecodeThreads = 1;
   enableFreeType = gTrue;
   disableFreeTypeHinting = gFalse;
   antialias = gTrue;
@@ -649,6 +667,7 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
   createDefaultKeyBindings();
   popupMenuCmds = new GList();
   tabStateFile = appendToPath(getHomeDir(), ".xpdf.tab-state");
+  cachePageContent = gFalse;
   printCommands = gFalse;
   errQuiet = gFalse;
 
@@ -657,6 +676,10 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
       new CharCodeToUnicodeCache(unicodeToUnicodeCacheSize);
   unicodeMapCache = new UnicodeMapCache();
   cMapCache = new CMapCache();
+  fileKeyCache = new FileKeyCache();
+#ifndef NO_JBIG_STREAM
+  jbig2GlobalsCache = new JBIG2GlobalsCache();
+#endif
 
   // set up the initial nameToUnicode table
   for (i = 0; nameToUnicodeTab[i].name; ++i) {
@@ -1024,8 +1047,14 @@ void GlobalParams::parseLine(char *buf, GString *fileName, int line) {
       parseInteger("maxTileHeight", &maxTileHeight, tokens, fileName, line);
     } else if (!cmd->cmp("tileCacheSize")) {
       parseInteger("tileCacheSize", &tileCacheSize, tokens, fileName, line);
+    } else if (!cmd->cmp("tileCacheMemory")) {
+      parseInteger("tileCacheMemory", &tileCacheMemory,
+		   tokens, fileName, line);
     } else if (!cmd->cmp("workerThreads")) {
       parseInteger("workerThreads", &workerThreads, tokens, fileName, line);
+    } else if (!cmd->cmp("jpxDecodeThreads")) {
+      parseInteger("jpxDecodeThreads", &jpxDecodeThreads,
+		   tokens, fileName, line);
     } else if (!cmd->cmp("enableFreeType")) {
       parseYesNo("enableFreeType", &enableFreeType, tokens, fileName, line);
     } else if (!cmd->cmp("disableFreeTypeHinting")) {
@@ -1107,6 +1136,9 @@ void GlobalParams::parseLine(char *buf, GString *fileName, int line) {
       parsePopupMenuCmd(tokens, fileName, line);
     } else if (!cmd->cmp("tabStateFile")) {
       parseString("tabStateFile", &tabStateFile, tokens, fileName, line);
+    } else if (!cmd->cmp("cachePageContent")) {
+      parseYesNo("cachePageContent", &cachePageContent,
+		 tokens, fileName, line);
     } else if (!cmd->cmp("printCommands")) {
       parseYesNo("printCommands", &printCommands, tokens, fileName, line);
     } else if (!cmd->cmp("errQuiet")) {
@@ -1888,11 +1920,19 @@ GlobalParams::~GlobalParams() {
   delete unicodeToUnicodeCache;
   delete unicodeMapCache;
   delete cMapCache;
+  delete fileKeyCache;
+#ifndef NO_JBIG_STREAM
+  delete jbig2GlobalsCache;
+#endif
 
 #if MULTITHREADED
   gDestroyMutex(&mutex);
   gDestroyMutex(&unicodeMapCacheMutex);
   gDestroyMutex(&cMapCacheMutex);
+  gDestroyMutex(&fileKeyCacheMutex);
+#ifndef NO_JBIG_STREAM
+  gDestroyMutex(&jbig2GlobalsCacheMutex);
+#endif
 #endif
 }
 
@@ -2675,6 +2715,15 @@ int GlobalParams::getTileCacheSize() {
   return n;
 }
 
+int GlobalParams::getTileCacheMemory() {
+  int n;
+
+  lockGlobalParams;
+  n = tileCacheMemory;
+  unlockGlobalParams;
+  return n;
+}
+
 int GlobalParams::getWorkerThreads() {
   int n;
 
@@ -2684,6 +2733,15 @@ int GlobalParams::getWorkerThreads() {
   return n;
 }
 
+int GlobalParams::getJPXDecodeThreads() {
+  int n;
+
+  lockGlobalParams;
+  n = jpxDecodeThreads;
+  unlockGlobalParams;
+  return n;
+}
+
 GBool GlobalParams::getEnableFreeType() {
   GBool f;
 
@@ -2969,6 +3027,15 @@ GString *GlobalParams::getTabStateFile() {
   return s;
 }
 
+GBool GlobalParams::getCachePageContent() {
+  GBool c;
+
+  lockGlobalParams;
+  c = cachePageContent;
+  unlockGlobalParams;
+  return c;
+}
+
 GBool GlobalParams::getPrintCommands() {
   GBool p;
 
@@ -3055,6 +3122,40 @@ UnicodeMap *GlobalParams::getTextEncoding() {
   return getUnicodeMap2(textEncoding);
 }
 
+GBool GlobalParams::getCachedFileKey(Guchar *digest, Guchar *fileKey,
+				     GBool *ownerPasswordOk) {
+  GBool found;
+
+  lockFileKeyCache;
+  found = fileKeyCache->lookup(digest, fileKey, ownerPasswordOk);
+  unlockFileKeyCache;
+  return found;
+}
+
+void GlobalParams::addCachedFileKey(Guchar *digest, Guchar *fileKey,
+				    GBool ownerPasswordOk) {
+  lockFileKeyCache;
+  fileKeyCache->add(digest, fileKey, ownerPasswordOk);
+  unlockFileKeyCache;
+}
+
+#ifndef NO_JBIG_STREAM
+GList *GlobalParams::getCachedJBIG2Globals(GString *data) {
+  GList *segments;
+
+  lockJBIG2GlobalsCache;
+  segments = jbig2GlobalsCache->lookup(data);
+  unlockJBIG2GlobalsCache;
+  return segments;
+}
+
+void GlobalParams::addCachedJBIG2Globals(GString *data, GList *segments) {
+  lockJBIG2GlobalsCache;
+  jbig2GlobalsCache->add(data, segments);
+  unlockJBIG2GlobalsCache;
+}
+#endif
+
 //------------------------------------------------------------------------
 // functions to set parameters
 //------------------------------------------------------------------------
@@ -3281,6 +3382,12 @@ GBool GlobalParams::setVectorAntialias(char *s) {
   return ok;
 }
 
+void GlobalParams::setJPXDecodeThreads(int n) {
+  lockGlobalParams;
+  jpxDecodeThreads = n;
+  unlockGlobalParams;
+}
+
 void GlobalParams::setScreenType(ScreenType t) {
   lockGlobalParams;
   screenType = t;
@@ -3362,6 +3469,12 @@ void GlobalParams::setTabStateFile(char *tabStateFileA) {
   unlockGlobalParams;
 }
 
+void GlobalParams::setCachePageContent(GBool cache) {
+  lockGlobalParams;
+  cachePageContent = cache;
+  unlockGlobalParams;
+}
+
 void GlobalParams::setPrintCommands(GBool printCommandsA) {
   lockGlobalParams;
   printCommands = printCommandsA;
@@ -37,6 +37,8 @@ class UnicodeMapCache;
 class UnicodeRemapping;
 class CMap;
 class CMapCache;
+class FileKeyCache;
+class JBIG2GlobalsCache;
 struct XpdfSecurityHandler;
 class GlobalParams;
 class SysFontList;
@@ -284,7 +286,9 @@ public:
   int getMaxTileWidth();
   int getMaxTileHeight();
   int getTileCacheSize();
+  int getTileCacheMemory();
   int getWorkerThreads();
+  int getJPXDecodeThreads();
   GBool getEnableFreeType();
   GBool getDisableFreeTypeHinting();
   GBool getAntialias();
@@ -317,6 +321,7 @@ public:
   int getNumPopupMenuCmds();
   PopupMenuCmd *getPopupMenuCmd(int idx);
   GString *getTabStateFile();
+  GBool getCachePageContent();
   GBool getPrintCommands();
   GBool getErrQuiet();
 
@@ -325,6 +330,14 @@ public:
   UnicodeMap *getUnicodeMap(GString *encodingName);
   CMap *getCMap(GString *collection, GString *cMapName);
   UnicodeMap *getTextEncoding();
+  GBool getCachedFileKey(Guchar *digest, Guchar *fileKey,
+			 GBool *ownerPasswordOk);
+  void addCachedFileKey(Guchar *digest, Guchar *fileKey,
+			GBool ownerPasswordOk);
+#ifndef NO_JBIG_STREAM
+  GList *getCachedJBIG2Globals(GString *data);
+  void addCachedJBIG2Globals(GString *data, GList *segments);
+#endif
 
   //----- functions to set parameters
 
@@ -357,6 +370,7 @@ public:
   GBool setEnableFreeType(char *s);
   GBool setAntialias(char *s);
   GBool setVectorAntialias(char *s);
+  void setJPXDecodeThreads(int n);
   void setScreenType(ScreenType t);
   void setScreenSize(int size);
   void setScreenDotRadius(int r);
@@ -370,6 +384,7 @@ public:
   void setMapExtTrueTypeFontsViaUnicode(GBool map);
   void setEnableXFA(GBool enable);
   void setTabStateFile(char *tabStateFileA);
+  void setCachePageContent(GBool cache);
   void setPrintCommands(GBool printCommandsA);
   void setErrQuiet(GBool errQuietA);
 
@@ -511,7 +526,11 @@ private:
   int maxTileWidth;		// maximum rasterization tile width
   int maxTileHeight;		// maximum rasterization tile height
   int tileCacheSize;		// number of rasterization tiles in cache
+  int tileCacheMemory;		// tile cache memory budget, in MB
+				//   (0 disables prefetching)
   int workerThreads;		// number of rasterization worker threads
+  int jpxDecodeThreads;		// number of threads used to decode
+				//   JPEG 2000 code-blocks and tiles
   GBool enableFreeType;		// FreeType enable flag
   GBool disableFreeTypeHinting;	// FreeType hinting disable flag
   GBool antialias;		// font anti-aliasing enable flag
@@ -546,6 +565,8 @@ private:
   GList *keyBindings;		// key & mouse button bindings [KeyBinding]
   GList *popupMenuCmds;		// popup menu commands [PopupMenuCmd]
   GString *tabStateFile;	// path for the tab state save file
+  GBool cachePageContent;	// keep pre-tokenized page contents for
+				//   re-rendering/re-extracting pages?
   GBool printCommands;		// print the drawing commands
   GBool errQuiet;		// suppress error messages?
 
@@ -553,11 +574,19 @@ private:
   CharCodeToUnicodeCache *unicodeToUnicodeCache;
   UnicodeMapCache *unicodeMapCache;
   CMapCache *cMapCache;
+  FileKeyCache *fileKeyCache;
+#ifndef NO_JBIG_STREAM
+  JBIG2GlobalsCache *jbig2GlobalsCache;
+#endif
 
 #if MULTITHREADED
   GMutex mutex;
   GMutex unicodeMapCacheMutex;
   GMutex cMapCacheMutex;
+  GMutex fileKeyCacheMutex;
+#ifndef NO_JBIG_STREAM
+  GMutex jbig2GlobalsCacheMutex;
+#endif
 #endif
 #ifdef _WIN32
   DWORD tlsWin32ErrorInfo;	// TLS index for error info
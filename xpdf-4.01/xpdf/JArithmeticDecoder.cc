@@ -184,8 +184,10 @@ void JArithmeticDecoder::cleanup() {
   }
 }
 
-int JArithmeticDecoder::decodeBit(Guint context,
-				  JArithmeticDecoderStats *stats) {
+// NB: decodeBit() has already subtracted Qe from the interval, and
+// the inline MPS case has been ruled out.
+int JArithmeticDecoder::decodeBitSlow(Guint context,
+				      JArithmeticDecoderStats *stats) {
   int bit;
   Guint qe;
   int iCX, mpsCX;
@@ -193,7 +195,6 @@ int JArithmeticDecoder::decodeBit(Guint context,
   iCX = stats->cxTab[context] >> 1;
   mpsCX = stats->cxTab[context] & 1;
   qe = qeTab[iCX];
-  a -= qe;
   if (c < a) {
     if (a & 0x80000000) {
       bit = mpsCX;
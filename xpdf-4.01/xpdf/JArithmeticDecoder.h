@@ -90,6 +90,7 @@ public:
 private:
 
   Guint readByte();
+  int decodeBitSlow(Guint context, JArithmeticDecoderStats *stats);
   int decodeIntBit(JArithmeticDecoderStats *stats);
   void byteIn();
 
@@ -111,4 +112,18 @@ private:
   int readBuf;
 };
 
+// The common case -- an MPS that doesn't need renormalization -- is
+// handled inline; everything else goes through decodeBitSlow().
+inline int JArithmeticDecoder::decodeBit(Guint context,
+					 JArithmeticDecoderStats *stats) {
+  Guint cx;
+
+  cx = stats->cxTab[context];
+  a -= qeTab[cx >> 1];
+  if (c < a && (a & 0x80000000)) {
+    return (int)(cx & 1);
+  }
+  return decodeBitSlow(context, stats);
+}
+
 #endif
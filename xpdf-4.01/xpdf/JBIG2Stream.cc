@@ -15,8 +15,10 @@
 #include <stdlib.h>
 #include <limits.h>
 #include "gmempp.h"
+#include "GString.h"
 #include "GList.h"
 #include "Error.h"
+#include "GlobalParams.h"
 #include "JArithmeticDecoder.h"
 #include "JBIG2Stream.h"
 
@@ -739,12 +741,35 @@ JBIG2Bitmap::~JBIG2Bitmap() {
   gfree(data);
 }
 
-//~ optimize this
 JBIG2Bitmap *JBIG2Bitmap::getSlice(Guint x, Guint y, Guint wA, Guint hA) {
   JBIG2Bitmap *slice;
+  Guchar *srcPtr, *destPtr;
   Guint xx, yy;
+  int s;
 
   slice = new JBIG2Bitmap(0, wA, hA);
+
+  // the usual case (symbols cut from a collective bitmap): the slice
+  // is entirely inside this bitmap, so copy it a byte at a time
+  // (reading one byte past the end of a row is safe, thanks to the
+  // guard byte)
+  if (x < (Guint)w && wA <= (Guint)w - x &&
+      y < (Guint)h && hA <= (Guint)h - y) {
+    s = x & 7;
+    for (yy = 0; yy < hA; ++yy) {
+      srcPtr = data + (y + yy) * line + (x >> 3);
+      destPtr = slice->data + yy * slice->line;
+      for (xx = 0; xx < wA; xx += 8) {
+	*destPtr++ = (Guchar)(((srcPtr[0] << 8) | srcPtr[1]) >> (8 - s));
+	++srcPtr;
+      }
+      if (wA & 7) {
+	destPtr[-1] &= (Guchar)(0xff << (8 - (wA & 7)));
+      }
+    }
+    return slice;
+  }
+
   slice->clearToZero();
   for (yy = 0; yy < hA; ++yy) {
     for (xx = 0; xx < wA; ++xx) {
@@ -868,6 +893,32 @@ void JBIG2Bitmap::combine(JBIG2Bitmap *bitmap, int x, int y,
 
   oneByte = x0 == ((x1 - 1) & ~7);
 
+  // OR is by far the most common operator (every symbol instance in
+  // a typical text region), so it gets its own loop without the
+  // per-byte switch
+  if (combOp == 0 && x >= 0) {
+    for (yy = y0; yy < y1; ++yy) {
+      destPtr = data + (y + yy) * line + (x >> 3);
+      srcPtr = bitmap->data + yy * bitmap->line;
+      if (oneByte) {
+	*destPtr |= (Guchar)((*srcPtr >> s1) & m2);
+	continue;
+      }
+      src1 = *srcPtr++;
+      *destPtr++ |= (Guchar)(src1 >> s1);
+      for (xx = x0 + 8; xx < x1 - 8; xx += 8) {
+	src0 = src1;
+	src1 = *srcPtr++;
+	*destPtr++ |= (Guchar)(((src0 << 8) | src1) >> s1);
+      }
+      // see the guard byte note below
+      src0 = src1;
+      src1 = *srcPtr;
+      *destPtr |= (Guchar)((((src0 << 8) | src1) >> s1) & m2);
+    }
+    return;
+  }
+
   for (yy = y0; yy < y1; ++yy) {
 
     // one byte per line -- need to mask both left and right side
@@ -1023,6 +1074,7 @@ public:
   JBIG2SymbolDict(Guint segNumA, Guint sizeA);
   virtual ~JBIG2SymbolDict();
   virtual JBIG2SegmentType getType() { return jbig2SegSymbolDict; }
+  JBIG2SymbolDict *copy();
   Guint getSize() { return size; }
   void setBitmap(Guint idx, JBIG2Bitmap *bitmap) { bitmaps[idx] = bitmap; }
   JBIG2Bitmap *getBitmap(Guint idx) { return bitmaps[idx]; }
@@ -1074,6 +1126,25 @@ JBIG2SymbolDict::~JBIG2SymbolDict() {
   }
 }
 
+JBIG2SymbolDict *JBIG2SymbolDict::copy() {
+  JBIG2SymbolDict *dict;
+  Guint i;
+
+  dict = new JBIG2SymbolDict(getSegNum(), size);
+  for (i = 0; i < size; ++i) {
+    if (bitmaps[i]) {
+      dict->bitmaps[i] = bitmaps[i]->copy();
+    }
+  }
+  if (genericRegionStats) {
+    dict->genericRegionStats = genericRegionStats->copy();
+  }
+  if (refinementRegionStats) {
+    dict->refinementRegionStats = refinementRegionStats->copy();
+  }
+  return dict;
+}
+
 //------------------------------------------------------------------------
 // JBIG2PatternDict
 //------------------------------------------------------------------------
@@ -1084,6 +1155,7 @@ public:
   JBIG2PatternDict(Guint segNumA, Guint sizeA);
   virtual ~JBIG2PatternDict();
   virtual JBIG2SegmentType getType() { return jbig2SegPatternDict; }
+  JBIG2PatternDict *copy();
   Guint getSize() { return size; }
   void setBitmap(Guint idx, JBIG2Bitmap *bitmap) { bitmaps[idx] = bitmap; }
   JBIG2Bitmap *getBitmap(Guint idx) { return bitmaps[idx]; }
@@ -1110,6 +1182,17 @@ JBIG2PatternDict::~JBIG2PatternDict() {
   gfree(bitmaps);
 }
 
+JBIG2PatternDict *JBIG2PatternDict::copy() {
+  JBIG2PatternDict *dict;
+  Guint i;
+
+  dict = new JBIG2PatternDict(getSegNum(), size);
+  for (i = 0; i < size; ++i) {
+    dict->bitmaps[i] = bitmaps[i]->copy();
+  }
+  return dict;
+}
+
 //------------------------------------------------------------------------
 // JBIG2CodeTable
 //------------------------------------------------------------------------
@@ -1120,6 +1203,7 @@ public:
   JBIG2CodeTable(Guint segNumA, JBIG2HuffmanTable *tableA);
   virtual ~JBIG2CodeTable();
   virtual JBIG2SegmentType getType() { return jbig2SegCodeTable; }
+  JBIG2CodeTable *copy();
   JBIG2HuffmanTable *getHuffTable() { return table; }
 
 private:
@@ -1137,6 +1221,17 @@ JBIG2CodeTable::~JBIG2CodeTable() {
   gfree(table);
 }
 
+JBIG2CodeTable *JBIG2CodeTable::copy() {
+  JBIG2HuffmanTable *tableA;
+  int n;
+
+  for (n = 0; table[n].rangeLen != jbig2HuffmanEOT; ++n) ;
+  ++n;
+  tableA = (JBIG2HuffmanTable *)gmallocn(n, sizeof(JBIG2HuffmanTable));
+  memcpy(tableA, table, n * sizeof(JBIG2HuffmanTable));
+  return new JBIG2CodeTable(getSegNum(), tableA);
+}
+
 //------------------------------------------------------------------------
 // JBIG2Stream
 //------------------------------------------------------------------------
@@ -1202,17 +1297,45 @@ Stream *JBIG2Stream::copy() {
 }
 
 void JBIG2Stream::reset() {
-  // read the globals stream
-  globalSegments = new GList();
+  GString *globalsData;
+  Object obj;
+  char buf[4096];
+  int n;
+
+  // read the globals stream -- the decoded segments are shared
+  // through the JBIG2GlobalsCache, keyed by the globals data
+  globalSegments = NULL;
   if (globalsStream.isStream()) {
-    segments = globalSegments;
+    globalsData = new GString();
     curStr = globalsStream.getStream();
     curStr->reset();
-    arithDecoder->setStream(curStr);
-    huffDecoder->setStream(curStr);
-    mmrDecoder->setStream(curStr);
-    readSegments();
+    while ((n = curStr->getBlock(buf, sizeof(buf))) > 0) {
+      globalsData->append(buf, n);
+    }
     curStr->close();
+    if (globalParams) {
+      globalSegments = globalParams->getCachedJBIG2Globals(globalsData);
+    }
+    if (!globalSegments) {
+      segments = globalSegments = new GList();
+      obj.initNull();
+      curStr = new MemStream(globalsData->getCString(), 0,
+			     globalsData->getLength(), &obj);
+      curStr->reset();
+      arithDecoder->setStream(curStr);
+      huffDecoder->setStream(curStr);
+      mmrDecoder->setStream(curStr);
+      readSegments();
+      delete curStr;
+      // a page information segment in the globals stream would leave
+      // state behind in this JBIG2Stream, so that can't be cached
+      if (globalParams && !pageBitmap) {
+	globalParams->addCachedJBIG2Globals(globalsData, globalSegments);
+      }
+    }
+    delete globalsData;
+  } else {
+    globalSegments = new GList();
   }
 
   // read the main stream
@@ -1264,6 +1387,7 @@ int JBIG2Stream::lookChar() {
 }
 
 int JBIG2Stream::getBlock(char *blk, int size) {
+  Guchar *p;
   int n, i;
 
   if (size <= 0) {
@@ -1274,9 +1398,13 @@ int JBIG2Stream::getBlock(char *blk, int size) {
   } else {
     n = size;
   }
+  // copy through a local pointer -- blk may alias dataPtr, which
+  // would otherwise be reloaded and stored for every byte
+  p = dataPtr;
   for (i = 0; i < n; ++i) {
-    blk[i] = *dataPtr++ ^ 0xff;
+    blk[i] = (char)(p[i] ^ 0xff);
   }
+  dataPtr += n;
   return n;
 }
 
@@ -2807,7 +2935,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
   int code1, code2, code3;
   Guchar *p0, *p1, *p2, *pp;
   Guchar *atP0, *atP1, *atP2, *atP3;
-  Guint buf0, buf1, buf2;
+  Guint buf0, buf1, buf2, pixBuf;
   Guint atBuf0, atBuf1, atBuf2, atBuf3;
   int atShift0, atShift1, atShift2, atShift3;
   Guchar mask;
@@ -3072,10 +3200,48 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	  buf1 = buf0 = 0;
 	}
 
-	if (atx[0] >= -8 && atx[0] <= 8 &&
-	    atx[1] >= -8 && atx[1] <= 8 &&
-	    atx[2] >= -8 && atx[2] <= 8 &&
-	    atx[3] >= -8 && atx[3] <= 8) {
+	if (!useSkip &&
+	    atx[0] == 3 && aty[0] == -1 && atx[1] == -3 && aty[1] == -1 &&
+	    atx[2] == 2 && aty[2] == -2 && atx[3] == -2 && aty[3] == -2) {
+	  // nominal AT pixels, no skip bitmap: all four AT pixels lie
+	  // in the buf0/buf1 windows, and the current row's pixels are
+	  // kept in cx2, so the context is built with shifts and masks
+	  // and each output byte is written once
+	  cx2 = 0;
+	  for (x0 = 0, x = 0; x0 < w; x0 += 8, ++pp) {
+	    if (x0 + 8 < w) {
+	      if (p0) {
+		buf0 |= *p0++;
+	      }
+	      if (p1) {
+		buf1 |= *p1++;
+	      }
+	    }
+	    pixBuf = 0;
+	    for (x1 = 0; x1 < 8 && x < w; ++x1, ++x) {
+
+	      // build the context
+	      cx = ((buf0 >> 1) & 0xe000) | ((buf1 >> 5) & 0x1f00) |
+		   (cx2 << 4) |
+		   ((buf1 >> 9) & 0x08) | ((buf1 >> 16) & 0x04) |
+		   ((buf0 >> 12) & 0x02) | ((buf0 >> 17) & 0x01);
+
+	      // decode the pixel
+	      pix = arithDecoder->decodeBit(cx, genericRegionStats);
+	      pixBuf = (pixBuf << 1) | pix;
+
+	      // update the context
+	      cx2 = ((cx2 << 1) | pix) & 0x0f;
+	      buf0 <<= 1;
+	      buf1 <<= 1;
+	    }
+	    *pp = (Guchar)(pixBuf << (8 - x1));
+	  }
+
+	} else if (atx[0] >= -8 && atx[0] <= 8 &&
+		   atx[1] >= -8 && atx[1] <= 8 &&
+		   atx[2] >= -8 && atx[2] <= 8 &&
+		   atx[3] >= -8 && atx[3] <= 8) {
 	  // set up the adaptive context
 	  if (aty[0] <= 0 && y + aty[0] >= 0) {
 	    atP0 = bitmap->getDataPtr() + (y + aty[0]) * bitmap->getLineSize();
@@ -4131,3 +4297,95 @@ GBool JBIG2Stream::readLong(int *x) {
   }
   return gTrue;
 }
+
+//------------------------------------------------------------------------
+// JBIG2GlobalsCache
+//------------------------------------------------------------------------
+
+JBIG2GlobalsCache::JBIG2GlobalsCache() {
+  nEntries = 0;
+}
+
+JBIG2GlobalsCache::~JBIG2GlobalsCache() {
+  int i;
+
+  for (i = 0; i < nEntries; ++i) {
+    delete keys[i];
+    deleteGList(segments[i], JBIG2Segment);
+  }
+}
+
+GList *JBIG2GlobalsCache::lookup(GString *data) {
+  GString *key;
+  GList *segs;
+  int i, j;
+
+  for (i = 0; i < nEntries; ++i) {
+    if (!keys[i]->cmp(data)) {
+      key = keys[i];
+      segs = segments[i];
+      for (j = i; j >= 1; --j) {
+	keys[j] = keys[j - 1];
+	segments[j] = segments[j - 1];
+      }
+      keys[0] = key;
+      segments[0] = segs;
+      return copySegments(segs);
+    }
+  }
+  return NULL;
+}
+
+void JBIG2GlobalsCache::add(GString *data, GList *segmentsA) {
+  JBIG2Segment *seg;
+  int i, j;
+
+  if (segmentsA->getLength() == 0) {
+    return;
+  }
+  for (i = 0; i < segmentsA->getLength(); ++i) {
+    seg = (JBIG2Segment *)segmentsA->get(i);
+    if (seg->getType() != jbig2SegSymbolDict &&
+	seg->getType() != jbig2SegPatternDict &&
+	seg->getType() != jbig2SegCodeTable) {
+      return;
+    }
+  }
+  if (nEntries == jbig2GlobalsCacheSize) {
+    --nEntries;
+    delete keys[nEntries];
+    deleteGList(segments[nEntries], JBIG2Segment);
+  }
+  for (j = nEntries; j >= 1; --j) {
+    keys[j] = keys[j - 1];
+    segments[j] = segments[j - 1];
+  }
+  keys[0] = data->copy();
+  segments[0] = copySegments(segmentsA);
+  ++nEntries;
+}
+
+GList *JBIG2GlobalsCache::copySegments(GList *segmentsA) {
+  GList *segs;
+  JBIG2Segment *seg;
+  int i;
+
+  segs = new GList();
+  for (i = 0; i < segmentsA->getLength(); ++i) {
+    seg = (JBIG2Segment *)segmentsA->get(i);
+    switch (seg->getType()) {
+    case jbig2SegSymbolDict:
+      segs->append(((JBIG2SymbolDict *)seg)->copy());
+      break;
+    case jbig2SegPatternDict:
+      segs->append(((JBIG2PatternDict *)seg)->copy());
+      break;
+    case jbig2SegCodeTable:
+      segs->append(((JBIG2CodeTable *)seg)->copy());
+      break;
+    default:
+      break;
+    }
+  }
+  return segs;
+}
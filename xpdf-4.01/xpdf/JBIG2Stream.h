@@ -19,6 +19,7 @@
 #include "Object.h"
 #include "Stream.h"
 
+class GString;
 class GList;
 class JBIG2Segment;
 class JBIG2Bitmap;
@@ -149,4 +150,42 @@ private:
   JBIG2MMRDecoder *mmrDecoder;
 };
 
+//------------------------------------------------------------------------
+// JBIG2GlobalsCache
+//------------------------------------------------------------------------
+
+#define jbig2GlobalsCacheSize 4
+
+// Decoded JBIG2Globals streams.  Scanned documents usually have one
+// globals stream -- a symbol dictionary shared by all of the pages --
+// which would otherwise be decoded again for every page image.
+// Entries are keyed by the globals data, and only hold symbol/pattern
+// dictionaries and code tables, which are never modified once they
+// have been decoded.  Access is serialized by GlobalParams.
+class JBIG2GlobalsCache {
+public:
+
+  JBIG2GlobalsCache();
+  ~JBIG2GlobalsCache();
+
+  // Look up <data>.  If found, returns a copy of the cached segment
+  // list, otherwise returns NULL.
+  GList *lookup(GString *data);
+
+  // Add copies of <segmentsA>, which were decoded from <data>,
+  // dropping the least recently used entry if the cache is full.
+  // Does nothing if the list is empty or any of the segments can't
+  // be cached.
+  void add(GString *data, GList *segmentsA);
+
+private:
+
+  static GList *copySegments(GList *segmentsA);
+
+  GString *keys[jbig2GlobalsCacheSize];		// most recently used
+						//   first
+  GList *segments[jbig2GlobalsCacheSize];	// [JBIG2Segment]
+  int nEntries;
+};
+
 #endif
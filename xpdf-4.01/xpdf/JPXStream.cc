@@ -13,9 +13,16 @@
 #endif
 
 #include <limits.h>
+#include <string.h>
+#if (defined(__GNUC__) && defined(__SSE2__)) || \
+    (defined(_WIN32) && (_M_IX86_FP == 2 || defined(_M_X64)))
+#  include <emmintrin.h>
+#  define JPX_SSE2 1
+#endif
 #include "gmem.h"
 #include "gmempp.h"
 #include "Error.h"
+#include "GlobalParams.h"
 #include "JArithmeticDecoder.h"
 #include "JPXStream.h"
 
@@ -29,7 +36,7 @@
 //  - can we assume that QCC segments must come after the QCD segment?
 //  - handle tilePartToEOC in readTilePartData
 //  - progression orders 2, 3, and 4
-//  - in coefficient decoding (readCodeBlockData):
+//  - in coefficient decoding (decodeCodeBlockPacket):
 //    - selective arithmetic coding bypass
 //      (this also affects reading the cb->dataLen array)
 //    - coeffs longer than 31 bits (should just ignore the extra bits?)
@@ -158,6 +165,10 @@ static Guint signContext[5][5][2] = {
 // in the IDWT
 #define fracBits 24
 
+// number of rows/columns handled together by the inverse wavelet
+// transform (a multiple of 4, for SSE2)
+#define jpxIDWTLanes 8
+
 //------------------------------------------------------------------------
 
 // floor(x / y)
@@ -258,6 +269,10 @@ JPXStream::JPXStream(Stream *strA):
   bitBufLen = 0;
   bitBufSkip = gFalse;
   byteCount = 0;
+
+  decodeJobs = NULL;
+  nDecodeJobs = 0;
+  nextDecodeJob = 0;
 }
 
 JPXStream::~JPXStream() {
@@ -336,6 +351,8 @@ void JPXStream::close() {
 			for (k = 0; k < subband->nXCBs * subband->nYCBs; ++k) {
 			  cb = &subband->cbs[k];
 			  gfree(cb->dataLen);
+			  gfree(cb->pktData);
+			  gfree(cb->pktInfo);
 			  gfree(cb->touched);
 			  if (cb->arithDecoder) {
 			    delete cb->arithDecoder;
@@ -899,8 +916,6 @@ GBool JPXStream::readColorSpecBox(Guint dataLen) {
 }
 
 JPXDecodeResult JPXStream::readCodestream(Guint len) {
-  JPXTile *tile;
-  JPXTileComp *tileComp;
   int segType;
   GBool haveSIZ, haveCOD, haveQCD, haveSOT, ok;
   Guint style, progOrder, nLayers, multiComp, nDecompLevels;
@@ -1468,19 +1483,8 @@ JPXDecodeResult JPXStream::readCodestream(Guint len) {
   }
 
   //----- finish decoding the image
-  for (i = 0; i < img.nXTiles * img.nYTiles; ++i) {
-    tile = &img.tiles[i];
-    if (!tile->init) {
-      error(errSyntaxError, getPos(), "Uninitialized tile in JPX codestream");
-      return jpxDecodeFatalError;
-    }
-    for (comp = 0; comp < img.nComps; ++comp) {
-      tileComp = &tile->tileComps[comp];
-      inverseTransform(tileComp);
-    }
-    if (!inverseMultiCompAndDC(tile)) {
-      return jpxDecodeFatalError;
-    }
+  if (!decodeTiles()) {
+    return jpxDecodeFatalError;
   }
 
   //~ can free memory below tileComps here, and also tileComp.buf
@@ -1933,7 +1937,7 @@ GBool JPXStream::readTilePart() {
       } else {
 	n = tileComp->y1 - tileComp->y0;
       }
-      tileComp->buf = (int *)gmallocn(n + 8, sizeof(int));
+      tileComp->buf = (int *)gmallocn(n + 8, jpxIDWTLanes * sizeof(int));
       for (r = 0; r <= tileComp->nDecompLevels; ++r) {
 	resLevel = &tileComp->resLevels[r];
 	k = r == 0 ? tileComp->nDecompLevels
@@ -2027,6 +2031,12 @@ GBool JPXStream::readTilePart() {
 						    sizeof(JPXCodeBlock));
 	    for (k = 0; k < subband->nXCBs * subband->nYCBs; ++k) {
 	      subband->cbs[k].dataLen = NULL;
+	      subband->cbs[k].pktData = NULL;
+	      subband->cbs[k].pktDataLen = 0;
+	      subband->cbs[k].pktDataSize = 0;
+	      subband->cbs[k].pktInfo = NULL;
+	      subband->cbs[k].pktInfoLen = 0;
+	      subband->cbs[k].pktInfoSize = 0;
 	      subband->cbs[k].touched = NULL;
 	      subband->cbs[k].arithDecoder = NULL;
 	      subband->cbs[k].stats = NULL;
@@ -2444,34 +2454,263 @@ GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
 				   JPXSubband *subband,
 				   Guint res, Guint sb,
 				   JPXCodeBlock *cb) {
-  int *coeff0, *coeff1, *coeff;
-  char *touched0, *touched1, *touched;
-  Guint horiz, vert, diag, all, cx, xorBit;
-  int horizSign, vertSign, bit;
-  int segSym;
-  Guint n, i, x, y0, y1;
+  Guint nSegs, n, i;
+  int len;
+
+  if (tileComp->codeBlockStyle & 0x04) {
+    nSegs = cb->nCodingPasses;
+  } else {
+    nSegs = 1;
+  }
 
   if (res > tileComp->nDecompLevels - reduction) {
     // skip the codeblock data
-    if (tileComp->codeBlockStyle & 0x04) {
-      n = 0;
-      for (i = 0; i < cb->nCodingPasses; ++i) {
-	n += cb->dataLen[i];
-      }
-    } else {
-      n = cb->dataLen[0];
+    n = 0;
+    for (i = 0; i < nSegs; ++i) {
+      n += cb->dataLen[i];
     }
     bufStr->discardChars(n);
     return gTrue;
   }
 
+  // The code-block is decoded later, by decodeCodeBlock(), so that
+  // code-blocks can be decoded in parallel -- for now, just save the
+  // codeword segments and the coding pass counts.
+  if (cb->pktInfoLen + 1 + nSegs > cb->pktInfoSize) {
+    cb->pktInfoSize = 2 * cb->pktInfoSize + 1 + nSegs;
+    cb->pktInfo = (Guint *)greallocn(cb->pktInfo, cb->pktInfoSize,
+				     sizeof(Guint));
+  }
+  cb->pktInfo[cb->pktInfoLen++] = cb->nCodingPasses;
+  for (i = 0; i < nSegs; ++i) {
+    cb->pktInfo[cb->pktInfoLen++] = cb->dataLen[i];
+    // NB: the arithmetic decoder doesn't read anything for a segment
+    // whose length overflows an int, and the read stops at EOF --
+    // the buffered data ends there as well, and the decoder sees the
+    // same 0xff fill bytes
+    len = (int)cb->dataLen[i];
+    while (len > 0) {
+      if (cb->pktDataLen == cb->pktDataSize) {
+	cb->pktDataSize = cb->pktDataSize ? 2 * cb->pktDataSize : 1024;
+	cb->pktData = (Guchar *)grealloc(cb->pktData, cb->pktDataSize);
+      }
+      n = cb->pktDataSize - cb->pktDataLen;
+      if (n > (Guint)len) {
+	n = (Guint)len;
+      }
+      n = bufStr->getBlock((char *)cb->pktData + cb->pktDataLen, (int)n);
+      cb->pktDataLen += n;
+      len -= (int)n;
+      if (n == 0) {
+	break;
+      }
+    }
+  }
+  return gTrue;
+}
+
+// Decode the buffered code-block data, and then run the inverse
+// transforms, for all of the tiles.  Code-blocks are independent of
+// each other, as are tile-components, so each of those two steps is
+// split into jobs which can be run in parallel.
+GBool JPXStream::decodeTiles() {
+  JPXTile *tile;
+  JPXTileComp *tileComp;
+  JPXResLevel *resLevel;
+  JPXSubband *subband;
+  JPXCodeBlock *cb;
+  JPXDecodeJob *jobs;
+  int nJobs, jobsSize;
+  Guint i, comp, r, sb, k;
+
+  for (i = 0; i < img.nXTiles * img.nYTiles; ++i) {
+    if (!img.tiles[i].init) {
+      error(errSyntaxError, getPos(), "Uninitialized tile in JPX codestream");
+      return gFalse;
+    }
+  }
+
+  //----- decode the code-blocks
+  jobs = NULL;
+  nJobs = jobsSize = 0;
+  for (i = 0; i < img.nXTiles * img.nYTiles; ++i) {
+    tile = &img.tiles[i];
+    for (comp = 0; comp < img.nComps; ++comp) {
+      tileComp = &tile->tileComps[comp];
+      for (r = 0; r <= tileComp->nDecompLevels; ++r) {
+	resLevel = &tileComp->resLevels[r];
+	if (!resLevel->precincts) {
+	  continue;
+	}
+	for (sb = 0; sb < (Guint)(r == 0 ? 1 : 3); ++sb) {
+	  subband = &resLevel->precincts[0].subbands[sb];
+	  for (k = 0; k < subband->nXCBs * subband->nYCBs; ++k) {
+	    cb = &subband->cbs[k];
+	    if (cb->pktInfoLen) {
+	      if (nJobs == jobsSize) {
+		jobsSize = jobsSize ? 2 * jobsSize : 256;
+		jobs = (JPXDecodeJob *)greallocn(jobs, jobsSize,
+						 sizeof(JPXDecodeJob));
+	      }
+	      jobs[nJobs].tileComp = tileComp;
+	      jobs[nJobs].cb = cb;
+	      jobs[nJobs].res = r;
+	      jobs[nJobs].sb = sb;
+	      ++nJobs;
+	    }
+	  }
+	}
+      }
+    }
+  }
+  runDecodeJobs(jobs, nJobs);
+
+  //----- inverse transform each tile-component
+  nJobs = 0;
+  for (i = 0; i < img.nXTiles * img.nYTiles; ++i) {
+    tile = &img.tiles[i];
+    for (comp = 0; comp < img.nComps; ++comp) {
+      if (nJobs == jobsSize) {
+	jobsSize = jobsSize ? 2 * jobsSize : 256;
+	jobs = (JPXDecodeJob *)greallocn(jobs, jobsSize,
+					 sizeof(JPXDecodeJob));
+      }
+      jobs[nJobs].tileComp = &tile->tileComps[comp];
+      jobs[nJobs].cb = NULL;
+      jobs[nJobs].res = jobs[nJobs].sb = 0;
+      ++nJobs;
+    }
+  }
+  runDecodeJobs(jobs, nJobs);
+  gfree(jobs);
+
+  //----- inverse multi-component transform and DC level shift
+  for (i = 0; i < img.nXTiles * img.nYTiles; ++i) {
+    if (!inverseMultiCompAndDC(&img.tiles[i])) {
+      return gFalse;
+    }
+  }
+
+  return gTrue;
+}
+
+// Run a list of jobs on jpxDecodeThreads threads (including the
+// calling thread).
+void JPXStream::runDecodeJobs(JPXDecodeJob *jobs, int nJobs) {
+#if MULTITHREADED
+  GThreadID *threads;
+  int nThreads, i;
+#endif
+
+  decodeJobs = jobs;
+  nDecodeJobs = nJobs;
+  nextDecodeJob = 0;
+#if MULTITHREADED
+  nThreads = globalParams ? globalParams->getJPXDecodeThreads() : 1;
+  if (nThreads > nJobs) {
+    nThreads = nJobs;
+  }
+  if (nThreads > 1) {
+    threads = (GThreadID *)gmallocn(nThreads - 1, sizeof(GThreadID));
+    for (i = 0; i < nThreads - 1; ++i) {
+      gCreateThread(&threads[i], &decodeThread, this);
+    }
+    doDecodeJobs();
+    for (i = 0; i < nThreads - 1; ++i) {
+      gJoinThread(threads[i]);
+    }
+    gfree(threads);
+  } else {
+    doDecodeJobs();
+  }
+#else
+  doDecodeJobs();
+#endif
+  decodeJobs = NULL;
+  nDecodeJobs = 0;
+}
+
+#if MULTITHREADED
+GThreadReturn JPXStream::decodeThread(void *arg) {
+  ((JPXStream *)arg)->doDecodeJobs();
+  return 0;
+}
+#endif
+
+// Run jobs until there are none left.  Jobs are handed out one at a
+// time, so a thread that gets cheap code-blocks (or empty subbands)
+// simply takes more of them.
+void JPXStream::doDecodeJobs() {
+  JPXDecodeJob *job;
+  int i;
+
+  while (1) {
+#if MULTITHREADED
+    i = (int)gAtomicIncrement(&nextDecodeJob) - 1;
+#else
+    i = nextDecodeJob++;
+#endif
+    if (i >= nDecodeJobs) {
+      break;
+    }
+    job = &decodeJobs[i];
+    if (job->cb) {
+      decodeCodeBlock(job->tileComp, job->res, job->sb, job->cb);
+    } else {
+      inverseTransform(job->tileComp);
+    }
+  }
+}
+
+void JPXStream::decodeCodeBlock(JPXTileComp *tileComp, Guint res, Guint sb,
+				JPXCodeBlock *cb) {
+  MemStream *dataStr;
+  Object obj;
+  Guint nSegs, i;
+
+  obj.initNull();
+  dataStr = new MemStream((char *)cb->pktData, 0, cb->pktDataLen, &obj);
+  for (i = 0; i < cb->pktInfoLen; i += 1 + nSegs) {
+    if (tileComp->codeBlockStyle & 0x04) {
+      nSegs = cb->pktInfo[i];
+    } else {
+      nSegs = 1;
+    }
+    decodeCodeBlockPacket(tileComp, res, sb, cb, dataStr,
+			  cb->pktInfo[i], &cb->pktInfo[i + 1]);
+  }
+  delete cb->arithDecoder;
+  cb->arithDecoder = NULL;
+  delete cb->stats;
+  cb->stats = NULL;
+  delete dataStr;
+  gfree(cb->pktData);
+  cb->pktData = NULL;
+  cb->pktDataLen = cb->pktDataSize = 0;
+  gfree(cb->pktInfo);
+  cb->pktInfo = NULL;
+  cb->pktInfoLen = cb->pktInfoSize = 0;
+}
+
+// Decode the coding passes from one packet.
+void JPXStream::decodeCodeBlockPacket(JPXTileComp *tileComp,
+				      Guint res, Guint sb,
+				      JPXCodeBlock *cb, Stream *dataStr,
+				      Guint nCodingPasses, Guint *dataLen) {
+  int *coeff0, *coeff1, *coeff;
+  char *touched0, *touched1, *touched;
+  Guint horiz, vert, diag, all, cx, xorBit;
+  int horizSign, vertSign, bit;
+  int segSym;
+  Guint i, x, y0, y1;
+
   if (cb->arithDecoder) {
     cover(63);
-    cb->arithDecoder->restart(cb->dataLen[0]);
+    cb->arithDecoder->restart(dataLen[0]);
   } else {
     cover(64);
     cb->arithDecoder = new JArithmeticDecoder();
-    cb->arithDecoder->setStream(bufStr, cb->dataLen[0]);
+    cb->arithDecoder->setStream(dataStr, dataLen[0]);
     cb->arithDecoder->start();
     cb->stats = new JArithmeticDecoderStats(jpxNContexts);
     cb->stats->setEntry(jpxContextSigProp, 4, 0);
@@ -2479,9 +2718,9 @@ GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
     cb->stats->setEntry(jpxContextUniform, 46, 0);
   }
 
-  for (i = 0; i < cb->nCodingPasses; ++i) {
+  for (i = 0; i < nCodingPasses; ++i) {
     if ((tileComp->codeBlockStyle & 0x04) && i > 0) {
-      cb->arithDecoder->setStream(bufStr, cb->dataLen[i]);
+      cb->arithDecoder->setStream(dataStr, dataLen[i]);
       cb->arithDecoder->start();
     }
 
@@ -2776,7 +3015,6 @@ GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
   }
 
   cb->arithDecoder->cleanup();
-  return gTrue;
 }
 
 // Inverse quantization, and wavelet transform (IDWT).  This also does
@@ -2890,8 +3128,8 @@ void JPXStream::inverseTransformLevel(JPXTileComp *tileComp,
   int shift2;
   double mu;
   int val;
-  int *dataPtr, *bufPtr;
-  Guint nx1, nx2, ny1, ny2, offset;
+  int *dataPtr0, *dataPtr, *bufPtr;
+  Guint nx1, nx2, ny1, ny2, offset, lOffset, hOffset, nLanes, lane;
   Guint x, y, sb, cbX, cbY;
 
   qStyle = tileComp->quantStyle & 0x1f;
@@ -2987,97 +3225,167 @@ void JPXStream::inverseTransformLevel(JPXTileComp *tileComp,
 
   //----- inverse transform
 
-  // horizontal (row) transforms
+  // horizontal (row) transforms -- jpxIDWTLanes rows at a time
   if (r == tileComp->nDecompLevels) {
     offset = 3 + (tileComp->x0 & 1);
   } else {
     offset = 3 + (tileComp->resLevels[r+1].x0 & 1);
   }
-  for (y = 0, dataPtr = tileComp->data; y < ny2; ++y, dataPtr += tileComp->w) {
-    if (precinct->subbands[0].x0 == precinct->subbands[1].x0) {
-      // fetch LL/LH
-      for (x = 0, bufPtr = tileComp->buf + offset;
-	   x < nx1;
-	   ++x, bufPtr += 2) {
-	*bufPtr = dataPtr[x];
-      }
-      // fetch HL/HH
-      for (x = nx1, bufPtr = tileComp->buf + offset + 1;
-	   x < nx2;
-	   ++x, bufPtr += 2) {
-	*bufPtr = dataPtr[x];
-      }
-    } else {
-      // fetch LL/LH
-      for (x = 0, bufPtr = tileComp->buf + offset + 1;
-	   x < nx1;
-	   ++x, bufPtr += 2) {
-	*bufPtr = dataPtr[x];
-      }
-      // fetch HL/HH
-      for (x = nx1, bufPtr = tileComp->buf + offset;
-	   x < nx2;
-	   ++x, bufPtr += 2) {
-	*bufPtr = dataPtr[x];
+  if (precinct->subbands[0].x0 == precinct->subbands[1].x0) {
+    lOffset = offset;
+    hOffset = offset + 1;
+  } else {
+    lOffset = offset + 1;
+    hOffset = offset;
+  }
+  for (y = 0, dataPtr0 = tileComp->data;
+       y < ny2;
+       y += jpxIDWTLanes, dataPtr0 += jpxIDWTLanes * tileComp->w) {
+    nLanes = ny2 - y < jpxIDWTLanes ? ny2 - y : jpxIDWTLanes;
+    for (lane = 0, dataPtr = dataPtr0;
+	 lane < jpxIDWTLanes;
+	 ++lane, dataPtr += tileComp->w) {
+      if (lane < nLanes) {
+	// fetch LL/LH
+	for (x = 0, bufPtr = tileComp->buf + lOffset * jpxIDWTLanes + lane;
+	     x < nx1;
+	     ++x, bufPtr += 2 * jpxIDWTLanes) {
+	  *bufPtr = dataPtr[x];
+	}
+	// fetch HL/HH
+	for (x = nx1, bufPtr = tileComp->buf + hOffset * jpxIDWTLanes + lane;
+	     x < nx2;
+	     ++x, bufPtr += 2 * jpxIDWTLanes) {
+	  *bufPtr = dataPtr[x];
+	}
+      } else {
+	// unused lane
+	for (x = 0, bufPtr = tileComp->buf + offset * jpxIDWTLanes + lane;
+	     x < nx2;
+	     ++x, bufPtr += jpxIDWTLanes) {
+	  *bufPtr = 0;
+	}
       }
     }
     inverseTransform1D(tileComp, tileComp->buf, offset, nx2);
-    for (x = 0, bufPtr = tileComp->buf + offset; x < nx2; ++x, ++bufPtr) {
-      dataPtr[x] = *bufPtr;
+    for (lane = 0, dataPtr = dataPtr0;
+	 lane < nLanes;
+	 ++lane, dataPtr += tileComp->w) {
+      for (x = 0, bufPtr = tileComp->buf + offset * jpxIDWTLanes + lane;
+	   x < nx2;
+	   ++x, bufPtr += jpxIDWTLanes) {
+	dataPtr[x] = *bufPtr;
+      }
     }
   }
 
-  // vertical (column) transforms
+  // vertical (column) transforms -- jpxIDWTLanes columns at a time,
+  // so each row of the data array is read and written in runs
   if (r == tileComp->nDecompLevels) {
     offset = 3 + (tileComp->y0 & 1);
   } else {
     offset = 3 + (tileComp->resLevels[r+1].y0 & 1);
   }
-  for (x = 0, dataPtr = tileComp->data; x < nx2; ++x, ++dataPtr) {
-    if (precinct->subbands[1].y0 == precinct->subbands[0].y0) {
-      // fetch LL/HL
-      for (y = 0, bufPtr = tileComp->buf + offset;
-	   y < ny1;
-	   ++y, bufPtr += 2) {
-	*bufPtr = dataPtr[y * tileComp->w];
+  if (precinct->subbands[1].y0 == precinct->subbands[0].y0) {
+    lOffset = offset;
+    hOffset = offset + 1;
+  } else {
+    lOffset = offset + 1;
+    hOffset = offset;
+  }
+  for (x = 0, dataPtr0 = tileComp->data;
+       x < nx2;
+       x += jpxIDWTLanes, dataPtr0 += jpxIDWTLanes) {
+    nLanes = nx2 - x < jpxIDWTLanes ? nx2 - x : jpxIDWTLanes;
+    // fetch LL/HL
+    for (y = 0, dataPtr = dataPtr0,
+	   bufPtr = tileComp->buf + lOffset * jpxIDWTLanes;
+	 y < ny1;
+	 ++y, dataPtr += tileComp->w, bufPtr += 2 * jpxIDWTLanes) {
+      for (lane = 0; lane < nLanes; ++lane) {
+	bufPtr[lane] = dataPtr[lane];
       }
-      // fetch LH/HH
-      for (y = ny1, bufPtr = tileComp->buf + offset + 1;
-	   y < ny2;
-	   ++y, bufPtr += 2) {
-	*bufPtr = dataPtr[y * tileComp->w];
+      for (; lane < jpxIDWTLanes; ++lane) {
+	bufPtr[lane] = 0;
       }
-    } else {
-      // fetch LL/HL
-      for (y = 0, bufPtr = tileComp->buf + offset + 1;
-	   y < ny1;
-	   ++y, bufPtr += 2) {
-	*bufPtr = dataPtr[y * tileComp->w];
+    }
+    // fetch LH/HH
+    for (y = ny1, bufPtr = tileComp->buf + hOffset * jpxIDWTLanes;
+	 y < ny2;
+	 ++y, dataPtr += tileComp->w, bufPtr += 2 * jpxIDWTLanes) {
+      for (lane = 0; lane < nLanes; ++lane) {
+	bufPtr[lane] = dataPtr[lane];
       }
-      // fetch LH/HH
-      for (y = ny1, bufPtr = tileComp->buf + offset;
-	   y < ny2;
-	   ++y, bufPtr += 2) {
-	*bufPtr = dataPtr[y * tileComp->w];
+      for (; lane < jpxIDWTLanes; ++lane) {
+	bufPtr[lane] = 0;
       }
     }
     inverseTransform1D(tileComp, tileComp->buf, offset, ny2);
-    for (y = 0, bufPtr = tileComp->buf + offset; y < ny2; ++y, ++bufPtr) {
-      dataPtr[y * tileComp->w] = *bufPtr;
+    for (y = 0, dataPtr = dataPtr0,
+	   bufPtr = tileComp->buf + offset * jpxIDWTLanes;
+	 y < ny2;
+	 ++y, dataPtr += tileComp->w, bufPtr += jpxIDWTLanes) {
+      for (lane = 0; lane < nLanes; ++lane) {
+	dataPtr[lane] = bufPtr[lane];
+      }
     }
   }
 }
 
+#if JPX_SSE2
+
+// Four lanes of one 9-7 lifting step: (int)(d - coef * (a + b)).
+static inline __m128i jpxLift97(__m128i d, __m128i a, __m128i b,
+				__m128d coef) {
+  __m128i sum;
+  __m128d lo, hi;
+
+  sum = _mm_add_epi32(a, b);
+  lo = _mm_sub_pd(_mm_cvtepi32_pd(d),
+		  _mm_mul_pd(coef, _mm_cvtepi32_pd(sum)));
+  hi = _mm_sub_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(d, 0x0e)),
+		  _mm_mul_pd(coef,
+			     _mm_cvtepi32_pd(_mm_shuffle_epi32(sum, 0x0e))));
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+// Four lanes of a 9-7 scaling step: (int)(coef * d).
+static inline __m128i jpxScale97(__m128i d, __m128d coef) {
+  __m128d lo, hi;
+
+  lo = _mm_mul_pd(coef, _mm_cvtepi32_pd(d));
+  hi = _mm_mul_pd(coef, _mm_cvtepi32_pd(_mm_shuffle_epi32(d, 0x0e)));
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+#endif
+
+// 1D inverse transform of jpxIDWTLanes independent signals at once.
+// Sample i of the signal in lane k is data[i * jpxIDWTLanes + k].
+// Each lane gets exactly the arithmetic of the one-signal version, so
+// the SSE2 code produces the same results as the plain C code.
 void JPXStream::inverseTransform1D(JPXTileComp *tileComp, int *data,
 				   Guint offset, Guint n) {
+  int *p;
   Guint end, i;
+  int lane;
+#if JPX_SSE2
+  __m128d coef;
+  __m128i two;
+#endif
+
+#define jpxIDWTCopy(dst, src)						\
+  memcpy(data + (dst) * jpxIDWTLanes, data + (src) * jpxIDWTLanes,	\
+	 jpxIDWTLanes * sizeof(int))
 
   //----- special case for length = 1
   if (n == 1) {
     cover(79);
     if (offset == 4) {
       cover(104);
-      *data >>= 1;
+      for (lane = 0; lane < jpxIDWTLanes; ++lane) {
+	data[lane] >>= 1;
+      }
     }
 
   } else {
@@ -3086,84 +3394,170 @@ void JPXStream::inverseTransform1D(JPXTileComp *tileComp, int *data,
     end = offset + n;
 
     //----- extend right
-    data[end] = data[end - 2];
+    jpxIDWTCopy(end, end - 2);
     if (n == 2) {
       cover(81);
-      data[end+1] = data[offset + 1];
-      data[end+2] = data[offset];
-      data[end+3] = data[offset + 1];
+      jpxIDWTCopy(end + 1, offset + 1);
+      jpxIDWTCopy(end + 2, offset);
+      jpxIDWTCopy(end + 3, offset + 1);
     } else {
       cover(82);
-      data[end+1] = data[end - 3];
+      jpxIDWTCopy(end + 1, end - 3);
       if (n == 3) {
 	cover(105);
-	data[end+2] = data[offset + 1];
-	data[end+3] = data[offset + 2];
+	jpxIDWTCopy(end + 2, offset + 1);
+	jpxIDWTCopy(end + 3, offset + 2);
       } else {
 	cover(106);
-	data[end+2] = data[end - 4];
+	jpxIDWTCopy(end + 2, end - 4);
 	if (n == 4) {
 	  cover(107);
-	  data[end+3] = data[offset + 1];
+	  jpxIDWTCopy(end + 3, offset + 1);
 	} else {
 	  cover(108);
-	  data[end+3] = data[end - 5];
+	  jpxIDWTCopy(end + 3, end - 5);
 	}
       }
     }
 
     //----- extend left
-    data[offset - 1] = data[offset + 1];
-    data[offset - 2] = data[offset + 2];
-    data[offset - 3] = data[offset + 3];
+    jpxIDWTCopy(offset - 1, offset + 1);
+    jpxIDWTCopy(offset - 2, offset + 2);
+    jpxIDWTCopy(offset - 3, offset + 3);
     if (offset == 4) {
       cover(83);
-      data[0] = data[offset + 4];
+      jpxIDWTCopy(0, offset + 4);
     }
 
     //----- 9-7 irreversible filter
 
     if (tileComp->transform == 0) {
       cover(84);
+#if JPX_SSE2
       // step 1 (even)
-      for (i = 1; i <= end + 2; i += 2) {
-	data[i] = (int)(idwtKappa * data[i]);
+      coef = _mm_set1_pd(idwtKappa);
+      for (i = 1, p = data + jpxIDWTLanes; i <= end + 2;
+	   i += 2, p += 2 * jpxIDWTLanes) {
+	for (lane = 0; lane < jpxIDWTLanes; lane += 4) {
+	  _mm_storeu_si128((__m128i *)(p + lane),
+	      jpxScale97(_mm_loadu_si128((__m128i *)(p + lane)), coef));
+	}
       }
       // step 2 (odd)
-      for (i = 0; i <= end + 3; i += 2) {
-	data[i] = (int)(idwtIKappa * data[i]);
+      coef = _mm_set1_pd(idwtIKappa);
+      for (i = 0, p = data; i <= end + 3; i += 2, p += 2 * jpxIDWTLanes) {
+	for (lane = 0; lane < jpxIDWTLanes; lane += 4) {
+	  _mm_storeu_si128((__m128i *)(p + lane),
+	      jpxScale97(_mm_loadu_si128((__m128i *)(p + lane)), coef));
+	}
+      }
+#define jpxIDWTStep97(first, last, c)					\
+      coef = _mm_set1_pd(c);						\
+      for (i = first, p = data + (first) * jpxIDWTLanes; i <= last;	\
+	   i += 2, p += 2 * jpxIDWTLanes) {				\
+	for (lane = 0; lane < jpxIDWTLanes; lane += 4) {		\
+	  _mm_storeu_si128((__m128i *)(p + lane),			\
+	      jpxLift97(						\
+		  _mm_loadu_si128((__m128i *)(p + lane)),		\
+		  _mm_loadu_si128((__m128i *)(p + lane - jpxIDWTLanes)), \
+		  _mm_loadu_si128((__m128i *)(p + lane + jpxIDWTLanes)), \
+		  coef));						\
+	}								\
       }
-      // step 3 (even)
-      for (i = 1; i <= end + 2; i += 2) {
-	data[i] = (int)(data[i] - idwtDelta * (data[i-1] + data[i+1]));
+#else
+      // step 1 (even)
+      for (i = 1, p = data + jpxIDWTLanes; i <= end + 2;
+	   i += 2, p += 2 * jpxIDWTLanes) {
+	for (lane = 0; lane < jpxIDWTLanes; ++lane) {
+	  p[lane] = (int)(idwtKappa * p[lane]);
+	}
       }
-      // step 4 (odd)
-      for (i = 2; i <= end + 1; i += 2) {
-	data[i] = (int)(data[i] - idwtGamma * (data[i-1] + data[i+1]));
+      // step 2 (odd)
+      for (i = 0, p = data; i <= end + 3; i += 2, p += 2 * jpxIDWTLanes) {
+	for (lane = 0; lane < jpxIDWTLanes; ++lane) {
+	  p[lane] = (int)(idwtIKappa * p[lane]);
+	}
       }
-      // step 5 (even)
-      for (i = 3; i <= end; i += 2) {
-	data[i] = (int)(data[i] - idwtBeta * (data[i-1] + data[i+1]));
+#define jpxIDWTStep97(first, last, c)					\
+      for (i = first, p = data + (first) * jpxIDWTLanes; i <= last;	\
+	   i += 2, p += 2 * jpxIDWTLanes) {				\
+	for (lane = 0; lane < jpxIDWTLanes; ++lane) {			\
+	  p[lane] = (int)(p[lane] - c * (p[lane - jpxIDWTLanes] +	\
+					 p[lane + jpxIDWTLanes]));	\
+	}								\
       }
+#endif
+      // step 3 (even)
+      jpxIDWTStep97(1, end + 2, idwtDelta);
+      // step 4 (odd)
+      jpxIDWTStep97(2, end + 1, idwtGamma);
+      // step 5 (even)
+      jpxIDWTStep97(3, end, idwtBeta);
       // step 6 (odd)
-      for (i = 4; i <= end - 1; i += 2) {
-	data[i] = (int)(data[i] - idwtAlpha * (data[i-1] + data[i+1]));
-      }
+      jpxIDWTStep97(4, end - 1, idwtAlpha);
+#undef jpxIDWTStep97
 
     //----- 5-3 reversible filter
 
     } else {
       cover(85);
+#if JPX_SSE2
+      two = _mm_set1_epi32(2);
       // step 1 (even)
-      for (i = 3; i <= end; i += 2) {
-	data[i] -= (data[i-1] + data[i+1] + 2) >> 2;
+      for (i = 3, p = data + 3 * jpxIDWTLanes; i <= end;
+	   i += 2, p += 2 * jpxIDWTLanes) {
+	for (lane = 0; lane < jpxIDWTLanes; lane += 4) {
+	  _mm_storeu_si128((__m128i *)(p + lane),
+	      _mm_sub_epi32(
+		  _mm_loadu_si128((__m128i *)(p + lane)),
+		  _mm_srai_epi32(
+		      _mm_add_epi32(
+			  _mm_add_epi32(
+			      _mm_loadu_si128((__m128i *)
+					      (p + lane - jpxIDWTLanes)),
+			      _mm_loadu_si128((__m128i *)
+					      (p + lane + jpxIDWTLanes))),
+			  two),
+		      2)));
+	}
       }
       // step 2 (odd)
-      for (i = 4; i < end; i += 2) {
-	data[i] += (data[i-1] + data[i+1]) >> 1;
+      for (i = 4, p = data + 4 * jpxIDWTLanes; i < end;
+	   i += 2, p += 2 * jpxIDWTLanes) {
+	for (lane = 0; lane < jpxIDWTLanes; lane += 4) {
+	  _mm_storeu_si128((__m128i *)(p + lane),
+	      _mm_add_epi32(
+		  _mm_loadu_si128((__m128i *)(p + lane)),
+		  _mm_srai_epi32(
+		      _mm_add_epi32(
+			  _mm_loadu_si128((__m128i *)
+					  (p + lane - jpxIDWTLanes)),
+			  _mm_loadu_si128((__m128i *)
+					  (p + lane + jpxIDWTLanes))),
+		      1)));
+	}
+      }
+#else
+      // step 1 (even)
+      for (i = 3, p = data + 3 * jpxIDWTLanes; i <= end;
+	   i += 2, p += 2 * jpxIDWTLanes) {
+	for (lane = 0; lane < jpxIDWTLanes; ++lane) {
+	  p[lane] -= (p[lane - jpxIDWTLanes] + p[lane + jpxIDWTLanes] + 2)
+	             >> 2;
+	}
       }
+      // step 2 (odd)
+      for (i = 4, p = data + 4 * jpxIDWTLanes; i < end;
+	   i += 2, p += 2 * jpxIDWTLanes) {
+	for (lane = 0; lane < jpxIDWTLanes; ++lane) {
+	  p[lane] += (p[lane - jpxIDWTLanes] + p[lane + jpxIDWTLanes]) >> 1;
+	}
+      }
+#endif
     }
   }
+
+#undef jpxIDWTCopy
 }
 
 // Inverse multi-component transform and DC level shift.  This also
@@ -16,6 +16,10 @@
 #endif
 
 #include "gtypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#include "GThread.h"
+#endif
 #include "Object.h"
 #include "Stream.h"
 
@@ -121,6 +125,15 @@ struct JPXCodeBlock {
   Guint *dataLen;		// data lengths (one per codeword segment)
   Guint dataLenSize;		// size of the dataLen array
 
+  //----- buffered packet data (decoded once all tile-parts are read)
+  Guchar *pktData;		// codeword segments from all packets
+  Guint pktDataLen;		// number of bytes in pktData
+  Guint pktDataSize;		// size of the pktData array
+  Guint *pktInfo;		// for each packet: number of coding passes,
+				//   followed by the data lengths
+  Guint pktInfoLen;		// number of entries in pktInfo
+  Guint pktInfoSize;		// size of the pktInfo array
+
   //----- coefficient data
   int *coeffs;
   char *touched;		// coefficient 'touched' flags
@@ -207,7 +220,8 @@ struct JPXTileComp {
   //----- image data
   int *data;			// the decoded image data
   int *buf;			// intermediate buffer for the inverse
-				//   transform
+				//   transform (jpxIDWTLanes interleaved
+				//   rows or columns)
 
   //----- children
   JPXResLevel *resLevels;	// the resolution levels
@@ -268,6 +282,16 @@ struct JPXImage {
 
 //------------------------------------------------------------------------
 
+// One unit of work for decodeTiles(): a code-block to decode, or a
+// tile-component to inverse transform (cb == NULL).
+struct JPXDecodeJob {
+  JPXTileComp *tileComp;
+  JPXCodeBlock *cb;
+  Guint res, sb;
+};
+
+//------------------------------------------------------------------------
+
 enum JPXDecodeResult {
   jpxDecodeOk,
   jpxDecodeNonFatalError,
@@ -309,6 +333,17 @@ private:
 			  JPXSubband *subband,
 			  Guint res, Guint sb,
 			  JPXCodeBlock *cb);
+  GBool decodeTiles();
+  void runDecodeJobs(JPXDecodeJob *jobs, int nJobs);
+#if MULTITHREADED
+  static GThreadReturn decodeThread(void *arg);
+#endif
+  void doDecodeJobs();
+  void decodeCodeBlock(JPXTileComp *tileComp, Guint res, Guint sb,
+		       JPXCodeBlock *cb);
+  void decodeCodeBlockPacket(JPXTileComp *tileComp, Guint res, Guint sb,
+			     JPXCodeBlock *cb, Stream *dataStr,
+			     Guint nCodingPasses, Guint *dataLen);
   void inverseTransform(JPXTileComp *tileComp);
   void inverseTransformLevel(JPXTileComp *tileComp,
 			     Guint r, JPXResLevel *resLevel);
@@ -352,6 +387,14 @@ private:
 				//   (for bit stuffing)
   Guint byteCount;		// number of available bytes left
 
+  JPXDecodeJob *decodeJobs;	// jobs being run by runDecodeJobs()
+  int nDecodeJobs;		// number of entries in decodeJobs
+#if MULTITHREADED
+  GAtomicCounter nextDecodeJob;	// number of jobs taken so far
+#else
+  int nextDecodeJob;
+#endif
+
   Guint curX, curY, curComp;	// current position for lookChar/getChar
   Guint readBuf;		// read buffer
   Guint readBufLen;		// number of valid bits in readBuf
@@ -530,7 +530,12 @@ void Lexer::skipToNextLine() {
 }
 
 void Lexer::skipToEOF() {
-  while (getChar() != EOF) ;
+  while (!curStr.isNone()) {
+    // skip the rest of the current stream in blocks, then let
+    // getChar() move on to the next one
+    while (curStr.getStream()->discardChars(4096) == 4096) ;
+    getChar();
+  }
 }
 
 GBool Lexer::isSpace(int c) {
@@ -59,6 +59,7 @@ PDFCore::PDFCore(SplashColorMode colorMode, int bitmapRowPad,
   state = new DisplayState(globalParams->getMaxTileWidth(),
 			   globalParams->getMaxTileHeight(),
 			   globalParams->getTileCacheSize(),
+			   globalParams->getTileCacheMemory(),
 			   globalParams->getWorkerThreads(),
 			   colorMode, bitmapRowPad);
   tileMap = new TileMap(state);
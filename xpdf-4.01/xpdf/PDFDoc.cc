@@ -40,6 +40,7 @@
 #include "Outline.h"
 #endif
 #include "OptionalContent.h"
+#include "ContentStreamCache.h"
 #include "PDFDoc.h"
 
 //------------------------------------------------------------------------
@@ -240,6 +241,7 @@ void PDFDoc::init(PDFCore *coreA) {
   outline = NULL;
 #endif
   optContent = NULL;
+  contentStreamCache = NULL;
 }
 
 GBool PDFDoc::setup(GString *ownerPassword, GString *userPassword) {
@@ -271,6 +273,8 @@ GBool PDFDoc::setup(GString *ownerPassword, GString *userPassword) {
   // read the optional content info
   optContent = new OptionalContent(this);
 
+  // cache for pre-tokenized form XObjects, etc.
+  contentStreamCache = new ContentStreamCache();
 
   // done
   return gTrue;
@@ -312,6 +316,9 @@ GBool PDFDoc::setup2(GString *ownerPassword, GString *userPassword,
 }
 
 PDFDoc::~PDFDoc() {
+  if (contentStreamCache) {
+    delete contentStreamCache;
+  }
   if (optContent) {
     delete optContent;
   }
@@ -30,6 +30,7 @@ class Outline;
 class OutlineItem;
 class OptionalContent;
 class PDFCore;
+class ContentStreamCache;
 
 //------------------------------------------------------------------------
 // PDFDoc
@@ -149,6 +150,9 @@ public:
   // Return the OptionalContent object.
   OptionalContent *getOptionalContent() { return optContent; }
 
+  // Return the cache of pre-tokenized content streams.
+  ContentStreamCache *getContentStreamCache() { return contentStreamCache; }
+
   // Is the file encrypted?
   GBool isEncrypted() { return xref->isEncrypted(); }
 
@@ -216,6 +220,7 @@ private:
   Outline *outline;
 #endif
   OptionalContent *optContent;
+  ContentStreamCache *contentStreamCache;
 
   GBool ok;
   int errCode;
@@ -341,6 +341,8 @@ void StandardSecurityHandler::freeAuthData(void *authData) {
 
 GBool StandardSecurityHandler::authorize(void *authData) {
   GString *ownerPassword, *userPassword;
+  Guchar digest[32];
+  GBool aes256;
 
   if (!ok) {
     return gFalse;
@@ -352,6 +354,20 @@ GBool StandardSecurityHandler::authorize(void *authData) {
     ownerPassword = NULL;
     userPassword = NULL;
   }
+
+  // checking the passwords of an AES-256 document is expensive (the
+  // revision 6 hash), so reuse the key if the same document was
+  // opened with the same passwords before
+  aes256 = encRevision == 5 || encRevision == 6;
+  if (aes256) {
+    Decrypt::makeFileKeyDigest(encRevision, ownerKey, userKey,
+			       ownerEnc, userEnc, permFlags, encryptMetadata,
+			       ownerPassword, userPassword, digest);
+    if (globalParams->getCachedFileKey(digest, fileKey, &ownerPasswordOk)) {
+      return gTrue;
+    }
+  }
+
   if (!Decrypt::makeFileKey(encVersion, encRevision, fileKeyLength,
 			    ownerKey, userKey, ownerEnc, userEnc,
 			    permFlags, fileID,
@@ -359,5 +375,8 @@ GBool StandardSecurityHandler::authorize(void *authData) {
 			    encryptMetadata, &ownerPasswordOk)) {
     return gFalse;
   }
+  if (aes256) {
+    globalParams->addCachedFileKey(digest, fileKey, ownerPasswordOk);
+  }
   return gTrue;
 }
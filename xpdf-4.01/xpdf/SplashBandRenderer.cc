@@ -0,0 +1,313 @@
+//========================================================================
+//
+// SplashBandRenderer.cc
+//
+// Rasterize pages in horizontal bands, on several threads.
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "gmem.h"
+#include "gmempp.h"
+#include "SplashBitmap.h"
+#include "GfxState.h"
+#include "Page.h"
+#include "Catalog.h"
+#include "PDFDoc.h"
+#include "SplashOutputDev.h"
+#include "SplashDisplayList.h"
+#include "SplashBandRenderer.h"
+
+//------------------------------------------------------------------------
+// SplashBandThread
+//------------------------------------------------------------------------
+
+struct SplashBandThread {
+  SplashBandRenderer *renderer;
+  SplashOutputDev *out;
+  int band;			// band to rasterize (displayPageBands)
+};
+
+//------------------------------------------------------------------------
+// SplashBandRenderer
+//------------------------------------------------------------------------
+
+SplashBandRenderer::SplashBandRenderer(SplashColorMode colorModeA,
+				       int bitmapRowPadA,
+				       GBool reverseVideoA,
+				       SplashColorPtr paperColorA,
+				       int nThreadsA) {
+  int i;
+
+  colorMode = colorModeA;
+  bitmapRowPad = bitmapRowPadA;
+#if MULTITHREADED
+  nThreads = nThreadsA < 1 ? 1 : nThreadsA;
+#else
+  nThreads = 1;
+#endif
+  threads = (SplashBandThread *)gmallocn(nThreads, sizeof(SplashBandThread));
+  for (i = 0; i < nThreads; ++i) {
+    threads[i].renderer = this;
+    threads[i].out = new SplashOutputDev(colorMode, bitmapRowPad,
+					 reverseVideoA, paperColorA);
+  }
+  displayList = new SplashDisplayList(colorMode, bitmapRowPad,
+				      reverseVideoA, paperColorA);
+  doc = NULL;
+  bitmap = NULL;
+}
+
+SplashBandRenderer::~SplashBandRenderer() {
+  int i;
+
+  for (i = 0; i < nThreads; ++i) {
+    delete threads[i].out;
+  }
+  gfree(threads);
+  delete displayList;
+  if (bitmap) {
+    delete bitmap;
+  }
+}
+
+void SplashBandRenderer::setNoComposite(GBool f) {
+  int i;
+
+  for (i = 0; i < nThreads; ++i) {
+    threads[i].out->setNoComposite(f);
+  }
+}
+
+void SplashBandRenderer::startDoc(PDFDoc *docA) {
+  int i;
+
+  doc = docA;
+  for (i = 0; i < nThreads; ++i) {
+    threads[i].out->startDoc(doc->getXRef());
+  }
+  displayList->startDoc(doc->getXRef());
+}
+
+void SplashBandRenderer::displayPage(int pageA, double hDPIA, double vDPIA,
+				     int rotateA, GBool useMediaBoxA,
+				     GBool cropA, GBool printingA) {
+  int w, h, n;
+#if MULTITHREADED
+  GThreadID *tids;
+  int i;
+#endif
+
+  page = pageA;
+  hDPI = hDPIA;
+  vDPI = vDPIA;
+  rotate = rotateA;
+  useMediaBox = useMediaBoxA;
+  crop = cropA;
+  printing = printingA;
+  getPageSize(&w, &h);
+
+  // split the page into bands
+  n = nThreads * splashBandsPerThread;
+  if (n > h / splashMinBandHeight) {
+    n = h / splashMinBandHeight;
+  }
+  if (n <= 1 || nThreads == 1) {
+    // not worth splitting -- rasterize the full page on this thread
+    threads[0].out->setBand(0, -1);
+    doc->displayPage(threads[0].out, page, hDPI, vDPI, rotate,
+		     useMediaBox, crop, printing);
+    if (bitmap) {
+      delete bitmap;
+    }
+    bitmap = threads[0].out->takeBitmap();
+    return;
+  }
+  bandHeight = (h + n - 1) / n;
+  nBands = (h + bandHeight - 1) / bandHeight;
+  nextBand = 0;
+
+  if (!bitmap || bitmap->getWidth() != w || bitmap->getHeight() != h) {
+    if (bitmap) {
+      delete bitmap;
+    }
+    bitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode,
+			      colorMode != splashModeMono1);
+  }
+
+  doc->displayPage(displayList, page, hDPI, vDPI, rotate,
+		   useMediaBox, crop, printing);
+
+#if MULTITHREADED
+  n = nThreads < nBands ? nThreads : nBands;
+  tids = (GThreadID *)gmallocn(n - 1, sizeof(GThreadID));
+  for (i = 1; i < n; ++i) {
+    gCreateThread(&tids[i - 1], &renderThread, &threads[i]);
+  }
+  renderBands(threads[0].out);
+  for (i = 1; i < n; ++i) {
+    gJoinThread(tids[i - 1]);
+  }
+  gfree(tids);
+#else
+  renderBands(threads[0].out);
+#endif
+}
+
+void SplashBandRenderer::displayPageBands(int pageA, double hDPIA,
+					  double vDPIA, int rotateA,
+					  GBool useMediaBoxA, GBool cropA,
+					  GBool printingA, int bandHeightA,
+					  SplashBandCbk bandCbk,
+					  void *bandCbkData) {
+  int w, h, band, n, i;
+#if MULTITHREADED
+  GThreadID *tids;
+#endif
+
+  page = pageA;
+  hDPI = hDPIA;
+  vDPI = vDPIA;
+  rotate = rotateA;
+  useMediaBox = useMediaBoxA;
+  crop = cropA;
+  printing = printingA;
+  getPageSize(&w, &h);
+  bandHeight = bandHeightA < 1 ? 1 : bandHeightA;
+  nBands = (h + bandHeight - 1) / bandHeight;
+  if (nBands > 1) {
+    doc->displayPage(displayList, page, hDPI, vDPI, rotate,
+		     useMediaBox, crop, printing);
+  }
+
+  // rasterize up to nThreads bands at a time, and pass them on in
+  // order
+#if MULTITHREADED
+  tids = (GThreadID *)gmallocn(nThreads, sizeof(GThreadID));
+#endif
+  for (band = 0; band < nBands; band += n) {
+    n = nBands - band < nThreads ? nBands - band : nThreads;
+#if MULTITHREADED
+    for (i = 1; i < n; ++i) {
+      threads[i].band = band + i;
+      gCreateThread(&tids[i], &renderBandThread, &threads[i]);
+    }
+#endif
+    renderBand(threads[0].out, band);
+#if MULTITHREADED
+    for (i = 1; i < n; ++i) {
+      gJoinThread(tids[i]);
+    }
+#endif
+    for (i = 0; i < n; ++i) {
+      (*bandCbk)(threads[i].out->getBitmap(), bandCbkData);
+    }
+  }
+#if MULTITHREADED
+  gfree(tids);
+#endif
+}
+
+// Compute the bitmap size exactly as SplashOutputDev::startPage does
+// (with the GfxState that Page::displaySlice constructs).
+void SplashBandRenderer::getPageSize(int *w, int *h) {
+  Page *pageObj;
+  PDFRectangle box;
+  GfxState *state;
+  GBool crop2;
+  int rotate2;
+
+  pageObj = doc->getCatalog()->getPage(page);
+  rotate2 = rotate + pageObj->getRotate();
+  if (rotate2 >= 360) {
+    rotate2 -= 360;
+  } else if (rotate2 < 0) {
+    rotate2 += 360;
+  }
+  pageObj->makeBox(hDPI, vDPI, rotate2, useMediaBox,
+		   threads[0].out->upsideDown(), -1, -1, -1, -1,
+		   &box, &crop2);
+  state = new GfxState(hDPI, vDPI, &box, rotate2,
+		       threads[0].out->upsideDown());
+  *w = (int)(state->getPageWidth() + 0.5);
+  if (*w <= 0) {
+    *w = 1;
+  }
+  *h = (int)(state->getPageHeight() + 0.5);
+  if (*h <= 0) {
+    *h = 1;
+  }
+  delete state;
+}
+
+#if MULTITHREADED
+GThreadReturn SplashBandRenderer::renderThread(void *arg) {
+  SplashBandThread *thread;
+
+  thread = (SplashBandThread *)arg;
+  thread->renderer->renderBands(thread->out);
+  return 0;
+}
+
+GThreadReturn SplashBandRenderer::renderBandThread(void *arg) {
+  SplashBandThread *thread;
+
+  thread = (SplashBandThread *)arg;
+  thread->renderer->renderBand(thread->out, thread->band);
+  return 0;
+}
+#endif
+
+// Rasterize one band (for displayPageBands).
+void SplashBandRenderer::renderBand(SplashOutputDev *out, int band) {
+  out->setBand(band * bandHeight, bandHeight);
+  if (nBands == 1) {
+    // nothing to share -- run the page content directly
+    doc->displayPage(out, page, hDPI, vDPI, rotate,
+		     useMediaBox, crop, printing);
+  } else {
+    displayList->replay(out);
+  }
+}
+
+// Rasterize bands until there are none left, and copy them into the
+// page bitmap.  The bands don't overlap, so no locking is needed.
+void SplashBandRenderer::renderBands(SplashOutputDev *out) {
+  SplashBitmap *band;
+  int i, y, h;
+
+  while (1) {
+#if MULTITHREADED
+    i = (int)gAtomicIncrement(&nextBand) - 1;
+#else
+    i = nextBand++;
+#endif
+    if (i >= nBands) {
+      break;
+    }
+    out->setBand(i * bandHeight, bandHeight);
+    displayList->replay(out);
+    band = out->getBitmap();
+    if (band->getWidth() != bitmap->getWidth() ||
+	band->getHeight() != bitmap->getHeight() ||
+	band->getRowSize() != bitmap->getRowSize()) {
+      continue;
+    }
+    y = band->getBandY();
+    h = band->getBandHeight();
+    memcpy(bitmap->getDataPtr() + y * bitmap->getRowSize(),
+	   band->getDataPtr() + y * band->getRowSize(),
+	   h * bitmap->getRowSize());
+    if (bitmap->getAlphaPtr() && band->getAlphaPtr()) {
+      memcpy(bitmap->getAlphaPtr() + y * bitmap->getAlphaRowSize(),
+	     band->getAlphaPtr() + y * band->getAlphaRowSize(),
+	     h * bitmap->getAlphaRowSize());
+    }
+  }
+}
@@ -0,0 +1,130 @@
+//========================================================================
+//
+// SplashBandRenderer.h
+//
+// Rasterize pages in horizontal bands, on several threads.
+//
+//========================================================================
+
+#ifndef SPLASHBANDRENDERER_H
+#define SPLASHBANDRENDERER_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "gtypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#include "GThread.h"
+#endif
+#include "SplashTypes.h"
+
+class PDFDoc;
+class SplashBitmap;
+class SplashOutputDev;
+class SplashDisplayList;
+struct SplashBandThread;
+
+//------------------------------------------------------------------------
+
+// number of bands per thread -- more bands balance the load better,
+// but each band replays the complete display list (the paths, glyphs,
+// and images outside the band are clipped away, but shadings, groups,
+// and image scaling are still set up for each band), which usually
+// costs more than the imbalance
+#define splashBandsPerThread 1
+
+// minimum band height, in pixels
+#define splashMinBandHeight 64
+
+// Called by SplashBandRenderer::displayPageBands with each band
+// bitmap, top to bottom.
+typedef void (*SplashBandCbk)(SplashBitmap *band, void *data);
+
+//------------------------------------------------------------------------
+// SplashBandRenderer
+//------------------------------------------------------------------------
+
+// The page content is run once, into a SplashDisplayList.  Each
+// thread has its own SplashOutputDev.  The threads take bands one at
+// a time, and replay the display list with the bitmap and clip
+// limited to the band (see SplashOutputDev::setBand); the bands are
+// then copied into one page bitmap.  The page bitmap is identical to
+// the one a single SplashOutputDev would produce.
+
+class SplashBandRenderer {
+public:
+
+  // The first four args are passed to the SplashOutputDev
+  // constructor.  <nThreadsA> is the number of threads, including the
+  // calling thread.
+  SplashBandRenderer(SplashColorMode colorModeA, int bitmapRowPadA,
+		     GBool reverseVideoA, SplashColorPtr paperColorA,
+		     int nThreadsA);
+
+  ~SplashBandRenderer();
+
+  // Setting this to true disables the final composite (with the
+  // opaque paper color), resulting in transparent output.
+  void setNoComposite(GBool f);
+
+  void startDoc(PDFDoc *docA);
+
+  // Rasterize a page, with the same args as PDFDoc::displayPage.
+  void displayPage(int pageA, double hDPIA, double vDPIA, int rotateA,
+		   GBool useMediaBoxA, GBool cropA, GBool printingA);
+
+  // Get the bitmap of the last rasterized page.
+  SplashBitmap *getBitmap() { return bitmap; }
+
+  // Rasterize a page in bands of <bandHeightA> rows (the last band
+  // may be shorter), and pass each band bitmap to <bandCbk>, top to
+  // bottom, instead of assembling a page bitmap.  Transparency group
+  // and soft mask bitmaps are band-sized too, so peak memory depends
+  // on the band size (times the number of threads), not on the page
+  // height (the display list does hold the page's image data, as
+  // decoded by the stream filters).  The band bitmaps are only valid
+  // during the callback.
+  // The first seven args are the same as for displayPage.
+  void displayPageBands(int pageA, double hDPIA, double vDPIA, int rotateA,
+			GBool useMediaBoxA, GBool cropA, GBool printingA,
+			int bandHeightA,
+			SplashBandCbk bandCbk, void *bandCbkData);
+
+private:
+
+  void getPageSize(int *w, int *h);
+#if MULTITHREADED
+  static GThreadReturn renderThread(void *arg);
+  static GThreadReturn renderBandThread(void *arg);
+#endif
+  void renderBands(SplashOutputDev *out);
+  void renderBand(SplashOutputDev *out, int band);
+
+  SplashColorMode colorMode;
+  int bitmapRowPad;
+  int nThreads;
+  SplashBandThread *threads;	// [nThreads]
+  SplashDisplayList *displayList;
+  PDFDoc *doc;
+  SplashBitmap *bitmap;		// page bitmap
+
+  // current page
+  int page;
+  double hDPI, vDPI;
+  int rotate;
+  GBool useMediaBox, crop, printing;
+  int bandHeight;		// rows per band (the last band may be
+				//   shorter)
+  int nBands;
+#if MULTITHREADED
+  GAtomicCounter nextBand;
+#else
+  int nextBand;
+#endif
+};
+
+#endif
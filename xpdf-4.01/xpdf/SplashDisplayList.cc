@@ -0,0 +1,1104 @@
+//========================================================================
+//
+// SplashDisplayList.cc
+//
+// Record the drawing operations of a page once, and replay them into
+// SplashOutputDevs.
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <limits.h>
+#include <string.h>
+#include "gmem.h"
+#include "gmempp.h"
+#include "GList.h"
+#include "Object.h"
+#include "Stream.h"
+#include "Function.h"
+#include "GfxState.h"
+#include "GfxFont.h"
+#include "Gfx.h"
+#include "SplashOutputDev.h"
+#include "SplashDisplayList.h"
+
+//------------------------------------------------------------------------
+
+// initial size of the buffer for recorded image data
+#define splashDLImageBufSize 65536
+
+//------------------------------------------------------------------------
+// SplashDLArgs
+//------------------------------------------------------------------------
+
+static void deleteRecords(GList *list);
+
+// Args that don't fit in a SplashDLRecord.
+class SplashDLArgs {
+public:
+
+  SplashDLArgs();
+  ~SplashDLArgs();
+
+  // images
+  Guchar *data;			// image data, as ImageStream reads it
+  int dataLen;
+  int width, height;
+  GfxImageColorMap *colorMap;
+  int *maskColors;
+  Guchar *maskData;		// mask data, as ImageStream reads it
+  int maskDataLen;
+  int maskWidth, maskHeight;
+  GfxImageColorMap *maskColorMap;
+  double *matte;
+
+  // shaded fills
+  GfxShading *shading;
+
+  // transparency groups and soft masks
+  GfxColorSpace *blendingColorSpace;
+  Function *transferFunc;
+  GfxColor backdropColor;
+
+  // tiling pattern fills
+  int tilingType;
+  double bbox[4];
+  double xStep, yStep;
+  GList *tiles;			// one record list per pattern cell
+				//   callback [GList[SplashDLRecord]]
+};
+
+SplashDLArgs::SplashDLArgs() {
+  data = NULL;
+  dataLen = 0;
+  width = height = 0;
+  colorMap = NULL;
+  maskColors = NULL;
+  maskData = NULL;
+  maskDataLen = 0;
+  maskWidth = maskHeight = 0;
+  maskColorMap = NULL;
+  matte = NULL;
+  shading = NULL;
+  blendingColorSpace = NULL;
+  transferFunc = NULL;
+  memset(&backdropColor, 0, sizeof(backdropColor));
+  tilingType = 0;
+  bbox[0] = bbox[1] = bbox[2] = bbox[3] = 0;
+  xStep = yStep = 0;
+  tiles = NULL;
+}
+
+SplashDLArgs::~SplashDLArgs() {
+  int i;
+
+  gfree(data);
+  if (colorMap) {
+    delete colorMap;
+  }
+  gfree(maskColors);
+  gfree(maskData);
+  if (maskColorMap) {
+    delete maskColorMap;
+  }
+  gfree(matte);
+  if (shading) {
+    delete shading;
+  }
+  if (blendingColorSpace) {
+    delete blendingColorSpace;
+  }
+  if (transferFunc) {
+    delete transferFunc;
+  }
+  if (tiles) {
+    for (i = 0; i < tiles->getLength(); ++i) {
+      deleteRecords((GList *)tiles->get(i));
+    }
+    delete tiles;
+  }
+}
+
+//------------------------------------------------------------------------
+// SplashDLRecord
+//------------------------------------------------------------------------
+
+struct SplashDLRecord {
+  SplashDLOp op;
+  GfxState *state;		// state copy (owned by the
+				//   SplashDisplayList), or NULL
+  double x[6];			// coordinates, matrix, or bbox
+  int n[4];			// ints and flags
+  SplashDLArgs *args;		// other args, or NULL
+};
+
+static void deleteRecords(GList *list) {
+  SplashDLRecord *rec;
+  int i;
+
+  for (i = 0; i < list->getLength(); ++i) {
+    rec = (SplashDLRecord *)list->get(i);
+    if (rec->args) {
+      delete rec->args;
+    }
+    delete rec;
+  }
+  delete list;
+}
+
+//------------------------------------------------------------------------
+
+// Data for the pattern cell callbacks.
+struct SplashDLTileRecorder {
+  SplashDisplayList *dl;
+  Gfx *gfx;
+  Object *strRef;
+  Dict *resDict;
+  GList *tiles;
+};
+
+struct SplashDLTileReplay {
+  SplashDisplayList *dl;
+  SplashOutputDev *out;
+  GList *tiles;
+  int next;
+};
+
+//------------------------------------------------------------------------
+// SplashDisplayList
+//------------------------------------------------------------------------
+
+SplashDisplayList::SplashDisplayList(SplashColorMode colorModeA,
+				     int bitmapRowPadA,
+				     GBool reverseVideoA,
+				     SplashColorPtr paperColorA) {
+  tracker = new SplashOutputDev(colorModeA, bitmapRowPadA,
+				reverseVideoA, paperColorA);
+  tracker->setBand(0, 1);
+  records = new GList();
+  curList = records;
+  states = new GList();
+  fonts = new GList();
+  charState = NULL;
+}
+
+SplashDisplayList::~SplashDisplayList() {
+  clear();
+  deleteRecords(records);
+  delete states;
+  delete fonts;
+  delete tracker;
+}
+
+void SplashDisplayList::clear() {
+  int i;
+
+  deleteRecords(records);
+  records = new GList();
+  curList = records;
+  for (i = 0; i < states->getLength(); ++i) {
+    delete (GfxState *)states->get(i);
+  }
+  delete states;
+  states = new GList();
+  for (i = 0; i < fonts->getLength(); ++i) {
+    ((GfxFont *)fonts->get(i))->decRefCnt();
+  }
+  delete fonts;
+  fonts = new GList();
+  charState = NULL;
+}
+
+void SplashDisplayList::startDoc(XRef *xrefA) {
+  tracker->startDoc(xrefA);
+}
+
+// Copy <state>, and hold a reference to its font (the GfxFontDict
+// that owns it may be gone before the page is replayed).
+GfxState *SplashDisplayList::copyState(GfxState *state) {
+  GfxState *copy;
+  GfxFont *font;
+  int i;
+
+  copy = state->copy(gTrue);
+  states->append(copy);
+  if ((font = copy->getFont())) {
+    for (i = fonts->getLength() - 1; i >= 0; --i) {
+      if (fonts->get(i) == font) {
+	break;
+      }
+    }
+    if (i < 0) {
+      font->incRefCnt();
+      fonts->append(font);
+    }
+  }
+  return copy;
+}
+
+SplashDLRecord *SplashDisplayList::addRecord(SplashDLOp op,
+					     GfxState *state) {
+  SplashDLRecord *rec;
+
+  rec = new SplashDLRecord;
+  rec->op = op;
+  rec->state = state ? copyState(state) : (GfxState *)NULL;
+  rec->args = NULL;
+  curList->append(rec);
+  charState = NULL;
+  return rec;
+}
+
+// Read the data that ImageStream would read for a <width> x <height>
+// image (up to the end of the stream).
+Guchar *SplashDisplayList::readImageData(Stream *str, int width, int height,
+					 int nComps, int nBits, int *len) {
+  Guchar *buf;
+  int lineSize, size, n, y;
+
+  *len = 0;
+  if (width <= 0 || height <= 0 ||
+      width > INT_MAX / nComps ||
+      width * nComps > (INT_MAX - 7) / nBits) {
+    return NULL;
+  }
+  lineSize = (width * nComps * nBits + 7) >> 3;
+  size = lineSize < splashDLImageBufSize ? splashDLImageBufSize : lineSize;
+  buf = (Guchar *)gmalloc(size);
+  str->reset();
+  for (y = 0; y < height; ++y) {
+    if (*len > size - lineSize) {
+      if (size > INT_MAX / 2) {
+	break;
+      }
+      size *= 2;
+      buf = (Guchar *)grealloc(buf, size);
+    }
+    n = str->getBlock((char *)buf + *len, lineSize);
+    *len += n;
+    if (n < lineSize) {
+      break;
+    }
+  }
+  str->close();
+  return buf;
+}
+
+GBool SplashDisplayList::upsideDown() {
+  return tracker->upsideDown();
+}
+
+void SplashDisplayList::setDefaultCTM(double *ctm) {
+  SplashDLRecord *rec;
+  int i;
+
+  OutputDev::setDefaultCTM(ctm);
+  rec = addRecord(splashDLSetDefaultCTM, NULL);
+  for (i = 0; i < 6; ++i) {
+    rec->x[i] = ctm[i];
+  }
+  tracker->setDefaultCTM(ctm);
+}
+
+void SplashDisplayList::startPage(int pageNum, GfxState *state) {
+  SplashDLRecord *rec;
+
+  clear();
+  tracker->clearType3Cache();
+  rec = addRecord(splashDLStartPage, state);
+  rec->n[0] = pageNum;
+  tracker->startPage(pageNum, state);
+}
+
+void SplashDisplayList::endPage() {
+  addRecord(splashDLEndPage, NULL);
+  tracker->endPage();
+}
+
+void SplashDisplayList::saveState(GfxState *state) {
+  addRecord(splashDLSaveState, state);
+  tracker->saveState(state);
+}
+
+void SplashDisplayList::restoreState(GfxState *state) {
+  addRecord(splashDLRestoreState, state);
+  tracker->restoreState(state);
+}
+
+void SplashDisplayList::updateAll(GfxState *state) {
+  addRecord(splashDLUpdateAll, state);
+  tracker->updateAll(state);
+}
+
+void SplashDisplayList::updateCTM(GfxState *state, double m11, double m12,
+				  double m21, double m22,
+				  double m31, double m32) {
+  SplashDLRecord *rec;
+
+  rec = addRecord(splashDLUpdateCTM, state);
+  rec->x[0] = m11;
+  rec->x[1] = m12;
+  rec->x[2] = m21;
+  rec->x[3] = m22;
+  rec->x[4] = m31;
+  rec->x[5] = m32;
+  tracker->updateCTM(state, m11, m12, m21, m22, m31, m32);
+}
+
+void SplashDisplayList::updateLineDash(GfxState *state) {
+  addRecord(splashDLUpdateLineDash, state);
+  tracker->updateLineDash(state);
+}
+
+void SplashDisplayList::updateFlatness(GfxState *state) {
+  addRecord(splashDLUpdateFlatness, state);
+  tracker->updateFlatness(state);
+}
+
+void SplashDisplayList::updateLineJoin(GfxState *state) {
+  addRecord(splashDLUpdateLineJoin, state);
+  tracker->updateLineJoin(state);
+}
+
+void SplashDisplayList::updateLineCap(GfxState *state) {
+  addRecord(splashDLUpdateLineCap, state);
+  tracker->updateLineCap(state);
+}
+
+void SplashDisplayList::updateMiterLimit(GfxState *state) {
+  addRecord(splashDLUpdateMiterLimit, state);
+  tracker->updateMiterLimit(state);
+}
+
+void SplashDisplayList::updateLineWidth(GfxState *state) {
+  addRecord(splashDLUpdateLineWidth, state);
+  tracker->updateLineWidth(state);
+}
+
+void SplashDisplayList::updateStrokeAdjust(GfxState *state) {
+  addRecord(splashDLUpdateStrokeAdjust, state);
+  tracker->updateStrokeAdjust(state);
+}
+
+void SplashDisplayList::updateFillColor(GfxState *state) {
+  addRecord(splashDLUpdateFillColor, state);
+  tracker->updateFillColor(state);
+}
+
+void SplashDisplayList::updateStrokeColor(GfxState *state) {
+  addRecord(splashDLUpdateStrokeColor, state);
+  tracker->updateStrokeColor(state);
+}
+
+void SplashDisplayList::updateBlendMode(GfxState *state) {
+  addRecord(splashDLUpdateBlendMode, state);
+  tracker->updateBlendMode(state);
+}
+
+void SplashDisplayList::updateFillOpacity(GfxState *state) {
+  addRecord(splashDLUpdateFillOpacity, state);
+  tracker->updateFillOpacity(state);
+}
+
+void SplashDisplayList::updateStrokeOpacity(GfxState *state) {
+  addRecord(splashDLUpdateStrokeOpacity, state);
+  tracker->updateStrokeOpacity(state);
+}
+
+void SplashDisplayList::updateRenderingIntent(GfxState *state) {
+  addRecord(splashDLUpdateRenderingIntent, state);
+  tracker->updateRenderingIntent(state);
+}
+
+void SplashDisplayList::updateTransfer(GfxState *state) {
+  addRecord(splashDLUpdateTransfer, state);
+  tracker->updateTransfer(state);
+}
+
+void SplashDisplayList::updateFont(GfxState *state) {
+  addRecord(splashDLUpdateFont, state);
+  tracker->updateFont(state);
+}
+
+// Painting operations only change the bitmap, so they aren't passed
+// on to the tracker.
+void SplashDisplayList::stroke(GfxState *state) {
+  addRecord(splashDLStroke, state);
+}
+
+void SplashDisplayList::fill(GfxState *state) {
+  addRecord(splashDLFill, state);
+}
+
+void SplashDisplayList::eoFill(GfxState *state) {
+  addRecord(splashDLEOFill, state);
+}
+
+void SplashDisplayList::tilingPatternFill(GfxState *state, Gfx *gfx,
+					  Object *strRef,
+					  int paintType, int tilingType,
+					  Dict *resDict,
+					  double *mat, double *bbox,
+					  int x0, int y0, int x1, int y1,
+					  double xStep, double yStep) {
+  SplashDLRecord *rec;
+  SplashDLTileRecorder tile;
+  int i;
+
+  rec = addRecord(splashDLTilingPatternFill, state);
+  for (i = 0; i < 6; ++i) {
+    rec->x[i] = mat[i];
+  }
+  rec->n[0] = x0;
+  rec->n[1] = y0;
+  rec->n[2] = x1;
+  rec->n[3] = y1;
+  rec->args = new SplashDLArgs();
+  rec->args->tilingType = tilingType;
+  for (i = 0; i < 4; ++i) {
+    rec->args->bbox[i] = bbox[i];
+  }
+  rec->args->xStep = xStep;
+  rec->args->yStep = yStep;
+  rec->args->tiles = new GList();
+
+  // the tracker decides how many times the cell is drawn, with which
+  // matrix (and state) -- each one is recorded in a separate list
+  tile.dl = this;
+  tile.gfx = gfx;
+  tile.strRef = strRef;
+  tile.resDict = resDict;
+  tile.tiles = rec->args->tiles;
+  tracker->doTilingPatternFill(state, &recordTile, &tile, tilingType,
+			       mat, bbox, x0, y0, x1, y1, xStep, yStep);
+  charState = NULL;
+}
+
+void SplashDisplayList::recordTile(double *mat, double *bbox, void *data) {
+  SplashDLTileRecorder *tile;
+  GList *savedList;
+
+  tile = (SplashDLTileRecorder *)data;
+  savedList = tile->dl->curList;
+  tile->dl->curList = new GList();
+  // (cast, so this doesn't pick the append-all-elements overload)
+  tile->tiles->append((void *)tile->dl->curList);
+  tile->dl->charState = NULL;
+  tile->gfx->drawForm(tile->strRef, tile->resDict, mat, bbox);
+  tile->dl->curList = savedList;
+  tile->dl->charState = NULL;
+}
+
+GBool SplashDisplayList::axialShadedFill(GfxState *state,
+					 GfxAxialShading *shading) {
+  SplashDLRecord *rec;
+
+  rec = addRecord(splashDLAxialShadedFill, state);
+  if (!tracker->axialShadedFill(state, shading)) {
+    curList->del(curList->getLength() - 1);
+    delete rec;
+    return gFalse;
+  }
+  rec->args = new SplashDLArgs();
+  rec->args->shading = shading->copy();
+  return gTrue;
+}
+
+GBool SplashDisplayList::radialShadedFill(GfxState *state,
+					  GfxRadialShading *shading) {
+  SplashDLRecord *rec;
+
+  rec = addRecord(splashDLRadialShadedFill, state);
+  if (!tracker->radialShadedFill(state, shading)) {
+    curList->del(curList->getLength() - 1);
+    delete rec;
+    return gFalse;
+  }
+  rec->args = new SplashDLArgs();
+  rec->args->shading = shading->copy();
+  return gTrue;
+}
+
+void SplashDisplayList::clip(GfxState *state) {
+  addRecord(splashDLClip, state);
+  tracker->clip(state);
+}
+
+void SplashDisplayList::eoClip(GfxState *state) {
+  addRecord(splashDLEOClip, state);
+  tracker->eoClip(state);
+}
+
+void SplashDisplayList::clipToStrokePath(GfxState *state) {
+  addRecord(splashDLClipToStrokePath, state);
+  tracker->clipToStrokePath(state);
+}
+
+void SplashDisplayList::beginString(GfxState *state, GString *s) {
+  charState = NULL;
+}
+
+// Gfx only moves the text position between the chars of a string, so
+// they share one state copy.
+void SplashDisplayList::drawChar(GfxState *state, double x, double y,
+				 double dx, double dy,
+				 double originX, double originY,
+				 CharCode code, int nBytes,
+				 Unicode *u, int uLen) {
+  SplashDLRecord *rec;
+
+  if (!charState) {
+    charState = copyState(state);
+  }
+  rec = new SplashDLRecord;
+  rec->op = splashDLDrawChar;
+  rec->state = charState;
+  rec->x[0] = x;
+  rec->x[1] = y;
+  rec->x[2] = dx;
+  rec->x[3] = dy;
+  rec->x[4] = originX;
+  rec->x[5] = originY;
+  rec->n[0] = (int)code;
+  rec->n[1] = nBytes;
+  rec->args = NULL;
+  curList->append(rec);
+
+  // text clipping changes the clip region at endTextObject
+  if (state->getRender() & 4) {
+    tracker->drawChar(state, x, y, dx, dy, originX, originY,
+		      code, nBytes, u, uLen);
+  }
+}
+
+GBool SplashDisplayList::beginType3Char(GfxState *state, double x, double y,
+					double dx, double dy,
+					CharCode code, Unicode *u, int uLen) {
+  SplashDLRecord *rec;
+
+  rec = addRecord(splashDLBeginType3Char, state);
+  rec->x[0] = x;
+  rec->x[1] = y;
+  rec->x[2] = dx;
+  rec->x[3] = dy;
+  rec->n[0] = (int)code;
+  return tracker->beginType3Char(state, x, y, dx, dy, code, u, uLen);
+}
+
+void SplashDisplayList::endType3Char(GfxState *state) {
+  addRecord(splashDLEndType3Char, state);
+  tracker->endType3Char(state);
+}
+
+void SplashDisplayList::endTextObject(GfxState *state) {
+  addRecord(splashDLEndTextObject, state);
+  tracker->endTextObject(state);
+}
+
+void SplashDisplayList::drawImageMask(GfxState *state, Object *ref,
+				      Stream *str, int width, int height,
+				      GBool invert, GBool inlineImg,
+				      GBool interpolate) {
+  SplashDLRecord *rec;
+
+  // SplashOutputDev doesn't read the image in this case
+  if (state->getFillColorSpace()->isNonMarking()) {
+    return;
+  }
+  rec = addRecord(splashDLDrawImageMask, state);
+  rec->n[0] = invert;
+  rec->n[1] = inlineImg;
+  rec->n[2] = interpolate;
+  rec->args = new SplashDLArgs();
+  SplashOutputDev::reduceImageResolution(str, state->getCTM(),
+					 &width, &height, gFalse);
+  rec->args->width = width;
+  rec->args->height = height;
+  rec->args->data = readImageData(str, width, height, 1, 1,
+				  &rec->args->dataLen);
+}
+
+void SplashDisplayList::setSoftMaskFromImageMask(GfxState *state,
+						 Object *ref, Stream *str,
+						 int width, int height,
+						 GBool invert,
+						 GBool inlineImg,
+						 GBool interpolate) {
+  SplashDLRecord *rec;
+
+  rec = addRecord(splashDLSetSoftMaskFromImageMask, state);
+  rec->n[0] = invert;
+  rec->n[1] = inlineImg;
+  rec->n[2] = interpolate;
+  rec->args = new SplashDLArgs();
+  SplashOutputDev::reduceImageResolution(str, state->getCTM(),
+					 &width, &height, gFalse);
+  rec->args->width = width;
+  rec->args->height = height;
+  rec->args->data = readImageData(str, width, height, 1, 1,
+				  &rec->args->dataLen);
+}
+
+void SplashDisplayList::drawImage(GfxState *state, Object *ref, Stream *str,
+				  int width, int height,
+				  GfxImageColorMap *colorMap,
+				  int *maskColors, GBool inlineImg,
+				  GBool interpolate) {
+  SplashDLRecord *rec;
+  int n;
+
+  rec = addRecord(splashDLDrawImage, state);
+  rec->n[1] = inlineImg;
+  rec->n[2] = interpolate;
+  rec->args = new SplashDLArgs();
+  SplashOutputDev::reduceImageResolution(str, state->getCTM(),
+					 &width, &height, gFalse);
+  rec->args->width = width;
+  rec->args->height = height;
+  rec->args->colorMap = colorMap->copy();
+  n = colorMap->getNumPixelComps();
+  if (maskColors) {
+    rec->args->maskColors = (int *)gmallocn(2 * n, sizeof(int));
+    memcpy(rec->args->maskColors, maskColors, 2 * n * sizeof(int));
+  }
+  rec->args->data = readImageData(str, width, height,
+				  n, colorMap->getBits(),
+				  &rec->args->dataLen);
+}
+
+void SplashDisplayList::drawMaskedImage(GfxState *state, Object *ref,
+					Stream *str, int width, int height,
+					GfxImageColorMap *colorMap,
+					Stream *maskStr,
+					int maskWidth, int maskHeight,
+					GBool maskInvert, GBool interpolate) {
+  SplashDLRecord *rec;
+
+  rec = addRecord(splashDLDrawMaskedImage, state);
+  rec->n[0] = maskInvert;
+  rec->n[2] = interpolate;
+  rec->args = new SplashDLArgs();
+  SplashOutputDev::reduceImageResolution(str, state->getCTM(),
+					 &width, &height, gFalse);
+  SplashOutputDev::reduceImageResolution(maskStr, state->getCTM(),
+					 &maskWidth, &maskHeight, gFalse);
+  rec->args->width = width;
+  rec->args->height = height;
+  rec->args->colorMap = colorMap->copy();
+  rec->args->maskWidth = maskWidth;
+  rec->args->maskHeight = maskHeight;
+  rec->args->maskData = readImageData(maskStr, maskWidth, maskHeight, 1, 1,
+				      &rec->args->maskDataLen);
+  rec->args->data = readImageData(str, width, height,
+				  colorMap->getNumPixelComps(),
+				  colorMap->getBits(),
+				  &rec->args->dataLen);
+}
+
+void SplashDisplayList::drawSoftMaskedImage(GfxState *state, Object *ref,
+					    Stream *str,
+					    int width, int height,
+					    GfxImageColorMap *colorMap,
+					    Stream *maskStr,
+					    int maskWidth, int maskHeight,
+					    GfxImageColorMap *maskColorMap,
+					    double *matte, GBool interpolate) {
+  SplashDLRecord *rec;
+  int n;
+
+  rec = addRecord(splashDLDrawSoftMaskedImage, state);
+  rec->n[2] = interpolate;
+  rec->args = new SplashDLArgs();
+  // SplashOutputDev doesn't reduce the resolution of preblended
+  // images
+  if (!(matte && width == maskWidth && height == maskHeight)) {
+    SplashOutputDev::reduceImageResolution(str, state->getCTM(),
+					   &width, &height, gFalse);
+    SplashOutputDev::reduceImageResolution(maskStr, state->getCTM(),
+					   &maskWidth, &maskHeight, gFalse);
+  }
+  rec->args->width = width;
+  rec->args->height = height;
+  rec->args->colorMap = colorMap->copy();
+  rec->args->maskWidth = maskWidth;
+  rec->args->maskHeight = maskHeight;
+  rec->args->maskColorMap = maskColorMap->copy();
+  n = colorMap->getNumPixelComps();
+  if (matte) {
+    rec->args->matte = (double *)gmallocn(n, sizeof(double));
+    memcpy(rec->args->matte, matte, n * sizeof(double));
+  }
+  rec->args->maskData = readImageData(maskStr, maskWidth, maskHeight,
+				      maskColorMap->getNumPixelComps(),
+				      maskColorMap->getBits(),
+				      &rec->args->maskDataLen);
+  rec->args->data = readImageData(str, width, height,
+				  n, colorMap->getBits(),
+				  &rec->args->dataLen);
+}
+
+void SplashDisplayList::type3D0(GfxState *state, double wx, double wy) {
+  SplashDLRecord *rec;
+
+  rec = addRecord(splashDLType3D0, state);
+  rec->x[0] = wx;
+  rec->x[1] = wy;
+  tracker->type3D0(state, wx, wy);
+}
+
+void SplashDisplayList::type3D1(GfxState *state, double wx, double wy,
+				double llx, double lly,
+				double urx, double ury) {
+  SplashDLRecord *rec;
+
+  rec = addRecord(splashDLType3D1, state);
+  rec->x[0] = wx;
+  rec->x[1] = wy;
+  rec->x[2] = llx;
+  rec->x[3] = lly;
+  rec->x[4] = urx;
+  rec->x[5] = ury;
+  tracker->type3D1(state, wx, wy, llx, lly, urx, ury);
+}
+
+void SplashDisplayList::beginTransparencyGroup(
+			    GfxState *state, double *bbox,
+			    GfxColorSpace *blendingColorSpace,
+			    GBool isolated, GBool knockout,
+			    GBool forSoftMask) {
+  SplashDLRecord *rec;
+  int i;
+
+  rec = addRecord(splashDLBeginTransparencyGroup, state);
+  for (i = 0; i < 4; ++i) {
+    rec->x[i] = bbox[i];
+  }
+  rec->n[0] = isolated;
+  rec->n[1] = knockout;
+  rec->n[2] = forSoftMask;
+  if (blendingColorSpace) {
+    rec->args = new SplashDLArgs();
+    rec->args->blendingColorSpace = blendingColorSpace->copy();
+  }
+  tracker->beginTransparencyGroup(state, bbox, blendingColorSpace,
+				  isolated, knockout, forSoftMask);
+}
+
+void SplashDisplayList::endTransparencyGroup(GfxState *state) {
+  addRecord(splashDLEndTransparencyGroup, state);
+  tracker->endTransparencyGroup(state);
+}
+
+void SplashDisplayList::paintTransparencyGroup(GfxState *state,
+					       double *bbox) {
+  SplashDLRecord *rec;
+  int i;
+
+  rec = addRecord(splashDLPaintTransparencyGroup, state);
+  for (i = 0; i < 4; ++i) {
+    rec->x[i] = bbox[i];
+  }
+  tracker->paintTransparencyGroup(state, bbox);
+}
+
+void SplashDisplayList::setSoftMask(GfxState *state, double *bbox,
+				    GBool alpha, Function *transferFunc,
+				    GfxColor *backdropColor) {
+  SplashDLRecord *rec;
+  int i;
+
+  rec = addRecord(splashDLSetSoftMask, state);
+  for (i = 0; i < 4; ++i) {
+    rec->x[i] = bbox[i];
+  }
+  rec->n[0] = alpha;
+  rec->n[1] = backdropColor != NULL;
+  rec->args = new SplashDLArgs();
+  if (transferFunc) {
+    rec->args->transferFunc = transferFunc->copy();
+  }
+  if (backdropColor) {
+    rec->args->backdropColor = *backdropColor;
+  }
+  tracker->setSoftMask(state, bbox, alpha, transferFunc, backdropColor);
+}
+
+void SplashDisplayList::clearSoftMask(GfxState *state) {
+  addRecord(splashDLClearSoftMask, state);
+  tracker->clearSoftMask(state);
+}
+
+void SplashDisplayList::setInShading(GBool sh) {
+  SplashDLRecord *rec;
+
+  rec = addRecord(splashDLSetInShading, NULL);
+  rec->n[0] = sh;
+  tracker->setInShading(sh);
+}
+
+void SplashDisplayList::replay(SplashOutputDev *out) {
+  out->clearType3Cache();
+  replayRecords(out, records);
+}
+
+// Each replay works on its own copies of the states, shadings, etc.:
+// SplashOutputDev modifies some of them, and functions and color
+// spaces cache their results.
+void SplashDisplayList::replayRecords(SplashOutputDev *out, GList *list) {
+  SplashDLRecord *rec;
+  SplashDLArgs *args;
+  SplashDLTileReplay tile;
+  GfxState *recState, *state;
+  GfxImageColorMap *colorMap, *maskColorMap;
+  GfxShading *shading;
+  Function *transferFunc;
+  GfxColor backdropColor;
+  Stream *str, *maskStr;
+  Object ref, dict;
+  int i;
+
+  ref.initNull();
+  recState = state = NULL;
+  for (i = 0; i < list->getLength(); ++i) {
+    rec = (SplashDLRecord *)list->get(i);
+    args = rec->args;
+    if (rec->state != recState) {
+      if (state) {
+	delete state;
+      }
+      recState = rec->state;
+      state = recState ? recState->copy(gTrue) : (GfxState *)NULL;
+    }
+    switch (rec->op) {
+    case splashDLStartPage:
+      out->startPage(rec->n[0], state);
+      break;
+    case splashDLEndPage:
+      out->endPage();
+      break;
+    case splashDLSetDefaultCTM:
+      out->setDefaultCTM(rec->x);
+      break;
+    case splashDLSaveState:
+      out->saveState(state);
+      break;
+    case splashDLRestoreState:
+      out->restoreState(state);
+      break;
+    case splashDLUpdateAll:
+      out->updateAll(state);
+      break;
+    case splashDLUpdateCTM:
+      out->updateCTM(state, rec->x[0], rec->x[1], rec->x[2],
+		     rec->x[3], rec->x[4], rec->x[5]);
+      break;
+    case splashDLUpdateLineDash:
+      out->updateLineDash(state);
+      break;
+    case splashDLUpdateFlatness:
+      out->updateFlatness(state);
+      break;
+    case splashDLUpdateLineJoin:
+      out->updateLineJoin(state);
+      break;
+    case splashDLUpdateLineCap:
+      out->updateLineCap(state);
+      break;
+    case splashDLUpdateMiterLimit:
+      out->updateMiterLimit(state);
+      break;
+    case splashDLUpdateLineWidth:
+      out->updateLineWidth(state);
+      break;
+    case splashDLUpdateStrokeAdjust:
+      out->updateStrokeAdjust(state);
+      break;
+    case splashDLUpdateFillColor:
+      out->updateFillColor(state);
+      break;
+    case splashDLUpdateStrokeColor:
+      out->updateStrokeColor(state);
+      break;
+    case splashDLUpdateBlendMode:
+      out->updateBlendMode(state);
+      break;
+    case splashDLUpdateFillOpacity:
+      out->updateFillOpacity(state);
+      break;
+    case splashDLUpdateStrokeOpacity:
+      out->updateStrokeOpacity(state);
+      break;
+    case splashDLUpdateRenderingIntent:
+      out->updateRenderingIntent(state);
+      break;
+    case splashDLUpdateTransfer:
+      out->updateTransfer(state);
+      break;
+    case splashDLUpdateFont:
+      out->updateFont(state);
+      break;
+    case splashDLStroke:
+      out->stroke(state);
+      break;
+    case splashDLFill:
+      out->fill(state);
+      break;
+    case splashDLEOFill:
+      out->eoFill(state);
+      break;
+    case splashDLTilingPatternFill:
+      tile.dl = this;
+      tile.out = out;
+      tile.tiles = args->tiles;
+      tile.next = 0;
+      out->doTilingPatternFill(state, &replayTile, &tile, args->tilingType,
+			       rec->x, args->bbox,
+			       rec->n[0], rec->n[1], rec->n[2], rec->n[3],
+			       args->xStep, args->yStep);
+      break;
+    case splashDLAxialShadedFill:
+      shading = args->shading->copy();
+      out->axialShadedFill(state, (GfxAxialShading *)shading);
+      delete shading;
+      break;
+    case splashDLRadialShadedFill:
+      shading = args->shading->copy();
+      out->radialShadedFill(state, (GfxRadialShading *)shading);
+      delete shading;
+      break;
+    case splashDLClip:
+      out->clip(state);
+      break;
+    case splashDLEOClip:
+      out->eoClip(state);
+      break;
+    case splashDLClipToStrokePath:
+      out->clipToStrokePath(state);
+      break;
+    case splashDLDrawChar:
+      out->drawChar(state, rec->x[0], rec->x[1], rec->x[2], rec->x[3],
+		    rec->x[4], rec->x[5], (CharCode)rec->n[0], rec->n[1],
+		    NULL, 0);
+      break;
+    case splashDLBeginType3Char:
+      out->beginType3Char(state, rec->x[0], rec->x[1], rec->x[2], rec->x[3],
+			  (CharCode)rec->n[0], NULL, 0);
+      break;
+    case splashDLEndType3Char:
+      out->endType3Char(state);
+      break;
+    case splashDLEndTextObject:
+      out->endTextObject(state);
+      break;
+    case splashDLDrawImageMask:
+      dict.initNull();
+      str = new MemStream((char *)args->data, 0, args->dataLen, &dict);
+      out->drawImageMask(state, &ref, str, args->width, args->height,
+			 rec->n[0], rec->n[1], rec->n[2]);
+      delete str;
+      break;
+    case splashDLSetSoftMaskFromImageMask:
+      dict.initNull();
+      str = new MemStream((char *)args->data, 0, args->dataLen, &dict);
+      out->setSoftMaskFromImageMask(state, &ref, str,
+				    args->width, args->height,
+				    rec->n[0], rec->n[1], rec->n[2]);
+      delete str;
+      break;
+    case splashDLDrawImage:
+      dict.initNull();
+      str = new MemStream((char *)args->data, 0, args->dataLen, &dict);
+      colorMap = args->colorMap->copy();
+      out->drawImage(state, &ref, str, args->width, args->height,
+		     colorMap, args->maskColors, rec->n[1], rec->n[2]);
+      delete colorMap;
+      delete str;
+      break;
+    case splashDLDrawMaskedImage:
+      dict.initNull();
+      str = new MemStream((char *)args->data, 0, args->dataLen, &dict);
+      dict.initNull();
+      maskStr = new MemStream((char *)args->maskData, 0, args->maskDataLen,
+			      &dict);
+      colorMap = args->colorMap->copy();
+      out->drawMaskedImage(state, &ref, str, args->width, args->height,
+			   colorMap, maskStr,
+			   args->maskWidth, args->maskHeight,
+			   rec->n[0], rec->n[2]);
+      delete colorMap;
+      delete maskStr;
+      delete str;
+      break;
+    case splashDLDrawSoftMaskedImage:
+      dict.initNull();
+      str = new MemStream((char *)args->data, 0, args->dataLen, &dict);
+      dict.initNull();
+      maskStr = new MemStream((char *)args->maskData, 0, args->maskDataLen,
+			      &dict);
+      colorMap = args->colorMap->copy();
+      maskColorMap = args->maskColorMap->copy();
+      out->drawSoftMaskedImage(state, &ref, str, args->width, args->height,
+			       colorMap, maskStr,
+			       args->maskWidth, args->maskHeight,
+			       maskColorMap, args->matte, rec->n[2]);
+      delete maskColorMap;
+      delete colorMap;
+      delete maskStr;
+      delete str;
+      break;
+    case splashDLType3D0:
+      out->type3D0(state, rec->x[0], rec->x[1]);
+      break;
+    case splashDLType3D1:
+      out->type3D1(state, rec->x[0], rec->x[1], rec->x[2], rec->x[3],
+		   rec->x[4], rec->x[5]);
+      break;
+    case splashDLBeginTransparencyGroup:
+      out->beginTransparencyGroup(state, rec->x,
+				  args ? args->blendingColorSpace
+				       : (GfxColorSpace *)NULL,
+				  rec->n[0], rec->n[1], rec->n[2]);
+      break;
+    case splashDLEndTransparencyGroup:
+      out->endTransparencyGroup(state);
+      break;
+    case splashDLPaintTransparencyGroup:
+      out->paintTransparencyGroup(state, rec->x);
+      break;
+    case splashDLSetSoftMask:
+      transferFunc = args->transferFunc ? args->transferFunc->copy()
+					: (Function *)NULL;
+      backdropColor = args->backdropColor;
+      out->setSoftMask(state, rec->x, rec->n[0], transferFunc,
+		       rec->n[1] ? &backdropColor : (GfxColor *)NULL);
+      if (transferFunc) {
+	delete transferFunc;
+      }
+      break;
+    case splashDLClearSoftMask:
+      out->clearSoftMask(state);
+      break;
+    case splashDLSetInShading:
+      out->setInShading(rec->n[0]);
+      break;
+    }
+  }
+  if (state) {
+    delete state;
+  }
+}
+
+void SplashDisplayList::replayTile(double *mat, double *bbox, void *data) {
+  SplashDLTileReplay *tile;
+
+  tile = (SplashDLTileReplay *)data;
+  if (tile->next < tile->tiles->getLength()) {
+    tile->dl->replayRecords(tile->out,
+			    (GList *)tile->tiles->get(tile->next++));
+  }
+}
@@ -0,0 +1,251 @@
+//========================================================================
+//
+// SplashDisplayList.h
+//
+// Record the drawing operations of a page once, and replay them into
+// SplashOutputDevs.
+//
+//========================================================================
+
+#ifndef SPLASHDISPLAYLIST_H
+#define SPLASHDISPLAYLIST_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "gtypes.h"
+#include "SplashTypes.h"
+#include "OutputDev.h"
+
+class GList;
+class SplashOutputDev;
+struct SplashDLRecord;
+
+//------------------------------------------------------------------------
+
+enum SplashDLOp {
+  splashDLStartPage,
+  splashDLEndPage,
+  splashDLSetDefaultCTM,
+  splashDLSaveState,
+  splashDLRestoreState,
+  splashDLUpdateAll,
+  splashDLUpdateCTM,
+  splashDLUpdateLineDash,
+  splashDLUpdateFlatness,
+  splashDLUpdateLineJoin,
+  splashDLUpdateLineCap,
+  splashDLUpdateMiterLimit,
+  splashDLUpdateLineWidth,
+  splashDLUpdateStrokeAdjust,
+  splashDLUpdateFillColor,
+  splashDLUpdateStrokeColor,
+  splashDLUpdateBlendMode,
+  splashDLUpdateFillOpacity,
+  splashDLUpdateStrokeOpacity,
+  splashDLUpdateRenderingIntent,
+  splashDLUpdateTransfer,
+  splashDLUpdateFont,
+  splashDLStroke,
+  splashDLFill,
+  splashDLEOFill,
+  splashDLTilingPatternFill,
+  splashDLAxialShadedFill,
+  splashDLRadialShadedFill,
+  splashDLClip,
+  splashDLEOClip,
+  splashDLClipToStrokePath,
+  splashDLDrawChar,
+  splashDLBeginType3Char,
+  splashDLEndType3Char,
+  splashDLEndTextObject,
+  splashDLDrawImageMask,
+  splashDLSetSoftMaskFromImageMask,
+  splashDLDrawImage,
+  splashDLDrawMaskedImage,
+  splashDLDrawSoftMaskedImage,
+  splashDLType3D0,
+  splashDLType3D1,
+  splashDLBeginTransparencyGroup,
+  splashDLEndTransparencyGroup,
+  splashDLPaintTransparencyGroup,
+  splashDLSetSoftMask,
+  splashDLClearSoftMask,
+  splashDLSetInShading
+};
+
+//------------------------------------------------------------------------
+// SplashDisplayList
+//------------------------------------------------------------------------
+
+// Displaying a page with this device records the SplashOutputDev
+// calls, each with a copy of the GfxState (the chars of a string share
+// one copy).  Image data is read once, and stored as ImageStream
+// reads it.  Each replay then runs the same calls, in the same order,
+// on a SplashOutputDev -- typically one per band, on several threads
+// at once -- without parsing the content streams again.
+//
+// SplashOutputDev modifies the GfxState in a few places (transparency
+// groups, Type 3 glyphs, shaded fills, tiling patterns), and whether
+// a Type 3 char runs its CharProc depends on the glyph cache.  The
+// recorder passes the calls that affect those on to a private
+// SplashOutputDev with a one-row band, so the recorded states and
+// CharProcs are the ones each replay device will need.  For the same
+// reason, the Type 3 glyph cache is cleared before each replay.
+
+class SplashDisplayList: public OutputDev {
+public:
+
+  // The args are the same as for the SplashOutputDevs that the page
+  // will be replayed into.
+  SplashDisplayList(SplashColorMode colorModeA, int bitmapRowPadA,
+		    GBool reverseVideoA, SplashColorPtr paperColorA);
+
+  virtual ~SplashDisplayList();
+
+  void startDoc(XRef *xrefA);
+
+  // Run the recorded page (startPage through endPage) on <out>.  This
+  // only reads the display list, so it can be called on several
+  // threads at once, with different SplashOutputDevs.
+  void replay(SplashOutputDev *out);
+
+  //----- get info about output device
+
+  virtual GBool upsideDown();
+  virtual GBool useDrawChar() { return gTrue; }
+  virtual GBool useTilingPatternFill() { return gTrue; }
+  virtual GBool useShadedFills() { return gTrue; }
+  virtual GBool interpretType3Chars() { return gTrue; }
+
+  //----- initialization and control
+
+  virtual void setDefaultCTM(double *ctm);
+  virtual void startPage(int pageNum, GfxState *state);
+  virtual void endPage();
+
+  //----- save/restore graphics state
+  virtual void saveState(GfxState *state);
+  virtual void restoreState(GfxState *state);
+
+  //----- update graphics state
+  virtual void updateAll(GfxState *state);
+  virtual void updateCTM(GfxState *state, double m11, double m12,
+			 double m21, double m22, double m31, double m32);
+  virtual void updateLineDash(GfxState *state);
+  virtual void updateFlatness(GfxState *state);
+  virtual void updateLineJoin(GfxState *state);
+  virtual void updateLineCap(GfxState *state);
+  virtual void updateMiterLimit(GfxState *state);
+  virtual void updateLineWidth(GfxState *state);
+  virtual void updateStrokeAdjust(GfxState *state);
+  virtual void updateFillColor(GfxState *state);
+  virtual void updateStrokeColor(GfxState *state);
+  virtual void updateBlendMode(GfxState *state);
+  virtual void updateFillOpacity(GfxState *state);
+  virtual void updateStrokeOpacity(GfxState *state);
+  virtual void updateRenderingIntent(GfxState *state);
+  virtual void updateTransfer(GfxState *state);
+
+  //----- update text state
+  virtual void updateFont(GfxState *state);
+
+  //----- path painting
+  virtual void stroke(GfxState *state);
+  virtual void fill(GfxState *state);
+  virtual void eoFill(GfxState *state);
+  virtual void tilingPatternFill(GfxState *state, Gfx *gfx, Object *strRef,
+				 int paintType, int tilingType, Dict *resDict,
+				 double *mat, double *bbox,
+				 int x0, int y0, int x1, int y1,
+				 double xStep, double yStep);
+  virtual GBool axialShadedFill(GfxState *state, GfxAxialShading *shading);
+  virtual GBool radialShadedFill(GfxState *state, GfxRadialShading *shading);
+
+  //----- path clipping
+  virtual void clip(GfxState *state);
+  virtual void eoClip(GfxState *state);
+  virtual void clipToStrokePath(GfxState *state);
+
+  //----- text drawing
+  virtual void beginString(GfxState *state, GString *s);
+  virtual void drawChar(GfxState *state, double x, double y,
+			double dx, double dy,
+			double originX, double originY,
+			CharCode code, int nBytes, Unicode *u, int uLen);
+  virtual GBool beginType3Char(GfxState *state, double x, double y,
+			       double dx, double dy,
+			       CharCode code, Unicode *u, int uLen);
+  virtual void endType3Char(GfxState *state);
+  virtual void endTextObject(GfxState *state);
+
+  //----- image drawing
+  virtual void drawImageMask(GfxState *state, Object *ref, Stream *str,
+			     int width, int height, GBool invert,
+			     GBool inlineImg, GBool interpolate);
+  virtual void setSoftMaskFromImageMask(GfxState *state,
+					Object *ref, Stream *str,
+					int width, int height, GBool invert,
+					GBool inlineImg, GBool interpolate);
+  virtual void drawImage(GfxState *state, Object *ref, Stream *str,
+			 int width, int height, GfxImageColorMap *colorMap,
+			 int *maskColors, GBool inlineImg, GBool interpolate);
+  virtual void drawMaskedImage(GfxState *state, Object *ref, Stream *str,
+			       int width, int height,
+			       GfxImageColorMap *colorMap,
+			       Stream *maskStr, int maskWidth, int maskHeight,
+			       GBool maskInvert, GBool interpolate);
+  virtual void drawSoftMaskedImage(GfxState *state, Object *ref, Stream *str,
+				   int width, int height,
+				   GfxImageColorMap *colorMap,
+				   Stream *maskStr,
+				   int maskWidth, int maskHeight,
+				   GfxImageColorMap *maskColorMap,
+				   double *matte, GBool interpolate);
+
+  //----- Type 3 font operators
+  virtual void type3D0(GfxState *state, double wx, double wy);
+  virtual void type3D1(GfxState *state, double wx, double wy,
+		       double llx, double lly, double urx, double ury);
+
+  //----- transparency groups and soft masks
+  virtual void beginTransparencyGroup(GfxState *state, double *bbox,
+				      GfxColorSpace *blendingColorSpace,
+				      GBool isolated, GBool knockout,
+				      GBool forSoftMask);
+  virtual void endTransparencyGroup(GfxState *state);
+  virtual void paintTransparencyGroup(GfxState *state, double *bbox);
+  virtual void setSoftMask(GfxState *state, double *bbox, GBool alpha,
+			   Function *transferFunc, GfxColor *backdropColor);
+  virtual void clearSoftMask(GfxState *state);
+
+#if 1 //~tmp: turn off anti-aliasing temporarily
+  virtual void setInShading(GBool sh);
+#endif
+
+private:
+
+  void clear();
+  GfxState *copyState(GfxState *state);
+  SplashDLRecord *addRecord(SplashDLOp op, GfxState *state);
+  static Guchar *readImageData(Stream *str, int width, int height,
+			       int nComps, int nBits, int *len);
+  static void recordTile(double *mat, double *bbox, void *data);
+  void replayRecords(SplashOutputDev *out, GList *list);
+  static void replayTile(double *mat, double *bbox, void *data);
+
+  SplashOutputDev *tracker;	// tracks the device-side state changes
+  GList *records;		// recorded page [SplashDLRecord]
+  GList *curList;		// list being recorded into (the page or a
+				//   tiling pattern cell) [SplashDLRecord]
+  GList *states;		// GfxState copies [GfxState]
+  GList *fonts;			// fonts used by the states, with one
+				//   reference each [GfxFont]
+  GfxState *charState;		// state copy shared by the chars of the
+				//   current string, or NULL
+};
+
+#endif
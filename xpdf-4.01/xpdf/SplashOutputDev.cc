@@ -28,7 +28,9 @@
 #include "BuiltinFont.h"
 #include "BuiltinFontTables.h"
 #include "FoFiTrueType.h"
+#ifndef NO_JPX_STREAM
 #include "JPXStream.h"
+#endif
 #include "SplashBitmap.h"
 #include "SplashGlyphBitmap.h"
 #include "SplashPattern.h"
@@ -611,6 +613,10 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA,
   splashColorCopy(paperColor, paperColorA);
   skipHorizText = gFalse;
   skipRotatedText = gFalse;
+  reduceImages = gFalse;
+  draft = gFalse;
+  bandY = 0;
+  bandH = -1;
 
   xref = NULL;
 
@@ -711,8 +717,6 @@ SplashOutputDev::~SplashOutputDev() {
 }
 
 void SplashOutputDev::startDoc(XRef *xrefA) {
-  int i;
-
   xref = xrefA;
   if (fontEngine) {
     delete fontEngine;
@@ -726,6 +730,12 @@ void SplashOutputDev::startDoc(XRef *xrefA) {
 				    allowAntialias &&
 				      globalParams->getAntialias() &&
 				      colorMode != splashModeMono1);
+  clearType3Cache();
+}
+
+void SplashOutputDev::clearType3Cache() {
+  int i;
+
   for (i = 0; i < nT3Fonts; ++i) {
     delete t3FontCache[i];
   }
@@ -733,7 +743,7 @@ void SplashOutputDev::startDoc(XRef *xrefA) {
 }
 
 void SplashOutputDev::startPage(int pageNum, GfxState *state) {
-  int w, h;
+  int w, h, by, bh;
   double *ctm;
   SplashCoord mat[6];
   SplashColor color;
@@ -755,13 +765,25 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state) {
     delete splash;
     splash = NULL;
   }
-  if (!bitmap || w != bitmap->getWidth() || h != bitmap->getHeight()) {
+  if (bandH < 0) {
+    by = 0;
+    bh = h;
+  } else {
+    by = bandY < h ? bandY : h - 1;
+    bh = bandH < h - by ? bandH : h - by;
+    if (bh < 1) {
+      bh = 1;
+    }
+  }
+  if (!bitmap || w != bitmap->getWidth() || h != bitmap->getHeight() ||
+      by != bitmap->getBandY() || bh != bitmap->getBandHeight()) {
     if (bitmap) {
       delete bitmap;
       bitmap = NULL;
     }
     bitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode,
-			      colorMode != splashModeMono1, bitmapTopDown);
+			      colorMode != splashModeMono1, bitmapTopDown,
+			      by, bandH < 0 ? -1 : bh);
   }
   splash = new Splash(bitmap, vectorAntialias, &screenParams);
   splash->setMinLineWidth(globalParams->getMinLineWidth());
@@ -1689,6 +1711,12 @@ void SplashOutputDev::eoFill(GfxState *state) {
   delete path;
 }
 
+struct SplashOutTileFormData {
+  Gfx *gfx;
+  Object *strRef;
+  Dict *resDict;
+};
+
 void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
 					Object *strRef,
 					int paintType, int tilingType,
@@ -1696,6 +1724,29 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
 					double *mat, double *bbox,
 					int x0, int y0, int x1, int y1,
 					double xStep, double yStep) {
+  SplashOutTileFormData tileData;
+
+  tileData.gfx = gfx;
+  tileData.strRef = strRef;
+  tileData.resDict = resDict;
+  doTilingPatternFill(state, &drawTileForm, &tileData, tilingType,
+		      mat, bbox, x0, y0, x1, y1, xStep, yStep);
+}
+
+void SplashOutputDev::drawTileForm(double *mat, double *bbox, void *data) {
+  SplashOutTileFormData *tileData;
+
+  tileData = (SplashOutTileFormData *)data;
+  tileData->gfx->drawForm(tileData->strRef, tileData->resDict, mat, bbox);
+}
+
+void SplashOutputDev::doTilingPatternFill(GfxState *state,
+					  SplashOutTileCbk drawTileCbk,
+					  void *drawTileCbkData,
+					  int tilingType,
+					  double *mat, double *bbox,
+					  int x0, int y0, int x1, int y1,
+					  double xStep, double yStep) {
   SplashBitmap *origBitmap, *tileBitmap;
   Splash *origSplash;
   SplashColor color;
@@ -1791,7 +1842,7 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
 	ty = iy * yStep;
 	mat1[4] = tx * mat[0] + ty * mat[2] + mat[4];
 	mat1[5] = tx * mat[1] + ty * mat[3] + mat[5];
-	gfx->drawForm(strRef, resDict, mat1, bbox);
+	(*drawTileCbk)(mat1, bbox, drawTileCbkData);
       }
     }
     return;
@@ -1955,7 +2006,7 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
   state->resetDevClipRect(0, 0, tileW, tileH);
 
   // render the tile
-  gfx->drawForm(strRef, resDict, tileMat, bbox);
+  (*drawTileCbk)(tileMat, bbox, drawTileCbkData);
 
   // restore the original bitmap
   --nestCount;
@@ -1987,7 +2038,8 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
   double xMin, yMin, xMax, yMax, tx, ty, xx, yy;
   double xx0, yy0, xx1, yy1, dx, dy, d, s, t;
   GBool dZero, go;
-  int ixMin, iyMin, ixMax, iyMax, bitmapWidth, bitmapHeight, nColors;
+  int ixMin, iyMin, ixMax, iyMax, pyMin, pyMax;
+  int bitmapWidth, bitmapHeight, nColors;
   SplashClipResult clipRes;
   SplashColorMode srcMode;
   SplashBitmap *tBitmap;
@@ -1996,6 +2048,8 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
   SplashColorPtr dataPtr;
   Guchar *alphaPtr;
   GfxColor color;
+  GfxColor *colors;
+  double *ts;
   SplashColorPtr sColors, sColor;
   SplashColor sColor0;
 
@@ -2069,6 +2123,15 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
   iyMin = (int)floor(yMin);
   ixMax = (int)floor(xMax) + 1;
   iyMax = (int)floor(yMax) + 1;
+  // the clipped rows on the full page (which may differ from
+  // [iyMin, iyMax) in a band bitmap)
+  splash->getPageClipYBounds(&pyMin, &pyMax);
+  if (pyMin < iyMin) {
+    pyMin = iyMin;
+  }
+  if (pyMax > iyMax) {
+    pyMax = iyMax;
+  }
   clipRes = splash->limitRectToClipRect(&ixMin, &iyMin, &ixMax, &iyMax);
   if (clipRes == splashClipAllOutside) {
     return gTrue;
@@ -2130,7 +2193,7 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
       dataPtr = tBitmap->getDataPtr() + x * nComps;
       alphaPtr = tBitmap->getAlphaPtr() + x;
       tx = ixMin + x + 0.5;
-      ty = iyMin + 0.5;
+      ty = pyMin + 0.5;
       xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
       yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
       s = ((xx - x0) * dx + (yy - y0) * dy) * d;
@@ -2213,14 +2276,20 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
       nColors = 1024;
     }
     sColors = (SplashColorPtr)gmallocn(nColors, nComps);
-    sColor = sColors;
+    ts = (double *)gmallocn(nColors, sizeof(double));
+    colors = (GfxColor *)gmallocn(nColors, sizeof(GfxColor));
     for (i = 0; i < nColors; ++i) {
       s = (double)i / (double)(nColors - 1);
-      t = t0 + s * (t1 - t0);
-      shading->getColor(t, &color);
-      computeShadingColor(state, srcMode, &color, sColor);
+      ts[i] = t0 + s * (t1 - t0);
+    }
+    shading->getColors(ts, colors, nColors);
+    sColor = sColors;
+    for (i = 0; i < nColors; ++i) {
+      computeShadingColor(state, srcMode, &colors[i], sColor);
       sColor += nComps;
     }
+    gfree(colors);
+    gfree(ts);
 
     dataPtr = tBitmap->getDataPtr();
     alphaPtr = tBitmap->getAlphaPtr();
@@ -2285,10 +2354,10 @@ GBool SplashOutputDev::radialShadedFill(GfxState *state,
   double *ctm;
   double ictm[6];
   double xMin, yMin, xMax, yMax, tx, ty, xx, yy;
-  double dx, dy, dr, r0dr, r02, a, a2, b, c, e, es, s, s0, s1, rs0, rs1, t;
+  double dx, dy, dr, r0dr, r02, a, a2, b, c, e, es, s, s0, s1, rs0, rs1;
   GBool aIsZero, go;
   int ixMin, iyMin, ixMax, iyMax, bitmapWidth, bitmapHeight, nColors;
-  int bxMin, byMin, bxMax, byMax;
+  int bxMin, byMin, bxMax, byMax, pyMin, pyMax;
   SplashClipResult clipRes;
   SplashColorMode srcMode;
   SplashBitmap *tBitmap;
@@ -2296,7 +2365,8 @@ GBool SplashOutputDev::radialShadedFill(GfxState *state,
   int x, y, i;
   SplashColorPtr dataPtr;
   Guchar *alphaPtr;
-  GfxColor color;
+  GfxColor *colors;
+  double *ts;
   SplashColorPtr sColors, sColor;
 
 
@@ -2387,6 +2457,15 @@ GBool SplashOutputDev::radialShadedFill(GfxState *state,
   iyMin = (int)floor(yMin);
   ixMax = (int)floor(xMax) + 1;
   iyMax = (int)floor(yMax) + 1;
+  // the clipped rows on the full page (which may differ from
+  // [iyMin, iyMax) in a band bitmap)
+  splash->getPageClipYBounds(&pyMin, &pyMax);
+  if (pyMin < iyMin) {
+    pyMin = iyMin;
+  }
+  if (pyMax > iyMax) {
+    pyMax = iyMax;
+  }
   clipRes = splash->limitRectToClipRect(&ixMin, &iyMin, &ixMax, &iyMax);
   if (clipRes == splashClipAllOutside) {
     return gTrue;
@@ -2418,21 +2497,27 @@ GBool SplashOutputDev::radialShadedFill(GfxState *state,
 
   // pre-compute colors along the axis
   nColors = (int)sqrt((double)(bitmapWidth * bitmapWidth
-			       + bitmapHeight * bitmapHeight));
+			       + (pyMax - pyMin) * (pyMax - pyMin)));
   if (nColors < 16) {
     nColors = 16;
   } else if (nColors > 1024) {
     nColors = 1024;
   }
   sColors = (SplashColorPtr)gmallocn(nColors, nComps);
-  sColor = sColors;
+  ts = (double *)gmallocn(nColors, sizeof(double));
+  colors = (GfxColor *)gmallocn(nColors, sizeof(GfxColor));
   for (i = 0; i < nColors; ++i) {
     s = (double)i / (double)(nColors - 1);
-    t = t0 + s * (t1 - t0);
-    shading->getColor(t, &color);
-    computeShadingColor(state, srcMode, &color, sColor);
+    ts[i] = t0 + s * (t1 - t0);
+  }
+  shading->getColors(ts, colors, nColors);
+  sColor = sColors;
+  for (i = 0; i < nColors; ++i) {
+    computeShadingColor(state, srcMode, &colors[i], sColor);
     sColor += nComps;
   }
+  gfree(colors);
+  gfree(ts);
 
   // special case: in the "enclosed" + extended case, we can fill the
   // bitmap with the outer color and just render inside the larger
@@ -2772,6 +2857,14 @@ void SplashOutputDev::drawChar(GfxState *state, double x, double y,
     return;
   }
 
+  if (draft) {
+    if (!(render & 1) && !state->getFillColorSpace()->isNonMarking() &&
+	!(uLen == 1 && u[0] == 0x20)) {
+      drawGreekedChar(state, x - originX, y - originY, dx, dy);
+    }
+    return;
+  }
+
   if (needFontUpdate) {
     doUpdateFont(state);
   }
@@ -2854,6 +2947,39 @@ void SplashOutputDev::drawChar(GfxState *state, double x, double y,
   }
 }
 
+// Fill a box from the glyph origin to the next glyph origin, half an
+// em high (or, for vertical text, half an em wide).
+void SplashOutputDev::drawGreekedChar(GfxState *state, double x, double y,
+				      double dx, double dy) {
+  SplashPath *path;
+  double *tm;
+  double ex, ey;
+
+  tm = state->getTextMat();
+  if (state->getFont() && state->getFont()->getWMode()) {
+    ex = 0.25 * state->getFontSize() * tm[0];
+    ey = 0.25 * state->getFontSize() * tm[1];
+    x -= ex;
+    y -= ey;
+    ex *= 2;
+    ey *= 2;
+  } else {
+    ex = 0.5 * state->getFontSize() * tm[2];
+    ey = 0.5 * state->getFontSize() * tm[3];
+  }
+  path = new SplashPath();
+  path->moveTo((SplashCoord)x, (SplashCoord)y);
+  path->lineTo((SplashCoord)(x + dx), (SplashCoord)(y + dy));
+  path->lineTo((SplashCoord)(x + dx + ex), (SplashCoord)(y + dy + ey));
+  path->lineTo((SplashCoord)(x + ex), (SplashCoord)(y + ey));
+  path->close();
+  setOverprintMask(state, state->getFillColorSpace(),
+		   state->getFillOverprint(), state->getOverprintMode(),
+		   state->getFillColor());
+  splash->fill(path, gFalse);
+  delete path;
+}
+
 GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
 				      double dx, double dy,
 				      CharCode code, Unicode *u, int uLen) {
@@ -3230,7 +3356,7 @@ void SplashOutputDev::drawImageMask(GfxState *state, Object *ref, Stream *str,
   mat[4] = ctm[2] + ctm[4];
   mat[5] = ctm[3] + ctm[5];
 
-  reduceImageResolution(str, ctm, &width, &height);
+  reduceImageResolution(str, ctm, &width, &height, reduceImages);
 
   imgMaskData.imgStr = new ImageStream(str, width, 1, 1);
   imgMaskData.imgStr->reset();
@@ -3272,7 +3398,7 @@ void SplashOutputDev::setSoftMaskFromImageMask(GfxState *state,
   mat[3] = -ctm[3];
   mat[4] = ctm[2] + ctm[4];
   mat[5] = ctm[3] + ctm[5];
-  reduceImageResolution(str, ctm, &width, &height);
+  reduceImageResolution(str, ctm, &width, &height, reduceImages);
   imgMaskData.imgStr = new ImageStream(str, width, 1, 1);
   imgMaskData.imgStr->reset();
   imgMaskData.invert = invert ? 0 : 1;
@@ -3280,7 +3406,8 @@ void SplashOutputDev::setSoftMaskFromImageMask(GfxState *state,
   imgMaskData.height = height;
   imgMaskData.y = 0;
   maskBitmap = new SplashBitmap(bitmap->getWidth(), bitmap->getHeight(),
-				1, splashModeMono8, gFalse);
+				1, splashModeMono8, gFalse, gTrue,
+				bitmap->getBandY(), bitmap->getBandHeight());
   maskSplash = new Splash(maskBitmap, gTrue);
   maskSplash->setStrokeAdjust(
 		     mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
@@ -3297,12 +3424,63 @@ void SplashOutputDev::setSoftMaskFromImageMask(GfxState *state,
   splash->setSoftMask(maskBitmap);
 }
 
+// Returns true if converting 8-bit image samples with <colorMap> (or
+// with <lookup>, for one-channel images) to <colorMode> leaves them
+// unchanged, as it does for DeviceGray and DeviceRGB images with the
+// default decode array.  The image source callbacks then copy the
+// samples as they are, so the Splash image scalers effectively read
+// the decoded samples, without a separate color conversion pass.
+static GBool isIdentityColorMap(GfxImageColorMap *colorMap,
+				SplashColorPtr lookup,
+				SplashColorMode colorMode,
+				GfxRenderingIntent ri) {
+  Guchar in[3 * 256], out[3 * 256];
+  int i;
+
+  if (colorMap->getBits() != 8) {
+    return gFalse;
+  }
+  switch (colorMode) {
+  case splashModeMono1:
+  case splashModeMono8:
+    if (!lookup) {
+      return gFalse;
+    }
+    for (i = 0; i < 256; ++i) {
+      if (lookup[i] != i) {
+	return gFalse;
+      }
+    }
+    return gTrue;
+  case splashModeRGB8:
+  case splashModeBGR8:
+    if (colorMap->getNumPixelComps() != 3 ||
+	colorMap->getColorSpace()->getMode() != csDeviceRGB) {
+      return gFalse;
+    }
+    // DeviceRGB converts each component separately, so one line that
+    // has all 256 values in each component covers every pixel
+    for (i = 0; i < 256; ++i) {
+      in[3*i] = (Guchar)i;
+      in[3*i+1] = (Guchar)(i + 85);
+      in[3*i+2] = (Guchar)(i + 170);
+    }
+    colorMap->getRGBByteLine(in, out, 256, ri);
+    return !memcmp(in, out, sizeof(in));
+  default:
+    return gFalse;
+  }
+}
+
 struct SplashOutImageData {
   ImageStream *imgStr;
   GfxImageColorMap *colorMap;
   GfxRenderingIntent ri;
   SplashColorPtr lookup;
+  GBool identity;		// the color conversion is a copy
   int *maskColors;
+  SplashColorPtr missingColor;	// color for missing image data (NULL
+				//   for all-zero components)
   SplashColorMode colorMode;
   int width, height, y;
 };
@@ -3312,16 +3490,27 @@ GBool SplashOutputDev::imageSrc(void *data, SplashColorPtr colorLine,
   SplashOutImageData *imgData = (SplashOutImageData *)data;
   Guchar *p;
   SplashColorPtr q, col;
-  int x;
+  int nComps, x, i;
 
   if (imgData->y == imgData->height ||
       !(p = imgData->imgStr->getLine())) {
-    memset(colorLine, 0,
-	   imgData->width * splashColorModeNComps[imgData->colorMode]);
+    nComps = splashColorModeNComps[imgData->colorMode];
+    if (imgData->missingColor) {
+      for (x = 0, q = colorLine; x < imgData->width; ++x) {
+	for (i = 0; i < nComps; ++i) {
+	  *q++ = imgData->missingColor[i];
+	}
+      }
+    } else {
+      memset(colorLine, 0, imgData->width * nComps);
+    }
     return gFalse;
   }
 
-  if (imgData->lookup) {
+  if (imgData->identity) {
+    memcpy(colorLine, p,
+	   imgData->width * splashColorModeNComps[imgData->colorMode]);
+  } else if (imgData->lookup) {
     switch (imgData->colorMode) {
     case splashModeMono1:
     case splashModeMono8:
@@ -3393,7 +3582,10 @@ GBool SplashOutputDev::alphaImageSrc(void *data, SplashColorPtr colorLine,
 
   nComps = imgData->colorMap->getNumPixelComps();
 
-  if (imgData->lookup) {
+  if (imgData->identity) {
+    memcpy(colorLine, p0,
+	   imgData->width * splashColorModeNComps[imgData->colorMode]);
+  } else if (imgData->lookup) {
     switch (imgData->colorMode) {
     case splashModeMono1:
     case splashModeMono8:
@@ -3490,7 +3682,7 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
   mat[4] = ctm[2] + ctm[4];
   mat[5] = ctm[3] + ctm[5];
 
-  reduceImageResolution(str, ctm, &width, &height);
+  reduceImageResolution(str, ctm, &width, &height, reduceImages);
 
   imgData.imgStr = new ImageStream(str, width,
 				   colorMap->getNumPixelComps(),
@@ -3499,6 +3691,7 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
   imgData.colorMap = colorMap;
   imgData.ri = state->getRenderingIntent();
   imgData.maskColors = maskColors;
+  imgData.missingColor = draft ? paperColor : (SplashColorPtr)NULL;
   imgData.colorMode = colorMode;
   imgData.width = width;
   imgData.height = height;
@@ -3550,6 +3743,8 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
 #endif
     }
   }
+  imgData.identity = isIdentityColorMap(colorMap, imgData.lookup, colorMode,
+					imgData.ri);
 
   if (colorMode == splashModeMono1) {
     srcMode = splashModeMono8;
@@ -3579,6 +3774,7 @@ struct SplashOutMaskedImageData {
   GfxRenderingIntent ri;
   SplashBitmap *mask;
   SplashColorPtr lookup;
+  GBool identity;		// the color conversion is a copy
   SplashColorMode colorMode;
   int width, height, y;
 };
@@ -3622,7 +3818,10 @@ GBool SplashOutputDev::maskedImageSrc(void *data, SplashColorPtr colorLine,
     --maskShift;
   }
 
-  if (imgData->lookup) {
+  if (imgData->identity) {
+    memcpy(colorLine, p,
+	   imgData->width * splashColorModeNComps[imgData->colorMode]);
+  } else if (imgData->lookup) {
     switch (imgData->colorMode) {
     case splashModeMono1:
     case splashModeMono8:
@@ -3706,8 +3905,9 @@ void SplashOutputDev::drawMaskedImage(GfxState *state, Object *ref,
 		   NULL);
 
   ctm = state->getCTM();
-  reduceImageResolution(str, ctm, &width, &height);
-  reduceImageResolution(maskStr, ctm, &maskWidth, &maskHeight);
+  reduceImageResolution(str, ctm, &width, &height, reduceImages);
+  reduceImageResolution(maskStr, ctm, &maskWidth, &maskHeight,
+			reduceImages);
 
   // If the mask is higher resolution than the image, use
   // drawSoftMaskedImage() instead.
@@ -3825,6 +4025,8 @@ void SplashOutputDev::drawMaskedImage(GfxState *state, Object *ref,
 #endif
       }
     }
+    imgData.identity = isIdentityColorMap(colorMap, imgData.lookup,
+					  colorMode, imgData.ri);
 
     if (colorMode == splashModeMono1) {
       srcMode = splashModeMono8;
@@ -4056,8 +4258,9 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
 
   } else {
 
-    reduceImageResolution(str, ctm, &width, &height);
-    reduceImageResolution(maskStr, ctm, &maskWidth, &maskHeight);
+    reduceImageResolution(str, ctm, &width, &height, reduceImages);
+    reduceImageResolution(maskStr, ctm, &maskWidth, &maskHeight,
+			  reduceImages);
 
     //----- set up the soft mask
 
@@ -4068,6 +4271,7 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
     imgMaskData.colorMap = maskColorMap;
     imgMaskData.ri = state->getRenderingIntent();
     imgMaskData.maskColors = NULL;
+    imgMaskData.missingColor = NULL;
     imgMaskData.colorMode = splashModeMono8;
     imgMaskData.width = maskWidth;
     imgMaskData.height = maskHeight;
@@ -4079,8 +4283,11 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
       maskColorMap->getGray(&pix, &gray, state->getRenderingIntent());
       imgMaskData.lookup[i] = colToByte(gray);
     }
+    imgMaskData.identity = isIdentityColorMap(maskColorMap, imgMaskData.lookup,
+					      splashModeMono8, imgMaskData.ri);
     maskBitmap = new SplashBitmap(bitmap->getWidth(), bitmap->getHeight(),
-				  1, splashModeMono8, gFalse);
+				  1, splashModeMono8, gFalse, gTrue,
+				  bitmap->getBandY(), bitmap->getBandHeight());
     maskSplash = new Splash(maskBitmap, vectorAntialias);
     maskSplash->setStrokeAdjust(
 		       mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
@@ -4104,6 +4311,7 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
     imgData.colorMap = colorMap;
     imgData.ri = state->getRenderingIntent();
     imgData.maskColors = NULL;
+    imgData.missingColor = draft ? paperColor : (SplashColorPtr)NULL;
     imgData.colorMode = colorMode;
     imgData.width = width;
     imgData.height = height;
@@ -4155,6 +4363,8 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
 #endif
       }
     }
+    imgData.identity = isIdentityColorMap(colorMap, imgData.lookup,
+					  colorMode, imgData.ri);
 
     splash->drawImage(&imageSrc, &imgData, srcMode, gFalse, width, height, mat,
 		      interpolate);
@@ -4169,12 +4379,15 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
 }
 
 void SplashOutputDev::reduceImageResolution(Stream *str, double *ctm,
-					    int *width, int *height) {
+					    int *width, int *height,
+					    GBool reduceAll) {
+  StreamKind kind;
   double sw, sh;
   int reduction;
 
-  if (str->getKind() == strJPX &&
-      *width * *height > 10000000) {
+  kind = str->getKind();
+  if ((kind == strJPX && (reduceAll || *width * *height > 10000000)) ||
+      (kind == strDCT && reduceAll)) {
     sw = (double)*width / (fabs(ctm[2]) + fabs(ctm[3]));
     sh = (double)*height / (fabs(ctm[0]) + fabs(ctm[1]));
     if (sw > 8 && sh > 8) {
@@ -4187,9 +4400,21 @@ void SplashOutputDev::reduceImageResolution(Stream *str, double *ctm,
       reduction = 0;
     }
     if (reduction > 0) {
-      ((JPXStream *)str)->reduceResolution(reduction);
-      *width >>= reduction;
-      *height >>= reduction;
+#ifndef NO_JPX_STREAM
+      if (kind == strJPX) {
+	((JPXStream *)str)->reduceResolution(reduction);
+	*width >>= reduction;
+	*height >>= reduction;
+      }
+#endif
+#ifndef NO_DCT_STREAM
+      if (kind == strDCT) {
+	// NB: DCTStream rounds the reduced size up
+	((DCTStream *)str)->reduceResolution(reduction);
+	*width = (*width + (1 << reduction) - 1) >> reduction;
+	*height = (*height + (1 << reduction) - 1) >> reduction;
+      }
+#endif
     }
   }
 }
@@ -4237,12 +4462,12 @@ void SplashOutputDev::clearMaskRegion(GfxState *state,
     xxMaxI = maskBitmap->getWidth();
   }
   yyMinI = (int)floor(yyMin);
-  if (yyMinI < 0) {
-    yyMinI = 0;
+  if (yyMinI < maskBitmap->getBandY()) {
+    yyMinI = maskBitmap->getBandY();
   }
   yyMaxI = (int)ceil(yyMax);
-  if (yyMaxI > maskBitmap->getHeight()) {
-    yyMaxI = maskBitmap->getHeight();
+  if (yyMaxI > maskBitmap->getBandY() + maskBitmap->getBandHeight()) {
+    yyMaxI = maskBitmap->getBandY() + maskBitmap->getBandHeight();
   }
   p = maskBitmap->getDataPtr() + yyMinI * maskBitmap->getRowSize();
   if (maskBitmap->getMode() == splashModeMono1) {
@@ -4268,7 +4493,7 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
   SplashBitmap *backdropBitmap;
   SplashColor color;
   double xMin, yMin, xMax, yMax, x, y;
-  int bw, bh, tx, ty, w, h, i;
+  int bw, bh, tx, ty, w, h, by0, by1, i;
 
   // transform the bbox
   state->transform(bbox[0], bbox[1], &x, &y);
@@ -4356,6 +4581,22 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
     h = 1;
   }
 
+  // if drawing into a band bitmap, the group bitmap only needs the
+  // rows of the band -- but it keeps the same origin, because mono1
+  // groups are dithered in group coordinates
+  by0 = bitmap->getBandY() - ty;
+  by1 = by0 + bitmap->getBandHeight();
+  if (by0 < 0) {
+    by0 = 0;
+  } else if (by0 > h) {
+    by0 = h;
+  }
+  if (by1 > h) {
+    by1 = h;
+  } else if (by1 < by0) {
+    by1 = by0;
+  }
+
   // push a new stack entry
   transpGroup = new SplashTransparencyGroup();
   transpGroup->tx = tx;
@@ -4396,7 +4637,7 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
 
   // create the temporary bitmap
   bitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode, gTrue,
-			    bitmapTopDown); 
+			    bitmapTopDown, by0, by1 - by0 < h ? by1 - by0 : -1);
   splash = new Splash(bitmap, vectorAntialias,
 		      transpGroup->origSplash->getScreen());
   splash->setMinLineWidth(globalParams->getMinLineWidth());
@@ -4419,7 +4660,9 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
     // when drawing a non-isolated group into another non-isolated group,
     // compute a backdrop bitmap with corrected alpha values
     backdropBitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode, gTrue,
-				      bitmapTopDown);
+				      bitmapTopDown, bitmap->getBandY(),
+				      bitmap->isBand() ?
+				        bitmap->getBandHeight() : -1);
     transpGroup->origSplash->blitCorrectedAlpha(backdropBitmap,
 						tx, ty, 0, 0, w, h);
     transpGroup->backdropBitmap = backdropBitmap;
@@ -4508,7 +4751,7 @@ void SplashOutputDev::setSoftMask(GfxState *state, double *bbox,
   GfxCMYK cmyk;
 #endif
   double backdrop, backdrop2, lum, lum2;
-  int tx, ty, x, y;
+  int tx, ty, x, y, y0, y1;
 
   tx = transpGroupStack->tx;
   ty = transpGroupStack->ty;
@@ -4578,12 +4821,17 @@ void SplashOutputDev::setSoftMask(GfxState *state, double *bbox,
   }
 
   softMask = new SplashBitmap(bitmap->getWidth(), bitmap->getHeight(),
-			      1, splashModeMono8, gFalse);
-  memset(softMask->getDataPtr(), (int)(backdrop2 * 255.0 + 0.5),
-	 softMask->getRowSize() * softMask->getHeight());
+			      1, splashModeMono8, gFalse, gTrue,
+			      bitmap->getBandY(), bitmap->getBandHeight());
+  memset(softMask->getDataPtr() +
+	   softMask->getBandY() * softMask->getRowSize(),
+	 (int)(backdrop2 * 255.0 + 0.5),
+	 softMask->getRowSize() * softMask->getBandHeight());
   if (tx < softMask->getWidth() && ty < softMask->getHeight()) {
-    p = softMask->getDataPtr() + ty * softMask->getRowSize() + tx;
-    for (y = 0; y < tBitmap->getHeight(); ++y) {
+    y0 = tBitmap->getBandY();
+    y1 = y0 + tBitmap->getBandHeight();
+    p = softMask->getDataPtr() + (ty + y0) * softMask->getRowSize() + tx;
+    for (y = y0; y < y1; ++y) {
       for (x = 0; x < tBitmap->getWidth(); ++x) {
 	if (alpha) {
 	  lum = tBitmap->getAlpha(x, y) / 255.0;
@@ -38,6 +38,10 @@ struct SplashTransparencyGroup;
 // number of Type 3 fonts to cache
 #define splashOutT3FontCacheSize 8
 
+// Called by SplashOutputDev::doTilingPatternFill to draw the pattern
+// cell, with the pattern matrix <mat> and cell bbox <bbox>.
+typedef void (*SplashOutTileCbk)(double *mat, double *bbox, void *data);
+
 //------------------------------------------------------------------------
 // SplashOutputDev
 //------------------------------------------------------------------------
@@ -126,6 +130,15 @@ public:
   virtual GBool axialShadedFill(GfxState *state, GfxAxialShading *shading);
   virtual GBool radialShadedFill(GfxState *state, GfxRadialShading *shading);
 
+  // Same as tilingPatternFill, but the pattern cell is drawn by
+  // <drawTileCbk> (once, or once per tile if the tiles are too big to
+  // cache) instead of Gfx::drawForm.
+  void doTilingPatternFill(GfxState *state,
+			   SplashOutTileCbk drawTileCbk, void *drawTileCbkData,
+			   int tilingType, double *mat, double *bbox,
+			   int x0, int y0, int x1, int y1,
+			   double xStep, double yStep);
+
   //----- path clipping
   virtual void clip(GfxState *state);
   virtual void eoClip(GfxState *state);
@@ -187,6 +200,9 @@ public:
   // Called to indicate that a new PDF document has been loaded.
   void startDoc(XRef *xrefA);
 
+  // Discard the cached Type 3 glyphs.
+  void clearType3Cache();
+
   void setStartPageCallback(void (*cbk)(void *data), void *data)
     { startPageCbk = cbk; startPageCbkData = data; }
  
@@ -234,8 +250,36 @@ public:
   void setSkipText(GBool skipHorizTextA, GBool skipRotatedTextA)
     { skipHorizText = skipHorizTextA; skipRotatedText = skipRotatedTextA; }
 
+  // If <reduceImagesA> is true, DCT and JPX images are decoded at
+  // 1/2, 1/4, or 1/8 resolution whenever they will be downsampled by
+  // at least that much.  (By default, this is only done for very
+  // large JPX images.)
+  void setReduceImages(GBool reduceImagesA) { reduceImages = reduceImagesA; }
+
+  // Draft mode, intended for very low resolutions (e.g., thumbnails):
+  // glyphs are drawn as filled boxes (half an em high, one advance
+  // wide) instead of being rasterized, which doesn't need a font
+  // engine; and image data that can't be read (e.g., because the
+  // filter isn't included in this build) is drawn in the paper color
+  // instead of black.  Type 3 glyphs are still drawn normally.
+  void setDraft(GBool draftA) { draft = draftA; }
+
+  // Rasterize only rows <bandYA> .. <bandYA> + <bandHA> - 1 of the
+  // following pages, into a band bitmap (see SplashBitmap).  The band
+  // rows are identical to the same rows of the full page.  Set
+  // <bandHA> to -1 to go back to full pages.
+  void setBand(int bandYA, int bandHA) { bandY = bandYA; bandH = bandHA; }
+
   int getNestCount() { return nestCount; }
 
+  // Reduce the resolution of a large JPX image that is drawn at a
+  // much smaller size (the image drawing functions do this before
+  // reading <str>).  If <reduceAll> is true, this is done for any
+  // DCT or JPX image (see setReduceImages).
+  static void reduceImageResolution(Stream *str, double *mat,
+				    int *width, int *height,
+				    GBool reduceAll);
+
 
   // Get the screen parameters.
   SplashScreenParams *getScreenParams() { return &screenParams; }
@@ -267,6 +311,8 @@ private:
   SplashPath *convertPath(GfxState *state, GfxPath *path,
 			  GBool dropEmptySubpaths);
   void doUpdateFont(GfxState *state);
+  void drawGreekedChar(GfxState *state, double x, double y,
+		       double dx, double dy);
   void drawType3Glyph(GfxState *state, T3FontCache *t3Font,
 		      T3FontCacheTag *tag, Guchar *data);
   static GBool imageMaskSrc(void *data, Guchar *line);
@@ -279,8 +325,7 @@ private:
   static GBool softMaskMatteImageSrc(void *data,
 				     SplashColorPtr colorLine,
 				     Guchar *alphaLine);
-  void reduceImageResolution(Stream *str, double *mat,
-			     int *width, int *height);
+  static void drawTileForm(double *mat, double *bbox, void *data);
   void clearMaskRegion(GfxState *state,
 		       Splash *maskSplash,
 		       double xMin, double yMin,
@@ -299,6 +344,11 @@ private:
   SplashScreenParams screenParams;
   GBool skipHorizText;
   GBool skipRotatedText;
+  GBool reduceImages;		// decode DCT/JPX images at reduced
+				//   resolution when downsampling
+  GBool draft;			// draft mode (see setDraft)
+  int bandY, bandH;		// rows to rasterize (bandH < 0 for the
+				//   full page)
 
   XRef *xref;			// xref table for current document
 
@@ -23,6 +23,11 @@
 #endif
 #include <string.h>
 #include <ctype.h>
+#if (defined(__GNUC__) && defined(__SSE2__)) || \
+    (defined(_WIN32) && (_M_IX86_FP == 2 || defined(_M_X64)))
+#  include <emmintrin.h>
+#  define STREAM_SSE2 1
+#endif
 #include "gmem.h"
 #include "gmempp.h"
 #include "gfile.h"
@@ -75,6 +80,19 @@ int Stream::getRawChar() {
   return EOF;
 }
 
+int Stream::getRawBlock(char *blk, int size) {
+  int n, c;
+
+  n = 0;
+  while (n < size) {
+    if ((c = getRawChar()) == EOF) {
+      break;
+    }
+    blk[n++] = (char)c;
+  }
+  return n;
+}
+
 int Stream::getBlock(char *buf, int size) {
   int n, c;
 
@@ -487,7 +505,7 @@ StreamPredictor::StreamPredictor(Stream *strA, int predictorA,
   width = widthA;
   nComps = nCompsA;
   nBits = nBitsA;
-  predLine = NULL;
+  predLine = prevLine = NULL;
   ok = gFalse;
 
   nVals = width * nComps;
@@ -501,6 +519,7 @@ StreamPredictor::StreamPredictor(Stream *strA, int predictorA,
     return;
   }
   predLine = (Guchar *)gmalloc(rowBytes);
+  prevLine = (Guchar *)gmalloc(rowBytes);
 
   reset();
 
@@ -509,10 +528,12 @@ StreamPredictor::StreamPredictor(Stream *strA, int predictorA,
 
 StreamPredictor::~StreamPredictor() {
   gfree(predLine);
+  gfree(prevLine);
 }
 
 void StreamPredictor::reset() {
   memset(predLine, 0, rowBytes);
+  memset(prevLine, 0, rowBytes);
   predIdx = rowBytes;
 }
 
@@ -555,11 +576,154 @@ int StreamPredictor::getBlock(char *blk, int size) {
   return n;
 }
 
+// The PNG row functions work on <n> bytes of <line>, with <prev> (if
+// used) pointing to the same position in the previous line.  The
+// <bpp> bytes before both pointers are the zero-filled left border.
+
+#if STREAM_SSE2
+
+// Load/store one pixel of 1 to 4 bytes in the low 32 bits.
+static inline __m128i loadPixel(Guchar *p, int bpp) {
+  Guint x;
+
+  x = 0;
+  memcpy(&x, p, bpp);
+  return _mm_cvtsi32_si128((int)x);
+}
+
+static inline void storePixel(Guchar *p, int bpp, __m128i v) {
+  Guint x;
+
+  x = (Guint)_mm_cvtsi128_si32(v);
+  memcpy(p, &x, bpp);
+}
+
+#endif
+
+// PNG sub, also used for the 8-bit TIFF predictor: x += left
+static void pngSubRow(Guchar *line, int bpp, int n) {
+  int i;
+
+  i = 0;
+#if STREAM_SSE2
+  if (bpp == 3 || bpp == 4) {
+    __m128i a;
+
+    a = _mm_setzero_si128();
+    for (; i + bpp <= n; i += bpp) {
+      a = _mm_add_epi8(loadPixel(line + i, bpp), a);
+      storePixel(line + i, bpp, a);
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    line[i] = (Guchar)(line[i] + line[i - bpp]);
+  }
+}
+
+// PNG up: x += up
+static void pngUpRow(Guchar *line, Guchar *prev, int n) {
+  int i;
+
+  i = 0;
+#if STREAM_SSE2
+  for (; i + 16 <= n; i += 16) {
+    _mm_storeu_si128((__m128i *)(line + i),
+		     _mm_add_epi8(_mm_loadu_si128((__m128i *)(line + i)),
+				  _mm_loadu_si128((__m128i *)(prev + i))));
+  }
+#endif
+  for (; i < n; ++i) {
+    line[i] = (Guchar)(line[i] + prev[i]);
+  }
+}
+
+// PNG average: x += (left + up) >> 1
+static void pngAverageRow(Guchar *line, Guchar *prev, int bpp, int n) {
+  int i;
+
+  i = 0;
+#if STREAM_SSE2
+  if (bpp == 3 || bpp == 4) {
+    __m128i a, b, one;
+
+    // _mm_avg_epu8 rounds up, so subtract the carry of odd sums
+    one = _mm_set1_epi8(1);
+    a = _mm_setzero_si128();
+    for (; i + bpp <= n; i += bpp) {
+      b = loadPixel(prev + i, bpp);
+      a = _mm_add_epi8(loadPixel(line + i, bpp),
+		       _mm_sub_epi8(_mm_avg_epu8(a, b),
+				    _mm_and_si128(_mm_xor_si128(a, b), one)));
+      storePixel(line + i, bpp, a);
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    line[i] = (Guchar)(((line[i - bpp] + prev[i]) >> 1) + line[i]);
+  }
+}
+
+// PNG Paeth: x += whichever of left, up, and up-left is closest to
+// left + up - upLeft
+static void pngPaethRow(Guchar *line, Guchar *prev, int bpp, int n) {
+  int left, up, upLeft, p, pa, pb, pc;
+  int i;
+
+  i = 0;
+#if STREAM_SSE2
+  if (bpp == 3 || bpp == 4) {
+    __m128i zero, a, b, c, pA, pB, pC, notA, useC, pred;
+
+    // 16-bit lanes, one pixel per iteration
+    zero = _mm_setzero_si128();
+    a = c = zero;
+    for (; i + bpp <= n; i += bpp) {
+      b = _mm_unpacklo_epi8(loadPixel(prev + i, bpp), zero);
+      pA = _mm_sub_epi16(b, c);			// p - left
+      pB = _mm_sub_epi16(a, c);			// p - up
+      pC = _mm_add_epi16(pA, pB);		// p - upLeft
+      pA = _mm_max_epi16(pA, _mm_sub_epi16(zero, pA));
+      pB = _mm_max_epi16(pB, _mm_sub_epi16(zero, pB));
+      pC = _mm_max_epi16(pC, _mm_sub_epi16(zero, pC));
+      notA = _mm_or_si128(_mm_cmpgt_epi16(pA, pB), _mm_cmpgt_epi16(pA, pC));
+      useC = _mm_cmpgt_epi16(pB, pC);
+      pred = _mm_or_si128(_mm_and_si128(useC, c), _mm_andnot_si128(useC, b));
+      pred = _mm_or_si128(_mm_and_si128(notA, pred),
+			  _mm_andnot_si128(notA, a));
+      a = _mm_add_epi8(loadPixel(line + i, bpp),
+		       _mm_packus_epi16(pred, pred));
+      storePixel(line + i, bpp, a);
+      a = _mm_unpacklo_epi8(a, zero);
+      c = b;
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    left = line[i - bpp];
+    up = prev[i];
+    upLeft = prev[i - bpp];
+    p = left + up - upLeft;
+    if ((pa = p - left) < 0)
+      pa = -pa;
+    if ((pb = p - up) < 0)
+      pb = -pb;
+    if ((pc = p - upLeft) < 0)
+      pc = -pc;
+    if (pa <= pb && pa <= pc)
+      line[i] = (Guchar)(left + line[i]);
+    else if (pb <= pc)
+      line[i] = (Guchar)(up + line[i]);
+    else
+      line[i] = (Guchar)(upLeft + line[i]);
+  }
+}
+
 GBool StreamPredictor::getNextLine() {
   int curPred;
   Guchar upLeftBuf[gfxColorMaxComps * 2 + 1];
-  int left, up, upLeft, p, pa, pb, pc;
-  int c;
+  Guchar *line;
+  int c, n;
   Gulong inBuf, outBuf, bitMask;
   int inBits, outBits;
   int i, j, k, kk;
@@ -574,63 +738,48 @@ GBool StreamPredictor::getNextLine() {
     curPred = predictor;
   }
 
-  // read the raw line, apply PNG (byte) predictor
-  memset(upLeftBuf, 0, pixBytes + 1);
-  for (i = pixBytes; i < rowBytes; ++i) {
-    for (j = pixBytes; j > 0; --j) {
-      upLeftBuf[j] = upLeftBuf[j-1];
-    }
-    upLeftBuf[0] = predLine[i];
-    if ((c = str->getRawChar()) == EOF) {
-      if (i > pixBytes) {
-	// this ought to return false, but some (broken) PDF files
-	// contain truncated image data, and Adobe apparently reads the
-	// last partial line
-	break;
-      }
+  // read the raw line into the other buffer -- the current line
+  // becomes the 'up' line for the PNG predictors
+  line = prevLine;
+  prevLine = predLine;
+  predLine = line;
+  n = str->getRawBlock((char *)predLine + pixBytes, rowBytes - pixBytes);
+  if (n < rowBytes - pixBytes) {
+    if (n == 0) {
+      predLine = prevLine;
+      prevLine = line;
       return gFalse;
     }
-    switch (curPred) {
-    case 11:			// PNG sub
-      predLine[i] = (Guchar)(predLine[i - pixBytes] + c);
-      break;
-    case 12:			// PNG up
-      predLine[i] = (Guchar)(predLine[i] + c);
-      break;
-    case 13:			// PNG average
-      predLine[i] = (Guchar)(((predLine[i - pixBytes] + predLine[i]) >> 1) + c);
-      break;
-    case 14:			// PNG Paeth
-      left = predLine[i - pixBytes];
-      up = predLine[i];
-      upLeft = upLeftBuf[pixBytes];
-      p = left + up - upLeft;
-      if ((pa = p - left) < 0)
-	pa = -pa;
-      if ((pb = p - up) < 0)
-	pb = -pb;
-      if ((pc = p - upLeft) < 0)
-	pc = -pc;
-      if (pa <= pb && pa <= pc)
-	predLine[i] = (Guchar)(left + c);
-      else if (pb <= pc)
-	predLine[i] = (Guchar)(up + c);
-      else
-	predLine[i] = (Guchar)(upLeft + c);
-      break;
-    case 10:			// PNG none
-    default:			// no predictor or TIFF predictor
-      predLine[i] = (Guchar)c;
-      break;
-    }
+    // this ought to return false, but some (broken) PDF files
+    // contain truncated image data, and Adobe apparently reads the
+    // last partial line -- the rest of the line is left as it was
+    memcpy(predLine + pixBytes + n, prevLine + pixBytes + n,
+	   rowBytes - pixBytes - n);
+  }
+
+  // apply PNG (byte) predictor
+  switch (curPred) {
+  case 11:			// PNG sub
+    pngSubRow(predLine + pixBytes, pixBytes, n);
+    break;
+  case 12:			// PNG up
+    pngUpRow(predLine + pixBytes, prevLine + pixBytes, n);
+    break;
+  case 13:			// PNG average
+    pngAverageRow(predLine + pixBytes, prevLine + pixBytes, pixBytes, n);
+    break;
+  case 14:			// PNG Paeth
+    pngPaethRow(predLine + pixBytes, prevLine + pixBytes, pixBytes, n);
+    break;
+  case 10:			// PNG none
+  default:			// no predictor or TIFF predictor
+    break;
   }
 
   // apply TIFF (component) predictor
   if (predictor == 2) {
     if (nBits == 8) {
-      for (i = pixBytes; i < rowBytes; ++i) {
-	predLine[i] = (Guchar)(predLine[i] + predLine[i - nComps]);
-      }
+      pngSubRow(predLine + pixBytes, nComps, rowBytes - pixBytes);
     } else if (nBits == 16) {
       for (i = pixBytes; i < rowBytes; i += 2) {
 	c = ((predLine[i] + predLine[i - 2*nComps]) << 8) +
@@ -1041,6 +1190,54 @@ void EmbedStream::moveStart(int delta) {
 // ASCIIHexStream
 //------------------------------------------------------------------------
 
+// Value of each char in ASCIIHex data: 0-15 for hex digits, -1 for
+// white space, -2 for the '>' end marker, -3 for anything else.
+static signed char asciiHexVals[256] = {
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -1, -1, -1, -1, -1, -3, -3,   // 0x
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // 1x
+  -1, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // 2x
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -3, -3, -3, -3, -2, -3,   // 3x
+  -3, 10, 11, 12, 13, 14, 15, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // 4x
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // 5x
+  -3, 10, 11, 12, 13, 14, 15, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // 6x
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // 7x
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // 8x
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // 9x
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // ax
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // bx
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // cx
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // dx
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3,   // ex
+  -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3, -3   // fx
+};
+
+#if STREAM_SSE2
+// Decode 16 hex digits at <in> into 8 bytes at <out>.  Returns false
+// (without writing anything) if any of the 16 chars is not a hex
+// digit.
+static inline GBool asciiHexDecode16(Guchar *in, Guchar *out) {
+  __m128i s, d, a, isDigit, isAlpha, v;
+
+  s = _mm_loadu_si128((__m128i *)in);
+  d = _mm_sub_epi8(s, _mm_set1_epi8('0'));
+  isDigit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+  a = _mm_sub_epi8(_mm_and_si128(s, _mm_set1_epi8((char)0xdf)),
+		   _mm_set1_epi8('A'));
+  isAlpha = _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(5)), a);
+  if (_mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha)) != 0xffff) {
+    return gFalse;
+  }
+  v = _mm_or_si128(_mm_and_si128(isDigit, d),
+		   _mm_and_si128(isAlpha,
+				 _mm_add_epi8(a, _mm_set1_epi8(10))));
+  // each 16-bit lane holds (high nibble, low nibble)
+  v = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)), 4),
+		   _mm_srli_epi16(v, 8));
+  _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(v, v));
+  return gTrue;
+}
+#endif
+
 ASCIIHexStream::ASCIIHexStream(Stream *strA):
     FilterStream(strA) {
   buf = EOF;
@@ -1116,6 +1313,76 @@ int ASCIIHexStream::lookChar() {
   return buf;
 }
 
+int ASCIIHexStream::getBlock(char *blk, int size) {
+  Guchar in[4096];
+  int n, nIn, need, end, i, hi, v;
+
+  // reading ahead could swallow the end of inline image data
+  if (str->isEmbedStream()) {
+    return Stream::getBlock(blk, size);
+  }
+  n = 0;
+  if (buf != EOF && n < size) {
+    blk[n++] = (char)buf;
+    buf = EOF;
+  }
+  hi = -1;
+  while (n < size && !eof) {
+    // two digits per byte -- reading no more than that means there
+    // are never any unused chars left over
+    need = 2 * (size - n) - (hi >= 0 ? 1 : 0);
+    if (need > (int)sizeof(in)) {
+      need = (int)sizeof(in);
+    }
+    nIn = str->getBlock((char *)in, need);
+    i = 0;
+    while (i < nIn && !eof) {
+      end = nIn;
+#if STREAM_SSE2
+      if (hi < 0 && nIn - i >= 16) {
+	if (asciiHexDecode16(in + i, (Guchar *)blk + n)) {
+	  i += 16;
+	  n += 8;
+	  continue;
+	}
+	end = i + 16;
+      }
+#endif
+      for (; i < end; ++i) {
+	v = asciiHexVals[in[i]];
+	if (v == -1) {
+	  continue;
+	}
+	if (v == -2) {
+	  eof = gTrue;
+	  if (hi >= 0) {
+	    blk[n++] = (char)(hi << 4);
+	  }
+	  break;
+	}
+	if (v == -3) {
+	  error(errSyntaxError, getPos(),
+		"Illegal character <{0:02x}> in ASCIIHex stream", in[i]);
+	  v = 0;
+	}
+	if (hi < 0) {
+	  hi = v;
+	} else {
+	  blk[n++] = (char)((hi << 4) | v);
+	  hi = -1;
+	}
+      }
+    }
+    if (nIn == 0) {
+      // end of stream without '>': a partial byte is dropped, and a
+      // zero byte is returned instead (same as lookChar)
+      eof = gTrue;
+      blk[n++] = 0;
+    }
+  }
+  return n;
+}
+
 GString *ASCIIHexStream::getPSFilter(int psLevel, const char *indent) {
   GString *s;
 
@@ -1141,6 +1408,7 @@ ASCII85Stream::ASCII85Stream(Stream *strA):
     FilterStream(strA) {
   index = n = 0;
   eof = gFalse;
+  inPos = inLen = 0;
 }
 
 ASCII85Stream::~ASCII85Stream() {
@@ -1155,6 +1423,7 @@ void ASCII85Stream::reset() {
   str->reset();
   index = n = 0;
   eof = gFalse;
+  inPos = inLen = 0;
 }
 
 int ASCII85Stream::lookChar() {
@@ -1166,7 +1435,7 @@ int ASCII85Stream::lookChar() {
       return EOF;
     index = 0;
     do {
-      c[0] = str->getChar();
+      c[0] = getInChar();
     } while (Lexer::isSpace(c[0]));
     if (c[0] == '~' || c[0] == EOF) {
       eof = gTrue;
@@ -1178,12 +1447,13 @@ int ASCII85Stream::lookChar() {
     } else {
       for (k = 1; k < 5; ++k) {
 	do {
-	  c[k] = str->getChar();
+	  c[k] = getInChar();
 	} while (Lexer::isSpace(c[k]));
 	if (c[k] == '~' || c[k] == EOF)
 	  break;
       }
-      n = k - 1;
+      // (a lone final char is invalid, but still produces one byte)
+      n = k > 1 ? k - 1 : 1;
       if (k < 5 && (c[k] == '~' || c[k] == EOF)) {
 	for (++k; k < 5; ++k)
 	  c[k] = 0x21 + 84;
@@ -1201,6 +1471,74 @@ int ASCII85Stream::lookChar() {
   return b[index];
 }
 
+int ASCII85Stream::getBlock(char *blk, int size) {
+  Guchar *p;
+  Guint t;
+  int nRead, m, k;
+
+  nRead = 0;
+  while (nRead < size) {
+    if (index < n) {
+      m = n - index;
+      if (m > size - nRead) {
+	m = size - nRead;
+      }
+      for (k = 0; k < m; ++k) {
+	blk[nRead++] = (char)b[index++];
+      }
+      continue;
+    }
+    if (eof) {
+      break;
+    }
+
+    // fast path: decode complete groups (with no white space)
+    // straight from the input buffer
+    if (size - nRead >= 4 && inPos < inLen) {
+      p = inBuf + inPos;
+      if (p[0] == 'z') {
+	blk[nRead] = blk[nRead+1] = blk[nRead+2] = blk[nRead+3] = 0;
+	nRead += 4;
+	++inPos;
+	continue;
+      }
+      if (inLen - inPos >= 5 &&
+	  (Guchar)(p[0] - 0x21) < 85 && (Guchar)(p[1] - 0x21) < 85 &&
+	  (Guchar)(p[2] - 0x21) < 85 && (Guchar)(p[3] - 0x21) < 85 &&
+	  (Guchar)(p[4] - 0x21) < 85) {
+	t = (Guint)(p[0] - 0x21);
+	for (k = 1; k < 5; ++k) {
+	  t = t * 85 + (Guint)(p[k] - 0x21);
+	}
+	blk[nRead] = (char)(t >> 24);
+	blk[nRead+1] = (char)(t >> 16);
+	blk[nRead+2] = (char)(t >> 8);
+	blk[nRead+3] = (char)t;
+	nRead += 4;
+	inPos += 5;
+	continue;
+      }
+    }
+
+    // refill the input buffer -- but don't read ahead in inline image
+    // data, where that could swallow the EI operator
+    if (inPos == inLen && !str->isEmbedStream()) {
+      inPos = 0;
+      inLen = str->getBlock((char *)inBuf, ascii85InBufSize);
+      if (inLen > 0) {
+	continue;
+      }
+    }
+
+    // everything else (white space, the end of the data, groups split
+    // across reads) goes through lookChar
+    if (lookChar() == EOF) {
+      break;
+    }
+  }
+  return nRead;
+}
+
 GString *ASCII85Stream::getPSFilter(int psLevel, const char *indent) {
   GString *s;
 
@@ -1236,7 +1574,11 @@ LZWStream::LZWStream(Stream *strA, int predictor, int columns, int colors,
   }
   early = earlyA;
   eof = gFalse;
+  inPos = inLen = 0;
   inputBits = 0;
+  newChar = 0;
+  hist = NULL;
+  histSize = 0;
   clearTable();
 }
 
@@ -1244,6 +1586,7 @@ LZWStream::~LZWStream() {
   if (pred) {
     delete pred;
   }
+  gfree(hist);
   delete str;
 }
 
@@ -1264,12 +1607,12 @@ int LZWStream::getChar() {
   if (eof) {
     return EOF;
   }
-  if (seqIndex >= seqLength) {
+  if (histIndex >= histLength) {
     if (!processNextCode()) {
       return EOF;
     }
   }
-  return seqBuf[seqIndex++];
+  return hist[histIndex++];
 }
 
 int LZWStream::lookChar() {
@@ -1279,48 +1622,52 @@ int LZWStream::lookChar() {
   if (eof) {
     return EOF;
   }
-  if (seqIndex >= seqLength) {
+  if (histIndex >= histLength) {
     if (!processNextCode()) {
       return EOF;
     }
   }
-  return seqBuf[seqIndex];
+  return hist[histIndex];
 }
 
 int LZWStream::getRawChar() {
   if (eof) {
     return EOF;
   }
-  if (seqIndex >= seqLength) {
+  if (histIndex >= histLength) {
     if (!processNextCode()) {
       return EOF;
     }
   }
-  return seqBuf[seqIndex++];
+  return hist[histIndex++];
 }
 
 int LZWStream::getBlock(char *blk, int size) {
-  int n, m;
-
   if (pred) {
     return pred->getBlock(blk, size);
   }
+  return getRawBlock(blk, size);
+}
+
+int LZWStream::getRawBlock(char *blk, int size) {
+  int n, m;
+
   if (eof) {
     return 0;
   }
   n = 0;
   while (n < size) {
-    if (seqIndex >= seqLength) {
+    if (histIndex >= histLength) {
       if (!processNextCode()) {
 	break;
       }
     }
-    m = seqLength - seqIndex;
+    m = histLength - histIndex;
     if (m > size - n) {
       m = size - n;
     }
-    memcpy(blk + n, seqBuf + seqIndex, m);
-    seqIndex += m;
+    memcpy(blk + n, hist + histIndex, m);
+    histIndex += m;
     n += m;
   }
   return n;
@@ -1332,14 +1679,22 @@ void LZWStream::reset() {
     pred->reset();
   }
   eof = gFalse;
+  inPos = inLen = 0;
   inputBits = 0;
   clearTable();
 }
 
+// The output of each code is appended to hist, which holds everything
+// decoded since the last clear-table code.  A table entry is always
+// the previous code's output plus the first char of the following
+// output, which is exactly the span of hist that starts at the
+// previous output -- so entries are stored as (offset, length) spans,
+// and each code is decoded with a single memcpy instead of a walk
+// back along the prefix chain.  (The table has to be cleared after
+// at most 3840 codes, so hist is bounded.)
 GBool LZWStream::processNextCode() {
   int code;
-  int nextLength;
-  int i, j;
+  int offset, length;
 
   // check for EOF
   if (eof) {
@@ -1363,33 +1718,49 @@ GBool LZWStream::processNextCode() {
     clearTable();
   }
 
-  // process the next code
-  nextLength = seqLength + 1;
+  // find the sequence for the next code
   if (code < 256) {
-    seqBuf[0] = (Guchar)code;
-    seqLength = 1;
+    offset = -1;
+    length = 1;
   } else if (code < nextCode) {
-    seqLength = table[code].length;
-    for (i = seqLength - 1, j = code; i > 0; --i) {
-      seqBuf[i] = table[j].tail;
-      j = table[j].head;
-    }
-    seqBuf[0] = (Guchar)j;
+    offset = table[code].offset;
+    length = table[code].length;
   } else if (code == nextCode) {
-    seqBuf[seqLength] = (Guchar)newChar;
-    ++seqLength;
+    offset = prevOffset;
+    length = prevLength + 1;
   } else {
     error(errSyntaxError, getPos(), "Bad LZW stream - unexpected code");
     eof = gTrue;
     return gFalse;
   }
-  newChar = seqBuf[0];
+
+  // append it to the history buffer
+  if (histLength + length > histSize) {
+    histSize = 2 * histSize;
+    if (histSize < histLength + length) {
+      histSize = histLength + length;
+    }
+    if (histSize < 4096) {
+      histSize = 4096;
+    }
+    hist = (Guchar *)grealloc(hist, histSize);
+  }
+  if (code < 256) {
+    hist[histLength] = (Guchar)code;
+  } else if (code < nextCode) {
+    memcpy(hist + histLength, hist + offset, length);
+  } else {
+    memcpy(hist + histLength, hist + offset, length - 1);
+    hist[histLength + length - 1] = (Guchar)newChar;
+  }
+  newChar = hist[histLength];
+
+  // add a table entry
   if (first) {
     first = gFalse;
   } else if (nextCode < 4097) {
-    table[nextCode].length = nextLength;
-    table[nextCode].head = prevCode;
-    table[nextCode].tail = (Guchar)newChar;
+    table[nextCode].offset = prevOffset;
+    table[nextCode].length = prevLength + 1;
     ++nextCode;
     if (nextCode + early == 512)
       nextBits = 10;
@@ -1398,10 +1769,12 @@ GBool LZWStream::processNextCode() {
     else if (nextCode + early == 2048)
       nextBits = 12;
   }
-  prevCode = code;
+  prevOffset = histLength;
+  prevLength = length;
 
-  // reset buffer
-  seqIndex = 0;
+  // the new sequence is the next data to be returned
+  histIndex = histLength;
+  histLength += length;
 
   return gTrue;
 }
@@ -1409,18 +1782,19 @@ GBool LZWStream::processNextCode() {
 void LZWStream::clearTable() {
   nextCode = 258;
   nextBits = 9;
-  seqIndex = seqLength = 0;
+  histIndex = histLength = 0;
+  prevOffset = prevLength = 0;
   first = gTrue;
 }
 
 int LZWStream::getCode() {
-  int c;
   int code;
 
   while (inputBits < nextBits) {
-    if ((c = str->getChar()) == EOF)
+    if (inPos >= inLen && !fillInputBuf()) {
       return EOF;
-    inputBuf = (inputBuf << 8) | (c & 0xff);
+    }
+    inputBuf = (inputBuf << 8) | inBuf[inPos++];
     inputBits += 8;
   }
   code = (inputBuf >> (inputBits - nextBits)) & ((1 << nextBits) - 1);
@@ -1428,6 +1802,28 @@ int LZWStream::getCode() {
   return code;
 }
 
+GBool LZWStream::fillInputBuf() {
+  int c;
+
+  inPos = 0;
+  // don't read ahead in inline image data -- that could swallow the
+  // EI operator
+  if (str->isEmbedStream()) {
+    if ((c = str->getChar()) == EOF) {
+      inLen = 0;
+      return gFalse;
+    }
+    inBuf[0] = (Guchar)c;
+    inLen = 1;
+    return gTrue;
+  }
+  inLen = str->getBlock((char *)inBuf, lzwInBufSize);
+  if (inLen < 0) {
+    inLen = 0;
+  }
+  return inLen > 0;
+}
+
 GString *LZWStream::getPSFilter(int psLevel, const char *indent) {
   GString *s;
 
@@ -1564,10 +1960,13 @@ CCITTFaxStream::CCITTFaxStream(Stream *strA, int encodingA, GBool endOfLineA,
   // ---> max refLine size = columns + 3
   codingLine = (int *)gmallocn(columns + 1, sizeof(int));
   refLine = (int *)gmallocn(columns + 3, sizeof(int));
+  rowBytes = (columns + 7) >> 3;
+  rowBuf = (Guchar *)gmalloc(rowBytes);
 
   eof = gFalse;
   row = 0;
   nextLine2D = encoding < 0;
+  inPos = inLen = 0;
   inputBits = 0;
   codingLine[0] = columns;
   nextCol = columns;
@@ -1578,6 +1977,7 @@ CCITTFaxStream::CCITTFaxStream(Stream *strA, int encodingA, GBool endOfLineA,
 
 CCITTFaxStream::~CCITTFaxStream() {
   delete str;
+  gfree(rowBuf);
   gfree(refLine);
   gfree(codingLine);
 }
@@ -1594,6 +1994,7 @@ void CCITTFaxStream::reset() {
   eof = gFalse;
   row = 0;
   nextLine2D = encoding < 0;
+  inPos = inLen = 0;
   inputBits = 0;
   codingLine[0] = columns;
   nextCol = columns;
@@ -1615,7 +2016,7 @@ void CCITTFaxStream::reset() {
 }
 
 int CCITTFaxStream::getChar() {
-  int c, bitsNeeded, bitsAvail, bitsUsed;
+  int c;
 
   if (nextCol >= columns) {
     if (eof) {
@@ -1625,38 +2026,12 @@ int CCITTFaxStream::getChar() {
       return EOF;
     }
   }
-  bitsAvail = codingLine[a0i] - nextCol;
-  if (bitsAvail > 8) {
-    c = (a0i & 1) ? 0x00 : 0xff;
-  } else {
-    c = 0;
-    bitsNeeded = 8;
-    do {
-      bitsUsed = (bitsAvail < bitsNeeded) ? bitsAvail : bitsNeeded;
-      c <<= bitsUsed;
-      if (!(a0i & 1)) {
-	c |= 0xff >> (8 - bitsUsed);
-      }
-      bitsAvail -= bitsUsed;
-      bitsNeeded -= bitsUsed;
-      if (bitsAvail == 0) {
-	if (codingLine[a0i] >= columns) {
-	  c <<= bitsNeeded;
-	  break;
-	}
-	++a0i;
-	bitsAvail = codingLine[a0i] - codingLine[a0i - 1];
-      }
-    } while (bitsNeeded > 0);
-  }
+  c = rowBuf[nextCol >> 3];
   nextCol += 8;
-  c ^= blackXOR;
   return c;
 }
 
 int CCITTFaxStream::lookChar() {
-  int c, bitsNeeded, bitsAvail, bitsUsed, i;
-
   if (nextCol >= columns) {
     if (eof) {
       return EOF;
@@ -1665,37 +2040,11 @@ int CCITTFaxStream::lookChar() {
       return EOF;
     }
   }
-  bitsAvail = codingLine[a0i] - nextCol;
-  if (bitsAvail >= 8) {
-    c = (a0i & 1) ? 0x00 : 0xff;
-  } else {
-    i = a0i;
-    c = 0;
-    bitsNeeded = 8;
-    do {
-      bitsUsed = (bitsAvail < bitsNeeded) ? bitsAvail : bitsNeeded;
-      c <<= bitsUsed;
-      if (!(i & 1)) {
-	c |= 0xff >> (8 - bitsUsed);
-      }
-      bitsAvail -= bitsUsed;
-      bitsNeeded -= bitsUsed;
-      if (bitsAvail == 0) {
-	if (codingLine[i] >= columns) {
-	  c <<= bitsNeeded;
-	  break;
-	}
-	++i;
-	bitsAvail = codingLine[i] - codingLine[i - 1];
-      }
-    } while (bitsNeeded > 0);
-  }
-  c ^= blackXOR;
-  return c;
+  return rowBuf[nextCol >> 3];
 }
 
 int CCITTFaxStream::getBlock(char *blk, int size) {
-  int bytesRead, bitsAvail, bitsNeeded, bitsUsed, byte, c;
+  int bytesRead, n;
 
   bytesRead = 0;
   while (bytesRead < size) {
@@ -1707,33 +2056,13 @@ int CCITTFaxStream::getBlock(char *blk, int size) {
 	break;
       }
     }
-    bitsAvail = codingLine[a0i] - nextCol;
-    byte = (a0i & 1) ? 0x00 : 0xff;
-    if (bitsAvail > 8) {
-      c = byte;
-      bitsAvail -= 8;
-    } else {
-      c = 0;
-      bitsNeeded = 8;
-      do {
-	bitsUsed = (bitsAvail < bitsNeeded) ? bitsAvail : bitsNeeded;
-	c <<= bitsUsed;
-	c |= byte >> (8 - bitsUsed);
-	bitsAvail -= bitsUsed;
-	bitsNeeded -= bitsUsed;
-	if (bitsAvail == 0) {
-	  if (codingLine[a0i] >= columns) {
-	    c <<= bitsNeeded;
-	    break;
-	  }
-	  ++a0i;
-	  bitsAvail = codingLine[a0i] - codingLine[a0i - 1];
-	  byte ^= 0xff;
-	}
-      } while (bitsNeeded > 0);
+    n = rowBytes - (nextCol >> 3);
+    if (n > size - bytesRead) {
+      n = size - bytesRead;
     }
-    nextCol += 8;
-    blk[bytesRead++] = (char)(c ^ blackXOR);
+    memcpy(blk + bytesRead, rowBuf + (nextCol >> 3), n);
+    bytesRead += n;
+    nextCol += n << 3;
   }
   return bytesRead;
 }
@@ -2081,14 +2410,47 @@ GBool CCITTFaxStream::readRow() {
   }
 
   // set up for output
+  expandRow();
   nextCol = 0;
-  a0i = (codingLine[0] > 0) ? 0 : 1;
 
   ++row;
 
   return gTrue;
 }
 
+// Convert the changing elements in codingLine to packed pixels in
+// rowBuf.  The row is filled with black, and then each white run is
+// filled a byte at a time, with masks for the partial bytes at its
+// ends.  (Padding bits in the last byte are black.)
+void CCITTFaxStream::expandRow() {
+  int x0, x1, i, i0, i1, m0, m1, white;
+
+  memset(rowBuf, blackXOR, rowBytes);
+  white = 0xff ^ blackXOR;
+  x0 = 0;
+  for (i = 0; ; ++i) {
+    x1 = codingLine[i];
+    if (!(i & 1) && x1 > x0) {
+      i0 = x0 >> 3;
+      i1 = (x1 - 1) >> 3;
+      m0 = 0xff >> (x0 & 7);
+      m1 = (0xff << (7 - ((x1 - 1) & 7))) & 0xff;
+      if (i0 == i1) {
+	m0 &= m1;
+	rowBuf[i0] = (Guchar)((rowBuf[i0] & ~m0) | (white & m0));
+      } else {
+	rowBuf[i0] = (Guchar)((rowBuf[i0] & ~m0) | (white & m0));
+	memset(rowBuf + i0 + 1, white, i1 - i0 - 1);
+	rowBuf[i1] = (Guchar)((rowBuf[i1] & ~m1) | (white & m1));
+      }
+    }
+    if (x1 >= columns) {
+      break;
+    }
+    x0 = x1;
+  }
+}
+
 short CCITTFaxStream::getTwoDimCode() {
   int code;
   CCITTCode *p;
@@ -2260,11 +2622,12 @@ short CCITTFaxStream::getBlackCode() {
   return 1;
 }
 
-short CCITTFaxStream::lookBits(int n) {
+// Refill the bit buffer for lookBits().
+short CCITTFaxStream::fillBits(int n) {
   int c;
 
   while (inputBits < n) {
-    if ((c = str->getChar()) == EOF) {
+    if ((c = getInputByte()) == EOF) {
       if (inputBits == 0) {
 	return EOF;
       }
@@ -2280,6 +2643,23 @@ short CCITTFaxStream::lookBits(int n) {
   return (short)((inputBuf >> (inputBits - n)) & (0xffffffff >> (32 - n)));
 }
 
+int CCITTFaxStream::getInputByte() {
+  if (inPos < inLen) {
+    return inBuf[inPos++];
+  }
+  // don't read ahead in inline image data -- that could swallow the
+  // EI operator
+  if (str->isEmbedStream()) {
+    return str->getChar();
+  }
+  inPos = 0;
+  if ((inLen = str->getBlock((char *)inBuf, ccittInBufSize)) <= 0) {
+    inLen = 0;
+    return EOF;
+  }
+  return inBuf[inPos++];
+}
+
 GString *CCITTFaxStream::getPSFilter(int psLevel, const char *indent) {
   GString *s;
   char s1[50];
@@ -2330,6 +2710,7 @@ GBool CCITTFaxStream::isBinary(GBool last) {
 DCTStream::DCTStream(Stream *strA, GBool colorXformA):
     FilterStream(strA) {
   colorXform = colorXformA;
+  reduction = 0;
   lineBuf = NULL;
   inlineImage = str->isEmbedStream();
 }
@@ -2373,6 +2754,10 @@ void DCTStream::reset() {
 
   // read the header
   jpeg_read_header(&decomp, TRUE);
+  if (reduction > 0) {
+    decomp.scale_num = 1;
+    decomp.scale_denom = 1 << (reduction < 3 ? reduction : 3);
+  }
   jpeg_calc_output_dimensions(&decomp);
 
   // set up the color transform
@@ -2637,13 +3022,303 @@ static int dctZigZag[64] = {
   63
 };
 
+#if STREAM_SSE2
+
+// Multiply four pairs of 32-bit ints, keeping the low 32 bits of each
+// product (SSE2 has no pmulld).
+static inline __m128i dctMul32(__m128i a, __m128i b) {
+  __m128i even, odd;
+
+  even = _mm_mul_epu32(a, b);
+  odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+			    _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Transpose an 8x8 block of ints: in[h][k] holds row k, columns
+// 4h..4h+3; out[h][k] gets column k, rows 4h..4h+3.
+static inline void dctTranspose(__m128i in[2][8], __m128i out[2][8]) {
+  __m128i t0, t1, t2, t3;
+  int h, k, j;
+
+  for (h = 0; h < 2; ++h) {
+    for (k = 0; k < 8; k += 4) {
+      j = k >> 2;
+      t0 = _mm_unpacklo_epi32(in[j][4*h], in[j][4*h+1]);
+      t1 = _mm_unpacklo_epi32(in[j][4*h+2], in[j][4*h+3]);
+      t2 = _mm_unpackhi_epi32(in[j][4*h], in[j][4*h+1]);
+      t3 = _mm_unpackhi_epi32(in[j][4*h+2], in[j][4*h+3]);
+      out[h][k]   = _mm_unpacklo_epi64(t0, t1);
+      out[h][k+1] = _mm_unpackhi_epi64(t0, t1);
+      out[h][k+2] = _mm_unpacklo_epi64(t2, t3);
+      out[h][k+3] = _mm_unpackhi_epi64(t2, t3);
+    }
+  }
+}
+
+// 1-D inverse DCT on four vectors at once: p[k] holds coefficient k of
+// each of the four vectors.  This is exactly the arithmetic of the
+// scalar code in DCTStream::transformDataUnit.
+static inline void dctIDCT4(__m128i p[8]) {
+  __m128i v0, v1, v2, v3, v4, v5, v6, v7;
+  __m128i t0, t1, t2, t3, t4, t5, t6, t7;
+
+  // stage 4
+  v0 = p[0];
+  v1 = p[4];
+  v2 = p[2];
+  v3 = p[6];
+  v4 = _mm_sub_epi32(p[1], p[7]);
+  v7 = _mm_add_epi32(p[1], p[7]);
+  v5 = p[3];
+  v6 = p[5];
+
+  // stage 3
+  t0 = _mm_sub_epi32(v0, v1);
+  v0 = _mm_add_epi32(v0, v1);
+  v1 = t0;
+  t0 = _mm_add_epi32(v2, _mm_srai_epi32(v2, 5));
+  t1 = _mm_srai_epi32(t0, 2);
+  t2 = _mm_add_epi32(t1, _mm_srai_epi32(v2, 4));
+  t3 = _mm_sub_epi32(t0, t1);
+  t4 = _mm_add_epi32(v3, _mm_srai_epi32(v3, 5));
+  t5 = _mm_srai_epi32(t4, 2);
+  t6 = _mm_add_epi32(t5, _mm_srai_epi32(v3, 4));
+  t7 = _mm_sub_epi32(t4, t5);
+  v2 = _mm_sub_epi32(t2, t7);
+  v3 = _mm_add_epi32(t3, t6);
+  t0 = _mm_sub_epi32(v4, v6);
+  v4 = _mm_add_epi32(v4, v6);
+  v6 = t0;
+  t0 = _mm_add_epi32(v7, v5);
+  v5 = _mm_sub_epi32(v7, v5);
+  v7 = t0;
+
+  // stage 2
+  t0 = _mm_sub_epi32(v0, v3);
+  v0 = _mm_add_epi32(v0, v3);
+  v3 = t0;
+  t0 = _mm_sub_epi32(v1, v2);
+  v1 = _mm_add_epi32(v1, v2);
+  v2 = t0;
+  t0 = _mm_sub_epi32(_mm_srai_epi32(v4, 9), v4);
+  t1 = _mm_srai_epi32(v4, 1);
+  t2 = _mm_sub_epi32(_mm_srai_epi32(t0, 2), t0);
+  t3 = _mm_sub_epi32(_mm_srai_epi32(v7, 9), v7);
+  t4 = _mm_srai_epi32(v7, 1);
+  t5 = _mm_sub_epi32(_mm_srai_epi32(t3, 2), t3);
+  v4 = _mm_sub_epi32(t2, t4);
+  v7 = _mm_add_epi32(t1, t5);
+  t0 = _mm_sub_epi32(_mm_srai_epi32(v5, 3), _mm_srai_epi32(v5, 7));
+  t1 = _mm_sub_epi32(t0, _mm_srai_epi32(v5, 11));
+  t2 = _mm_add_epi32(t0, _mm_srai_epi32(t1, 1));
+  t3 = _mm_sub_epi32(v5, t0);
+  t4 = _mm_sub_epi32(_mm_srai_epi32(v6, 3), _mm_srai_epi32(v6, 7));
+  t5 = _mm_sub_epi32(t4, _mm_srai_epi32(v6, 11));
+  t6 = _mm_add_epi32(t4, _mm_srai_epi32(t5, 1));
+  t7 = _mm_sub_epi32(v6, t4);
+  v5 = _mm_sub_epi32(t3, t6);
+  v6 = _mm_add_epi32(t2, t7);
+
+  // stage 1
+  p[0] = _mm_add_epi32(v0, v7);
+  p[7] = _mm_sub_epi32(v0, v7);
+  p[1] = _mm_add_epi32(v1, v6);
+  p[6] = _mm_sub_epi32(v1, v6);
+  p[2] = _mm_add_epi32(v2, v5);
+  p[5] = _mm_sub_epi32(v2, v5);
+  p[3] = _mm_add_epi32(v3, v4);
+  p[4] = _mm_sub_epi32(v3, v4);
+}
+
+// Compute dctClip(128 + (x >> 13)) for four ints, including the
+// wrap-around of the dctClipData index.
+static inline __m128i dctClip4(__m128i x) {
+  __m128i t;
+
+  t = _mm_add_epi32(_mm_srai_epi32(x, 13),
+		    _mm_set1_epi32(128 + dctClipOffset));
+  t = _mm_sub_epi32(_mm_and_si128(t, _mm_set1_epi32(dctClipMask)),
+		    _mm_set1_epi32(dctClipOffset));
+  // the last entry of dctClipData is zero
+  t = _mm_andnot_si128(_mm_cmpeq_epi32(t, _mm_set1_epi32(639)), t);
+  return t;
+}
+
+// Convert eight YCbCr pixels to RGB.  All values are 16-bit; <cb> and
+// <cr> are centered on zero, and the results are clipped to [0,255].
+// The 16.16 constants are split into a multiple of 65536 plus a
+// 16-bit part, which gives exactly the scalar results.
+static inline void dctYCbCrToRGB8(__m128i y, __m128i cb, __m128i cr,
+				  __m128i *r, __m128i *g, __m128i *b) {
+  __m128i zero, max, rnd, mulR, mulG, mulB, lo, hi;
+
+  zero = _mm_setzero_si128();
+  max = _mm_set1_epi16(255);
+  rnd = _mm_set1_epi32(32768);
+  mulR = _mm_set1_epi32(26345);				// (26345, 0)
+  mulG = _mm_set1_epi32((18734 << 16) | (-22553 & 0xffff));	// (-22553, 18734)
+  mulB = _mm_set1_epi32(-14942 & 0xffff);		// (-14942, 0)
+
+  // dctCrToR = 65536 + 26345
+  lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cr, zero), mulR), rnd);
+  hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cr, zero), mulR), rnd);
+  *r = _mm_add_epi16(_mm_add_epi16(y, cr),
+		     _mm_packs_epi32(_mm_srai_epi32(lo, 16),
+				     _mm_srai_epi32(hi, 16)));
+
+  // dctCbToG = -22553, dctCrToG = -65536 + 18734
+  lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb, cr), mulG), rnd);
+  hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cb, cr), mulG), rnd);
+  *g = _mm_add_epi16(_mm_sub_epi16(y, cr),
+		     _mm_packs_epi32(_mm_srai_epi32(lo, 16),
+				     _mm_srai_epi32(hi, 16)));
+
+  // dctCbToB = 2 * 65536 - 14942
+  lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb, zero), mulB), rnd);
+  hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cb, zero), mulB), rnd);
+  *b = _mm_add_epi16(_mm_add_epi16(y, _mm_add_epi16(cb, cb)),
+		     _mm_packs_epi32(_mm_srai_epi32(lo, 16),
+				     _mm_srai_epi32(hi, 16)));
+
+  *r = _mm_min_epi16(_mm_max_epi16(*r, zero), max);
+  *g = _mm_min_epi16(_mm_max_epi16(*g, zero), max);
+  *b = _mm_min_epi16(_mm_max_epi16(*b, zero), max);
+}
+
+#endif // STREAM_SSE2
+
+// Convert <n> pixels from the YCbCr planes <pY>, <pCb>, <pCr> to
+// interleaved RGB in <out>.  If <pK> is non-NULL, convert YCbCrK to
+// interleaved CMYK instead (K is passed through unchanged).
+static void dctConvertYCbCr(Guchar *pY, Guchar *pCb, Guchar *pCr,
+			    Guchar *pK, Guchar *out, int n) {
+  int y, cb, cr, r, g, b, i;
+#if STREAM_SSE2
+  __m128i zero, c128, max, vY, vCb, vCr, vR, vG, vB, rg, bk;
+  Guchar rgb[3][8];
+  int j;
+#endif
+
+  i = 0;
+#if STREAM_SSE2
+  zero = _mm_setzero_si128();
+  c128 = _mm_set1_epi16(128);
+  max = _mm_set1_epi16(255);
+  for (; i + 8 <= n; i += 8) {
+    vY = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(pY + i)), zero);
+    vCb = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(pCb + i)), zero);
+    vCr = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(pCr + i)), zero);
+    dctYCbCrToRGB8(vY, _mm_sub_epi16(vCb, c128), _mm_sub_epi16(vCr, c128),
+		   &vR, &vG, &vB);
+    if (pK) {
+      vR = _mm_packus_epi16(_mm_sub_epi16(max, vR), zero);
+      vG = _mm_packus_epi16(_mm_sub_epi16(max, vG), zero);
+      vB = _mm_packus_epi16(_mm_sub_epi16(max, vB), zero);
+      rg = _mm_unpacklo_epi8(vR, vG);
+      bk = _mm_unpacklo_epi8(vB, _mm_loadl_epi64((__m128i *)(pK + i)));
+      _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(rg, bk));
+      _mm_storeu_si128((__m128i *)(out + 16), _mm_unpackhi_epi16(rg, bk));
+      out += 32;
+    } else {
+      _mm_storel_epi64((__m128i *)rgb[0], _mm_packus_epi16(vR, zero));
+      _mm_storel_epi64((__m128i *)rgb[1], _mm_packus_epi16(vG, zero));
+      _mm_storel_epi64((__m128i *)rgb[2], _mm_packus_epi16(vB, zero));
+      for (j = 0; j < 8; ++j) {
+	out[0] = rgb[0][j];
+	out[1] = rgb[1][j];
+	out[2] = rgb[2][j];
+	out += 3;
+      }
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    y = pY[i];
+    cb = pCb[i] - 128;
+    cr = pCr[i] - 128;
+    r = ((y << 16) + dctCrToR * cr + 32768) >> 16;
+    g = ((y << 16) + dctCbToG * cb + dctCrToG * cr + 32768) >> 16;
+    b = ((y << 16) + dctCbToB * cb + 32768) >> 16;
+    if (pK) {
+      out[0] = (Guchar)(255 - dctClip(r));
+      out[1] = (Guchar)(255 - dctClip(g));
+      out[2] = (Guchar)(255 - dctClip(b));
+      out[3] = pK[i];
+      out += 4;
+    } else {
+      out[0] = dctClip(r);
+      out[1] = dctClip(g);
+      out[2] = dctClip(b);
+      out += 3;
+    }
+  }
+}
+
+// Same as dctConvertYCbCr, but converts in place in the int planes
+// used in progressive mode.
+static void dctConvertYCbCrInt(int *p0, int *p1, int *p2, GBool invert,
+			       int n) {
+  int y, cb, cr, r, g, b, i;
+#if STREAM_SSE2
+  __m128i zero, c128, max, vY, vCb, vCr, vR, vG, vB;
+#endif
+
+  i = 0;
+#if STREAM_SSE2
+  zero = _mm_setzero_si128();
+  c128 = _mm_set1_epi16(128);
+  max = _mm_set1_epi16(255);
+  for (; i + 8 <= n; i += 8) {
+    vY = _mm_packs_epi32(_mm_loadu_si128((__m128i *)(p0 + i)),
+			 _mm_loadu_si128((__m128i *)(p0 + i + 4)));
+    vCb = _mm_packs_epi32(_mm_loadu_si128((__m128i *)(p1 + i)),
+			  _mm_loadu_si128((__m128i *)(p1 + i + 4)));
+    vCr = _mm_packs_epi32(_mm_loadu_si128((__m128i *)(p2 + i)),
+			  _mm_loadu_si128((__m128i *)(p2 + i + 4)));
+    dctYCbCrToRGB8(vY, _mm_sub_epi16(vCb, c128), _mm_sub_epi16(vCr, c128),
+		   &vR, &vG, &vB);
+    if (invert) {
+      vR = _mm_sub_epi16(max, vR);
+      vG = _mm_sub_epi16(max, vG);
+      vB = _mm_sub_epi16(max, vB);
+    }
+    _mm_storeu_si128((__m128i *)(p0 + i), _mm_unpacklo_epi16(vR, zero));
+    _mm_storeu_si128((__m128i *)(p0 + i + 4), _mm_unpackhi_epi16(vR, zero));
+    _mm_storeu_si128((__m128i *)(p1 + i), _mm_unpacklo_epi16(vG, zero));
+    _mm_storeu_si128((__m128i *)(p1 + i + 4), _mm_unpackhi_epi16(vG, zero));
+    _mm_storeu_si128((__m128i *)(p2 + i), _mm_unpacklo_epi16(vB, zero));
+    _mm_storeu_si128((__m128i *)(p2 + i + 4), _mm_unpackhi_epi16(vB, zero));
+  }
+#endif
+  for (; i < n; ++i) {
+    y = p0[i];
+    cb = p1[i] - 128;
+    cr = p2[i] - 128;
+    r = ((y << 16) + dctCrToR * cr + 32768) >> 16;
+    g = ((y << 16) + dctCbToG * cb + dctCrToG * cr + 32768) >> 16;
+    b = ((y << 16) + dctCbToB * cb + 32768) >> 16;
+    if (invert) {
+      p0[i] = 255 - dctClip(r);
+      p1[i] = 255 - dctClip(g);
+      p2[i] = 255 - dctClip(b);
+    } else {
+      p0[i] = dctClip(r);
+      p1[i] = dctClip(g);
+      p2[i] = dctClip(b);
+    }
+  }
+}
+
 DCTStream::DCTStream(Stream *strA, GBool colorXformA):
     FilterStream(strA) {
   int i;
 
   colorXform = colorXformA;
+  reduction = 0;
   progressive = interleaved = gFalse;
   width = height = 0;
+  outWidth = outHeight = 0;
   mcuWidth = mcuHeight = 0;
   numComps = 0;
   comp = 0;
@@ -2652,6 +3327,7 @@ DCTStream::DCTStream(Stream *strA, GBool colorXformA):
     frameBuf[i] = NULL;
   }
   rowBuf = NULL;
+  planeBuf = NULL;
   memset(dcHuffTables, 0, sizeof(dcHuffTables));
   memset(acHuffTables, 0, sizeof(acHuffTables));
 
@@ -2674,6 +3350,7 @@ void DCTStream::reset() {
 
   progressive = interleaved = gFalse;
   width = height = 0;
+  outWidth = outHeight = 0;
   numComps = 0;
   numQuantTables = 0;
   numDCHuffTables = 0;
@@ -2706,6 +3383,15 @@ void DCTStream::reset() {
   mcuWidth *= 8;
   mcuHeight *= 8;
 
+  // compute the output size
+  if (reduction < 0) {
+    reduction = 0;
+  } else if (reduction > 3) {
+    reduction = 3;
+  }
+  outWidth = (width + (1 << reduction) - 1) >> reduction;
+  outHeight = (height + (1 << reduction) - 1) >> reduction;
+
   // figure out color transform
   if (colorXform == -1) {
     if (numComps == 3) {
@@ -2764,6 +3450,9 @@ void DCTStream::reset() {
     // allocate a buffer for one row of MCUs
     bufWidth = ((width + mcuWidth - 1) / mcuWidth) * mcuWidth;
     rowBuf = (Guchar *)gmallocn(numComps * mcuHeight, bufWidth);
+    if (colorXform && (numComps == 3 || numComps == 4)) {
+      planeBuf = (Guchar *)gmallocn(numComps * mcuHeight, bufWidth);
+    }
     rowBufPtr = rowBufEnd = rowBuf;
 
     // initialize counters
@@ -2783,6 +3472,8 @@ void DCTStream::close() {
   }
   gfree(rowBuf);
   rowBuf = NULL;
+  gfree(planeBuf);
+  planeBuf = NULL;
   FilterStream::close();
 }
 
@@ -2790,13 +3481,13 @@ int DCTStream::getChar() {
   int c;
 
   if (progressive || !interleaved) {
-    if (y >= height) {
+    if (y >= outHeight) {
       return EOF;
     }
     c = frameBuf[comp][y * bufWidth + x];
     if (++comp == numComps) {
       comp = 0;
-      if (++x == width) {
+      if (++x == outWidth) {
 	x = 0;
 	++y;
       }
@@ -2819,7 +3510,7 @@ int DCTStream::getChar() {
 
 int DCTStream::lookChar() {
   if (progressive || !interleaved) {
-    if (y >= height) {
+    if (y >= outHeight) {
       return EOF;
     }
     return frameBuf[comp][y * bufWidth + x];
@@ -2841,17 +3532,17 @@ int DCTStream::getBlock(char *blk, int size) {
   int nRead, nAvail, n;
 
   if (progressive || !interleaved) {
-    if (y >= height) {
+    if (y >= outHeight) {
       return 0;
     }
     for (nRead = 0; nRead < size; ++nRead) {
       blk[nRead] = (char)frameBuf[comp][y * bufWidth + x];
       if (++comp == numComps) {
 	comp = 0;
-	if (++x == width) {
+	if (++x == outWidth) {
 	  x = 0;
 	  ++y;
-	  if (y >= height) {
+	  if (y >= outHeight) {
 	    ++nRead;
 	    break;
 	  }
@@ -2895,11 +3586,11 @@ void DCTStream::restart() {
 // Read one row of MCUs from a sequential JPEG stream.
 GBool DCTStream::readMCURow() {
   int data1[64];
-  Guchar data2[64];
-  Guchar *p1, *p2;
-  int pY, pCb, pCr, pR, pG, pB;
+  Guchar data2[256];
+  Guchar *dst, *p1, *p2;
   int h, v, horiz, vert, hSub, vSub;
-  int x1, x2, y2, x3, y3, x4, y4, x5, y5, cc, i;
+  int x1, x2, y2, x3, y3, x4, y4, x5, y5, xr, yr, cc, i;
+  int step, planeSize, nRows, nW, nH;
   int c;
 
   for (cc = 0; cc < numComps; ++cc) {
@@ -2916,6 +3607,12 @@ GBool DCTStream::readMCURow() {
     }
   }
 
+  // with a color transform, the components are decoded into separate
+  // planes, and converted into rowBuf at the end
+  nRows = mcuHeight >> reduction;
+  planeSize = outWidth * nRows;
+  step = planeBuf ? 1 : numComps;
+
   for (x1 = 0; x1 < width; x1 += mcuWidth) {
 
     // deal with restart marker
@@ -2939,6 +3636,7 @@ GBool DCTStream::readMCURow() {
       vert = mcuHeight / v;
       hSub = horiz / 8;
       vSub = vert / 8;
+      dst = planeBuf ? planeBuf + cc * planeSize : rowBuf + cc;
       for (y2 = 0; y2 < mcuHeight; y2 += vert) {
 	for (x2 = 0; x2 < mcuWidth; x2 += horiz) {
 	  if (!readDataUnit(&dcHuffTables[scanInfo.dcHuffTable[cc]],
@@ -2947,49 +3645,62 @@ GBool DCTStream::readMCURow() {
 			    data1)) {
 	    return gFalse;
 	  }
+	  if (reduction) {
+	    reduceDataUnit(quantTables[compInfo[cc].quantTable], data1,
+			   hSub, vSub, data2, &nW, &nH);
+	    xr = (x1 + x2) >> reduction;
+	    yr = y2 >> reduction;
+	    for (y3 = 0, i = 0; y3 < nH; ++y3, i += nW) {
+	      p1 = &dst[((yr + y3) * outWidth + xr) * step];
+	      for (x3 = 0; x3 < nW && xr + x3 < outWidth; ++x3) {
+		p1[x3 * step] = data2[i + x3];
+	      }
+	    }
+	    continue;
+	  }
 	  transformDataUnit(quantTables[compInfo[cc].quantTable],
 			    data1, data2);
 	  if (hSub == 1 && vSub == 1 && x1+x2+8 <= width) {
 	    for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
-	      p1 = &rowBuf[((y2+y3) * width + (x1+x2)) * numComps + cc];
-	      p1[0]          = data2[i];
-	      p1[  numComps] = data2[i+1];
-	      p1[2*numComps] = data2[i+2];
-	      p1[3*numComps] = data2[i+3];
-	      p1[4*numComps] = data2[i+4];
-	      p1[5*numComps] = data2[i+5];
-	      p1[6*numComps] = data2[i+6];
-	      p1[7*numComps] = data2[i+7];
+	      p1 = &dst[((y2+y3) * width + (x1+x2)) * step];
+	      p1[0]      = data2[i];
+	      p1[  step] = data2[i+1];
+	      p1[2*step] = data2[i+2];
+	      p1[3*step] = data2[i+3];
+	      p1[4*step] = data2[i+4];
+	      p1[5*step] = data2[i+5];
+	      p1[6*step] = data2[i+6];
+	      p1[7*step] = data2[i+7];
 	    }
 	  } else if (hSub == 2 && vSub == 2 && x1+x2+16 <= width) {
 	    for (y3 = 0, i = 0; y3 < 16; y3 += 2, i += 8) {
-	      p1 = &rowBuf[((y2+y3) * width + (x1+x2)) * numComps + cc];
-	      p2 = p1 + width * numComps;
-	      p1[0] = p1[numComps] =
-		p2[0] = p2[numComps] = data2[i];
-	      p1[2*numComps] = p1[3*numComps] =
-		p2[2*numComps] = p2[3*numComps] = data2[i+1];
-	      p1[4*numComps] = p1[5*numComps] =
-		p2[4*numComps] = p2[5*numComps] = data2[i+2];
-	      p1[6*numComps] = p1[7*numComps] =
-		p2[6*numComps] = p2[7*numComps] = data2[i+3];
-	      p1[8*numComps] = p1[9*numComps] =
-		p2[8*numComps] = p2[9*numComps] = data2[i+4];
-	      p1[10*numComps] = p1[11*numComps] =
-		p2[10*numComps] = p2[11*numComps] = data2[i+5];
-	      p1[12*numComps] = p1[13*numComps] =
-		p2[12*numComps] = p2[13*numComps] = data2[i+6];
-	      p1[14*numComps] = p1[15*numComps] =
-		p2[14*numComps] = p2[15*numComps] = data2[i+7];
+	      p1 = &dst[((y2+y3) * width + (x1+x2)) * step];
+	      p2 = p1 + width * step;
+	      p1[0] = p1[step] =
+		p2[0] = p2[step] = data2[i];
+	      p1[2*step] = p1[3*step] =
+		p2[2*step] = p2[3*step] = data2[i+1];
+	      p1[4*step] = p1[5*step] =
+		p2[4*step] = p2[5*step] = data2[i+2];
+	      p1[6*step] = p1[7*step] =
+		p2[6*step] = p2[7*step] = data2[i+3];
+	      p1[8*step] = p1[9*step] =
+		p2[8*step] = p2[9*step] = data2[i+4];
+	      p1[10*step] = p1[11*step] =
+		p2[10*step] = p2[11*step] = data2[i+5];
+	      p1[12*step] = p1[13*step] =
+		p2[12*step] = p2[13*step] = data2[i+6];
+	      p1[14*step] = p1[15*step] =
+		p2[14*step] = p2[15*step] = data2[i+7];
 	    }
 	  } else {
-	    p1 = &rowBuf[(y2 * width + (x1+x2)) * numComps + cc];
+	    p1 = &dst[(y2 * width + (x1+x2)) * step];
 	    i = 0;
 	    for (y3 = 0, y4 = 0; y3 < 8; ++y3, y4 += vSub) {
 	      for (x3 = 0, x4 = 0; x3 < 8; ++x3, x4 += hSub) {
 		for (y5 = 0; y5 < vSub; ++y5) {
 		  for (x5 = 0; x5 < hSub && x1+x2+x4+x5 < width; ++x5) {
-		    p1[((y4+y5) * width + (x4+x5)) * numComps] = data2[i];
+		    p1[((y4+y5) * width + (x4+x5)) * step] = data2[i];
 		  }
 		}
 		++i;
@@ -3002,42 +3713,19 @@ GBool DCTStream::readMCURow() {
     --restartCtr;
   }
 
-  // color space conversion
-  if (colorXform) {
-    // convert YCbCr to RGB
-    if (numComps == 3) {
-      for (i = 0, p1 = rowBuf; i < width * mcuHeight; ++i, p1 += 3) {
-	pY = p1[0];
-	pCb = p1[1] - 128;
-	pCr = p1[2] - 128;
-	pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	p1[0] = dctClip(pR);
-	pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr + 32768) >> 16;
-	p1[1] = dctClip(pG);
-	pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	p1[2] = dctClip(pB);
-      }
-    // convert YCbCrK to CMYK (K is passed through unchanged)
-    } else if (numComps == 4) {
-      for (i = 0, p1 = rowBuf; i < width * mcuHeight; ++i, p1 += 4) {
-	pY = p1[0];
-	pCb = p1[1] - 128;
-	pCr = p1[2] - 128;
-	pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	p1[0] = (Guchar)(255 - dctClip(pR));
-	pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr + 32768) >> 16;
-	p1[1] = (Guchar)(255 - dctClip(pG));
-	pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	p1[2] = (Guchar)(255 - dctClip(pB));
-      }
-    }
+  // color space conversion: YCbCr to RGB, or YCbCrK to CMYK (K is
+  // passed through unchanged)
+  if (planeBuf) {
+    dctConvertYCbCr(planeBuf, planeBuf + planeSize, planeBuf + 2 * planeSize,
+		    numComps == 4 ? planeBuf + 3 * planeSize : (Guchar *)NULL,
+		    rowBuf, planeSize);
   }
 
   rowBufPtr = rowBuf;
   if (y + mcuHeight <= height) {
-    rowBufEnd = rowBuf + numComps * width * mcuHeight;
+    rowBufEnd = rowBuf + numComps * planeSize;
   } else {
-    rowBufEnd = rowBuf + numComps * width * (height - y);
+    rowBufEnd = rowBuf + numComps * outWidth * (outHeight - (y >> reduction));
   }
 
   return gTrue;
@@ -3361,12 +4049,11 @@ GBool DCTStream::readProgressiveDataUnit(DCTHuffTable *dcHuffTable,
 // Decode a progressive JPEG image.
 void DCTStream::decodeImage() {
   int dataIn[64];
-  Guchar dataOut[64];
-  Gushort *quantTable;
-  int pY, pCb, pCr, pR, pG, pB;
-  int x1, y1, x2, y2, x3, y3, x4, y4, x5, y5, cc, i;
+  Guchar dataOut[256];
+  int *quantTable;
+  int x1, y1, x2, y2, x3, y3, x4, y4, x5, y5, xr, yr, nW, nH, cc, i, n;
   int h, v, horiz, vert, hSub, vSub;
-  int *p0, *p1, *p2;
+  int *p1, *p2;
 
   for (y1 = 0; y1 < bufHeight; y1 += mcuHeight) {
     for (x1 = 0; x1 < bufWidth; x1 += mcuWidth) {
@@ -3395,6 +4082,22 @@ void DCTStream::decodeImage() {
 	      p1 += bufWidth * vSub;
 	    }
 
+	    // reduced resolution: store the smaller data unit at its
+	    // scaled-down position -- this only overwrites coefficients
+	    // that have already been transformed
+	    if (reduction) {
+	      reduceDataUnit(quantTable, dataIn, hSub, vSub, dataOut, &nW, &nH);
+	      xr = (x1 + x2) >> reduction;
+	      yr = (y1 + y2) >> reduction;
+	      for (y3 = 0, i = 0; y3 < nH; ++y3, i += nW) {
+		p1 = &frameBuf[cc][(yr + y3) * bufWidth + xr];
+		for (x3 = 0; x3 < nW; ++x3) {
+		  p1[x3] = dataOut[i + x3];
+		}
+	      }
+	      continue;
+	    }
+
 	    // transform
 	    transformDataUnit(quantTable, dataIn, dataOut);
 
@@ -3448,45 +4151,14 @@ void DCTStream::decodeImage() {
       }
 
       // color space conversion
-      if (colorXform) {
-	// convert YCbCr to RGB
-	if (numComps == 3) {
-	  for (y2 = 0; y2 < mcuHeight; ++y2) {
-	    p0 = &frameBuf[0][(y1+y2) * bufWidth + x1];
-	    p1 = &frameBuf[1][(y1+y2) * bufWidth + x1];
-	    p2 = &frameBuf[2][(y1+y2) * bufWidth + x1];
-	    for (x2 = 0; x2 < mcuWidth; ++x2) {
-	      pY = *p0;
-	      pCb = *p1 - 128;
-	      pCr = *p2 - 128;
-	      pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	      *p0++ = dctClip(pR);
-	      pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr +
-		    32768) >> 16;
-	      *p1++ = dctClip(pG);
-	      pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	      *p2++ = dctClip(pB);
-	    }
-	  }
-	// convert YCbCrK to CMYK (K is passed through unchanged)
-	} else if (numComps == 4) {
-	  for (y2 = 0; y2 < mcuHeight; ++y2) {
-	    p0 = &frameBuf[0][(y1+y2) * bufWidth + x1];
-	    p1 = &frameBuf[1][(y1+y2) * bufWidth + x1];
-	    p2 = &frameBuf[2][(y1+y2) * bufWidth + x1];
-	    for (x2 = 0; x2 < mcuWidth; ++x2) {
-	      pY = *p0;
-	      pCb = *p1 - 128;
-	      pCr = *p2 - 128;
-	      pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	      *p0++ = 255 - dctClip(pR);
-	      pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr +
-		    32768) >> 16;
-	      *p1++ = 255 - dctClip(pG);
-	      pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	      *p2++ = 255 - dctClip(pB);
-	    }
-	  }
+      if (colorXform && (numComps == 3 || numComps == 4)) {
+	xr = x1 >> reduction;
+	yr = y1 >> reduction;
+	n = mcuWidth >> reduction;
+	for (y2 = 0; y2 < (mcuHeight >> reduction); ++y2) {
+	  i = (yr + y2) * bufWidth + xr;
+	  dctConvertYCbCrInt(frameBuf[0] + i, frameBuf[1] + i, frameBuf[2] + i,
+			     numComps == 4, n);
 	}
       }
     }
@@ -3506,24 +4178,66 @@ void DCTStream::decodeImage() {
 //   988-991.
 // The stage numbers mentioned in the comments refer to Figure 1 in the
 // Loeffler paper.
-void DCTStream::transformDataUnit(Gushort *quantTable,
+void DCTStream::transformDataUnit(int *quantTable,
 				  int dataIn[64], Guchar dataOut[64]) {
+#if STREAM_SSE2
+  __m128i rows[2][8], cols[2][8];
+  int h, k;
+#else
   int v0, v1, v2, v3, v4, v5, v6, v7;
   int t0, t1, t2, t3, t4, t5, t6, t7;
-  int *p, *scale;
-  Gushort *q;
+  int *p, *q;
+#endif
   int i;
 
+  // check for a DC-only data unit -- the output is flat
+  for (i = 1; i < 64 && !dataIn[i]; ++i) ;
+  if (i == 64) {
+    memset(dataOut, dctClip(128 + ((dataIn[0] * quantTable[0] + (1 << 12))
+				   >> 13)),
+	   64);
+    return;
+  }
+
+#if STREAM_SSE2
+  // dequant
+  for (k = 0; k < 8; ++k) {
+    for (h = 0; h < 2; ++h) {
+      rows[h][k] = dctMul32(_mm_loadu_si128((__m128i *)&dataIn[8*k + 4*h]),
+			    _mm_loadu_si128((__m128i *)&quantTable[8*k + 4*h]));
+    }
+  }
+  rows[0][0] = _mm_add_epi32(rows[0][0], _mm_setr_epi32(1 << 12, 0, 0, 0));
+
+  // inverse DCT on rows
+  dctTranspose(rows, cols);
+  dctIDCT4(cols[0]);
+  dctIDCT4(cols[1]);
+
+  // inverse DCT on columns
+  dctTranspose(cols, rows);
+  dctIDCT4(rows[0]);
+  dctIDCT4(rows[1]);
+
+  // convert to 8-bit integers
+  for (k = 0; k < 8; k += 2) {
+    _mm_storeu_si128((__m128i *)&dataOut[8*k],
+		     _mm_packus_epi16(
+			 _mm_packs_epi32(dctClip4(rows[0][k]),
+					 dctClip4(rows[1][k])),
+			 _mm_packs_epi32(dctClip4(rows[0][k+1]),
+					 dctClip4(rows[1][k+1]))));
+  }
+#else
   // dequant; inverse DCT on rows
   for (i = 0; i < 64; i += 8) {
     p = dataIn + i;
     q = quantTable + i;
-    scale = idctScaleMat + i;
 
     // check for all-zero AC coefficients
     if (p[1] == 0 && p[2] == 0 && p[3] == 0 &&
 	p[4] == 0 && p[5] == 0 && p[6] == 0 && p[7] == 0) {
-      t0 = p[0] * q[0] * scale[0];
+      t0 = p[0] * q[0];
       if (i == 0) {
 	t0 += 1 << 12;		// rounding bias
       }
@@ -3539,19 +4253,19 @@ void DCTStream::transformDataUnit(Gushort *quantTable,
     }
 
     // stage 4
-    v0 = p[0] * q[0] * scale[0];
+    v0 = p[0] * q[0];
     if (i == 0) {
       v0 += 1 << 12;		// rounding bias
     }
-    v1 = p[4] * q[4] * scale[4];
-    v2 = p[2] * q[2] * scale[2];
-    v3 = p[6] * q[6] * scale[6];
-    t0 = p[1] * q[1] * scale[1];
-    t1 = p[7] * q[7] * scale[7];
+    v1 = p[4] * q[4];
+    v2 = p[2] * q[2];
+    v3 = p[6] * q[6];
+    t0 = p[1] * q[1];
+    t1 = p[7] * q[7];
     v4 = t0 - t1;
     v7 = t0 + t1;
-    v5 = p[3] * q[3] * scale[3];
-    v6 = p[5] * q[5] * scale[5];
+    v5 = p[3] * q[3];
+    v6 = p[5] * q[5];
 
     // stage 3
     t0 = v0 - v1;
@@ -3703,6 +4417,89 @@ void DCTStream::transformDataUnit(Gushort *quantTable,
   for (i = 0; i < 64; ++i) {
     dataOut[i] = dctClip(128 + (dataIn[i] >> 13));
   }
+#endif
+}
+
+// Transform one data unit at the reduced resolution.  The data unit
+// covers (8 * hSub) x (8 * vSub) pixels at full resolution; each value
+// stored in <dataOut> is the average of the samples under one reduced
+// pixel.  Sets *<nW> x *<nH> to the size of the reduced data unit.
+void DCTStream::reduceDataUnit(int *quantTable, int dataIn[64],
+			       int hSub, int vSub, Guchar dataOut[256],
+			       int *nW, int *nH) {
+  Guchar block[64];
+  Guchar *p;
+  int scale, w, h, bw, bh, shift, x0, x1, y0, y1, xo, yo, xx, yy, sum;
+
+  scale = 1 << reduction;
+  w = (8 * hSub) / scale;
+  h = (8 * vSub) / scale;
+  *nW = w;
+  *nH = h;
+
+  // one value for the whole data unit: just the DC coefficient
+  if (w == 1 && h == 1) {
+    dataOut[0] = dctClip(128 + ((dataIn[0] * quantTable[0] + (1 << 12))
+				>> 13));
+    return;
+  }
+
+  transformDataUnit(quantTable, dataIn, block);
+
+  // the usual case: each reduced pixel averages a bw x bh box of
+  // samples, where bw * bh is a power of two
+  if (scale % hSub == 0 && scale % vSub == 0) {
+    bw = scale / hSub;
+    bh = scale / vSub;
+    for (shift = 0; (1 << shift) < bw * bh; ++shift) ;
+    if (shift == 0) {
+      memcpy(dataOut, block, 64);
+    } else if (bw == 2 && bh == 2) {
+      for (yo = 0, p = block; yo < 4; ++yo, p += 16) {
+	for (xo = 0; xo < 4; ++xo) {
+	  dataOut[yo * 4 + xo] = (Guchar)((p[2*xo] + p[2*xo + 1] +
+					   p[2*xo + 8] + p[2*xo + 9] + 2)
+					  >> 2);
+	}
+      }
+    } else {
+      for (yo = 0; yo < h; ++yo) {
+	for (xo = 0; xo < w; ++xo) {
+	  p = &block[yo * bh * 8 + xo * bw];
+	  sum = 1 << (shift - 1);
+	  for (yy = 0; yy < bh; ++yy) {
+	    for (xx = 0; xx < bw; ++xx) {
+	      sum += p[yy * 8 + xx];
+	    }
+	  }
+	  dataOut[yo * w + xo] = (Guchar)(sum >> shift);
+	}
+      }
+    }
+    return;
+  }
+
+  // odd sampling factors: boxes of varying size
+  for (yo = 0; yo < h; ++yo) {
+    y0 = (yo * scale) / vSub;
+    if ((y1 = ((yo + 1) * scale) / vSub) <= y0) {
+      y1 = y0 + 1;
+    }
+    for (xo = 0; xo < w; ++xo) {
+      x0 = (xo * scale) / hSub;
+      if ((x1 = ((xo + 1) * scale) / hSub) <= x0) {
+	x1 = x0 + 1;
+      }
+      sum = 0;
+      for (yy = y0; yy < y1; ++yy) {
+	for (xx = x0; xx < x1; ++xx) {
+	  sum += block[yy * 8 + xx];
+	}
+      }
+      sum += ((y1 - y0) * (x1 - x0)) >> 1;
+      dataOut[yo * w + xo] = (Guchar)(sum / ((y1 - y0) * (x1 - x0)));
+    }
+  }
 }
 
 int DCTStream::readHuffSym(DCTHuffTable *table) {
@@ -4036,6 +4833,7 @@ GBool DCTStream::readQuantTables() {
       } else {
 	quantTables[index][dctZigZag[i]] = (Gushort)str->getChar();
       }
+      quantTables[index][dctZigZag[i]] *= idctScaleMat[dctZigZag[i]];
     }
     if (prec) {
       length -= 129;
@@ -4983,12 +5781,8 @@ int FlateStream::getRawChar() {
   return c;
 }
 
-int FlateStream::getBlock(char *blk, int size) {
-  int n;
-
-  if (pred) {
-    return pred->getBlock(blk, size);
-  }
+int FlateStream::getRawBlock(char *blk, int size) {
+  int n, m;
 
   n = 0;
   while (n < size) {
@@ -4997,16 +5791,31 @@ int FlateStream::getBlock(char *blk, int size) {
 	break;
       }
       readSome();
+      continue;
+    }
+    // copy up to the end of the output window, then wrap around
+    m = remain;
+    if (m > (int)(flateWindow - index)) {
+      m = (int)(flateWindow - index);
     }
-    while (remain && n < size) {
-      blk[n++] = buf[index];
-      index = (index + 1) & flateMask;
-      --remain;
+    if (m > size - n) {
+      m = size - n;
     }
+    memcpy(blk + n, buf + index, m);
+    index = (index + m) & flateMask;
+    remain -= m;
+    n += m;
   }
   return n;
 }
 
+int FlateStream::getBlock(char *blk, int size) {
+  if (pred) {
+    return pred->getBlock(blk, size);
+  }
+  return getRawBlock(blk, size);
+}
+
 GString *FlateStream::getPSFilter(int psLevel, const char *indent) {
   GString *s;
 
@@ -5407,6 +6216,29 @@ int BufStream::lookChar() {
   return buf[0];
 }
 
+int BufStream::getBlock(char *blk, int size) {
+  int n, i;
+
+  // chars in the look-ahead buffer come first
+  for (n = 0; n < size && n < bufSize && buf[n] != EOF; ++n) {
+    blk[n] = (char)buf[n];
+  }
+  if (n < bufSize) {
+    for (i = n; i < bufSize; ++i) {
+      buf[i - n] = buf[i];
+    }
+    for (i = bufSize - n; i < bufSize; ++i) {
+      buf[i] = str->getChar();
+    }
+    return n;
+  }
+  n += str->getBlock(blk + n, size - n);
+  for (i = 0; i < bufSize; ++i) {
+    buf[i] = str->getChar();
+  }
+  return n;
+}
+
 int BufStream::lookChar(int idx) {
   return buf[idx];
 }
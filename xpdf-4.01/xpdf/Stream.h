@@ -96,6 +96,11 @@ public:
   // This is only used by StreamPredictor.
   virtual int getRawChar();
 
+  // Get a block of chars from stream without using the predictor.
+  // Returns the number of bytes read, which will be less than <size>
+  // only at EOF.  This is only used by StreamPredictor.
+  virtual int getRawBlock(char *blk, int size);
+
   // Get exactly <size> bytes from stream.  Returns the number of
   // bytes read -- the returned count will be less than <size> at EOF.
   virtual int getBlock(char *blk, int size);
@@ -289,6 +294,8 @@ private:
   int pixBytes;			// bytes per pixel
   int rowBytes;			// bytes per line
   Guchar *predLine;		// line buffer
+  Guchar *prevLine;		// previous line, for the PNG up, average,
+				//   and Paeth predictors
   int predIdx;			// current index in predLine
   GBool ok;
 };
@@ -422,6 +429,7 @@ public:
   virtual int getChar()
     { int c = lookChar(); buf = EOF; return c; }
   virtual int lookChar();
+  virtual int getBlock(char *blk, int size);
   virtual GString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
@@ -435,6 +443,8 @@ private:
 // ASCII85Stream
 //------------------------------------------------------------------------
 
+#define ascii85InBufSize 1280
+
 class ASCII85Stream: public FilterStream {
 public:
 
@@ -446,21 +456,29 @@ public:
   virtual int getChar()
     { int ch = lookChar(); ++index; return ch; }
   virtual int lookChar();
+  virtual int getBlock(char *blk, int size);
   virtual GString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
 private:
 
+  int getInChar()
+    { return inPos < inLen ? inBuf[inPos++] : str->getChar(); }
+
   int c[5];
   int b[4];
   int index, n;
   GBool eof;
+  Guchar inBuf[ascii85InBufSize];	// input read ahead by getBlock()
+  int inPos, inLen;
 };
 
 //------------------------------------------------------------------------
 // LZWStream
 //------------------------------------------------------------------------
 
+#define lzwInBufSize 256
+
 class LZWStream: public FilterStream {
 public:
 
@@ -474,6 +492,7 @@ public:
   virtual int lookChar();
   virtual int getRawChar();
   virtual int getBlock(char *blk, int size);
+  virtual int getRawBlock(char *blk, int size);
   virtual GString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
@@ -482,25 +501,29 @@ private:
   StreamPredictor *pred;	// predictor
   int early;			// early parameter
   GBool eof;			// true if at eof
-  int inputBuf;			// input buffer
-  int inputBits;		// number of bits in input buffer
-  struct {			// decoding table
+  Guchar inBuf[lzwInBufSize];	// input read ahead from str
+  int inPos, inLen;		// position/length of data in inBuf
+  int inputBuf;			// input bit buffer
+  int inputBits;		// number of bits in input bit buffer
+  struct {			// decoding table -- each entry is a
+    int offset;			//   span of hist
     int length;
-    int head;
-    Guchar tail;
   } table[4097];
   int nextCode;			// next code to be used
   int nextBits;			// number of bits in next code word
-  int prevCode;			// previous code used in stream
   int newChar;			// next char to be added to table
-  Guchar seqBuf[4097];		// buffer for current sequence
-  int seqLength;		// length of current sequence
-  int seqIndex;			// index into current sequence
+  Guchar *hist;			// all output since the last table clear
+  int histSize;			// size of hist buffer
+  int histLength;		// number of bytes in hist
+  int histIndex;		// index of next byte to return from hist
+  int prevOffset;		// span of hist holding the output of the
+  int prevLength;		//   previous code
   GBool first;			// first code after a table clear
 
   GBool processNextCode();
   void clearTable();
   int getCode();
+  GBool fillInputBuf();
 };
 
 //------------------------------------------------------------------------
@@ -539,6 +562,8 @@ private:
 #ifndef NO_CCITT_STREAM
 struct CCITTCodeTable;
 
+#define ccittInBufSize 256
+
 class CCITTFaxStream: public FilterStream {
 public:
 
@@ -568,10 +593,14 @@ private:
   GBool eof;			// true if at eof
   GBool nextLine2D;		// true if next line uses 2D encoding
   int row;			// current row
-  Guint inputBuf;		// input buffer
-  int inputBits;		// number of bits in input buffer
+  Guchar inBuf[ccittInBufSize];	// input read ahead from str
+  int inPos, inLen;		// position/length of data in inBuf
+  Guint inputBuf;		// input bit buffer
+  int inputBits;		// number of bits in input bit buffer
   int *codingLine;		// coding line changing elements
   int *refLine;			// reference line changing elements
+  Guchar *rowBuf;		// current row, expanded to packed pixels
+  int rowBytes;			// size of rowBuf
   int nextCol;			// next column to read
   int a0i;			// index into codingLine
   GBool err;			// error on current line
@@ -580,10 +609,16 @@ private:
   void addPixels(int a1, int blackPixels);
   void addPixelsNeg(int a1, int blackPixels);
   GBool readRow();
+  void expandRow();
   short getTwoDimCode();
   short getWhiteCode();
   short getBlackCode();
-  short lookBits(int n);
+  short lookBits(int n)
+    { return inputBits >= n
+	       ? (short)((inputBuf >> (inputBits - n)) & (0xffffffff >> (32 - n)))
+	       : fillBits(n); }
+  short fillBits(int n);
+  int getInputByte();
   void eatBits(int n) { if ((inputBits -= n) < 0) inputBits = 0; }
 };
 #endif
@@ -655,8 +690,17 @@ public:
   virtual GBool isBinary(GBool last = gTrue);
   Stream *getRawStream() { return str; }
 
+  // Decode at 1/2, 1/4, or 1/8 of the full resolution (<reductionA> =
+  // 1, 2, or 3) -- at 1/8, non-subsampled components need only their
+  // DC coefficients.  The output is ceil(width / 2^reductionA) x
+  // ceil(height / 2^reductionA) pixels.  This must be called before
+  // reset().
+  void reduceResolution(int reductionA) { reduction = reductionA; }
+
 private:
 
+  int reduction;		// log2(reduction in resolution)
+
 #if HAVE_JPEGLIB
 
   int colorXform;		// color transform: -1 = unspecified
@@ -686,6 +730,7 @@ private:
   GBool progressive;		// set if in progressive mode
   GBool interleaved;		// set if in interleaved mode
   int width, height;		// image size
+  int outWidth, outHeight;	// output image size (after reduction)
   int mcuWidth, mcuHeight;	// size of min coding unit, in data units
   int bufWidth, bufHeight;	// frameBuf size
   DCTCompInfo compInfo[4];	// info for each component
@@ -697,13 +742,16 @@ private:
   GBool gotJFIFMarker;		// set if APP0 JFIF marker was present
   GBool gotAdobeMarker;		// set if APP14 Adobe marker was present
   int restartInterval;		// restart interval, in MCUs
-  Gushort quantTables[4][64];	// quantization tables
+  int quantTables[4][64];	// quantization tables, premultiplied by
+				//   the IDCT scale factors
   int numQuantTables;		// number of quantization tables
   DCTHuffTable dcHuffTables[4];	// DC Huffman tables
   DCTHuffTable acHuffTables[4];	// AC Huffman tables
   int numDCHuffTables;		// number of DC Huffman tables
   int numACHuffTables;		// number of AC Huffman tables
   Guchar *rowBuf;
+  Guchar *planeBuf;		// per-component planes for one MCU row,
+				//   used when converting colors
   Guchar *rowBufPtr;		// current position within rowBuf
   Guchar *rowBufEnd;		// end of valid data in rowBuf
   int *frameBuf[4];		// buffer for frame (progressive mode)
@@ -724,8 +772,11 @@ private:
 				DCTHuffTable *acHuffTable,
 				int *prevDC, int data[64]);
   void decodeImage();
-  void transformDataUnit(Gushort *quantTable,
+  void transformDataUnit(int *quantTable,
 			 int dataIn[64], Guchar dataOut[64]);
+  void reduceDataUnit(int *quantTable, int dataIn[64],
+		      int hSub, int vSub, Guchar dataOut[256],
+		      int *nW, int *nH);
   int readHuffSym(DCTHuffTable *table);
   int readAmp(int size);
   int readBit();
@@ -785,6 +836,7 @@ public:
   virtual int getChar();
   virtual int lookChar();
   virtual int getRawChar();
+  virtual int getRawBlock(char *blk, int size);
   virtual int getBlock(char *blk, int size);
   virtual GString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
@@ -860,6 +912,7 @@ public:
   virtual void reset();
   virtual int getChar();
   virtual int lookChar();
+  virtual int getBlock(char *blk, int size);
   virtual GString *getPSFilter(int psLevel, const char *indent)
     { return NULL; }
   virtual GBool isBinary(GBool last = gTrue);
@@ -16,6 +16,7 @@
 #include "gmempp.h"
 #include "GList.h"
 #include "GMutex.h"
+#include "GThread.h"
 #ifdef _WIN32
 #  include <windows.h>
 #else
@@ -51,11 +52,16 @@ public:
     TileDesc(tile->page, tile->rotate, tile->dpi,
 	     tile->tx, tile->ty, tile->tw, tile->th),
     state(cachedTileUnstarted), active(gTrue),
+    priority(0), prefetch(gFalse),
     bitmap(NULL), freeBitmap(gFalse) {}
   ~CachedTileDesc();
 
   CachedTileState state;
   GBool active;
+  int priority;			// rasterization order of active tiles
+				//   (lowest first)
+  GBool prefetch;		// set if this is a prefetch tile, i.e.,
+				//   not (yet) visible
   SplashBitmap *bitmap;
   GBool freeBitmap;
 };
@@ -67,7 +73,7 @@ CachedTileDesc::~CachedTileDesc() {
 }
 
 //------------------------------------------------------------------------
-// OS-dependent threading support code
+// OS-dependent condition support code (threads are in GThread.h)
 //
 // NB: This wrapper code is not meant to be general purpose.  Pthreads
 // condition objects are not equivalent to Windows event objects, in
@@ -77,20 +83,6 @@ CachedTileDesc::~CachedTileDesc() {
 //-------------------- Windows --------------------
 #ifdef _WIN32
 
-typedef HANDLE GThreadID;
-typedef DWORD (WINAPI *GThreadFunc)(void *);
-#define GThreadReturn DWORD WINAPI
-
-static void gCreateThread(GThreadID *thr, GThreadFunc threadFunc,
-			  void *data) {
-  *thr = CreateThread(NULL, 0, threadFunc, data, 0, NULL);
-}
-   
-static void gJoinThread(GThreadID thr) {
-  WaitForSingleObject(thr, INFINITE);
-  CloseHandle(thr);
-}
-
 typedef HANDLE GCondition;
 
 static void gInitCondition(GCondition *c) {
@@ -118,19 +110,6 @@ static void gWaitCondition(GCondition *c, GMutex *m) {
 //-------------------- pthreads --------------------
 #else
 
-typedef pthread_t GThreadID;
-typedef void *(*GThreadFunc)(void *);
-#define GThreadReturn void*
-
-static void gCreateThread(GThreadID *thr, GThreadFunc threadFunc,
-			  void *data) {
-  pthread_create(thr, NULL, threadFunc, data);
-}
-
-static void gJoinThread(GThreadID thr) {
-  pthread_join(thr, NULL);
-}
-
 typedef pthread_cond_t GCondition;
 
 static void gInitCondition(GCondition *c) {
@@ -280,23 +259,46 @@ TileCache::~TileCache() {
   delete cache;
 }
 
-void TileCache::setActiveTileList(GList *tiles) {
+void TileCache::setActiveTileList(GList *tiles, GList *prefetchTiles) {
+  GList *prefetch;
   TileDesc *tile;
   CachedTileDesc *ct;
+  double maxBytes, bytes;
   int tileIdx, cacheIdx;
   GBool newTiles;
 
   threadPool->lockMutex();
 
-  // remove any unstarted tiles not on the new active list;
-  // cancel any started tiles not on the new active list;
+  // pick the prefetch tiles that fit in the memory budget, along with
+  // the displayed tiles
+  prefetch = new GList();
+  maxBytes = getMaxBytes();
+  if (prefetchTiles && maxBytes > 0) {
+    bytes = 0;
+    for (tileIdx = 0; tileIdx < tiles->getLength(); ++tileIdx) {
+      bytes += getTileBytes((TileDesc *)tiles->get(tileIdx));
+    }
+    for (tileIdx = 0; tileIdx < prefetchTiles->getLength(); ++tileIdx) {
+      tile = (TileDesc *)prefetchTiles->get(tileIdx);
+      bytes += getTileBytes(tile);
+      if (bytes > maxBytes) {
+	break;
+      }
+      prefetch->append(tile);
+    }
+  }
+
+  // remove any unstarted tiles not on the new lists;
+  // cancel any started tiles not on the new lists;
   // mark all other tiles as inactive (active tiles will be marked later)
   cacheIdx = 0;
   while (cacheIdx < cache->getLength()) {
     ct = (CachedTileDesc *)cache->get(cacheIdx);
-    if (ct->state == cachedTileUnstarted && findTile(ct, tiles) < 0) {
+    if (ct->state == cachedTileUnstarted &&
+	findTile(ct, tiles) < 0 && findTile(ct, prefetch) < 0) {
       delete (CachedTileDesc *)cache->del(cacheIdx);
-    } else if (ct->state == cachedTileStarted && findTile(ct, tiles) < 0) {
+    } else if (ct->state == cachedTileStarted &&
+	       findTile(ct, tiles) < 0 && findTile(ct, prefetch) < 0) {
       ct->state = cachedTileCanceled;
       ++cacheIdx;
     } else {
@@ -305,20 +307,25 @@ void TileCache::setActiveTileList(GList *tiles) {
     }
   }
 
-  // mark cached tiles as active; add any new tiles to the cache
+  // mark cached tiles as active; add any new tiles to the cache -- the
+  // lowest priority tiles are moved to the front of the cache first,
+  // so the cache ends up in priority order, followed by the inactive
+  // tiles in LRU order
   newTiles = gFalse;
-  for (tileIdx = 0; tileIdx < tiles->getLength(); ++tileIdx) {
-    tile = (TileDesc *)tiles->get(tileIdx);
-    cacheIdx = findTile(tile, cache);
-    if (cacheIdx >= 0) {
-      ct = (CachedTileDesc *)cache->del(cacheIdx);
-    } else {
-      ct = new CachedTileDesc(tile);
+  for (tileIdx = prefetch->getLength() - 1; tileIdx >= 0; --tileIdx) {
+    if (activateTile((TileDesc *)prefetch->get(tileIdx),
+		     tiles->getLength() + tileIdx, gTrue)) {
       newTiles = gTrue;
     }
-    ct->active = gTrue;
-    cache->insert(0, ct);
   }
+  for (tileIdx = tiles->getLength() - 1; tileIdx >= 0; --tileIdx) {
+    if (activateTile((TileDesc *)tiles->get(tileIdx), tileIdx, gFalse)) {
+      newTiles = gTrue;
+    }
+  }
+  delete prefetch;
+
+  preemptPrefetchTiles();
 
   cleanCache();
 
@@ -335,9 +342,12 @@ SplashBitmap *TileCache::getTileBitmap(TileDesc *tile, GBool *finished) {
   int cacheIdx;
 
   threadPool->lockMutex();
-  cacheIdx = findTile(tile, cache);
+  cacheIdx = findCachedTile(tile);
   if (cacheIdx < 0) {
     threadPool->unlockMutex();
+    if (finished) {
+      *finished = gFalse;
+    }
     return NULL;
   }
   ct = (CachedTileDesc *)cache->get(cacheIdx);
@@ -390,25 +400,120 @@ int TileCache::findTile(TileDesc *tile, GList *tileList) {
   return -1;
 }
 
-// If there are too many tiles in the cache, remove the least recently
-// used tiles.  Never removes active tiles.  The caller must have
-// locked the ThreadPool mutex.
+// Search the cache for <tile>, skipping canceled tiles, and return
+// its index if found, or -1 if not found.  The caller must have locked
+// the ThreadPool mutex.
+int TileCache::findCachedTile(TileDesc *tile) {
+  CachedTileDesc *ct;
+  int i;
+
+  for (i = 0; i < cache->getLength(); ++i) {
+    ct = (CachedTileDesc *)cache->get(i);
+    if (ct->state != cachedTileCanceled && ct->matches(tile)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Mark <tile> as active, with the specified priority, and move it to
+// the front of the cache, adding it to the cache if needed.  Returns
+// true if a new tile was added.  The caller must have locked the
+// ThreadPool mutex.
+GBool TileCache::activateTile(TileDesc *tile, int priority, GBool prefetch) {
+  CachedTileDesc *ct;
+  int cacheIdx;
+  GBool newTile;
+
+  cacheIdx = findCachedTile(tile);
+  if (cacheIdx >= 0) {
+    ct = (CachedTileDesc *)cache->del(cacheIdx);
+    newTile = gFalse;
+  } else {
+    ct = new CachedTileDesc(tile);
+    newTile = gTrue;
+  }
+  ct->active = gTrue;
+  ct->priority = priority;
+  ct->prefetch = prefetch;
+  cache->insert(0, ct);
+  return newTile;
+}
+
+// If displayed tiles are waiting for a worker thread, and all of the
+// threads are busy, cancel prefetch tiles (lowest priority first) to
+// free up threads.  Canceled prefetch tiles will be queued again by
+// the next call to setActiveTileList().  The caller must have locked
+// the ThreadPool mutex.
+void TileCache::preemptPrefetchTiles() {
+  CachedTileDesc *ct;
+  int nWaiting, nBusy, n, i;
+
+  nWaiting = nBusy = 0;
+  for (i = 0; i < cache->getLength(); ++i) {
+    ct = (CachedTileDesc *)cache->get(i);
+    if (ct->state == cachedTileUnstarted && !ct->prefetch) {
+      ++nWaiting;
+    } else if (ct->state == cachedTileStarted ||
+	       ct->state == cachedTileCanceled) {
+      ++nBusy;
+    }
+  }
+  n = nWaiting - (state->getNWorkerThreads() - nBusy);
+  for (i = cache->getLength() - 1; i >= 0 && n > 0; --i) {
+    ct = (CachedTileDesc *)cache->get(i);
+    if (ct->active && ct->prefetch && ct->state == cachedTileStarted) {
+      ct->state = cachedTileCanceled;
+      --n;
+    }
+  }
+}
+
+// Return the approximate size, in bytes, of the bitmap for <tile>.
+double TileCache::getTileBytes(TileDesc *tile) {
+  double n;
+
+  n = (double)tile->tw * (double)tile->th;
+  if (state->getColorMode() == splashModeMono1) {
+    return n / 8;
+  }
+  return n * splashColorModeNComps[state->getColorMode()];
+}
+
+// Return the tile cache memory budget, in bytes, or 0 for no budget.
+double TileCache::getMaxBytes() {
+  return state->getTileCacheMemory() * 1048576.0;
+}
+
+// If there are too many tiles in the cache, or the tiles use more than
+// the memory budget, remove the least recently used tiles.  Never
+// removes active tiles.  Prefetch tiles don't count against the
+// tileCacheSize limit -- they were already limited by the memory
+// budget.  The caller must have locked the ThreadPool mutex.
 void TileCache::cleanCache() {
   CachedTileDesc *ct;
+  double maxBytes, bytes;
   int n, i;
 
-  // count the number of non-canceled tiles
+  // count the number and size of non-canceled tiles
   n = 0;
+  bytes = 0;
   for (i = 0; i < cache->getLength(); ++i) {
     ct = (CachedTileDesc *)cache->get(i);
     if (ct->state != cachedTileCanceled) {
-      ++n;
+      if (!(ct->active && ct->prefetch)) {
+	++n;
+      }
+      bytes += getTileBytes(ct);
     }
   }
 
   // if there are too many non-canceled tiles, remove tiles
+  maxBytes = getMaxBytes();
   i = cache->getLength() - 1;
-  while (n > state->getTileCacheSize() && i >= 0) {
+  while ((n > state->getTileCacheSize() ||
+	  (maxBytes > 0 && bytes > maxBytes)) &&
+	 i >= 0) {
     ct = (CachedTileDesc *)cache->get(i);
     if (ct->active) {
       break;
@@ -416,6 +521,7 @@ void TileCache::cleanCache() {
     // any non-active tiles with state == cachedTileUnstarted should
     // already have been removed by setActiveTileList()
     if (ct->state == cachedTileFinished) {
+      bytes -= getTileBytes(ct);
       delete (CachedTileDesc *)cache->del(i);
       --n;
       --i;
@@ -488,21 +594,25 @@ GBool TileCache::hasUnstartedTiles() {
   return gFalse;
 }
 
-// Return the next unstarted tile, changing its state to
+// Return the highest priority unstarted tile, changing its state to
 // cachedTileStarted.  If there are no unstarted tiles, return NULL.
 // This will be called with the TileCacheThreadPool mutex locked.
 CachedTileDesc *TileCache::getUnstartedTile() {
-  CachedTileDesc *ct;
+  CachedTileDesc *ct, *best;
   int i;
 
+  best = NULL;
   for (i = 0; i < cache->getLength(); ++i) {
     ct = (CachedTileDesc *)cache->get(i);
-    if (ct->state == cachedTileUnstarted) {
-      ct->state = cachedTileStarted;
-      return ct;
+    if (ct->state == cachedTileUnstarted &&
+	(!best || ct->priority < best->priority)) {
+      best = ct;
     }
   }
-  return NULL;
+  if (best) {
+    best->state = cachedTileStarted;
+  }
+  return best;
 }
 
 struct TileCacheStartPageInfo {
@@ -525,6 +635,7 @@ void TileCache::startPageCbk(void *data) {
 void TileCache::rasterizeTile(CachedTileDesc *ct) {
   SplashOutputDev *out;
   TileCacheStartPageInfo info;
+  GBool prefetch;
 
 
   out = new SplashOutputDev(state->getColorMode(), 1, state->getReverseVideo(),
@@ -537,18 +648,19 @@ void TileCache::rasterizeTile(CachedTileDesc *ct) {
   state->getDoc()->displayPageSlice(out, ct->page, ct->dpi, ct->dpi, ct->rotate,
 				    gFalse, gTrue, gFalse,
 				    ct->tx, ct->ty, ct->tw, ct->th,
-				    &abortCheckCbk, ct);
+				    &abortCheckCbk, &info);
+  threadPool->lockMutex();
   if (ct->state == cachedTileCanceled) {
-    threadPool->lockMutex();
     removeTile(ct);
     threadPool->unlockMutex();
   } else {
-    threadPool->lockMutex();
     ct->bitmap = out->takeBitmap();
     ct->freeBitmap = gTrue;
     ct->state = cachedTileFinished;
+    prefetch = ct->prefetch;
     threadPool->unlockMutex();
-    if (tileDoneCbk) {
+    // prefetch tiles aren't displayed, so there's nothing to redraw
+    if (tileDoneCbk && !prefetch) {
       (*tileDoneCbk)(tileDoneCbkData);
     }
   }
@@ -556,7 +668,14 @@ void TileCache::rasterizeTile(CachedTileDesc *ct) {
 }
 
 
+// The tile state is changed by other threads (e.g., when a prefetch
+// tile is canceled), so it is read with the mutex locked.
 GBool TileCache::abortCheckCbk(void *data) {
-  CachedTileDesc *ct = (CachedTileDesc *)data;
-  return ct->state == cachedTileCanceled;
+  TileCacheStartPageInfo *info = (TileCacheStartPageInfo *)data;
+  GBool canceled;
+
+  info->tileCache->threadPool->lockMutex();
+  canceled = info->ct->state == cachedTileCanceled;
+  info->tileCache->threadPool->unlockMutex();
+  return canceled;
 }
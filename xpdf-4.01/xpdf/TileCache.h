@@ -33,8 +33,12 @@ public:
   TileCache(DisplayState *stateA);
   ~TileCache();
 
-  // Set the list of currently displayed tiles (TileDesc objects).
-  void setActiveTileList(GList *tiles);
+  // Set the list of currently displayed tiles, and the list of tiles
+  // to rasterize ahead of time (both TileDesc objects, in priority
+  // order).  The worker threads rasterize the displayed tiles first.
+  // Prefetch tiles are only queued while the cache stays within the
+  // tile cache memory budget; <prefetchTiles> can be NULL.
+  void setActiveTileList(GList *tiles, GList *prefetchTiles);
 
   // Return the bitmap for a tile.  The tile must be on the current
   // active list.  This can return NULL if tile rasterization hasn't
@@ -57,6 +61,11 @@ public:
 private:
 
   int findTile(TileDesc *tile, GList *tileList);
+  int findCachedTile(TileDesc *tile);
+  GBool activateTile(TileDesc *tile, int priority, GBool prefetch);
+  void preemptPrefetchTiles();
+  double getTileBytes(TileDesc *tile);
+  double getMaxBytes();
   void cleanCache();
   void flushCache(GBool wait);
   void removeTile(CachedTileDesc *ct);
@@ -74,7 +74,7 @@ SplashBitmap *TileCompositor::getBitmap(GBool *finished) {
   //--- PDF content
   allTilesFinished = gTrue;
   tiles = tileMap->getTileList();
-  tileCache->setActiveTileList(tiles);
+  tileCache->setActiveTileList(tiles, tileMap->getPrefetchTileList());
   for (i = 0; i < tiles->getLength(); ++i) {
     tile = (PlacedTileDesc *)tiles->get(i);
     if (tile->px >= 0) {
@@ -33,6 +33,11 @@
 // each other) in horizontal continuous mode.
 #define horizContinuousPageSpacing 3
 
+// Number of pages (or page pairs, in the side-by-side modes) past the
+// window, in the scroll direction, whose first window of tiles is
+// prefetched.
+#define prefetchPages 2
+
 //------------------------------------------------------------------------
 
 TileMap::TileMap(DisplayState *stateA) {
@@ -44,6 +49,9 @@ TileMap::TileMap(DisplayState *stateA) {
   pageBoxW = pageBoxH = NULL;
   pageX = pageY = NULL;
   tiles = NULL;
+  prefetchTiles = NULL;
+  scrollDirX = scrollDirY = 0;
+  lastScrollPage = lastScrollX = lastScrollY = 0;
 }
 
 TileMap::~TileMap() {
@@ -54,14 +62,12 @@ TileMap::~TileMap() {
   if (tiles) {
     deleteGList(tiles, PlacedTileDesc);
   }
+  if (prefetchTiles) {
+    deleteGList(prefetchTiles, PlacedTileDesc);
+  }
 }
 
 GList *TileMap::getTileList() {
-  double pageDPI1, pageDPI2;
-  int pageW1, pageH1, tileW1, tileH1, pageW2, pageH2, tileW2, tileH2;
-  int offsetX, offsetY, offsetX2;
-  int x0, y0, x1, y1, x, y, tx, ty, tw, th, page;
-
   if (tiles) {
     return tiles;
   }
@@ -75,10 +81,146 @@ GList *TileMap::getTileList() {
   updatePageParams();
   updateContinuousModeParams();
 
+  addTiles(tiles, state->getScrollPage(),
+	   state->getScrollX(), state->getScrollY());
+
+  return tiles;
+}
+
+GList *TileMap::getPrefetchTileList() {
+  GList *visibleTiles;
+  PlacedTileDesc *tile;
+  GBool horiz, backward, dup;
+  int nPages, scrollMaxX, scrollMaxY, dirX, dirY, step, pg, x, y, i, j;
+
+  if (prefetchTiles) {
+    return prefetchTiles;
+  }
+
+  visibleTiles = getTileList();
+  prefetchTiles = new GList();
+
+  if (!state->getDoc() || !state->getDoc()->getNumPages()) {
+    return prefetchTiles;
+  }
+
+  updatePageParams();
+  updateContinuousModeParams();
+
+  nPages = state->getDoc()->getNumPages();
+  getScrollLimits(&scrollMaxX, &scrollMaxY);
+  scrollMaxX -= state->getWinW();
+  scrollMaxY -= state->getWinH();
+
+  // with no scroll history, assume the user is reading forward
+  horiz = state->getDisplayMode() == displayHorizontalContinuous;
+  dirX = scrollDirX;
+  dirY = scrollDirY;
+  if (!dirX && !dirY) {
+    if (horiz) {
+      dirX = 1;
+    } else {
+      dirY = 1;
+    }
+  }
+  backward = horiz ? dirX < 0 : dirY < 0;
+
+  //--- the next window in the scroll direction
+  x = state->getScrollX() + dirX * state->getWinW();
+  if (x > scrollMaxX) {
+    x = scrollMaxX;
+  }
+  if (x < 0) {
+    x = 0;
+  }
+  y = state->getScrollY() + dirY * state->getWinH();
+  if (y > scrollMaxY) {
+    y = scrollMaxY;
+  }
+  if (y < 0) {
+    y = 0;
+  }
+  if (x != state->getScrollX() || y != state->getScrollY()) {
+    addTiles(prefetchTiles, state->getScrollPage(), x, y);
+  }
+
+  //--- the first window of each of the next few pages
+  step = state->displayModeIsSideBySide() ? 2 : 1;
+  for (i = 1; i <= prefetchPages; ++i) {
+    if (state->displayModeIsContinuous()) {
+      if (backward) {
+	pg = getFirstPage() - i * step;
+      } else {
+	pg = getLastPage() + i * step;
+      }
+    } else {
+      if (backward) {
+	pg = state->getScrollPage() - i * step;
+      } else {
+	pg = state->getScrollPage() + i * step;
+      }
+    }
+    if (pg < 1 || pg > nPages) {
+      break;
+    }
+    if (horiz) {
+      x = backward ? getPageRightX(pg) : getPageLeftX(pg);
+      y = state->getScrollY();
+    } else {
+      x = state->getScrollX();
+      y = backward ? getPageBottomY(pg) : getPageTopY(pg);
+    }
+    if (state->displayModeIsContinuous()) {
+      if (x > scrollMaxX) {
+	x = scrollMaxX;
+      }
+      if (y > scrollMaxY) {
+	y = scrollMaxY;
+      }
+    }
+    if (x < 0) {
+      x = 0;
+    }
+    if (y < 0) {
+      y = 0;
+    }
+    addTiles(prefetchTiles, state->displayModeIsContinuous()
+			      ? state->getScrollPage() : pg,
+	     x, y);
+  }
+
+  //--- remove visible and duplicate tiles
+  i = 0;
+  while (i < prefetchTiles->getLength()) {
+    tile = (PlacedTileDesc *)prefetchTiles->get(i);
+    dup = gFalse;
+    for (j = 0; !dup && j < visibleTiles->getLength(); ++j) {
+      dup = tile->matches((TileDesc *)visibleTiles->get(j));
+    }
+    for (j = 0; !dup && j < i; ++j) {
+      dup = tile->matches((TileDesc *)prefetchTiles->get(j));
+    }
+    if (dup) {
+      delete (PlacedTileDesc *)prefetchTiles->del(i);
+    } else {
+      ++i;
+    }
+  }
+
+  return prefetchTiles;
+}
+
+void TileMap::addTiles(GList *list, int scrollPage,
+		       int scrollX, int scrollY) {
+  double pageDPI1, pageDPI2;
+  int pageW1, pageH1, tileW1, tileH1, pageW2, pageH2, tileW2, tileH2;
+  int offsetX, offsetY, offsetX2;
+  int x0, y0, x1, y1, x, y, tx, ty, tw, th, page;
+
   switch (state->getDisplayMode()) {
 
   case displaySingle:
-    page = state->getScrollPage();
+    page = scrollPage;
     pageDPI1 = pageDPI[page - 1];
     pageW1 = pageW[page - 1];
     pageH1 = pageH[page - 1];
@@ -94,16 +236,16 @@ GList *TileMap::getTileList() {
     } else {
       offsetY = 0;
     }
-    if ((x0 = state->getScrollX() - offsetX) < 0) {
+    if ((x0 = scrollX - offsetX) < 0) {
       x0 = 0;
     }
-    if ((y0 = state->getScrollY() - offsetY) < 0) {
+    if ((y0 = scrollY - offsetY) < 0) {
       y0 = 0;
     }
-    if ((x1 = state->getScrollX() + state->getWinW() - 1 - offsetX) >= pageW1) {
+    if ((x1 = scrollX + state->getWinW() - 1 - offsetX) >= pageW1) {
       x1 = pageW1 - 1;
     }
-    if ((y1 = state->getScrollY() + state->getWinH() - 1 - offsetY) >= pageH1) {
+    if ((y1 = scrollY + state->getWinH() - 1 - offsetY) >= pageH1) {
       y1 = pageH1 - 1;
     }
     for (y = y0 / tileH1; y <= y1 / tileH1; ++y) {
@@ -118,10 +260,10 @@ GList *TileMap::getTileList() {
 	if (ty + th > pageH1) {
 	  th = pageH1 - ty;
 	}
-	tiles->append(new PlacedTileDesc(page, state->getRotate(), pageDPI1,
-					 tx, ty, tw, th,
-					 tx - state->getScrollX() + offsetX,
-					 ty - state->getScrollY() + offsetY));
+	list->append(new PlacedTileDesc(page, state->getRotate(), pageDPI1,
+					tx, ty, tw, th,
+					tx - scrollX + offsetX,
+					ty - scrollY + offsetY));
       }
     }
     break;
@@ -132,9 +274,9 @@ GList *TileMap::getTileList() {
     } else {
       offsetY = 0;
     }
-    page = findContinuousPage(state->getScrollY());
+    page = findContinuousPage(scrollY);
     while (page <= state->getDoc()->getNumPages() &&
-	   pageY[page - 1] < state->getScrollY() + state->getWinH()) {
+	   pageY[page - 1] < scrollY + state->getWinH()) {
       pageDPI1 = pageDPI[page - 1];
       pageW1 = pageW[page - 1];
       pageH1 = pageH[page - 1];
@@ -146,17 +288,17 @@ GList *TileMap::getTileList() {
 	offsetX = 0;
       }
       offsetX += (maxW - pageW1) / 2;
-      if ((x0 = state->getScrollX() - offsetX) < 0) {
+      if ((x0 = scrollX - offsetX) < 0) {
 	x0 = 0;
       }
-      if ((y0 = state->getScrollY() - pageY[page - 1] - offsetY) < 0) {
+      if ((y0 = scrollY - pageY[page - 1] - offsetY) < 0) {
 	y0 = 0;
       }
-      if ((x1 = state->getScrollX() + state->getWinW() - 1 - offsetX)
+      if ((x1 = scrollX + state->getWinW() - 1 - offsetX)
 	  >= pageW1) {
 	x1 = pageW1 - 1;
       }
-      if ((y1 = state->getScrollY() - pageY[page - 1]
+      if ((y1 = scrollY - pageY[page - 1]
 	        + state->getWinH() - 1 - offsetY)
 	  >= pageH1) {
 	y1 = pageH1 - 1;
@@ -173,11 +315,11 @@ GList *TileMap::getTileList() {
 	  if (ty + th > pageH1) {
 	    th = pageH1 - ty;
 	  }
-	  tiles->append(new PlacedTileDesc(
+	  list->append(new PlacedTileDesc(
 				page, state->getRotate(), pageDPI1,
 				tx, ty, tw, th,
-				tx - state->getScrollX() + offsetX,
-				ty - state->getScrollY() + pageY[page - 1]
+				tx - scrollX + offsetX,
+				ty - scrollY + pageY[page - 1]
 				  + offsetY));
 	}
       }
@@ -186,7 +328,7 @@ GList *TileMap::getTileList() {
     break;
 
   case displaySideBySideSingle:
-    page = state->getScrollPage();
+    page = scrollPage;
     pageDPI1 = pageDPI[page - 1];
     pageW1 = pageW[page - 1];
     pageH1 = pageH[page - 1];
@@ -224,18 +366,18 @@ GList *TileMap::getTileList() {
       offsetY = 0;
     }
     // left page
-    if ((x0 = state->getScrollX() - offsetX) < 0) {
+    if ((x0 = scrollX - offsetX) < 0) {
       x0 = 0;
     }
-    if ((y0 = state->getScrollY() - offsetY) < 0) {
+    if ((y0 = scrollY - offsetY) < 0) {
       y0 = 0;
     }
-    if ((x1 = state->getScrollX() + state->getWinW() - 1 - offsetX) >= pageW1) {
+    if ((x1 = scrollX + state->getWinW() - 1 - offsetX) >= pageW1) {
       x1 = pageW1 - 1;
     } else if (x1 < 0) {
       x1 = -tileW2;
     }
-    if ((y1 = state->getScrollY() + state->getWinH() - 1 - offsetY) >= pageH1) {
+    if ((y1 = scrollY + state->getWinH() - 1 - offsetY) >= pageH1) {
       y1 = pageH1 - 1;
     } else if (y1 < 0) {
       y1 = -tileH2;
@@ -252,28 +394,28 @@ GList *TileMap::getTileList() {
 	if (ty + th > pageH1) {
 	  th = pageH1 - ty;
 	}
-	tiles->append(new PlacedTileDesc(page,
-					 state->getRotate(), pageDPI1,
-					 tx, ty, tw, th,
-					 tx - state->getScrollX() + offsetX,
-					 ty - state->getScrollY() + offsetY));
+	list->append(new PlacedTileDesc(page,
+					state->getRotate(), pageDPI1,
+					tx, ty, tw, th,
+					tx - scrollX + offsetX,
+					ty - scrollY + offsetY));
       }
     }
     // right page
     if (page + 1 <= state->getDoc()->getNumPages()) {
-      if ((x0 = state->getScrollX() - offsetX2) < 0) {
+      if ((x0 = scrollX - offsetX2) < 0) {
 	x0 = 0;
       }
-      if ((y0 = state->getScrollY() - offsetY) < 0) {
+      if ((y0 = scrollY - offsetY) < 0) {
 	y0 = 0;
       }
-      if ((x1 = state->getScrollX() + state->getWinW() - 1 - offsetX2)
+      if ((x1 = scrollX + state->getWinW() - 1 - offsetX2)
 	  >= pageW2) {
 	x1 = pageW2 - 1;
       } else if (x1 < 0) {
 	x1 = -tileW2;
       }
-      if ((y1 = state->getScrollY() + state->getWinH() - 1 - offsetY)
+      if ((y1 = scrollY + state->getWinH() - 1 - offsetY)
 	  >= pageH2) {
 	y1 = pageH2 - 1;
       } else if (y1 < 0) {
@@ -291,11 +433,11 @@ GList *TileMap::getTileList() {
 	  if (ty + th > pageH2) {
 	    th = pageH2 - ty;
 	  }
-	  tiles->append(new PlacedTileDesc(page + 1,
-					   state->getRotate(), pageDPI2,
-					   tx, ty, tw, th,
-					   tx - state->getScrollX() + offsetX2,
-					   ty - state->getScrollY() + offsetY));
+	  list->append(new PlacedTileDesc(page + 1,
+					  state->getRotate(), pageDPI2,
+					  tx, ty, tw, th,
+					  tx - scrollX + offsetX2,
+					  ty - scrollY + offsetY));
 	}
       }
     }
@@ -307,11 +449,11 @@ GList *TileMap::getTileList() {
     } else {
       offsetY = 0;
     }
-    page = findSideBySideContinuousPage(state->getScrollY());
+    page = findSideBySideContinuousPage(scrollY);
     while (page <= state->getDoc()->getNumPages() &&
-	   (pageY[page - 1] < state->getScrollY() + state->getWinH() ||
+	   (pageY[page - 1] < scrollY + state->getWinH() ||
 	    (page + 1 <= state->getDoc()->getNumPages() &&
-	     pageY[page] < state->getScrollY() + state->getWinH()))) {
+	     pageY[page] < scrollY + state->getWinH()))) {
       pageDPI1 = pageDPI[page - 1];
       pageW1 = pageW[page - 1];
       pageH1 = pageH[page - 1];
@@ -341,19 +483,19 @@ GList *TileMap::getTileList() {
       offsetX += maxW - pageW1;
       offsetX2 = offsetX + pageW1 + sideBySidePageSpacing;
       // left page
-      if ((x0 = state->getScrollX() - offsetX) < 0) {
+      if ((x0 = scrollX - offsetX) < 0) {
 	x0 = 0;
       }
-      if ((y0 = state->getScrollY() - pageY[page - 1] - offsetY) < 0) {
+      if ((y0 = scrollY - pageY[page - 1] - offsetY) < 0) {
 	y0 = 0;
       }
-      if ((x1 = state->getScrollX() + state->getWinW() - 1 - offsetX)
+      if ((x1 = scrollX + state->getWinW() - 1 - offsetX)
 	  >= pageW1) {
 	x1 = pageW1 - 1;
       } else if (x1 < 0) {
 	x1 = -tileW2;
       }
-      if ((y1 = state->getScrollY() - pageY[page - 1]
+      if ((y1 = scrollY - pageY[page - 1]
 	        + state->getWinH() - 1 - offsetY)
 	  >= pageH1) {
 	y1 = pageH1 - 1;
@@ -372,30 +514,30 @@ GList *TileMap::getTileList() {
 	  if (ty + th > pageH1) {
 	    th = pageH1 - ty;
 	  }
-	  tiles->append(new PlacedTileDesc(
+	  list->append(new PlacedTileDesc(
 				page, state->getRotate(), pageDPI1,
 				tx, ty, tw, th,
-				tx - state->getScrollX() + offsetX,
-				ty - state->getScrollY() + pageY[page - 1]
+				tx - scrollX + offsetX,
+				ty - scrollY + pageY[page - 1]
 				  + offsetY));
 	}
       }
       ++page;
       // right page
       if (page <= state->getDoc()->getNumPages()) {
-	if ((x0 = state->getScrollX() - offsetX2) < 0) {
+	if ((x0 = scrollX - offsetX2) < 0) {
 	  x0 = 0;
 	}
-	if ((y0 = state->getScrollY() - pageY[page - 1] - offsetY) < 0) {
+	if ((y0 = scrollY - pageY[page - 1] - offsetY) < 0) {
 	  y0 = 0;
 	}
-	if ((x1 = state->getScrollX() + state->getWinW() - 1 - offsetX2)
+	if ((x1 = scrollX + state->getWinW() - 1 - offsetX2)
 	    >= pageW2) {
 	  x1 = pageW2 - 1;
 	} else if (x1 < 0) {
 	  x1 = -tileW2;
 	}
-	if ((y1 = state->getScrollY() - pageY[page - 1]
+	if ((y1 = scrollY - pageY[page - 1]
 	          + state->getWinH() - 1 - offsetY)
 	    >= pageH2) {
 	  y1 = pageH2 - 1;
@@ -414,11 +556,11 @@ GList *TileMap::getTileList() {
 	    if (ty + th > pageH2) {
 	      th = pageH2 - ty;
 	    }
-	    tiles->append(new PlacedTileDesc(
+	    list->append(new PlacedTileDesc(
 				  page, state->getRotate(), pageDPI2,
 				  tx, ty, tw, th,
-				  tx - state->getScrollX() + offsetX2,
-				  ty - state->getScrollY() + pageY[page - 1]
+				  tx - scrollX + offsetX2,
+				  ty - scrollY + pageY[page - 1]
 				    + offsetY));
 	  }
 	}
@@ -433,9 +575,9 @@ GList *TileMap::getTileList() {
     } else {
       offsetX = 0;
     }
-    page = findHorizContinuousPage(state->getScrollX());
+    page = findHorizContinuousPage(scrollX);
     while (page <= state->getDoc()->getNumPages() &&
-	   pageX[page - 1] < state->getScrollX() + state->getWinW()) {
+	   pageX[page - 1] < scrollX + state->getWinW()) {
       pageDPI1 = pageDPI[page - 1];
       pageW1 = pageW[page - 1];
       pageH1 = pageH[page - 1];
@@ -446,18 +588,18 @@ GList *TileMap::getTileList() {
       } else {
 	offsetY = 0;
       }
-      if ((x0 = state->getScrollX() - pageX[page - 1] - offsetX) < 0) {
+      if ((x0 = scrollX - pageX[page - 1] - offsetX) < 0) {
 	x0 = 0;
       }
-      if ((y0 = state->getScrollY() - offsetY) < 0) {
+      if ((y0 = scrollY - offsetY) < 0) {
 	y0 = 0;
       }
-      if ((x1 = state->getScrollX() - pageX[page - 1]
+      if ((x1 = scrollX - pageX[page - 1]
 	        + state->getWinW() - 1 - offsetX)
 	  >= pageW1) {
 	x1 = pageW1 - 1;
       }
-      if ((y1 = state->getScrollY() + state->getWinH() - 1 - offsetY)
+      if ((y1 = scrollY + state->getWinH() - 1 - offsetY)
 	  >= pageH1) {
 	y1 = pageH1 - 1;
       }
@@ -473,20 +615,18 @@ GList *TileMap::getTileList() {
 	  if (ty + th > pageH1) {
 	    th = pageH1 - ty;
 	  }
-	  tiles->append(new PlacedTileDesc(
+	  list->append(new PlacedTileDesc(
 				page, state->getRotate(), pageDPI1,
 				tx, ty, tw, th,
-				tx - state->getScrollX() + pageX[page - 1]
+				tx - scrollX + pageX[page - 1]
 				  + offsetX,
-				ty - state->getScrollY() + offsetY));
+				ty - scrollY + offsetY));
 	}
       }
       ++page;
     }
     break;
   }
-
-  return tiles;
 }
 
 void TileMap::getScrollLimits(int *horizMax, int *vertMax) {
@@ -1246,6 +1386,12 @@ void TileMap::docChanged() {
     deleteGList(tiles, PlacedTileDesc);
     tiles = NULL;
   }
+  if (prefetchTiles) {
+    deleteGList(prefetchTiles, PlacedTileDesc);
+    prefetchTiles = NULL;
+  }
+  lastScrollPage = 0;
+  scrollDirX = scrollDirY = 0;
 }
 
 void TileMap::windowSizeChanged() {
@@ -1255,6 +1401,12 @@ void TileMap::windowSizeChanged() {
     deleteGList(tiles, PlacedTileDesc);
     tiles = NULL;
   }
+  if (prefetchTiles) {
+    deleteGList(prefetchTiles, PlacedTileDesc);
+    prefetchTiles = NULL;
+  }
+  lastScrollPage = 0;
+  scrollDirX = scrollDirY = 0;
 }
 
 void TileMap::displayModeChanged() {
@@ -1264,6 +1416,12 @@ void TileMap::displayModeChanged() {
     deleteGList(tiles, PlacedTileDesc);
     tiles = NULL;
   }
+  if (prefetchTiles) {
+    deleteGList(prefetchTiles, PlacedTileDesc);
+    prefetchTiles = NULL;
+  }
+  lastScrollPage = 0;
+  scrollDirX = scrollDirY = 0;
 }
 
 void TileMap::zoomChanged() {
@@ -1273,6 +1431,12 @@ void TileMap::zoomChanged() {
     deleteGList(tiles, PlacedTileDesc);
     tiles = NULL;
   }
+  if (prefetchTiles) {
+    deleteGList(prefetchTiles, PlacedTileDesc);
+    prefetchTiles = NULL;
+  }
+  lastScrollPage = 0;
+  scrollDirX = scrollDirY = 0;
 }
 
 void TileMap::rotateChanged() {
@@ -1282,13 +1446,41 @@ void TileMap::rotateChanged() {
     deleteGList(tiles, PlacedTileDesc);
     tiles = NULL;
   }
+  if (prefetchTiles) {
+    deleteGList(prefetchTiles, PlacedTileDesc);
+    prefetchTiles = NULL;
+  }
+  lastScrollPage = 0;
+  scrollDirX = scrollDirY = 0;
 }
 
 void TileMap::scrollPositionChanged() {
+  int scrollPage, scrollX, scrollY;
+
+  scrollPage = state->getScrollPage();
+  scrollX = state->getScrollX();
+  scrollY = state->getScrollY();
+  if (lastScrollPage) {
+    if (!state->displayModeIsContinuous() && scrollPage != lastScrollPage) {
+      scrollDirX = 0;
+      scrollDirY = scrollPage > lastScrollPage ? 1 : -1;
+    } else if (scrollX != lastScrollX || scrollY != lastScrollY) {
+      scrollDirX = (scrollX > lastScrollX) - (scrollX < lastScrollX);
+      scrollDirY = (scrollY > lastScrollY) - (scrollY < lastScrollY);
+    }
+  }
+  lastScrollPage = scrollPage;
+  lastScrollX = scrollX;
+  lastScrollY = scrollY;
+
   if (tiles) {
     deleteGList(tiles, PlacedTileDesc);
     tiles = NULL;
   }
+  if (prefetchTiles) {
+    deleteGList(prefetchTiles, PlacedTileDesc);
+    prefetchTiles = NULL;
+  }
 }
 
 
@@ -1299,6 +1491,10 @@ void TileMap::forceRedraw() {
     deleteGList(tiles, PlacedTileDesc);
     tiles = NULL;
   }
+  if (prefetchTiles) {
+    deleteGList(prefetchTiles, PlacedTileDesc);
+    prefetchTiles = NULL;
+  }
 }
 
 void TileMap::clearPageParams() {
@@ -78,6 +78,17 @@ public:
   // modify or free it.
   GList *getTileList();
 
+  // Returns a list of PlacedTileDesc objects describing tiles that
+  // are likely to be needed soon, in priority order: first the tiles
+  // one window further along the most recent scroll direction, then
+  // the tops (or, when scrolling backward, the bottoms) of the next
+  // few pages.  Tiles on the getTileList() list are not included.
+  // The px/py fields are relative to the window position each tile
+  // was computed for, not to the current window.  The returned list
+  // is owned by the TileMap object -- the caller should not modify or
+  // free it.
+  GList *getPrefetchTileList();
+
   // Return the max values for the horizontal and vertical scrollbars.
   // Scroll thumbs should be winW and winH.
   void getScrollLimits(int *horizMax, int *vertMax);
@@ -187,6 +198,11 @@ private:
   // Update pageX, pageY, maxW, maxW2, maxH, totalW, totalH.
   void updateContinuousModeParams();
 
+  // Append the tiles needed to display the window at the given
+  // scroll position to <list>.  The page and continuous mode params
+  // must be up to date.
+  void addTiles(GList *list, int scrollPage, int scrollX, int scrollY);
+
   // Compute the user-to-device transform matrix for the specified
   // page.
   void computePageMatrix(int page, double *m);
@@ -242,6 +258,13 @@ private:
   int totalW, totalH;
 
   GList *tiles;
+  GList *prefetchTiles;
+
+  // Direction (-1, 0, or +1 along each axis) of the most recent
+  // scroll, and the scroll position it was measured from
+  // (lastScrollPage = 0 if there is no previous position).
+  int scrollDirX, scrollDirY;
+  int lastScrollPage, lastScrollX, lastScrollY;
 };
 
 #endif
@@ -33,6 +33,8 @@
 
 #define xrefSearchSize 1024	// read this many bytes at end of file
 				//   to look for 'startxref'
+#define xrefStreamBlockSize 1024 // read xref stream entries in blocks
+				 //   of this many bytes
 
 //------------------------------------------------------------------------
 // Permission bits
@@ -777,8 +779,10 @@ GBool XRef::readXRefStream(Stream *xrefStr, GFileOffset *pos) {
 }
 
 GBool XRef::readXRefStreamSection(Stream *xrefStr, int *w, int first, int n) {
+  Guchar buf[xrefStreamBlockSize];
+  Guchar *p;
   long long type, gen, offset;
-  int c, newSize, i, j;
+  int entryLen, nBuf, nRead, newSize, i, j;
 
   if (first + n < 0) {
     return gFalse;
@@ -797,31 +801,52 @@ GBool XRef::readXRefStreamSection(Stream *xrefStr, int *w, int first, int n) {
     }
     size = newSize;
   }
+  // read the entries a block at a time (w[i] <= 8, so at least 42
+  // entries fit in the buffer) -- entries with /W [0 0 0] don't use
+  // any data, so they are all handled as one block
+  entryLen = w[0] + w[1] + w[2];
+  nBuf = nRead = 0;
+  p = buf;
   for (i = first; i < first + n; ++i) {
+    if (nBuf == 0) {
+      if (nRead < 0) {
+	return gFalse;
+      }
+      if (entryLen == 0) {
+	nBuf = first + n - i;
+      } else {
+	nBuf = xrefStreamBlockSize / entryLen;
+	if (nBuf > first + n - i) {
+	  nBuf = first + n - i;
+	}
+	nRead = xrefStr->getBlock((char *)buf, nBuf * entryLen);
+	if (nRead < nBuf * entryLen) {
+	  // handle the complete entries, then fail
+	  nBuf = nRead / entryLen;
+	  nRead = -1;
+	  if (nBuf == 0) {
+	    return gFalse;
+	  }
+	}
+      }
+      p = buf;
+    }
+    --nBuf;
     if (w[0] == 0) {
       type = 1;
     } else {
       for (type = 0, j = 0; j < w[0]; ++j) {
-	if ((c = xrefStr->getChar()) == EOF) {
-	  return gFalse;
-	}
-	type = (type << 8) + c;
+	type = (type << 8) + *p++;
       }
     }
     for (offset = 0, j = 0; j < w[1]; ++j) {
-      if ((c = xrefStr->getChar()) == EOF) {
-	return gFalse;
-      }
-      offset = (offset << 8) + c;
+      offset = (offset << 8) + *p++;
     }
     if (offset < 0 || offset > GFILEOFFSET_MAX) {
       return gFalse;
     }
     for (gen = 0, j = 0; j < w[2]; ++j) {
-      if ((c = xrefStr->getChar()) == EOF) {
-	return gFalse;
-      }
-      gen = (gen << 8) + c;
+      gen = (gen << 8) + *p++;
     }
     if (gen < 0 || gen > INT_MAX) {
       return gFalse;
@@ -81,6 +81,10 @@ public:
 		      int *keyLengthA, int *encVersionA,
 		      CryptAlgorithm *encAlgorithmA);
 
+  // Get the file decryption key (only valid if isEncrypted() is
+  // true).
+  Guchar *getFileKey() { return fileKey; }
+
   // Check various permissions.
   GBool okToPrint(GBool ignoreOwnerPW = gFalse);
   GBool okToChange(GBool ignoreOwnerPW = gFalse);
@@ -0,0 +1,586 @@
+//========================================================================
+//
+// pdfrenderbench.cc
+//
+// Rasterization benchmark.  This renders pages with Splash, either
+// as full-page bitmaps or in bands (see SplashBandRenderer), and
+// reports the time per page and the peak memory use of the process.
+// An optional address space limit makes it possible to check that
+// a page can be rendered within a memory budget.  In image color
+// mode, it instead times the color conversion of the images on the
+// pages, per color space.
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <time.h>
+#  include <sys/time.h>
+#  include <sys/resource.h>
+#endif
+#include "gtypes.h"
+#include "gmem.h"
+#include "gmempp.h"
+#include "parseargs.h"
+#include "GString.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "Dict.h"
+#include "Stream.h"
+#include "Catalog.h"
+#include "Page.h"
+#include "PDFDoc.h"
+#include "GfxState.h"
+#include "SplashBitmap.h"
+#include "SplashOutputDev.h"
+#include "SplashBandRenderer.h"
+#include "config.h"
+
+//------------------------------------------------------------------------
+
+static int firstPage = 1;
+static int lastPage = 0;
+static double resolution = 150;
+static GBool mono = gFalse;
+static GBool gray = gFalse;
+static int bandHeight = 0;
+static int nThreads = 1;
+static int nReps = 1;
+static int maxMem = 0;
+static GBool imageColor = gFalse;
+static char antialiasStr[16] = "";
+static char vectorAntialiasStr[16] = "";
+static char ownerPassword[33] = "";
+static char userPassword[33] = "";
+static char cfgFileName[256] = "";
+static GBool printVersion = gFalse;
+static GBool printHelp = gFalse;
+
+static ArgDesc argDesc[] = {
+  {"-f",        argInt,     &firstPage,      0,
+   "first page to render"},
+  {"-l",        argInt,     &lastPage,       0,
+   "last page to render"},
+  {"-r",        argFP,      &resolution,     0,
+   "resolution, in DPI (default is 150)"},
+  {"-mono",     argFlag,    &mono,           0,
+   "render monochrome (1-bit) bitmaps"},
+  {"-gray",     argFlag,    &gray,           0,
+   "render grayscale bitmaps"},
+  {"-band",     argInt,     &bandHeight,     0,
+   "render in bands of this many rows (default is full pages)"},
+#if MULTITHREADED
+  {"-threads",  argInt,     &nThreads,       0,
+   "number of rendering threads (default is 1)"},
+#endif
+  {"-reps",     argInt,     &nReps,          0,
+   "render each page this many times, and report the fastest"},
+  {"-maxmem",   argInt,     &maxMem,         0,
+   "limit the process to this many MB of memory"},
+  {"-imagecolor", argFlag,  &imageColor,     0,
+   "time the color conversion of the images, instead of rendering"},
+  {"-aa",       argString,  antialiasStr,    sizeof(antialiasStr),
+   "enable font anti-aliasing: yes, no"},
+  {"-aaVector", argString,  vectorAntialiasStr, sizeof(vectorAntialiasStr),
+   "enable vector anti-aliasing: yes, no"},
+  {"-opw",      argString,  ownerPassword,   sizeof(ownerPassword),
+   "owner password (for encrypted files)"},
+  {"-upw",      argString,  userPassword,    sizeof(userPassword),
+   "user password (for encrypted files)"},
+  {"-cfg",      argString,  cfgFileName,     sizeof(cfgFileName),
+   "configuration file to use in place of .xpdfrc"},
+  {"-v",        argFlag,    &printVersion,   0,
+   "print copyright and version info"},
+  {"-h",        argFlag,    &printHelp,      0,
+   "print usage information"},
+  {"-help",     argFlag,    &printHelp,      0,
+   "print usage information"},
+  {"--help",    argFlag,    &printHelp,      0,
+   "print usage information"},
+  {"-?",        argFlag,    &printHelp,      0,
+   "print usage information"},
+  {NULL}
+};
+
+//------------------------------------------------------------------------
+
+// Returns a monotonic time, in seconds.
+static double getTime() {
+#ifdef _WIN32
+  LARGE_INTEGER freq, t;
+
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+#endif
+}
+
+// Limit the memory of this process to <mb> megabytes.  Returns false
+// if the limit couldn't be set.
+static GBool setMemLimit(int mb) {
+#ifdef _WIN32
+  HANDLE job;
+  JOBOBJECT_EXTENDED_LIMIT_INFORMATION info;
+
+  if (!(job = CreateJobObject(NULL, NULL))) {
+    return gFalse;
+  }
+  memset(&info, 0, sizeof(info));
+  info.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_PROCESS_MEMORY;
+  info.ProcessMemoryLimit = (SIZE_T)mb << 20;
+  return SetInformationJobObject(job, JobObjectExtendedLimitInformation,
+				 &info, sizeof(info)) &&
+         AssignProcessToJobObject(job, GetCurrentProcess());
+#else
+  struct rlimit lim;
+
+  lim.rlim_cur = lim.rlim_max = (rlim_t)mb << 20;
+  return setrlimit(RLIMIT_AS, &lim) == 0;
+#endif
+}
+
+// Returns the peak memory use of this process so far, in MB.
+static double getPeakMem() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+    return 0;
+  }
+  return (double)pmc.PeakWorkingSetSize / (1024 * 1024);
+#else
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage)) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return (double)usage.ru_maxrss / (1024 * 1024);
+#else
+  return (double)usage.ru_maxrss / 1024;
+#endif
+#endif
+}
+
+// Band callback: the bands are dropped, only the page size is
+// kept.
+static void dropBand(SplashBitmap *band, void *data) {
+  ((int *)data)[0] = band->getWidth();
+  ((int *)data)[1] = band->getHeight();
+}
+
+//------------------------------------------------------------------------
+// image color conversion benchmark
+//------------------------------------------------------------------------
+
+// Max depth of nested form XObjects searched for images.
+#define maxFormDepth 8
+
+// Color conversion results for one image color space mode.
+struct ImageColorStats {
+  int nImages;
+  double nPixels;
+  double time;			// seconds
+};
+
+static ImageColorStats *imageColorStats;
+
+// Convert the pixels of the image <str> to <nOutComps> (1 or 3)
+// 8-bit components per pixel, the way the SplashOutputDev image
+// source callbacks do: one-component images go through a lookup
+// table, and other images through GfxImageColorMap::get*ByteLine.
+// The image is decoded once, before timing.
+static void benchImage(Stream *str, Dict *resDict, int nOutComps) {
+  Dict *dict;
+  Object obj1, obj2, obj3;
+  GfxColorSpace *colorSpace;
+  GfxImageColorMap *colorMap;
+  StreamColorSpaceMode csMode;
+  ImageStream *imgStr;
+  Guchar *pixels, *line, *lookup, *out, *p, *q, *col;
+  Guchar pix[256];
+  double t0, t, best;
+  int width, height, bits, nComps, n, x, y, i, rep;
+
+  bits = 0;
+  csMode = streamCSNone;
+  str->getImageParams(&bits, &csMode);
+  dict = str->getDict();
+  if (dict->lookup("ImageMask", &obj1)->isBool() && obj1.getBool()) {
+    obj1.free();
+    return;
+  }
+  obj1.free();
+  if (!dict->lookup("Width", &obj1)->isInt() ||
+      (width = obj1.getInt()) <= 0) {
+    obj1.free();
+    return;
+  }
+  obj1.free();
+  if (!dict->lookup("Height", &obj1)->isInt() ||
+      (height = obj1.getInt()) <= 0) {
+    obj1.free();
+    return;
+  }
+  obj1.free();
+  if (bits == 0) {
+    if (!dict->lookup("BitsPerComponent", &obj1)->isInt() ||
+	(bits = obj1.getInt()) < 1 || bits > 16) {
+      obj1.free();
+      return;
+    }
+    obj1.free();
+  }
+
+  // color space (named color spaces are looked up in the resources)
+  dict->lookup("ColorSpace", &obj1);
+  if (obj1.isName() && resDict &&
+      resDict->lookup("ColorSpace", &obj2)->isDict()) {
+    if (!obj2.dictLookup(obj1.getName(), &obj3)->isNull()) {
+      obj1.free();
+      obj1 = obj3;
+    } else {
+      obj3.free();
+    }
+  }
+  obj2.free();
+  if (!obj1.isNull()) {
+    colorSpace = GfxColorSpace::parse(&obj1);
+  } else if (csMode == streamCSDeviceGray) {
+    colorSpace = GfxColorSpace::create(csDeviceGray);
+  } else if (csMode == streamCSDeviceRGB) {
+    colorSpace = GfxColorSpace::create(csDeviceRGB);
+  } else if (csMode == streamCSDeviceCMYK) {
+    colorSpace = GfxColorSpace::create(csDeviceCMYK);
+  } else {
+    colorSpace = NULL;
+  }
+  obj1.free();
+  if (!colorSpace) {
+    return;
+  }
+  dict->lookup("Decode", &obj1);
+  colorMap = new GfxImageColorMap(bits, &obj1, colorSpace);
+  obj1.free();
+  if (!colorMap->isOk()) {
+    delete colorMap;
+    return;
+  }
+  nComps = colorMap->getNumPixelComps();
+
+  // decode the image
+  pixels = (Guchar *)gmallocn(height, width * nComps);
+  imgStr = new ImageStream(str, width, nComps, bits);
+  imgStr->reset();
+  for (y = 0; y < height; ++y) {
+    if ((line = imgStr->getLine())) {
+      memcpy(pixels + y * width * nComps, line, width * nComps);
+    } else {
+      memset(pixels + y * width * nComps, 0, width * nComps);
+    }
+  }
+  imgStr->close();
+  delete imgStr;
+
+  // convert it
+  out = (Guchar *)gmallocn(width, nOutComps);
+  lookup = (Guchar *)gmallocn(256, nOutComps);
+  best = 0;
+  for (rep = 0; rep < nReps; ++rep) {
+    t0 = getTime();
+    if (nComps == 1) {
+      n = (bits <= 8) ? 1 << bits : 256;
+      for (i = 0; i < n; ++i) {
+	pix[i] = (Guchar)i;
+      }
+      if (nOutComps == 1) {
+	colorMap->getGrayByteLine(pix, lookup, n,
+				  gfxRenderingIntentRelativeColorimetric);
+      } else {
+	colorMap->getRGBByteLine(pix, lookup, n,
+				 gfxRenderingIntentRelativeColorimetric);
+      }
+      for (y = 0; y < height; ++y) {
+	p = pixels + y * width;
+	q = out;
+	for (x = 0; x < width; ++x) {
+	  col = &lookup[nOutComps * *p++];
+	  for (i = 0; i < nOutComps; ++i) {
+	    *q++ = col[i];
+	  }
+	}
+      }
+    } else {
+      for (y = 0; y < height; ++y) {
+	p = pixels + y * width * nComps;
+	if (nOutComps == 1) {
+	  colorMap->getGrayByteLine(p, out, width,
+				    gfxRenderingIntentRelativeColorimetric);
+	} else {
+	  colorMap->getRGBByteLine(p, out, width,
+				   gfxRenderingIntentRelativeColorimetric);
+	}
+      }
+    }
+    t = getTime() - t0;
+    if (rep == 0 || t < best) {
+      best = t;
+    }
+  }
+
+  i = colorSpace->getMode();
+  ++imageColorStats[i].nImages;
+  imageColorStats[i].nPixels += (double)width * (double)height;
+  imageColorStats[i].time += best;
+
+  gfree(lookup);
+  gfree(out);
+  gfree(pixels);
+  delete colorMap;
+}
+
+// Run benchImage on the image XObjects in <resDict>, and in the
+// form XObjects it uses.
+static void benchImages(Dict *resDict, int nOutComps, int depth) {
+  Object xObjDict, xObj, obj1;
+  Dict *dict;
+  int i;
+
+  if (!resDict || depth > maxFormDepth) {
+    return;
+  }
+  if (resDict->lookup("XObject", &xObjDict)->isDict()) {
+    for (i = 0; i < xObjDict.dictGetLength(); ++i) {
+      if (xObjDict.dictGetVal(i, &xObj)->isStream()) {
+	dict = xObj.streamGetDict();
+	dict->lookup("Subtype", &obj1);
+	if (obj1.isName("Image")) {
+	  benchImage(xObj.getStream(), resDict, nOutComps);
+	} else if (obj1.isName("Form")) {
+	  obj1.free();
+	  if (dict->lookup("Resources", &obj1)->isDict()) {
+	    benchImages(obj1.getDict(), nOutComps, depth + 1);
+	  }
+	}
+	obj1.free();
+      }
+      xObj.free();
+    }
+  }
+  xObjDict.free();
+}
+
+// Print the results of the image color conversion benchmark.
+static void printImageColorStats() {
+  ImageColorStats *st;
+  double nPixels, time;
+  int i;
+
+  printf("colorspace\timages\tMpixels\tms\tMpixels/s\n");
+  nPixels = time = 0;
+  for (i = 0; i < GfxColorSpace::getNumColorSpaceModes(); ++i) {
+    st = &imageColorStats[i];
+    if (st->nImages == 0) {
+      continue;
+    }
+    printf("%s\t%d\t%.1f\t%.1f\t%.1f\n",
+	   GfxColorSpace::getColorSpaceModeName(i), st->nImages,
+	   1e-6 * st->nPixels, 1000 * st->time,
+	   st->time > 0 ? 1e-6 * st->nPixels / st->time : 0.0);
+    nPixels += st->nPixels;
+    time += st->time;
+  }
+  printf("total\t\t%.1f\t%.1f\t%.1f\n",
+	 1e-6 * nPixels, 1000 * time, time > 0 ? 1e-6 * nPixels / time : 0.0);
+}
+
+//------------------------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+  PDFDoc *doc;
+  GString *ownerPW, *userPW;
+  SplashColor paperColor;
+  SplashColorMode colorMode;
+  SplashBandRenderer *renderer;
+  SplashBitmap *bitmap;
+  double t0, t, best, total;
+  GBool ok;
+  int pageSize[2];
+  int exitCode, pg, rep, n;
+
+  exitCode = 99;
+
+  // parse args
+  fixCommandLine(&argc, &argv);
+  ok = parseArgs(argDesc, &argc, argv);
+  if (mono && gray) {
+    ok = gFalse;
+  }
+  if (!ok || argc != 2 || printVersion || printHelp) {
+    fprintf(stderr, "pdfrenderbench version %s\n", xpdfVersion);
+    fprintf(stderr, "%s\n", xpdfCopyright);
+    if (!printVersion) {
+      printUsage("pdfrenderbench", "<PDF-file>", argDesc);
+    }
+    goto err0;
+  }
+  if (nReps < 1) {
+    nReps = 1;
+  }
+
+  // read config file
+  globalParams = new GlobalParams(cfgFileName);
+  globalParams->setErrQuiet(gTrue);
+  globalParams->setupBaseFonts(NULL);
+  if (antialiasStr[0]) {
+    if (!globalParams->setAntialias(antialiasStr)) {
+      fprintf(stderr, "Bad '-aa' value on command line\n");
+    }
+  }
+  if (vectorAntialiasStr[0]) {
+    if (!globalParams->setVectorAntialias(vectorAntialiasStr)) {
+      fprintf(stderr, "Bad '-aaVector' value on command line\n");
+    }
+  }
+
+  // open PDF file
+  if (ownerPassword[0]) {
+    ownerPW = new GString(ownerPassword);
+  } else {
+    ownerPW = NULL;
+  }
+  if (userPassword[0]) {
+    userPW = new GString(userPassword);
+  } else {
+    userPW = NULL;
+  }
+  doc = new PDFDoc(argv[1], ownerPW, userPW);
+  if (userPW) {
+    delete userPW;
+  }
+  if (ownerPW) {
+    delete ownerPW;
+  }
+  if (!doc->isOk()) {
+    fprintf(stderr, "Couldn't open PDF file '%s'\n", argv[1]);
+    exitCode = 1;
+    goto err1;
+  }
+
+  // get page range
+  if (firstPage < 1) {
+    firstPage = 1;
+  }
+  if (lastPage < 1 || lastPage > doc->getNumPages()) {
+    lastPage = doc->getNumPages();
+  }
+
+  if (maxMem > 0 && !setMemLimit(maxMem)) {
+    fprintf(stderr, "Couldn't set the memory limit\n");
+    exitCode = 2;
+    goto err1;
+  }
+
+  if (imageColor) {
+    n = GfxColorSpace::getNumColorSpaceModes();
+    imageColorStats = (ImageColorStats *)gmallocn(n, sizeof(ImageColorStats));
+    memset(imageColorStats, 0, n * sizeof(ImageColorStats));
+    for (pg = firstPage; pg <= lastPage; ++pg) {
+      benchImages(doc->getCatalog()->getPage(pg)->getResourceDict(),
+		  (mono || gray) ? 1 : 3, 0);
+    }
+    printImageColorStats();
+    printf("peak memory: %.1f MB\n", getPeakMem());
+    gfree(imageColorStats);
+    exitCode = 0;
+    goto err1;
+  }
+
+  if (mono) {
+    colorMode = splashModeMono1;
+    paperColor[0] = 0xff;
+  } else if (gray) {
+    colorMode = splashModeMono8;
+    paperColor[0] = 0xff;
+  } else {
+    colorMode = splashModeRGB8;
+    paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+  }
+  renderer = new SplashBandRenderer(colorMode, 1, gFalse, paperColor,
+				    nThreads);
+  renderer->startDoc(doc);
+
+  printf("page\twidth\theight\tms\n");
+  total = 0;
+  try {
+    for (pg = firstPage; pg <= lastPage; ++pg) {
+      best = 0;
+      for (rep = 0; rep < nReps; ++rep) {
+	t0 = getTime();
+	if (bandHeight > 0) {
+	  renderer->displayPageBands(pg, resolution, resolution, 0,
+				     gFalse, gTrue, gFalse,
+				     bandHeight, &dropBand, pageSize);
+	} else {
+	  renderer->displayPage(pg, resolution, resolution, 0,
+				gFalse, gTrue, gFalse);
+	}
+	t = getTime() - t0;
+	if (rep == 0 || t < best) {
+	  best = t;
+	}
+      }
+      total += best;
+      if (bandHeight <= 0) {
+	bitmap = renderer->getBitmap();
+	pageSize[0] = bitmap->getWidth();
+	pageSize[1] = bitmap->getHeight();
+      }
+      printf("%d\t%d\t%d\t%.1f\n", pg, pageSize[0], pageSize[1], 1000 * best);
+      fflush(stdout);
+    }
+#if USE_EXCEPTIONS
+  } catch (GMemException e) {
+    printf("out of memory at page %d\n", pg);
+    exitCode = 3;
+#endif
+  } catch (std::bad_alloc &e) {
+    printf("out of memory at page %d\n", pg);
+    exitCode = 3;
+  }
+  if (exitCode != 3) {
+    printf("total\t\t\t%.1f\n", 1000 * total);
+    exitCode = 0;
+  }
+  printf("peak memory: %.1f MB\n", getPeakMem());
+
+  // after running out of memory, the renderer may be in an
+  // inconsistent state, so it is not deleted
+  if (exitCode == 0) {
+    delete renderer;
+  }
+
+  // clean up
+ err1:
+  delete doc;
+  delete globalParams;
+ err0:
+
+  // check for memory leaks
+  Object::memCheck(stderr);
+  gMemReport(stderr);
+
+  return exitCode;
+}
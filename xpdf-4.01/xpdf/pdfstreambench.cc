@@ -0,0 +1,2962 @@
+//========================================================================
+//
+// pdfstreambench.cc
+//
+// Stream decoder benchmark.  In extract mode, this copies the encoded
+// input of every decoder stage used by the streams in a set of PDF
+// files into a corpus file.  In synth mode, it makes corpus records
+// by encoding arbitrary input files.  In benchmark mode, it replays
+// each corpus record through its decoder (on top of a MemStream) and
+// reports throughput, per-call latency, and allocation counts.  In
+// verify mode, it checks that each decoder returns the same data
+// through all of its read functions, and (optionally) that the data
+// matches a list of digests.
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+#include "gtypes.h"
+#include "gmem.h"
+#include "gmempp.h"
+#include "parseargs.h"
+#include "GString.h"
+#include "GList.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "Stream.h"
+#include "Stream-CCITT.h"
+#include "Decrypt.h"
+#include "Lexer.h"
+#include "Parser.h"
+#ifndef NO_JBIG_STREAM
+#include "JBIG2Stream.h"
+#endif
+#ifndef NO_JPX_STREAM
+#include "JPXStream.h"
+#endif
+#include "XRef.h"
+#include "PDFDoc.h"
+#include "Error.h"
+#include "config.h"
+
+//------------------------------------------------------------------------
+
+// corpus file header line
+#define corpusMagic "%PDFStreamBench-1"
+
+// number of integer parameters in each corpus record
+#define nBenchParams 8
+
+// size of the buffer used to read decoder output
+#define benchBufSize 65536
+
+//------------------------------------------------------------------------
+
+static char extractFileName[1024] = "";
+static char synthFileName[1024] = "";
+static GBool verifyMode = gFalse;
+static char sumsFileName[1024] = "";
+static char checkFileName[1024] = "";
+static char decoderName[32] = "";
+static int minIters = 1;
+static int minTime = 200;
+static GBool totalsOnly = gFalse;
+static char ownerPassword[33] = "\001";
+static char userPassword[33] = "\001";
+static char cfgFileName[256] = "";
+static GBool printVersion = gFalse;
+static GBool printHelp = gFalse;
+
+static ArgDesc argDesc[] = {
+  {"-extract", argString,  extractFileName, sizeof(extractFileName),
+   "extract the streams from the PDF files into this corpus file"},
+  {"-synth",   argString,  synthFileName,   sizeof(synthFileName),
+   "encode the input files into records in this corpus file"},
+  {"-verify",  argFlag,    &verifyMode,     0,
+   "check the decoders' output instead of benchmarking them"},
+  {"-sums",    argString,  sumsFileName,    sizeof(sumsFileName),
+   "write a digest of each record's decoded data to this file"},
+  {"-check",   argString,  checkFileName,   sizeof(checkFileName),
+   "check the decoded data against the digests in this file"},
+  {"-decoder", argString,  decoderName,     sizeof(decoderName),
+   "only benchmark records for this decoder"},
+  {"-iters",   argInt,     &minIters,       0,
+   "minimum number of decode calls per record"},
+  {"-time",    argInt,     &minTime,        0,
+   "minimum time (in milliseconds) spent on each record"},
+  {"-totals",  argFlag,    &totalsOnly,     0,
+   "print only the per-decoder totals"},
+  {"-opw",     argString,  ownerPassword,   sizeof(ownerPassword),
+   "owner password (for encrypted files)"},
+  {"-upw",     argString,  userPassword,    sizeof(userPassword),
+   "user password (for encrypted files)"},
+  {"-cfg",     argString,  cfgFileName,     sizeof(cfgFileName),
+   "configuration file to use in place of .xpdfrc"},
+  {"-v",       argFlag,    &printVersion,   0,
+   "print copyright and version info"},
+  {"-h",       argFlag,    &printHelp,      0,
+   "print usage information"},
+  {"-help",    argFlag,    &printHelp,      0,
+   "print usage information"},
+  {"--help",   argFlag,    &printHelp,      0,
+   "print usage information"},
+  {"-?",       argFlag,    &printHelp,      0,
+   "print usage information"},
+  {NULL}
+};
+
+//------------------------------------------------------------------------
+// allocation counting
+//------------------------------------------------------------------------
+
+// Decoders allocate their buffers with gmalloc, and their objects
+// with new -- the former are counted in gmem (pdfstreambench is built
+// with its own copy of gmem, compiled with GMEM_COUNT_ALLOCS), and
+// the latter are counted here.
+#ifndef DEBUG_MEM
+
+static size_t newCount = 0;
+
+void *operator new(size_t size) {
+  void *p;
+
+  ++newCount;
+  if (!(p = malloc(size ? size : 1))) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](size_t size) {
+  void *p;
+
+  ++newCount;
+  if (!(p = malloc(size ? size : 1))) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) {
+  free(p);
+}
+
+void operator delete[](void *p) {
+  free(p);
+}
+
+#endif // DEBUG_MEM
+
+static size_t getAllocCount() {
+#ifdef DEBUG_MEM
+  return gMemGetAllocCount();
+#else
+  return gMemGetAllocCount() + newCount;
+#endif
+}
+
+//------------------------------------------------------------------------
+
+// Returns a monotonic time, in seconds.
+static double getTime() {
+#ifdef _WIN32
+  LARGE_INTEGER freq, t;
+
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+#endif
+}
+
+//------------------------------------------------------------------------
+// BenchRecord
+//------------------------------------------------------------------------
+
+enum BenchDecoder {
+  benchASCIIHex,
+  benchASCII85,
+  benchLZW,
+  benchRunLength,
+  benchCCITTFax,
+  benchDCT,
+  benchFlate,
+  benchJBIG2,
+  benchJPX,
+  benchDecrypt,
+  benchPredictor,
+  benchChain
+};
+
+#define nBenchDecoders 12
+
+// NB: these must match the BenchDecoder enum
+static const char *benchDecoderNames[nBenchDecoders] = {
+  "ahx",
+  "a85",
+  "lzw",
+  "rl",
+  "ccitt",
+  "dct",
+  "flate",
+  "jbig2",
+  "jpx",
+  "decrypt",
+  "predictor",
+  "chain"
+};
+
+// Parameters, by decoder:
+//   lzw:        predictor, columns, colors, bits, early change
+//   ccitt:      K, EndOfLine, EncodedByteAlign, columns, rows,
+//               EndOfBlock, BlackIs1
+//   dct:        color transform
+//   flate:      predictor, columns, colors, bits
+//   decrypt:    algorithm, key length, object num, object gen
+//   predictor:  predictor, columns, colors, bits
+// A chain record runs a whole filter chain, which is described by a
+// stream dictionary (with Filter and DecodeParms entries, in PDF
+// syntax) in the globals field.
+struct BenchRecord {
+  BenchDecoder decoder;
+  int params[nBenchParams];
+  Guchar key[32];		// file key (decrypt only)
+  GString *data;		// encoded input data
+  GString *globals;		// JBIG2 globals data, or chain stream
+				//   dictionary (or NULL)
+  GString *source;		// "file:num.gen"
+};
+
+static BenchRecord *newRecord(BenchDecoder decoder, GString *source) {
+  BenchRecord *rec;
+
+  rec = (BenchRecord *)gmalloc(sizeof(BenchRecord));
+  memset(rec, 0, sizeof(BenchRecord));
+  rec->decoder = decoder;
+  rec->source = source->copy();
+  return rec;
+}
+
+static void freeRecord(BenchRecord *rec) {
+  if (rec->data) {
+    delete rec->data;
+  }
+  if (rec->globals) {
+    delete rec->globals;
+  }
+  delete rec->source;
+  gfree(rec);
+}
+
+//------------------------------------------------------------------------
+// PredictorStream
+//------------------------------------------------------------------------
+
+// Runs a StreamPredictor on the (already decompressed) data from
+// another stream.  StreamPredictor reads its input with
+// getRawChar/getRawBlock, which only the Flate and LZW decoders
+// implement -- this stream implements them by passing the data
+// through from the underlying stream.
+class PredictorStream: public FilterStream {
+public:
+
+  PredictorStream(Stream *strA, int predictorA, int widthA,
+		  int nCompsA, int nBitsA);
+  virtual ~PredictorStream();
+  virtual Stream *copy();
+  virtual StreamKind getKind() { return strWeird; }
+  virtual void reset();
+  virtual int getChar() { return pred->isOk() ? pred->getChar() : EOF; }
+  virtual int lookChar() { return pred->isOk() ? pred->lookChar() : EOF; }
+  virtual int getBlock(char *blk, int size)
+    { return pred->isOk() ? pred->getBlock(blk, size) : 0; }
+  virtual int getRawChar() { return str->getChar(); }
+  virtual int getRawBlock(char *blk, int size)
+    { return str->getBlock(blk, size); }
+  virtual GBool isBinary(GBool last = gTrue) { return gTrue; }
+
+private:
+
+  StreamPredictor *pred;
+};
+
+PredictorStream::PredictorStream(Stream *strA, int predictorA, int widthA,
+				 int nCompsA, int nBitsA):
+  FilterStream(strA)
+{
+  pred = new StreamPredictor(this, predictorA, widthA, nCompsA, nBitsA);
+}
+
+PredictorStream::~PredictorStream() {
+  delete pred;
+  delete str;
+}
+
+Stream *PredictorStream::copy() {
+  return new PredictorStream(str->copy(), pred->getPredictor(),
+			     pred->getWidth(), pred->getNComps(),
+			     pred->getNBits());
+}
+
+void PredictorStream::reset() {
+  str->reset();
+  if (pred->isOk()) {
+    pred->reset();
+  }
+}
+
+//------------------------------------------------------------------------
+
+// Construct the decoder for [rec] on top of [str].
+static Stream *makeDecoder(BenchRecord *rec, Stream *str) {
+  int *p;
+
+  p = rec->params;
+  switch (rec->decoder) {
+  case benchASCIIHex:
+    return new ASCIIHexStream(str);
+  case benchASCII85:
+    return new ASCII85Stream(str);
+  case benchLZW:
+    return new LZWStream(str, p[0], p[1], p[2], p[3], p[4]);
+  case benchRunLength:
+    return new RunLengthStream(str);
+#ifndef NO_CCITT_STREAM
+  case benchCCITTFax:
+    return new CCITTFaxStream(str, p[0], p[1], p[2], p[3], p[4],
+			      p[5], p[6]);
+#endif
+#ifndef NO_DCT_STREAM
+  case benchDCT:
+    return new DCTStream(str, p[0]);
+#endif
+  case benchFlate:
+    return new FlateStream(str, p[0], p[1], p[2], p[3]);
+#ifndef NO_JBIG_STREAM
+  case benchJBIG2: {
+    Object globals, dictObj;
+    Stream *jbig2Str;
+    if (rec->globals) {
+      dictObj.initNull();
+      globals.initStream(new MemStream(rec->globals->getCString(), 0,
+				       rec->globals->getLength(), &dictObj));
+    } else {
+      globals.initNull();
+    }
+    jbig2Str = new JBIG2Stream(str, &globals);
+    globals.free();
+    return jbig2Str;
+  }
+#endif
+#ifndef NO_JPX_STREAM
+  case benchJPX:
+    return new JPXStream(str);
+#endif
+  case benchDecrypt:
+    return new DecryptStream(str, rec->key, (CryptAlgorithm)p[0], p[1],
+			     p[2], p[3]);
+  case benchPredictor:
+    return new PredictorStream(str, p[0], p[1], p[2], p[3]);
+  case benchChain: {
+    Object dict, dictObj;
+    Parser *parser;
+    Stream *chainStr;
+    if (!rec->globals) {
+      return new EOFStream(str);
+    }
+    dictObj.initNull();
+    parser = new Parser(NULL,
+			new Lexer(NULL,
+				  new MemStream(rec->globals->getCString(), 0,
+						rec->globals->getLength(),
+						&dictObj)),
+			gFalse);
+    parser->getObj(&dict);
+    delete parser;
+    if (dict.isDict()) {
+      chainStr = str->addFilters(&dict);
+    } else {
+      chainStr = new EOFStream(str);
+    }
+    dict.free();
+    return chainStr;
+  }
+  default:
+    return new EOFStream(str);
+  }
+}
+
+// Construct the decoder for [rec], reading the record's data from a
+// MemStream.
+static Stream *makeRecordStream(BenchRecord *rec) {
+  Object dictObj;
+
+  dictObj.initNull();
+  return makeDecoder(rec, new MemStream(rec->data->getCString(), 0,
+					rec->data->getLength(), &dictObj));
+}
+
+// Run one decode of [rec], from construction to destruction of the
+// decoder.  If [out] is non-NULL, the decoded data is appended to it.
+// Returns the number of decoded bytes.
+static double decodeRecord(BenchRecord *rec, GString *out) {
+  char buf[benchBufSize];
+  Stream *str;
+  double total;
+  int n;
+
+  total = 0;
+  str = makeRecordStream(rec);
+  str->reset();
+  while ((n = str->getBlock(buf, sizeof(buf))) > 0) {
+    if (out) {
+      out->append(buf, n);
+    }
+    total += n;
+  }
+  str->close();
+  delete str;
+  return total;
+}
+
+//------------------------------------------------------------------------
+// corpus file I/O
+//------------------------------------------------------------------------
+
+static void writeRecord(FILE *f, BenchRecord *rec) {
+  int i;
+
+  fputs(benchDecoderNames[rec->decoder], f);
+  for (i = 0; i < nBenchParams; ++i) {
+    fprintf(f, " %d", rec->params[i]);
+  }
+  fputc(' ', f);
+  if (rec->decoder == benchDecrypt) {
+    for (i = 0; i < (int)sizeof(rec->key); ++i) {
+      fprintf(f, "%02x", rec->key[i]);
+    }
+  } else {
+    fputc('-', f);
+  }
+  fprintf(f, " %d %d %s\n", rec->data->getLength(),
+	  rec->globals ? rec->globals->getLength() : 0,
+	  rec->source->getCString());
+  fwrite(rec->data->getCString(), 1, rec->data->getLength(), f);
+  if (rec->globals) {
+    fwrite(rec->globals->getCString(), 1, rec->globals->getLength(), f);
+  }
+  fputc('\n', f);
+}
+
+static GString *readBytes(FILE *f, int len) {
+  GString *s;
+  char buf[benchBufSize];
+  int n;
+
+  s = new GString();
+  while (len > 0) {
+    n = len < (int)sizeof(buf) ? len : (int)sizeof(buf);
+    if ((int)fread(buf, 1, n, f) != n) {
+      delete s;
+      return NULL;
+    }
+    s->append(buf, n);
+    len -= n;
+  }
+  return s;
+}
+
+// Read the next record from a corpus file.  Returns NULL at end of
+// file or on error.
+static BenchRecord *readRecord(FILE *f, char *fileName) {
+  BenchRecord *rec;
+  GString *source;
+  char line[2048];
+  char name[32], key[72];
+  int params[nBenchParams];
+  int dataLen, globalsLen, decoder, pos, i, n;
+
+  if (!fgets(line, sizeof(line), f)) {
+    return NULL;
+  }
+  if (sscanf(line, "%31s %d %d %d %d %d %d %d %d %71s %d %d %n",
+	     name, &params[0], &params[1], &params[2], &params[3],
+	     &params[4], &params[5], &params[6], &params[7],
+	     key, &dataLen, &globalsLen, &pos) != 12 ||
+      dataLen < 0 || globalsLen < 0) {
+    error(errSyntaxError, -1, "Bad record in corpus file '{0:s}'", fileName);
+    return NULL;
+  }
+  for (decoder = 0; decoder < nBenchDecoders; ++decoder) {
+    if (!strcmp(name, benchDecoderNames[decoder])) {
+      break;
+    }
+  }
+  if (decoder == nBenchDecoders) {
+    error(errSyntaxError, -1, "Unknown decoder '{0:s}' in corpus file '{1:s}'",
+	  name, fileName);
+    return NULL;
+  }
+  n = (int)strlen(line);
+  while (n > pos && (line[n-1] == '\n' || line[n-1] == '\r')) {
+    --n;
+  }
+  source = new GString(line + pos, n - pos);
+  rec = newRecord((BenchDecoder)decoder, source);
+  delete source;
+  memcpy(rec->params, params, sizeof(params));
+  if (rec->decoder == benchDecrypt) {
+    for (i = 0; i < (int)sizeof(rec->key) && key[2*i] && key[2*i+1]; ++i) {
+      sscanf(key + 2*i, "%2hhx", &rec->key[i]);
+    }
+  }
+  if (!(rec->data = readBytes(f, dataLen)) ||
+      (globalsLen > 0 && !(rec->globals = readBytes(f, globalsLen))) ||
+      fgetc(f) != '\n') {
+    error(errSyntaxError, -1, "Truncated record in corpus file '{0:s}'",
+	  fileName);
+    freeRecord(rec);
+    return NULL;
+  }
+  return rec;
+}
+
+//------------------------------------------------------------------------
+// extraction
+//------------------------------------------------------------------------
+
+static void lookupInt(Object *params, const char *key, int *val) {
+  Object obj;
+
+  if (params->isDict()) {
+    if (params->dictLookup(key, &obj)->isInt()) {
+      *val = obj.getInt();
+    }
+    obj.free();
+  }
+}
+
+static void lookupBool(Object *params, const char *key, int *val) {
+  Object obj;
+
+  if (params->isDict()) {
+    if (params->dictLookup(key, &obj)->isBool()) {
+      *val = obj.getBool() ? 1 : 0;
+    }
+    obj.free();
+  }
+}
+
+static GString *readStream(Stream *str) {
+  GString *s;
+  char buf[benchBufSize];
+  int n;
+
+  s = new GString();
+  str->reset();
+  while ((n = str->getBlock(buf, sizeof(buf))) > 0) {
+    s->append(buf, n);
+  }
+  str->close();
+  return s;
+}
+
+// Create the record for a filter.  This uses the same parameter
+// defaults as Stream::makeFilter.  Returns NULL for unsupported
+// filters.
+static BenchRecord *makeFilterRecord(const char *name, Object *params,
+				     GString *source) {
+  BenchRecord *rec;
+  Object globals;
+  int *p;
+
+  if (!strcmp(name, "ASCIIHexDecode") || !strcmp(name, "AHx")) {
+    return newRecord(benchASCIIHex, source);
+  } else if (!strcmp(name, "ASCII85Decode") || !strcmp(name, "A85")) {
+    return newRecord(benchASCII85, source);
+  } else if (!strcmp(name, "RunLengthDecode") || !strcmp(name, "RL")) {
+    return newRecord(benchRunLength, source);
+  } else if (!strcmp(name, "LZWDecode") || !strcmp(name, "LZW")) {
+    rec = newRecord(benchLZW, source);
+    p = rec->params;
+    p[0] = 1;
+    p[1] = 1;
+    p[2] = 1;
+    p[3] = 8;
+    p[4] = 1;
+    lookupInt(params, "Predictor", &p[0]);
+    lookupInt(params, "Columns", &p[1]);
+    lookupInt(params, "Colors", &p[2]);
+    lookupInt(params, "BitsPerComponent", &p[3]);
+    lookupInt(params, "EarlyChange", &p[4]);
+    return rec;
+  } else if (!strcmp(name, "CCITTFaxDecode") || !strcmp(name, "CCF")) {
+    rec = newRecord(benchCCITTFax, source);
+    p = rec->params;
+    p[0] = 0;
+    p[1] = 0;
+    p[2] = 0;
+    p[3] = 1728;
+    p[4] = 0;
+    p[5] = 1;
+    p[6] = 0;
+    lookupInt(params, "K", &p[0]);
+    lookupBool(params, "EndOfLine", &p[1]);
+    lookupBool(params, "EncodedByteAlign", &p[2]);
+    lookupInt(params, "Columns", &p[3]);
+    lookupInt(params, "Rows", &p[4]);
+    lookupBool(params, "EndOfBlock", &p[5]);
+    lookupBool(params, "BlackIs1", &p[6]);
+    return rec;
+  } else if (!strcmp(name, "DCTDecode") || !strcmp(name, "DCT")) {
+    rec = newRecord(benchDCT, source);
+    rec->params[0] = -1;
+    lookupInt(params, "ColorTransform", &rec->params[0]);
+    return rec;
+  } else if (!strcmp(name, "FlateDecode") || !strcmp(name, "Fl")) {
+    rec = newRecord(benchFlate, source);
+    p = rec->params;
+    p[0] = 1;
+    p[1] = 1;
+    p[2] = 1;
+    p[3] = 8;
+    lookupInt(params, "Predictor", &p[0]);
+    lookupInt(params, "Columns", &p[1]);
+    lookupInt(params, "Colors", &p[2]);
+    lookupInt(params, "BitsPerComponent", &p[3]);
+    return rec;
+  } else if (!strcmp(name, "JBIG2Decode")) {
+    rec = newRecord(benchJBIG2, source);
+    if (params->isDict()) {
+      if (params->dictLookup("JBIG2Globals", &globals)->isStream()) {
+	rec->globals = readStream(globals.getStream());
+      }
+      globals.free();
+    }
+    return rec;
+  } else if (!strcmp(name, "JPXDecode")) {
+    return newRecord(benchJPX, source);
+  }
+  return NULL;
+}
+
+// Append [obj] to [s], in PDF syntax.  Returns false if [obj]
+// contains anything that isn't self-contained (e.g., a stream, like
+// JBIG2Globals).
+static GBool writeObject(Object *obj, GString *s) {
+  Object obj1;
+  const char *p;
+  GBool ok;
+  int c, i;
+
+  switch (obj->getType()) {
+  case objBool:
+    s->append(obj->getBool() ? "true" : "false");
+    return gTrue;
+  case objInt:
+    s->appendf("{0:d}", obj->getInt());
+    return gTrue;
+  case objReal:
+    s->appendf("{0:.6g}", obj->getReal());
+    return gTrue;
+  case objName:
+    s->append('/');
+    for (p = obj->getName(); *p; ++p) {
+      c = *p & 0xff;
+      if (c <= 0x20 || c >= 0x7f || strchr("#%()/<>[]{}", c)) {
+	s->appendf("#{0:02x}", c);
+      } else {
+	s->append((char)c);
+      }
+    }
+    return gTrue;
+  case objNull:
+    s->append("null");
+    return gTrue;
+  case objArray:
+    s->append('[');
+    ok = gTrue;
+    for (i = 0; ok && i < obj->arrayGetLength(); ++i) {
+      if (i > 0) {
+	s->append(' ');
+      }
+      ok = writeObject(obj->arrayGet(i, &obj1), s);
+      obj1.free();
+    }
+    s->append(']');
+    return ok;
+  case objDict:
+    s->append("<<");
+    ok = gTrue;
+    for (i = 0; ok && i < obj->dictGetLength(); ++i) {
+      obj1.initName(obj->dictGetKey(i));
+      writeObject(&obj1, s);
+      obj1.free();
+      s->append(' ');
+      ok = writeObject(obj->dictGetVal(i, &obj1), s);
+      obj1.free();
+    }
+    s->append(">>");
+    return ok;
+  default:
+    return gFalse;
+  }
+}
+
+static void addRecord(FILE *f, BenchRecord *rec, int *nRecords) {
+  if (rec->data->getLength() > 0) {
+    writeRecord(f, rec);
+    ++*nRecords;
+  }
+}
+
+// Write the records for all of the decoder stages of one stream.
+static void extractStream(FILE *f, XRef *xref, Object *strObj,
+			  int num, int gen, char *fileName, int *nRecords) {
+  BenchRecord *rec, *predRec;
+  Stream *str;
+  Dict *dict;
+  Object filter, params, filter1, params1;
+  GString *source, *data;
+  CryptAlgorithm encAlgorithm;
+  GBool ownerPasswordOk;
+  int permFlags, keyLength, encVersion;
+  int nStages, nFilters, i;
+
+  // count the filters in the stream's decoder chain -- this includes
+  // the DecryptStream, if any
+  str = strObj->getStream();
+  nStages = 0;
+  while (str->getNextStream()) {
+    ++nStages;
+    str = str->getNextStream();
+  }
+  if (nStages == 0) {
+    return;
+  }
+
+  dict = strObj->streamGetDict();
+  dict->lookup("Filter", &filter);
+  if (filter.isNull()) {
+    filter.free();
+    dict->lookup("F", &filter);
+  }
+  dict->lookup("DecodeParms", &params);
+  if (params.isNull()) {
+    params.free();
+    dict->lookup("DP", &params);
+  }
+  if (filter.isName()) {
+    nFilters = 1;
+  } else if (filter.isArray()) {
+    nFilters = filter.arrayGetLength();
+  } else {
+    nFilters = 0;
+  }
+  if (nStages != nFilters && !(xref->isEncrypted() &&
+			       nStages == nFilters + 1)) {
+    filter.free();
+    params.free();
+    return;
+  }
+
+  source = GString::format("{0:s}:{1:d}.{2:d}", fileName, num, gen);
+  data = readStream(str);
+
+  // decryption
+  if (nStages == nFilters + 1) {
+    xref->getEncryption(&permFlags, &ownerPasswordOk, &keyLength,
+			&encVersion, &encAlgorithm);
+    rec = newRecord(benchDecrypt, source);
+    rec->params[0] = (int)encAlgorithm;
+    rec->params[1] = keyLength;
+    rec->params[2] = num;
+    rec->params[3] = gen;
+    memcpy(rec->key, xref->getFileKey(), sizeof(rec->key));
+    rec->data = data;
+    addRecord(f, rec, nRecords);
+    data = new GString();
+    decodeRecord(rec, data);
+    freeRecord(rec);
+  }
+
+  // the whole filter chain, if there is more than one filter
+  if (nFilters > 1) {
+    rec = newRecord(benchChain, source);
+    rec->globals = new GString("<</Filter ");
+    if (writeObject(&filter, rec->globals)) {
+      rec->globals->append(" /DecodeParms ");
+      if (writeObject(&params, rec->globals)) {
+	rec->globals->append(">>");
+	rec->data = data->copy();
+	addRecord(f, rec, nRecords);
+      }
+    }
+    freeRecord(rec);
+  }
+
+  // filters
+  for (i = 0; i < nFilters; ++i) {
+    if (filter.isName()) {
+      filter.copy(&filter1);
+      params.copy(&params1);
+    } else {
+      filter.arrayGet(i, &filter1);
+      if (params.isArray()) {
+	params.arrayGet(i, &params1);
+      } else {
+	params1.initNull();
+      }
+    }
+    rec = NULL;
+    if (filter1.isName()) {
+      rec = makeFilterRecord(filter1.getName(), &params1, source);
+    }
+    filter1.free();
+    params1.free();
+    if (!rec) {
+      break;
+    }
+    rec->data = data;
+    addRecord(f, rec, nRecords);
+
+    // the PNG/TIFF predictor gets its own record, with the output of
+    // the Flate/LZW decoder as input
+    if ((rec->decoder == benchFlate || rec->decoder == benchLZW) &&
+	rec->params[0] >= 2) {
+      predRec = newRecord(benchPredictor, source);
+      memcpy(predRec->params, rec->params, 4 * sizeof(int));
+      rec->params[0] = 1;
+      predRec->data = new GString();
+      decodeRecord(rec, predRec->data);
+      addRecord(f, predRec, nRecords);
+      freeRecord(predRec);
+      rec->params[0] = predRec->params[0];
+    }
+
+    if (i < nFilters - 1) {
+      data = new GString();
+      decodeRecord(rec, data);
+    } else {
+      data = NULL;
+    }
+    freeRecord(rec);
+  }
+  if (data) {
+    delete data;
+  }
+
+  delete source;
+  filter.free();
+  params.free();
+}
+
+static GBool extractFile(FILE *f, char *fileName, int *nRecords) {
+  GString *ownerPW, *userPW;
+  PDFDoc *doc;
+  XRef *xref;
+  XRefEntry *entry;
+  Object obj;
+  int num, gen;
+
+  if (ownerPassword[0] != '\001') {
+    ownerPW = new GString(ownerPassword);
+  } else {
+    ownerPW = NULL;
+  }
+  if (userPassword[0] != '\001') {
+    userPW = new GString(userPassword);
+  } else {
+    userPW = NULL;
+  }
+  doc = new PDFDoc(fileName, ownerPW, userPW);
+  if (userPW) {
+    delete userPW;
+  }
+  if (ownerPW) {
+    delete ownerPW;
+  }
+  if (!doc->isOk()) {
+    delete doc;
+    return gFalse;
+  }
+
+  xref = doc->getXRef();
+  for (num = 0; num < xref->getNumObjects(); ++num) {
+    entry = xref->getEntry(num);
+    if (entry->type == xrefEntryFree) {
+      continue;
+    }
+    gen = entry->type == xrefEntryUncompressed ? entry->gen : 0;
+    if (xref->fetch(num, gen, &obj)->isStream()) {
+      extractStream(f, xref, &obj, num, gen, fileName, nRecords);
+    }
+    obj.free();
+  }
+
+  delete doc;
+  return gTrue;
+}
+
+//------------------------------------------------------------------------
+// synthetic records
+//------------------------------------------------------------------------
+
+// Synthetic records are made by encoding arbitrary data, so the
+// decoded data is known in advance.  The encoders used here don't
+// share code with the decoders they check (but the CCITTFax encoder
+// does use the decoder's code tables).
+
+// Prefix lengths of the input data used for the synthetic records
+// (in addition to the whole input): the interesting cases are around
+// the AES block size, the ASCII85 group size, and the read buffer
+// sizes.
+static int synthLengths[] = {
+  0, 1, 15, 16, 17, 4095, 4096, 4097
+};
+#define nSynthLengths ((int)(sizeof(synthLengths) / sizeof(int)))
+
+static struct {
+  CryptAlgorithm algorithm;
+  int keyLength;
+  const char *name;
+} synthCryptModes[] = {
+  { cryptRC4,     5, "rc4-40"  },
+  { cryptRC4,    16, "rc4-128" },
+  { cryptAES,    16, "aes-128" },
+  { cryptAES256, 32, "aes-256" }
+};
+#define nSynthCryptModes \
+  ((int)(sizeof(synthCryptModes) / sizeof(synthCryptModes[0])))
+
+static GString *readFile(char *fileName) {
+  FILE *f;
+  GString *s;
+  char buf[benchBufSize];
+  int n;
+
+  if (!(f = fopen(fileName, "rb"))) {
+    return NULL;
+  }
+  s = new GString();
+  while ((n = (int)fread(buf, 1, sizeof(buf), f)) > 0) {
+    s->append(buf, n);
+  }
+  fclose(f);
+  return s;
+}
+
+// Returns the length of the [i]th prefix of [data], where 0 <= [i] <=
+// nSynthLengths, and the last "prefix" is all of [data].  Returns -1
+// if the prefix isn't shorter than [data].
+static int getSynthLength(GString *data, int i) {
+  if (i == nSynthLengths) {
+    return data->getLength();
+  }
+  return synthLengths[i] < data->getLength() ? synthLengths[i] : -1;
+}
+
+// Write the digest line for record [recNum] to [f].
+static void writeSum(FILE *f, int recNum, GString *data, GString *source) {
+  Guchar digest[16];
+  int i;
+
+  md5((Guchar *)data->getCString(), data->getLength(), digest);
+  fprintf(f, "%d ", recNum);
+  for (i = 0; i < 16; ++i) {
+    fprintf(f, "%02x", digest[i]);
+  }
+  fprintf(f, " %d %s\n", data->getLength(), source->getCString());
+}
+
+// Write a synthetic record and, if [sumsFile] is non-NULL, the digest
+// of the data the record should decode to.  Frees [rec] and
+// [decoded].
+static void addSynthRecord(FILE *f, FILE *sumsFile, BenchRecord *rec,
+			   GString *decoded, int *nRecords) {
+  if (rec->data->getLength() > 0) {
+    writeRecord(f, rec);
+    if (sumsFile) {
+      writeSum(sumsFile, *nRecords, decoded, rec->source);
+    }
+    ++*nRecords;
+  }
+  delete decoded;
+  freeRecord(rec);
+}
+
+//----- AES encryption
+
+// This is a plain byte-oriented implementation of the FIPS-197
+// cipher, separate from the AES decryption code in Decrypt.cc.
+
+static Guchar aesSbox[256];
+
+static inline Guchar aesMul2(Guchar x) {
+  return (Guchar)((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+static inline Guchar aesRotl(Guchar x, int n) {
+  return (Guchar)((x << n) | (x >> (8 - n)));
+}
+
+static void aesInitSbox() {
+  Guchar p, q;
+
+  // p runs through the multiplicative group (powers of 3), and q
+  // through the inverses, which are then run through the affine
+  // transform
+  p = q = 1;
+  do {
+    p = (Guchar)(p ^ aesMul2(p));
+    q = (Guchar)(q ^ (q << 1));
+    q = (Guchar)(q ^ (q << 2));
+    q = (Guchar)(q ^ (q << 4));
+    if (q & 0x80) {
+      q ^= 0x09;
+    }
+    aesSbox[p] = (Guchar)(q ^ aesRotl(q, 1) ^ aesRotl(q, 2) ^
+			  aesRotl(q, 3) ^ aesRotl(q, 4) ^ 0x63);
+  } while (p != 1);
+  aesSbox[0] = 0x63;
+}
+
+// Expand a 16- or 32-byte key into [w] (176 or 240 bytes).
+static void aesExpandKey(Guchar *key, int keyLen, Guchar *w) {
+  Guchar t[4], t0, rcon;
+  int nk, nWords, i, j;
+
+  nk = keyLen / 4;
+  nWords = 4 * (nk + 7);
+  memcpy(w, key, keyLen);
+  rcon = 1;
+  for (i = nk; i < nWords; ++i) {
+    memcpy(t, w + 4 * (i - 1), 4);
+    if (i % nk == 0) {
+      t0 = t[0];
+      t[0] = (Guchar)(aesSbox[t[1]] ^ rcon);
+      t[1] = aesSbox[t[2]];
+      t[2] = aesSbox[t[3]];
+      t[3] = aesSbox[t0];
+      rcon = aesMul2(rcon);
+    } else if (nk > 6 && i % nk == 4) {
+      for (j = 0; j < 4; ++j) {
+	t[j] = aesSbox[t[j]];
+      }
+    }
+    for (j = 0; j < 4; ++j) {
+      w[4 * i + j] = (Guchar)(w[4 * (i - nk) + j] ^ t[j]);
+    }
+  }
+}
+
+// Encrypt one 16-byte block in place.
+static void aesEncryptBlockRef(Guchar *w, int nRounds, Guchar *block) {
+  Guchar t[16];
+  Guchar a0, a1, a2, a3;
+  int round, r, c;
+
+  for (c = 0; c < 16; ++c) {
+    block[c] ^= w[c];
+  }
+  for (round = 1; round <= nRounds; ++round) {
+    // SubBytes + ShiftRows
+    for (c = 0; c < 4; ++c) {
+      for (r = 0; r < 4; ++r) {
+	t[4 * c + r] = aesSbox[block[4 * ((c + r) & 3) + r]];
+      }
+    }
+    // MixColumns (not in the last round)
+    if (round < nRounds) {
+      for (c = 0; c < 4; ++c) {
+	a0 = t[4 * c];
+	a1 = t[4 * c + 1];
+	a2 = t[4 * c + 2];
+	a3 = t[4 * c + 3];
+	t[4 * c]     = (Guchar)(aesMul2(a0) ^ aesMul2(a1) ^ a1 ^ a2 ^ a3);
+	t[4 * c + 1] = (Guchar)(a0 ^ aesMul2(a1) ^ aesMul2(a2) ^ a2 ^ a3);
+	t[4 * c + 2] = (Guchar)(a0 ^ a1 ^ aesMul2(a2) ^ aesMul2(a3) ^ a3);
+	t[4 * c + 3] = (Guchar)(aesMul2(a0) ^ a0 ^ a1 ^ a2 ^ aesMul2(a3));
+      }
+    }
+    for (c = 0; c < 16; ++c) {
+      block[c] = (Guchar)(t[c] ^ w[16 * round + c]);
+    }
+  }
+}
+
+//----- decrypt records
+
+// Compute the object key, as DecryptStream does.  Returns the key
+// length.
+static int makeObjKey(Guchar *fileKey, CryptAlgorithm algorithm,
+		      int keyLength, int objNum, int objGen, Guchar *objKey) {
+  Guchar buf[48];
+  int n;
+
+  if (algorithm == cryptAES256) {
+    memcpy(objKey, fileKey, keyLength);
+    return keyLength;
+  }
+  memcpy(buf, fileKey, keyLength);
+  n = keyLength;
+  buf[n++] = (Guchar)(objNum & 0xff);
+  buf[n++] = (Guchar)((objNum >> 8) & 0xff);
+  buf[n++] = (Guchar)((objNum >> 16) & 0xff);
+  buf[n++] = (Guchar)(objGen & 0xff);
+  buf[n++] = (Guchar)((objGen >> 8) & 0xff);
+  if (algorithm == cryptAES) {
+    memcpy(buf + n, "sAlT", 4);
+    n += 4;
+  }
+  md5(buf, n, objKey);
+  return keyLength + 5 > 16 ? 16 : keyLength + 5;
+}
+
+// Encrypt [len] bytes of [data] the way a PDF writer would: RC4, or
+// AES-CBC with a random IV and PKCS#5 padding.
+static GString *encryptData(Guchar *objKey, int objKeyLen,
+			    CryptAlgorithm algorithm,
+			    const char *data, int len) {
+  GString *s;
+  Guchar rc4State[256];
+  Guchar w[240];
+  Guchar block[16];
+  Guchar x, y;
+  int nRounds, pad, i, j;
+
+  s = new GString();
+  if (algorithm == cryptRC4) {
+    rc4InitKey(objKey, objKeyLen, rc4State);
+    x = y = 0;
+    for (i = 0; i < len; ++i) {
+      s->append((char)rc4DecryptByte(rc4State, &x, &y, (Guchar)data[i]));
+    }
+    return s;
+  }
+
+  aesExpandKey(objKey, objKeyLen, w);
+  nRounds = objKeyLen / 4 + 6;
+  for (i = 0; i < 16; ++i) {
+    block[i] = (Guchar)(rand() & 0xff);
+  }
+  s->append((char *)block, 16);
+  pad = 16 - len % 16;
+  for (i = 0; i < len + pad; i += 16) {
+    for (j = 0; j < 16; ++j) {
+      block[j] ^= i + j < len ? (Guchar)data[i + j] : (Guchar)pad;
+    }
+    aesEncryptBlockRef(w, nRounds, block);
+    s->append((char *)block, 16);
+  }
+  return s;
+}
+
+static void synthDecrypt(FILE *f, FILE *sumsFile, char *fileName,
+			 GString *data, int *nRecords) {
+  BenchRecord *rec;
+  GString *source;
+  Guchar fileKey[32];
+  Guchar objKey[32];
+  int objKeyLen, mode, len, i;
+
+  for (i = 0; i < 32; ++i) {
+    fileKey[i] = (Guchar)(rand() & 0xff);
+  }
+  for (mode = 0; mode < nSynthCryptModes; ++mode) {
+    for (i = 0; i <= nSynthLengths; ++i) {
+      if ((len = getSynthLength(data, i)) < 0) {
+	continue;
+      }
+      source = GString::format("{0:s}:{1:s}:{2:d}",
+			       fileName, synthCryptModes[mode].name, len);
+      rec = newRecord(benchDecrypt, source);
+      delete source;
+      rec->params[0] = (int)synthCryptModes[mode].algorithm;
+      rec->params[1] = synthCryptModes[mode].keyLength;
+      rec->params[2] = *nRecords + 1;
+      rec->params[3] = 0;
+      memcpy(rec->key, fileKey, synthCryptModes[mode].keyLength);
+      objKeyLen = makeObjKey(rec->key, synthCryptModes[mode].algorithm,
+			     rec->params[1], rec->params[2], rec->params[3],
+			     objKey);
+      rec->data = encryptData(objKey, objKeyLen,
+			      synthCryptModes[mode].algorithm,
+			      data->getCString(), len);
+      addSynthRecord(f, sumsFile, rec, new GString(data->getCString(), len),
+		     nRecords);
+    }
+  }
+}
+
+//----- filter records
+
+#define maxSynthChain 3
+
+// Filter chains for the synthetic filter records, in Filter array
+// order (i.e., the first filter is decoded first).  A single filter
+// gets a record for that decoder, and a longer chain gets a chain
+// record.
+static const char *synthChains[][maxSynthChain] = {
+  { "AHx" },
+  { "A85" },
+  { "RL" },
+  { "AHx", "RL" },
+  { "A85", "RL" },
+  { "A85", "AHx", "RL" },
+  { "AHx", "LZW" },
+  { "A85", "LZW" }
+};
+#define nSynthChains ((int)(sizeof(synthChains) / sizeof(synthChains[0])))
+
+// Encode [data] with the encoder for [filter] (the encoders are the
+// ones PSOutputDev uses).
+static GString *encodeData(GString *data, const char *filter) {
+  Object dictObj;
+  Stream *memStr, *str;
+  GString *s;
+
+  dictObj.initNull();
+  memStr = new MemStream(data->getCString(), 0, data->getLength(), &dictObj);
+  if (!strcmp(filter, "AHx")) {
+    str = new ASCIIHexEncoder(memStr);
+  } else if (!strcmp(filter, "A85")) {
+    str = new ASCII85Encoder(memStr);
+  } else if (!strcmp(filter, "LZW")) {
+    str = new LZWEncoder(memStr);
+  } else {
+    str = new RunLengthEncoder(memStr);
+  }
+  s = readStream(str);
+  delete str;
+  delete memStr;
+  return s;
+}
+
+static void synthFilters(FILE *f, FILE *sumsFile, char *fileName,
+			 GString *data, int *nRecords) {
+  BenchRecord *rec;
+  GString *name, *source, *encoded, *s;
+  Object params;
+  int chain, n, len, i, j;
+
+  params.initNull();
+  for (chain = 0; chain < nSynthChains; ++chain) {
+    name = new GString();
+    for (n = 0; n < maxSynthChain && synthChains[chain][n]; ++n) {
+      if (n > 0) {
+	name->append('+');
+      }
+      name->append(synthChains[chain][n]);
+    }
+    for (i = 0; i <= nSynthLengths; ++i) {
+      if ((len = getSynthLength(data, i)) < 0) {
+	continue;
+      }
+      source = GString::format("{0:s}:{1:t}:{2:d}", fileName, name, len);
+      if (n == 1) {
+	rec = makeFilterRecord(synthChains[chain][0], &params, source);
+      } else {
+	rec = newRecord(benchChain, source);
+	rec->globals = new GString("<</Filter [");
+	for (j = 0; j < n; ++j) {
+	  rec->globals->appendf("{0:s}/{1:s}", j > 0 ? " " : "",
+				synthChains[chain][j]);
+	}
+	rec->globals->append("]>>");
+      }
+      delete source;
+      encoded = new GString(data->getCString(), len);
+      for (j = n - 1; j >= 0; --j) {
+	s = encodeData(encoded, synthChains[chain][j]);
+	delete encoded;
+	encoded = s;
+      }
+      rec->data = encoded;
+      addSynthRecord(f, sumsFile, rec, new GString(data->getCString(), len),
+		     nRecords);
+    }
+    delete name;
+  }
+}
+
+//----- bit output
+
+// Bit-oriented output for the LZW and CCITTFax encoders.
+struct SynthBitWriter {
+  GString *s;			// complete bytes
+  Guint buf;			// bit buffer
+  int bufLen;			// number of bits in buf
+};
+
+static void initBits(SynthBitWriter *w) {
+  w->s = new GString();
+  w->buf = 0;
+  w->bufLen = 0;
+}
+
+// Append the [n]-bit [code] (n <= 16).
+static void putBits(SynthBitWriter *w, int code, int n) {
+  w->buf = (w->buf << n) | ((Guint)code & ((1 << n) - 1));
+  w->bufLen += n;
+  while (w->bufLen >= 8) {
+    w->s->append((char)((w->buf >> (w->bufLen - 8)) & 0xff));
+    w->bufLen -= 8;
+  }
+}
+
+// Returns the number of bits written so far.
+static int getBitCount(SynthBitWriter *w) {
+  return 8 * w->s->getLength() + w->bufLen;
+}
+
+// Pad with zero bits to a byte boundary, and return the data.
+static GString *finishBits(SynthBitWriter *w) {
+  if (w->bufLen > 0) {
+    putBits(w, 0, 8 - w->bufLen);
+  }
+  return w->s;
+}
+
+//----- LZW records
+
+// Encode [len] bytes of [data] with LZW, using the given EarlyChange
+// value.  LZWEncoder only does EarlyChange = 1 (and it is used for
+// the chain records), so this is a separate, plain encoder.
+static GString *encodeLZW(const char *data, int len, int earlyChange) {
+  SynthBitWriter w;
+  short *table;
+  int nextCode, codeLen, code, c, i;
+
+  // table[code * 256 + c] is the code for sequence [code] followed by
+  // byte c, or 0 if there is no such code yet
+  table = (short *)gmallocn(4096 * 256, sizeof(short));
+  memset(table, 0, 4096 * 256 * sizeof(short));
+  initBits(&w);
+  nextCode = 258;
+  codeLen = 9;
+  putBits(&w, 256, codeLen);
+  code = -1;
+  for (i = 0; i <= len; ++i) {
+    c = i < len ? (data[i] & 0xff) : -1;
+    if (code < 0) {
+      code = c;
+      continue;
+    }
+    if (c >= 0 && table[code * 256 + c]) {
+      code = table[code * 256 + c];
+      continue;
+    }
+    putBits(&w, code, codeLen);
+    if (c >= 0) {
+      table[code * 256 + c] = (short)nextCode;
+    }
+    ++nextCode;
+    code = c;
+
+    // the decoder adds each table entry one code later than the
+    // encoder, so it sees nextCode - 1
+    if (nextCode - 1 + earlyChange == (1 << codeLen)) {
+      if (codeLen < 12) {
+	++codeLen;
+      }
+    }
+    if (nextCode == 4096) {
+      putBits(&w, 256, codeLen);
+      memset(table, 0, 4096 * 256 * sizeof(short));
+      nextCode = 258;
+      codeLen = 9;
+    }
+  }
+  putBits(&w, 257, codeLen);
+  gfree(table);
+  return finishBits(&w);
+}
+
+static void synthLZW(FILE *f, FILE *sumsFile, char *fileName,
+		     GString *data, int *nRecords) {
+  BenchRecord *rec;
+  GString *source;
+  Object params;
+  int earlyChange, len, i;
+
+  params.initNull();
+  for (earlyChange = 1; earlyChange >= 0; --earlyChange) {
+    for (i = 0; i <= nSynthLengths; ++i) {
+      if ((len = getSynthLength(data, i)) < 0) {
+	continue;
+      }
+      source = GString::format("{0:s}:LZW-early{1:d}:{2:d}",
+			       fileName, earlyChange, len);
+      rec = makeFilterRecord("LZW", &params, source);
+      delete source;
+      rec->params[4] = earlyChange;
+      rec->data = encodeLZW(data->getCString(), len, earlyChange);
+      addSynthRecord(f, sumsFile, rec, new GString(data->getCString(), len),
+		     nRecords);
+    }
+  }
+}
+
+//----- bitmaps
+
+// Make a bitmap (one byte per pixel, 1 = black) from [data]: either
+// the data is used directly as packed pixels ([scale] = 0), or each
+// byte is one pixel -- black unless it is whitespace -- scaled
+// horizontally by [scale], which looks somewhat like text, and has
+// longer runs.  Each row is repeated [vScale] times.  Returns the
+// number of rows, which is at most [maxRows].
+static int makeSynthBitmap(GString *data, int columns, int scale,
+			   int vScale, int maxRows, Guchar **pixels) {
+  Guchar *p;
+  int rows, x, y, i;
+
+  if (scale == 0) {
+    rows = (int)(8 * (double)data->getLength() / columns);
+  } else {
+    rows = (int)(scale * (double)data->getLength() / columns);
+  }
+  if (rows > maxRows / vScale) {
+    rows = maxRows / vScale;
+  }
+  rows *= vScale;
+  p = (Guchar *)gmallocn(rows > 0 ? rows : 1, columns);
+  for (y = 0; y < rows; ++y) {
+    for (x = 0; x < columns; ++x) {
+      i = (y / vScale) * columns + x;
+      if (scale == 0) {
+	p[y * columns + x] =
+	    (Guchar)((data->getChar(i >> 3) >> (7 - (i & 7))) & 1);
+      } else {
+	p[y * columns + x] = (Guchar)((data->getChar(i / scale) & 0xff) > ' ');
+      }
+    }
+  }
+  *pixels = p;
+  return rows;
+}
+
+//----- CCITTFax records
+
+// maximum number of rows in a synthetic CCITTFax image
+#define maxSynthCCITTRows 400
+
+// The images are made from the input data (see makeSynthBitmap).
+static struct {
+  const char *name;
+  int columns;
+  int scale;			// 0 for packed pixels
+} synthCCITTImages[] = {
+  { "bits",   1728,  0 },
+  { "bits",     31,  0 },
+  { "text",   2550,  1 },
+  { "text16", 4000, 16 }
+};
+#define nSynthCCITTImages \
+  ((int)(sizeof(synthCCITTImages) / sizeof(synthCCITTImages[0])))
+
+// Parameter combinations; if [setRows] is false, the Rows parameter
+// is 0, and the decoder stops at the end-of-block code.
+static struct {
+  int k;
+  GBool endOfLine;
+  GBool encodedByteAlign;
+  GBool endOfBlock;
+  GBool blackIs1;
+  GBool setRows;
+} synthCCITTModes[] = {
+  { -1, gFalse, gFalse, gTrue,  gFalse, gTrue  },
+  { -1, gFalse, gFalse, gTrue,  gTrue,  gFalse },
+  { -1, gFalse, gTrue,  gFalse, gFalse, gTrue  },
+  {  0, gFalse, gFalse, gFalse, gFalse, gTrue  },
+  {  0, gTrue,  gFalse, gTrue,  gFalse, gFalse },
+  {  0, gTrue,  gTrue,  gTrue,  gTrue,  gTrue  },
+  {  2, gTrue,  gFalse, gTrue,  gTrue,  gTrue  },
+  {  3, gFalse, gFalse, gFalse, gFalse, gTrue  },
+  {  3, gTrue,  gTrue,  gTrue,  gFalse, gFalse }
+};
+#define nSynthCCITTModes \
+  ((int)(sizeof(synthCCITTModes) / sizeof(synthCCITTModes[0])))
+
+struct SynthCCITTCode {
+  int code;
+  int len;			// 0 if not set
+};
+
+// Encoding tables, indexed by run length (terminating and makeup
+// codes) or 2D mode.
+static SynthCCITTCode ccittWhiteCodes[2561];
+static SynthCCITTCode ccittBlackCodes[2561];
+static SynthCCITTCode ccittTwoDimCodes[9];
+
+// Add the codes from a decoding table, which is indexed by the
+// [tabBits]-bit code, minus [offset].
+static void invertCCITTTable(CCITTCode *tab, int tabSize, int tabBits,
+			     int offset, SynthCCITTCode *codes, int nCodes) {
+  int i;
+
+  for (i = 0; i < tabSize; ++i) {
+    if (tab[i].bits > 0 && tab[i].n >= 0 && tab[i].n < nCodes &&
+	codes[tab[i].n].len == 0) {
+      codes[tab[i].n].code = (i + offset) >> (tabBits - tab[i].bits);
+      codes[tab[i].n].len = tab[i].bits;
+    }
+  }
+}
+
+static void initCCITTCodes() {
+  invertCCITTTable(twoDimTab1, 128, 7, 0, ccittTwoDimCodes, 9);
+  invertCCITTTable(whiteTab2, 512, 9, 0, ccittWhiteCodes, 2561);
+  invertCCITTTable(whiteTab1, 32, 12, 0, ccittWhiteCodes, 2561);
+  invertCCITTTable(blackTab3, 64, 6, 0, ccittBlackCodes, 2561);
+  invertCCITTTable(blackTab2, 192, 12, 64, ccittBlackCodes, 2561);
+  invertCCITTTable(blackTab1, 128, 13, 0, ccittBlackCodes, 2561);
+}
+
+static void putCCITTCode(SynthBitWriter *w, SynthCCITTCode *code) {
+  putBits(w, code->code, code->len);
+}
+
+// Write a run of [n] pixels of [color] (1 = black).
+static void putCCITTRun(SynthBitWriter *w, int n, int color) {
+  SynthCCITTCode *codes;
+
+  codes = color ? ccittBlackCodes : ccittWhiteCodes;
+  while (n >= 2560) {
+    putCCITTCode(w, &codes[2560]);
+    n -= 2560;
+  }
+  if (n >= 64) {
+    putCCITTCode(w, &codes[n & ~63]);
+    n &= 63;
+  }
+  putCCITTCode(w, &codes[n]);
+}
+
+// Returns the position of the first changing element in [line] after
+// [pos] (with the color of the pixel before [line] taken as white),
+// or [columns] if there isn't one.  If [color] is 0 or 1, only
+// changes to the other color count.
+static int nextCCITTChange(Guchar *line, int columns, int pos, int color) {
+  int i;
+
+  for (i = pos + 1; i < columns; ++i) {
+    if (line[i] != (i > 0 ? line[i - 1] : 0) && line[i] != color) {
+      return i;
+    }
+  }
+  return columns;
+}
+
+static void encodeCCITTRow1D(SynthBitWriter *w, Guchar *line, int columns) {
+  int a0, a1, color;
+
+  a0 = 0;
+  color = 0;
+  do {
+    for (a1 = a0; a1 < columns && line[a1] == color; ++a1) ;
+    putCCITTRun(w, a1 - a0, color);
+    a0 = a1;
+    color ^= 1;
+  } while (a0 < columns);
+}
+
+static void encodeCCITTRow2D(SynthBitWriter *w, Guchar *line, Guchar *ref,
+			     int columns) {
+  int a0, a1, a2, b1, b2, color, d;
+
+  a0 = -1;
+  color = 0;
+  do {
+    if (a0 >= 0) {
+      a1 = nextCCITTChange(line, columns, a0, -1);
+      b1 = nextCCITTChange(ref, columns, a0, color);
+    } else {
+      a1 = line[0] ? 0 : nextCCITTChange(line, columns, 0, -1);
+      b1 = ref[0] ? 0 : nextCCITTChange(ref, columns, 0, color);
+    }
+    b2 = b1 < columns ? nextCCITTChange(ref, columns, b1, -1) : columns;
+    if (b2 < a1) {
+      putCCITTCode(w, &ccittTwoDimCodes[twoDimPass]);
+      a0 = b2;
+      continue;
+    }
+    d = a1 - b1;
+    if (d >= -3 && d <= 3) {
+      switch (d) {
+      case 0:  d = twoDimVert0;  break;
+      case 1:  d = twoDimVertR1; break;
+      case 2:  d = twoDimVertR2; break;
+      case 3:  d = twoDimVertR3; break;
+      case -1: d = twoDimVertL1; break;
+      case -2: d = twoDimVertL2; break;
+      default: d = twoDimVertL3; break;
+      }
+      putCCITTCode(w, &ccittTwoDimCodes[d]);
+      a0 = a1;
+      color ^= 1;
+    } else {
+      a2 = a1 < columns ? nextCCITTChange(line, columns, a1, -1) : columns;
+      putCCITTCode(w, &ccittTwoDimCodes[twoDimHoriz]);
+      putCCITTRun(w, a1 - (a0 > 0 ? a0 : 0), color);
+      putCCITTRun(w, a2 - a1, color ^ 1);
+      a0 = a2;
+    }
+  } while (a0 < columns);
+}
+
+static GString *encodeCCITT(Guchar *pixels, int columns, int rows,
+			    int mode) {
+  SynthBitWriter w;
+  Guchar *line, *ref, *white;
+  GBool twoD;
+  int k, y, i;
+
+  k = synthCCITTModes[mode].k;
+  initBits(&w);
+  white = (Guchar *)gmalloc(columns);
+  memset(white, 0, columns);
+  ref = white;
+  for (y = 0; y < rows; ++y) {
+    line = pixels + y * columns;
+    if (synthCCITTModes[mode].endOfLine) {
+      if (synthCCITTModes[mode].encodedByteAlign) {
+	while ((getBitCount(&w) + 12) % 8) {
+	  putBits(&w, 0, 1);
+	}
+      }
+      putBits(&w, 1, 12);
+    }
+    if (k > 0) {
+      twoD = y % k != 0;
+      putBits(&w, twoD ? 0 : 1, 1);
+    } else {
+      twoD = k < 0;
+    }
+    if (twoD) {
+      encodeCCITTRow2D(&w, line, ref, columns);
+    } else {
+      encodeCCITTRow1D(&w, line, columns);
+    }
+    if (synthCCITTModes[mode].encodedByteAlign &&
+	!synthCCITTModes[mode].endOfLine && w.bufLen > 0) {
+      putBits(&w, 0, 8 - w.bufLen);
+    }
+    ref = line;
+  }
+  if (synthCCITTModes[mode].endOfBlock) {
+    // EOFB (2 EOLs) or RTC (6 EOLs)
+    for (i = 0; i < (k < 0 ? 2 : 6); ++i) {
+      putBits(&w, 1, 12);
+      if (k > 0) {
+	putBits(&w, 1, 1);
+      }
+    }
+  }
+  gfree(white);
+  return finishBits(&w);
+}
+
+// Pack the pixels the way the decoder returns them: one bit per
+// pixel, 1 = white, with each row padded to a byte boundary with 0
+// bits -- and all of it inverted if BlackIs1 is set.
+static GString *packCCITTImage(Guchar *pixels, int columns, int rows,
+			       GBool blackIs1) {
+  GString *s;
+  int x, y, c, i;
+
+  s = new GString();
+  for (y = 0; y < rows; ++y) {
+    for (x = 0; x < columns; x += 8) {
+      c = 0;
+      for (i = 0; i < 8; ++i) {
+	c <<= 1;
+	if (x + i < columns) {
+	  c |= pixels[y * columns + x + i] ^ 1;
+	}
+      }
+      s->append((char)(blackIs1 ? c ^ 0xff : c));
+    }
+  }
+  return s;
+}
+
+static void synthCCITT(FILE *f, FILE *sumsFile, char *fileName,
+		       GString *data, int *nRecords) {
+  BenchRecord *rec;
+  GString *source;
+  Object params;
+  Guchar *pixels;
+  int image, mode, rows;
+
+  params.initNull();
+  for (image = 0; image < nSynthCCITTImages; ++image) {
+    rows = makeSynthBitmap(data, synthCCITTImages[image].columns,
+			   synthCCITTImages[image].scale, 1,
+			   maxSynthCCITTRows, &pixels);
+    if (rows > 0) {
+      for (mode = 0; mode < nSynthCCITTModes; ++mode) {
+	source = GString::format("{0:s}:CCF-{1:s}{2:d}-{3:d}",
+				 fileName, synthCCITTImages[image].name,
+				 synthCCITTImages[image].columns, mode);
+	rec = makeFilterRecord("CCF", &params, source);
+	delete source;
+	rec->params[0] = synthCCITTModes[mode].k;
+	rec->params[1] = synthCCITTModes[mode].endOfLine;
+	rec->params[2] = synthCCITTModes[mode].encodedByteAlign;
+	rec->params[3] = synthCCITTImages[image].columns;
+	rec->params[4] = synthCCITTModes[mode].setRows ? rows : 0;
+	rec->params[5] = synthCCITTModes[mode].endOfBlock;
+	rec->params[6] = synthCCITTModes[mode].blackIs1;
+	rec->data = encodeCCITT(pixels, synthCCITTImages[image].columns, rows,
+				mode);
+	addSynthRecord(f, sumsFile, rec,
+		       packCCITTImage(pixels, synthCCITTImages[image].columns,
+				      rows, synthCCITTModes[mode].blackIs1),
+		       nRecords);
+      }
+    }
+    gfree(pixels);
+  }
+}
+
+#ifndef NO_JBIG_STREAM
+
+//----- JBIG2 records
+
+// The encoder makes embedded (PDF) JBIG2 streams with one page, with
+// either a generic region, or a symbol dictionary and a text region,
+// all arithmetic coded.  The symbol dictionary can be in the stream or
+// in the globals.
+
+// maximum number of rows in a synthetic JBIG2 generic region
+#define maxSynthJBIG2Rows 300
+
+// size of the synthetic text page
+#define synthJBIG2PageWidth 1200
+#define synthJBIG2PageHeight 1000
+
+// number of symbols in the synthetic symbol dictionary
+#define nSynthJBIG2Syms 40
+
+// MQ encoder probability estimation table (JBIG2 Annex E)
+static Guint mqQe[47] = {
+  0x5601, 0x3401, 0x1801, 0x0ac1, 0x0521, 0x0221, 0x5601, 0x5401,
+  0x4801, 0x3801, 0x3001, 0x2401, 0x1c01, 0x1601, 0x5601, 0x5401,
+  0x5101, 0x4801, 0x3801, 0x3401, 0x3001, 0x2801, 0x2401, 0x2201,
+  0x1c01, 0x1801, 0x1601, 0x1401, 0x1201, 0x1101, 0x0ac1, 0x09c1,
+  0x08a1, 0x0521, 0x0441, 0x02a1, 0x0221, 0x0141, 0x0111, 0x0085,
+  0x0049, 0x0025, 0x0015, 0x0009, 0x0005, 0x0001, 0x5601
+};
+static Guchar mqNMPS[47] = {
+   1,  2,  3,  4,  5, 38,  7,  8,  9, 10, 11, 12, 13, 29, 15, 16,
+  17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32,
+  33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 45, 46
+};
+static Guchar mqNLPS[47] = {
+   1,  6,  9, 12, 29, 33,  6, 14, 14, 14, 17, 18, 20, 21, 14, 14,
+  15, 16, 17, 18, 19, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29,
+  30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 46
+};
+static Guchar mqSwitch[47] = {
+  1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+// MQ arithmetic encoder (JBIG2 Annex E.2).  The context statistics
+// are arrays of (index << 1) | mps, initially zero.
+struct MQEncoder {
+  GString *s;			// output
+  Guint a, c;			// interval and code registers
+  int ct;			// bit counter
+  int b;			// output byte (not yet written)
+  GBool first;			// set if b is before the start
+};
+
+static void mqInit(MQEncoder *e) {
+  e->s = new GString();
+  e->a = 0x8000;
+  e->c = 0;
+  e->ct = 12;
+  e->b = 0;
+  e->first = gTrue;
+}
+
+static void mqByteOut(MQEncoder *e) {
+  if (!e->first && e->b == 0xff) {
+    e->s->append((char)e->b);
+    e->b = (e->c >> 20) & 0xff;
+    e->c &= 0xfffff;
+    e->ct = 7;
+  } else {
+    if (e->c >= 0x8000000) {
+      ++e->b;
+      e->c &= 0x7ffffff;
+    }
+    if (e->b == 0xff) {
+      e->s->append((char)e->b);
+      e->b = (e->c >> 20) & 0xff;
+      e->c &= 0xfffff;
+      e->ct = 7;
+    } else {
+      if (!e->first) {
+	e->s->append((char)e->b);
+      }
+      e->b = (e->c >> 19) & 0xff;
+      e->c &= 0x7ffff;
+      e->ct = 8;
+    }
+  }
+  e->first = gFalse;
+}
+
+static void mqRenorm(MQEncoder *e) {
+  do {
+    e->a = (e->a << 1) & 0xffff;
+    e->c <<= 1;
+    if (--e->ct == 0) {
+      mqByteOut(e);
+    }
+  } while (!(e->a & 0x8000));
+}
+
+// Encode bit [d] in context [cx].
+static void mqEncode(MQEncoder *e, Guchar *stats, int cx, int d) {
+  Guint qe;
+  int i, mps;
+
+  i = stats[cx] >> 1;
+  mps = stats[cx] & 1;
+  qe = mqQe[i];
+  e->a -= qe;
+  if (d == mps) {
+    if (e->a & 0x8000) {
+      e->c += qe;
+    } else {
+      if (e->a < qe) {
+	e->a = qe;
+      } else {
+	e->c += qe;
+      }
+      stats[cx] = (Guchar)((mqNMPS[i] << 1) | mps);
+      mqRenorm(e);
+    }
+  } else {
+    if (e->a < qe) {
+      e->c += qe;
+    } else {
+      e->a = qe;
+    }
+    if (mqSwitch[i]) {
+      mps ^= 1;
+    }
+    stats[cx] = (Guchar)((mqNLPS[i] << 1) | mps);
+    mqRenorm(e);
+  }
+}
+
+// Flush the encoder, append the end marker, and return the data.
+static GString *mqFinish(MQEncoder *e) {
+  Guint t;
+
+  t = e->c + e->a;
+  e->c |= 0xffff;
+  if (e->c >= t) {
+    e->c -= 0x8000;
+  }
+  e->c <<= e->ct;
+  mqByteOut(e);
+  e->c <<= e->ct;
+  mqByteOut(e);
+  if (e->b != 0xff) {
+    e->s->append((char)e->b);
+  }
+  e->s->append("\xff\xac", 2);
+  return e->s;
+}
+
+static void mqEncodeIntBit(MQEncoder *e, Guchar *stats, int *prev, int bit) {
+  mqEncode(e, stats, *prev, bit);
+  if (*prev < 0x100) {
+    *prev = (*prev << 1) | bit;
+  } else {
+    *prev = (((*prev << 1) | bit) & 0x1ff) | 0x100;
+  }
+}
+
+// Encode [v] with the arithmetic integer coder (JBIG2 Annex A.2), or
+// OOB if [oob] is set.  [stats] has 512 contexts.
+static void mqEncodeInt(MQEncoder *e, Guchar *stats, int v, GBool oob) {
+  Guint a;
+  int prev, prefix, n, i;
+
+  prev = 1;
+  if (oob) {
+    mqEncodeIntBit(e, stats, &prev, 1);
+    for (i = 0; i < 3; ++i) {
+      mqEncodeIntBit(e, stats, &prev, 0);
+    }
+    return;
+  }
+  mqEncodeIntBit(e, stats, &prev, v < 0);
+  a = v < 0 ? -v : v;
+  if (a < 4) {
+    prefix = 0;
+    n = 2;
+  } else if (a < 20) {
+    prefix = 1;
+    n = 4;
+    a -= 4;
+  } else if (a < 84) {
+    prefix = 2;
+    n = 6;
+    a -= 20;
+  } else if (a < 340) {
+    prefix = 3;
+    n = 8;
+    a -= 84;
+  } else if (a < 4436) {
+    prefix = 4;
+    n = 12;
+    a -= 340;
+  } else {
+    prefix = 5;
+    n = 32;
+    a -= 4436;
+  }
+  for (i = 0; i < prefix; ++i) {
+    mqEncodeIntBit(e, stats, &prev, 1);
+  }
+  if (prefix < 5) {
+    mqEncodeIntBit(e, stats, &prev, 0);
+  }
+  for (i = n - 1; i >= 0; --i) {
+    mqEncodeIntBit(e, stats, &prev, (a >> i) & 1);
+  }
+}
+
+// Encode the [codeLen]-bit symbol ID [v] (JBIG2 Annex A.3).
+static void mqEncodeIAID(MQEncoder *e, Guchar *stats, int codeLen, int v) {
+  int prev, bit, i;
+
+  prev = 1;
+  for (i = codeLen - 1; i >= 0; --i) {
+    bit = (v >> i) & 1;
+    mqEncode(e, stats, prev, bit);
+    prev = (prev << 1) | bit;
+  }
+}
+
+//----- generic regions
+
+// Generic region templates and AT pixel positions.  The first mode of
+// each template uses the nominal AT pixels, which the decoder has fast
+// paths for.
+static struct {
+  int templ;
+  GBool tpgdOn;
+  signed char atx[4], aty[4];
+} synthJBIG2GenericModes[] = {
+  { 0, gFalse, {  3, -3,  2, -2 }, { -1, -1, -2, -2 } },
+  { 0, gTrue,  {  3, -3,  2, -2 }, { -1, -1, -2, -2 } },
+  { 0, gTrue,  { -6,  5, -3,  4 }, { -1, -2, -2, -1 } },
+  { 1, gFalse, {  3 },             { -1 } },
+  { 1, gTrue,  {  3 },             { -1 } },
+  { 1, gTrue,  { -4 },             {  0 } },
+  { 2, gFalse, {  2 },             { -1 } },
+  { 2, gTrue,  {  2 },             { -1 } },
+  { 3, gFalse, {  2 },             { -1 } },
+  { 3, gTrue,  {  2 },             { -1 } },
+  { 3, gTrue,  { -5 },             { -2 } }
+};
+#define nSynthJBIG2GenericModes \
+  ((int)(sizeof(synthJBIG2GenericModes) / sizeof(synthJBIG2GenericModes[0])))
+
+// The images are made from the input data (see makeSynthBitmap); the
+// second one repeats each row, for TPGDON.
+static struct {
+  const char *name;
+  int columns;
+  int scale;
+  int vScale;
+} synthJBIG2Images[] = {
+  { "bits", 1000, 0, 1 },
+  { "text",  997, 3, 2 }
+};
+#define nSynthJBIG2Images \
+  ((int)(sizeof(synthJBIG2Images) / sizeof(synthJBIG2Images[0])))
+
+// TPGDON contexts, per template
+static int synthJBIG2LTPContext[4] = { 0x3953, 0x079a, 0x0e3, 0x18b };
+
+static inline int getSynthPixel(Guchar *pixels, int w, int h, int x, int y) {
+  if (x < 0 || x >= w || y < 0 || y >= h) {
+    return 0;
+  }
+  return pixels[y * w + x];
+}
+
+// Encode a [w] x [h] bitmap with generic region mode [mode].
+static void encodeJBIG2Generic(MQEncoder *e, Guchar *stats,
+			       Guchar *pixels, int w, int h, int mode) {
+  signed char *atx, *aty;
+  Guchar *p;
+  GBool ltp, typical;
+  int templ, cx, x, y;
+
+#define px(dx, dy) getSynthPixel(pixels, w, h, x + (dx), y + (dy))
+  templ = synthJBIG2GenericModes[mode].templ;
+  atx = synthJBIG2GenericModes[mode].atx;
+  aty = synthJBIG2GenericModes[mode].aty;
+  ltp = gFalse;
+  for (y = 0; y < h; ++y) {
+    if (synthJBIG2GenericModes[mode].tpgdOn) {
+      p = pixels + y * w;
+      if (y == 0) {
+	for (x = 0; x < w && !p[x]; ++x) ;
+	typical = x == w;
+      } else {
+	typical = !memcmp(p, p - w, w);
+      }
+      mqEncode(e, stats, synthJBIG2LTPContext[templ], typical != ltp);
+      ltp = typical;
+      if (typical) {
+	continue;
+      }
+    }
+    for (x = 0; x < w; ++x) {
+      switch (templ) {
+      case 0:
+      default:
+	cx = (px(-1, -2) << 15) | (px(0, -2) << 14) | (px(1, -2) << 13) |
+	     (px(-2, -1) << 12) | (px(-1, -1) << 11) | (px(0, -1) << 10) |
+	     (px(1, -1) << 9) | (px(2, -1) << 8) |
+	     (px(-4, 0) << 7) | (px(-3, 0) << 6) | (px(-2, 0) << 5) |
+	     (px(-1, 0) << 4) |
+	     (px(atx[0], aty[0]) << 3) | (px(atx[1], aty[1]) << 2) |
+	     (px(atx[2], aty[2]) << 1) | px(atx[3], aty[3]);
+	break;
+      case 1:
+	cx = (px(-1, -2) << 12) | (px(0, -2) << 11) | (px(1, -2) << 10) |
+	     (px(2, -2) << 9) |
+	     (px(-2, -1) << 8) | (px(-1, -1) << 7) | (px(0, -1) << 6) |
+	     (px(1, -1) << 5) | (px(2, -1) << 4) |
+	     (px(-3, 0) << 3) | (px(-2, 0) << 2) | (px(-1, 0) << 1) |
+	     px(atx[0], aty[0]);
+	break;
+      case 2:
+	cx = (px(-1, -2) << 9) | (px(0, -2) << 8) | (px(1, -2) << 7) |
+	     (px(-2, -1) << 6) | (px(-1, -1) << 5) | (px(0, -1) << 4) |
+	     (px(1, -1) << 3) |
+	     (px(-2, 0) << 2) | (px(-1, 0) << 1) |
+	     px(atx[0], aty[0]);
+	break;
+      case 3:
+	cx = (px(-3, -1) << 9) | (px(-2, -1) << 8) | (px(-1, -1) << 7) |
+	     (px(0, -1) << 6) | (px(1, -1) << 5) |
+	     (px(-4, 0) << 4) | (px(-3, 0) << 3) | (px(-2, 0) << 2) |
+	     (px(-1, 0) << 1) |
+	     px(atx[0], aty[0]);
+	break;
+      }
+      mqEncode(e, stats, cx, pixels[y * w + x]);
+    }
+  }
+#undef px
+}
+
+//----- segments
+
+static void putU16(GString *s, Guint x) {
+  s->append((char)((x >> 8) & 0xff));
+  s->append((char)(x & 0xff));
+}
+
+static void putU32(GString *s, Guint x) {
+  putU16(s, x >> 16);
+  putU16(s, x & 0xffff);
+}
+
+// Append a segment (with page association 1, and at most one referred
+// segment) with [data] to [s], and delete [data].
+static void putJBIG2Segment(GString *s, int segNum, int type, int refSegNum,
+			    GString *data) {
+  putU32(s, segNum);
+  s->append((char)type);
+  if (refSegNum >= 0) {
+    s->append((char)(1 << 5));
+    s->append((char)refSegNum);
+  } else {
+    s->append((char)0);
+  }
+  s->append((char)1);
+  putU32(s, data->getLength());
+  s->append(data);
+  delete data;
+}
+
+static void putJBIG2PageInfo(GString *s, int segNum, int w, int h) {
+  GString *data;
+
+  data = new GString();
+  putU32(data, w);
+  putU32(data, h);
+  putU32(data, 0);
+  putU32(data, 0);
+  data->append((char)0);
+  putU16(data, 0);
+  putJBIG2Segment(s, segNum, 48, -1, data);
+}
+
+// Append the region segment info field for a region at (0, 0).
+static void putJBIG2RegionInfo(GString *s, int w, int h) {
+  putU32(s, w);
+  putU32(s, h);
+  putU32(s, 0);
+  putU32(s, 0);
+  s->append((char)0);
+}
+
+static void putJBIG2AT(GString *s, int mode) {
+  int i;
+
+  for (i = 0; i < (synthJBIG2GenericModes[mode].templ == 0 ? 4 : 1); ++i) {
+    s->append((char)synthJBIG2GenericModes[mode].atx[i]);
+    s->append((char)synthJBIG2GenericModes[mode].aty[i]);
+  }
+}
+
+// Make a stream with a page that has one immediate generic region.
+static GString *encodeJBIG2GenericPage(Guchar *pixels, int w, int h,
+				       int mode) {
+  MQEncoder e;
+  GString *s, *data;
+  Guchar *stats;
+
+  s = new GString();
+  putJBIG2PageInfo(s, 0, w, h);
+  data = new GString();
+  putJBIG2RegionInfo(data, w, h);
+  data->append((char)((synthJBIG2GenericModes[mode].templ << 1) |
+		      (synthJBIG2GenericModes[mode].tpgdOn ? 8 : 0)));
+  putJBIG2AT(data, mode);
+  stats = (Guchar *)gmalloc(1 << 16);
+  memset(stats, 0, 1 << 16);
+  mqInit(&e);
+  encodeJBIG2Generic(&e, stats, pixels, w, h, mode);
+  data->append(mqFinish(&e));
+  delete e.s;
+  gfree(stats);
+  putJBIG2Segment(s, 1, 38, -1, data);
+  return s;
+}
+
+//----- text regions
+
+struct SynthJBIG2Symbol {
+  Guchar *pixels;
+  int w, h;
+  int id;			// symbol ID (position in the dictionary)
+};
+
+struct SynthJBIG2Instance {
+  int s, t;			// bottom left corner
+  int strip;			// t >> logStrips
+  int sym;			// index in the symbol array
+};
+
+// Make a random glyph: a few thick strokes.
+static void makeSynthGlyph(SynthJBIG2Symbol *sym) {
+  int nStrokes, x0, y0, x1, y1, th, n, x, y, dx, dy, i, k;
+
+  sym->w = 3 + rand() % 38;
+  sym->h = 4 + rand() % 37;
+  sym->pixels = (Guchar *)gmallocn(sym->w, sym->h);
+  memset(sym->pixels, 0, sym->w * sym->h);
+  nStrokes = 2 + rand() % 4;
+  for (i = 0; i < nStrokes; ++i) {
+    x0 = rand() % sym->w;
+    y0 = rand() % sym->h;
+    x1 = rand() % sym->w;
+    y1 = rand() % sym->h;
+    th = (sym->w < sym->h ? sym->w : sym->h) / 4;
+    th = th > 1 ? 1 + rand() % th : 1;
+    n = abs(x1 - x0) > abs(y1 - y0) ? abs(x1 - x0) + 1 : abs(y1 - y0) + 1;
+    for (k = 0; k < n; ++k) {
+      x = x0 + (x1 - x0) * k / n;
+      y = y0 + (y1 - y0) * k / n;
+      for (dy = 0; dy < th && y + dy < sym->h; ++dy) {
+	for (dx = 0; dx < th && x + dx < sym->w; ++dx) {
+	  sym->pixels[(y + dy) * sym->w + x + dx] = 1;
+	}
+      }
+    }
+  }
+}
+
+static int cmpSynthJBIG2Symbols(const void *p1, const void *p2) {
+  SynthJBIG2Symbol *sym1 = *(SynthJBIG2Symbol **)p1;
+  SynthJBIG2Symbol *sym2 = *(SynthJBIG2Symbol **)p2;
+
+  if (sym1->h != sym2->h) {
+    return sym1->h - sym2->h;
+  }
+  return sym1->w - sym2->w;
+}
+
+static int cmpSynthJBIG2Instances(const void *p1, const void *p2) {
+  SynthJBIG2Instance *inst1 = (SynthJBIG2Instance *)p1;
+  SynthJBIG2Instance *inst2 = (SynthJBIG2Instance *)p2;
+
+  if (inst1->strip != inst2->strip) {
+    return inst1->strip - inst2->strip;
+  }
+  return inst1->s - inst2->s;
+}
+
+// Make a symbol dictionary segment with all of the symbols (new and
+// exported), coded with generic region mode [mode], and set their
+// symbol IDs.
+static GString *encodeJBIG2SymbolDict(SynthJBIG2Symbol *syms, int nSyms,
+				      int mode) {
+  SynthJBIG2Symbol *order[nSynthJBIG2Syms];
+  MQEncoder e;
+  GString *s, *data;
+  Guchar *dhStats, *dwStats, *exStats, *stats;
+  int hc, wc, i;
+
+  for (i = 0; i < nSyms; ++i) {
+    order[i] = &syms[i];
+  }
+  qsort(order, nSyms, sizeof(SynthJBIG2Symbol *), &cmpSynthJBIG2Symbols);
+  dhStats = (Guchar *)gmalloc(3 * 512 + (1 << 16));
+  memset(dhStats, 0, 3 * 512 + (1 << 16));
+  dwStats = dhStats + 512;
+  exStats = dwStats + 512;
+  stats = exStats + 512;
+  mqInit(&e);
+  hc = 0;
+  i = 0;
+  while (i < nSyms) {
+    mqEncodeInt(&e, dhStats, order[i]->h - hc, gFalse);
+    hc = order[i]->h;
+    wc = 0;
+    for (; i < nSyms && order[i]->h == hc; ++i) {
+      mqEncodeInt(&e, dwStats, order[i]->w - wc, gFalse);
+      wc = order[i]->w;
+      encodeJBIG2Generic(&e, stats, order[i]->pixels, order[i]->w,
+			 order[i]->h, mode);
+      order[i]->id = i;
+    }
+    mqEncodeInt(&e, dwStats, 0, gTrue);
+  }
+  // export flags: a run of 0 unexported, then a run of nSyms exported
+  mqEncodeInt(&e, exStats, 0, gFalse);
+  mqEncodeInt(&e, exStats, nSyms, gFalse);
+  gfree(dhStats);
+
+  data = new GString();
+  putU16(data, synthJBIG2GenericModes[mode].templ << 10);
+  putJBIG2AT(data, mode);
+  putU32(data, nSyms);
+  putU32(data, nSyms);
+  data->append(mqFinish(&e));
+  delete e.s;
+  s = new GString();
+  putJBIG2Segment(s, 0, 0, -1, data);
+  return s;
+}
+
+// Make a text region segment (bottom-left reference corner, OR
+// combination, 2^[logStrips] rows per strip) that refers to the symbol
+// dictionary segment 0.
+static GString *encodeJBIG2Text(SynthJBIG2Symbol *syms, int nSyms,
+				SynthJBIG2Instance *insts, int nInsts,
+				int w, int h, int logStrips) {
+  MQEncoder e;
+  GString *data;
+  Guchar *dtStats, *fsStats, *dsStats, *itStats, *idStats;
+  int codeLen, stripT, firstS, curS, t0, i, j;
+
+  for (codeLen = 0; (1 << codeLen) < nSyms; ++codeLen) ;
+  for (i = 0; i < nInsts; ++i) {
+    insts[i].strip = insts[i].t >> logStrips;
+  }
+  qsort(insts, nInsts, sizeof(SynthJBIG2Instance), &cmpSynthJBIG2Instances);
+  dtStats = (Guchar *)gmalloc(4 * 512 + (1 << (codeLen + 1)));
+  memset(dtStats, 0, 4 * 512 + (1 << (codeLen + 1)));
+  fsStats = dtStats + 512;
+  dsStats = fsStats + 512;
+  itStats = dsStats + 512;
+  idStats = itStats + 512;
+  mqInit(&e);
+  mqEncodeInt(&e, dtStats, 0, gFalse);
+  stripT = 0;
+  firstS = 0;
+  curS = 0;
+  for (i = 0; i < nInsts; i = j) {
+    t0 = insts[i].strip << logStrips;
+    mqEncodeInt(&e, dtStats, (t0 - stripT) >> logStrips, gFalse);
+    stripT = t0;
+    for (j = i; j < nInsts && insts[j].strip == insts[i].strip; ++j) {
+      if (j == i) {
+	mqEncodeInt(&e, fsStats, insts[j].s - firstS, gFalse);
+	firstS = insts[j].s;
+      } else {
+	mqEncodeInt(&e, dsStats, insts[j].s - curS, gFalse);
+      }
+      if (logStrips > 0) {
+	mqEncodeInt(&e, itStats, insts[j].t - t0, gFalse);
+      }
+      mqEncodeIAID(&e, idStats, codeLen, syms[insts[j].sym].id);
+      curS = insts[j].s + syms[insts[j].sym].w - 1;
+    }
+    mqEncodeInt(&e, dsStats, 0, gTrue);
+  }
+  gfree(dtStats);
+
+  data = new GString();
+  putJBIG2RegionInfo(data, w, h);
+  putU16(data, logStrips << 2);
+  putU32(data, nInsts);
+  data->append(mqFinish(&e));
+  delete e.s;
+  return data;
+}
+
+// Lay out the symbols like text, one per byte of [data] (whitespace
+// makes a gap, and newlines start a new line), on a [w] x [h] page.
+// Returns the number of instances.  The baseline varies a little, so
+// that the instances on a line can fall in different strips.
+static int makeJBIG2TextPage(GString *data, SynthJBIG2Symbol *syms,
+			     int nSyms, int w, int h,
+			     SynthJBIG2Instance **insts) {
+  SynthJBIG2Instance *a;
+  int lineH, size, n, x, y, c, sym, i;
+
+  lineH = 0;
+  for (i = 0; i < nSyms; ++i) {
+    if (syms[i].h > lineH) {
+      lineH = syms[i].h;
+    }
+  }
+  a = NULL;
+  size = n = 0;
+  x = y = 10;
+  for (i = 0; i < data->getLength() && y + lineH + 3 < h - 10; ++i) {
+    c = data->getChar(i) & 0xff;
+    if (c == '\n') {
+      x = 10;
+      y += lineH + 4;
+    } else if (c <= ' ') {
+      x += 8;
+    } else {
+      sym = c % nSyms;
+      if (x + syms[sym].w > w - 10) {
+	x = 10;
+	y += lineH + 4;
+	if (y + lineH + 3 >= h - 10) {
+	  break;
+	}
+      }
+      if (n == size) {
+	size = size ? 2 * size : 256;
+	a = (SynthJBIG2Instance *)greallocn(a, size,
+					    sizeof(SynthJBIG2Instance));
+      }
+      a[n].s = x;
+      a[n].t = y + lineH - 1 + c % 3;
+      a[n].sym = sym;
+      ++n;
+      x += syms[sym].w + 1;
+    }
+  }
+  *insts = a;
+  return n;
+}
+
+// Render the instances into a [w] x [h] bitmap (one byte per pixel).
+static Guchar *renderJBIG2TextPage(SynthJBIG2Symbol *syms,
+				   SynthJBIG2Instance *insts, int nInsts,
+				   int w, int h) {
+  SynthJBIG2Symbol *sym;
+  Guchar *pixels;
+  int x, y, i;
+
+  pixels = (Guchar *)gmallocn(w, h);
+  memset(pixels, 0, w * h);
+  for (i = 0; i < nInsts; ++i) {
+    sym = &syms[insts[i].sym];
+    for (y = 0; y < sym->h; ++y) {
+      for (x = 0; x < sym->w; ++x) {
+	pixels[(insts[i].t - sym->h + 1 + y) * w + insts[i].s + x] |=
+	    sym->pixels[y * sym->w + x];
+      }
+    }
+  }
+  return pixels;
+}
+
+//----- records
+
+// Text region modes: strip size, symbol dictionary coding, and whether
+// the dictionary is in the globals.
+static struct {
+  int logStrips;
+  int dictMode;			// index in synthJBIG2GenericModes
+  GBool globals;
+} synthJBIG2TextModes[] = {
+  { 0, 0, gFalse },
+  { 2, 3, gTrue  },
+  { 3, 6, gFalse },
+  { 1, 8, gTrue  }
+};
+#define nSynthJBIG2TextModes \
+  ((int)(sizeof(synthJBIG2TextModes) / sizeof(synthJBIG2TextModes[0])))
+
+// Pack the pixels the way the decoder returns them: one bit per
+// pixel, 0 = black, with each row padded to a byte boundary with 1
+// bits.
+static GString *packJBIG2Image(Guchar *pixels, int w, int h) {
+  GString *s;
+  int x, y, c, i;
+
+  s = new GString();
+  for (y = 0; y < h; ++y) {
+    for (x = 0; x < w; x += 8) {
+      c = 0;
+      for (i = 0; i < 8; ++i) {
+	c <<= 1;
+	if (x + i < w) {
+	  c |= pixels[y * w + x + i];
+	}
+      }
+      s->append((char)(c ^ 0xff));
+    }
+  }
+  return s;
+}
+
+static void synthJBIG2(FILE *f, FILE *sumsFile, char *fileName,
+		       GString *data, int *nRecords) {
+  SynthJBIG2Symbol syms[nSynthJBIG2Syms];
+  SynthJBIG2Instance *insts;
+  BenchRecord *rec;
+  GString *source, *dict, *text;
+  Object params;
+  Guchar *pixels;
+  int image, mode, rows, nInsts, w, h, i;
+
+  params.initNull();
+
+  // generic regions
+  for (image = 0; image < nSynthJBIG2Images; ++image) {
+    w = synthJBIG2Images[image].columns;
+    rows = makeSynthBitmap(data, w, synthJBIG2Images[image].scale,
+			   synthJBIG2Images[image].vScale,
+			   maxSynthJBIG2Rows, &pixels);
+    if (rows > 0) {
+      for (mode = 0; mode < nSynthJBIG2GenericModes; ++mode) {
+	source = GString::format("{0:s}:JBIG2-{1:s}{2:d}-generic{3:d}",
+				 fileName, synthJBIG2Images[image].name, w,
+				 mode);
+	rec = makeFilterRecord("JBIG2Decode", &params, source);
+	delete source;
+	rec->data = encodeJBIG2GenericPage(pixels, w, rows, mode);
+	addSynthRecord(f, sumsFile, rec, packJBIG2Image(pixels, w, rows),
+		       nRecords);
+      }
+    }
+    gfree(pixels);
+  }
+
+  // symbol dictionary + text region
+  w = synthJBIG2PageWidth;
+  h = synthJBIG2PageHeight;
+  for (i = 0; i < nSynthJBIG2Syms; ++i) {
+    makeSynthGlyph(&syms[i]);
+  }
+  nInsts = makeJBIG2TextPage(data, syms, nSynthJBIG2Syms, w, h, &insts);
+  if (nInsts > 0) {
+    pixels = renderJBIG2TextPage(syms, insts, nInsts, w, h);
+    for (mode = 0; mode < nSynthJBIG2TextModes; ++mode) {
+      source = GString::format("{0:s}:JBIG2-text-strips{1:d}-{2:s}",
+			       fileName,
+			       1 << synthJBIG2TextModes[mode].logStrips,
+			       synthJBIG2TextModes[mode].globals ? "globals"
+			                                         : "embedded");
+      rec = makeFilterRecord("JBIG2Decode", &params, source);
+      delete source;
+      dict = encodeJBIG2SymbolDict(syms, nSynthJBIG2Syms,
+				   synthJBIG2TextModes[mode].dictMode);
+      text = encodeJBIG2Text(syms, nSynthJBIG2Syms, insts, nInsts, w, h,
+			     synthJBIG2TextModes[mode].logStrips);
+      if (synthJBIG2TextModes[mode].globals) {
+	rec->globals = dict;
+	rec->data = new GString();
+      } else {
+	rec->data = dict;
+      }
+      putJBIG2PageInfo(rec->data, 1, w, h);
+      putJBIG2Segment(rec->data, 2, 6, 0, text);
+      addSynthRecord(f, sumsFile, rec, packJBIG2Image(pixels, w, h),
+		     nRecords);
+    }
+    gfree(pixels);
+  }
+  gfree(insts);
+  for (i = 0; i < nSynthJBIG2Syms; ++i) {
+    gfree(syms[i].pixels);
+  }
+}
+
+#endif // NO_JBIG_STREAM
+
+//------------------------------------------------------------------------
+
+// Write the synthetic records for one input file.
+static void synthFile(FILE *f, FILE *sumsFile, char *fileName,
+		      GString *data, int *nRecords) {
+  synthDecrypt(f, sumsFile, fileName, data, nRecords);
+  synthFilters(f, sumsFile, fileName, data, nRecords);
+  synthLZW(f, sumsFile, fileName, data, nRecords);
+  synthCCITT(f, sumsFile, fileName, data, nRecords);
+#ifndef NO_JBIG_STREAM
+  synthJBIG2(f, sumsFile, fileName, data, nRecords);
+#endif
+}
+
+//------------------------------------------------------------------------
+// benchmark
+//------------------------------------------------------------------------
+
+struct BenchTotals {
+  double inBytes;
+  double outBytes;
+  double time;
+  double calls;
+  double allocs;
+  int nRecords;
+};
+
+static void printResult(const char *label, const char *decoder,
+			double inBytes, double outBytes, double calls,
+			double time, double allocs, const char *source) {
+  printf("%s\t%s\t%.0f\t%.0f\t%.0f\t%.3f\t%.3f\t%.1f\t%s\n",
+	 label, decoder, inBytes, outBytes, calls,
+	 1e6 * time / calls,
+	 time > 0 ? outBytes / time / 1e6 : 0.0,
+	 allocs / calls, source);
+}
+
+// Benchmark one record, and add it to the totals.  Returns false if
+// the record was skipped.
+static GBool benchRecord(BenchRecord *rec, int recNum, BenchTotals *totals) {
+  BenchTotals *t;
+  char label[32];
+  double outBytes, t0, time;
+  size_t allocs0, allocs;
+  int calls;
+
+  if (decoderName[0] && strcmp(decoderName, benchDecoderNames[rec->decoder])) {
+    return gFalse;
+  }
+
+  // warm-up call, which also fills any decoder caches
+  decodeRecord(rec, NULL);
+
+  calls = 0;
+  outBytes = 0;
+  allocs0 = getAllocCount();
+  t0 = getTime();
+  do {
+    outBytes += decodeRecord(rec, NULL);
+    ++calls;
+    time = getTime() - t0;
+  } while (calls < minIters || time < 0.001 * minTime);
+  allocs = getAllocCount() - allocs0;
+
+  if (!totalsOnly) {
+    sprintf(label, "%d", recNum);
+    printResult(label, benchDecoderNames[rec->decoder],
+		(double)rec->data->getLength() * calls, outBytes, calls,
+		time, (double)allocs, rec->source->getCString());
+  }
+  t = &totals[rec->decoder];
+  t->inBytes += (double)rec->data->getLength() * calls;
+  t->outBytes += outBytes;
+  t->time += time;
+  t->calls += calls;
+  t->allocs += (double)allocs;
+  ++t->nRecords;
+  return gTrue;
+}
+
+//------------------------------------------------------------------------
+// verification
+//------------------------------------------------------------------------
+
+// getBlock sizes used by the mixed-read check
+static int verifyBlockSizes[] = {
+  1, 2, 3, 7, 15, 16, 17, 31, 32, 33, 255, 256, 1000, 4095, 4096, 4097,
+  65536
+};
+#define nVerifyBlockSizes \
+  ((int)(sizeof(verifyBlockSizes) / sizeof(int)))
+
+// Decode [rec] with getChar, and append the data to [out].
+static void decodeRecordByChar(BenchRecord *rec, GString *out) {
+  Stream *str;
+  int c;
+
+  str = makeRecordStream(rec);
+  str->reset();
+  while ((c = str->getChar()) != EOF) {
+    out->append((char)c);
+  }
+  str->close();
+  delete str;
+}
+
+// Decode [rec] with a pseudo-random mix of lookChar, getChar, and
+// getBlock calls (with sizes from verifyBlockSizes), and append the
+// data to [out].  Returns false if lookChar doesn't return the same
+// byte as the following getChar.
+static GBool decodeRecordMixed(BenchRecord *rec, GString *out) {
+  char buf[benchBufSize];
+  Stream *str;
+  Guint seed;
+  GBool ok, eof;
+  int c, n;
+
+  str = makeRecordStream(rec);
+  str->reset();
+  seed = 1;
+  ok = gTrue;
+  eof = gFalse;
+  while (!eof) {
+    seed = seed * 1103515245 + 12345;
+    switch ((seed >> 16) & 3) {
+    case 0:
+      c = str->lookChar();
+      if (str->getChar() != c) {
+	ok = gFalse;
+	eof = gTrue;
+      } else if (c == EOF) {
+	eof = gTrue;
+      } else {
+	out->append((char)c);
+      }
+      break;
+    case 1:
+      if ((c = str->getChar()) == EOF) {
+	eof = gTrue;
+      } else {
+	out->append((char)c);
+      }
+      break;
+    default:
+      n = str->getBlock(buf, verifyBlockSizes[(seed >> 20) %
+					       nVerifyBlockSizes]);
+      if (n <= 0) {
+	eof = gTrue;
+      } else {
+	out->append(buf, n);
+      }
+      break;
+    }
+  }
+  str->close();
+  delete str;
+  return ok;
+}
+
+// Read a digest file written with -sums.  Returns an array of
+// digests (hex strings) indexed by record number, or NULL on error.
+static GString **readSums(char *fileName, int *nSums) {
+  FILE *f;
+  GString **sums;
+  char line[2048];
+  char digest[33];
+  int recNum, len, size, i;
+
+  if (!(f = fopen(fileName, "r"))) {
+    return NULL;
+  }
+  sums = NULL;
+  size = 0;
+  while (fgets(line, sizeof(line), f)) {
+    if (sscanf(line, "%d %32s %d", &recNum, digest, &len) != 3 ||
+	recNum < 0) {
+      continue;
+    }
+    if (recNum >= size) {
+      i = size;
+      size = recNum + 256;
+      sums = (GString **)greallocn(sums, size, sizeof(GString *));
+      for (; i < size; ++i) {
+	sums[i] = NULL;
+      }
+    }
+    if (sums[recNum]) {
+      delete sums[recNum];
+    }
+    sums[recNum] = GString::format("{0:s} {1:d}", digest, len);
+  }
+  fclose(f);
+  *nSums = size;
+  return sums;
+}
+
+// Check one record: its data read with getBlock (as in the benchmark),
+// with getChar, and with mixed reads must match, and it must match
+// the digest, if there is one.  Returns false if any check fails.
+static GBool verifyRecord(BenchRecord *rec, int recNum, FILE *sumsFile,
+			  GString **sums, int nSums) {
+  GString *data, *data2, *sum;
+  Guchar digest[16];
+  char hex[33];
+  const char *result;
+  int i;
+
+  if (decoderName[0] && strcmp(decoderName, benchDecoderNames[rec->decoder])) {
+    return gTrue;
+  }
+
+  data = new GString();
+  decodeRecord(rec, data);
+  md5((Guchar *)data->getCString(), data->getLength(), digest);
+  for (i = 0; i < 16; ++i) {
+    sprintf(hex + 2 * i, "%02x", digest[i]);
+  }
+  result = "ok";
+
+  data2 = new GString();
+  decodeRecordByChar(rec, data2);
+  if (data2->cmp(data)) {
+    result = "getChar-mismatch";
+  }
+  delete data2;
+
+  if (!strcmp(result, "ok")) {
+    data2 = new GString();
+    if (!decodeRecordMixed(rec, data2)) {
+      result = "lookChar-mismatch";
+    } else if (data2->cmp(data)) {
+      result = "mixed-read-mismatch";
+    }
+    delete data2;
+  }
+
+  if (!strcmp(result, "ok") && sums) {
+    sum = GString::format("{0:s} {1:d}", hex, data->getLength());
+    if (recNum >= nSums || !sums[recNum]) {
+      result = "no-digest";
+    } else if (sum->cmp(sums[recNum])) {
+      result = "digest-mismatch";
+    }
+    delete sum;
+  }
+
+  if (sumsFile) {
+    writeSum(sumsFile, recNum, data, rec->source);
+  }
+  if (!totalsOnly || strcmp(result, "ok")) {
+    printf("%d\t%s\t%d\t%s\t%s\t%s\n",
+	   recNum, benchDecoderNames[rec->decoder], data->getLength(), hex,
+	   result, rec->source->getCString());
+  }
+  delete data;
+  return !strcmp(result, "ok");
+}
+
+//------------------------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+  FILE *f, *sumsFile;
+  BenchRecord *rec;
+  BenchTotals totals[nBenchDecoders];
+  BenchTotals *t;
+  GString *data;
+  GString **sums;
+  char line[256];
+  int exitCode;
+  int nRecords, nSums, recNum, i;
+  GBool ok;
+
+  exitCode = 99;
+
+  // parse args
+  fixCommandLine(&argc, &argv);
+  ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc < 2 || printVersion || printHelp) {
+    fprintf(stderr, "pdfstreambench version %s\n", xpdfVersion);
+    fprintf(stderr, "%s\n", xpdfCopyright);
+    if (!printVersion) {
+      printUsage("pdfstreambench",
+		 "<corpus-file> ... | -extract <corpus-file> <PDF-file> ..."
+		 " | -synth <corpus-file> <file> ...",
+		 argDesc);
+    }
+    goto err0;
+  }
+
+  // read config file
+  globalParams = new GlobalParams(cfgFileName);
+
+  // extract mode
+  if (extractFileName[0]) {
+    if (!(f = fopen(extractFileName, "wb"))) {
+      error(errIO, -1, "Couldn't open corpus file '{0:s}'", extractFileName);
+      exitCode = 2;
+      goto err1;
+    }
+    fprintf(f, "%s\n", corpusMagic);
+    exitCode = 0;
+    for (i = 1; i < argc; ++i) {
+      nRecords = 0;
+      if (extractFile(f, argv[i], &nRecords)) {
+	fprintf(stderr, "%s: %d records\n", argv[i], nRecords);
+      } else {
+	exitCode = 1;
+      }
+    }
+    fclose(f);
+
+  // synth mode
+  } else if (synthFileName[0]) {
+    if (!(f = fopen(synthFileName, "wb"))) {
+      error(errIO, -1, "Couldn't open corpus file '{0:s}'", synthFileName);
+      exitCode = 2;
+      goto err1;
+    }
+    sumsFile = NULL;
+    if (sumsFileName[0] && !(sumsFile = fopen(sumsFileName, "w"))) {
+      error(errIO, -1, "Couldn't open digest file '{0:s}'", sumsFileName);
+      fclose(f);
+      exitCode = 2;
+      goto err1;
+    }
+    fprintf(f, "%s\n", corpusMagic);
+    aesInitSbox();
+    initCCITTCodes();
+    srand(1);
+    nRecords = 0;
+    exitCode = 0;
+    for (i = 1; i < argc; ++i) {
+      if (!(data = readFile(argv[i]))) {
+	error(errIO, -1, "Couldn't read file '{0:s}'", argv[i]);
+	exitCode = 1;
+	continue;
+      }
+      synthFile(f, sumsFile, argv[i], data, &nRecords);
+      delete data;
+    }
+    fprintf(stderr, "%d records\n", nRecords);
+    if (sumsFile) {
+      fclose(sumsFile);
+    }
+    fclose(f);
+
+  // benchmark and verify modes
+  } else {
+    globalParams->setErrQuiet(gTrue);
+    if (sumsFileName[0] || checkFileName[0]) {
+      verifyMode = gTrue;
+    }
+    sumsFile = NULL;
+    sums = NULL;
+    nSums = 0;
+    if (sumsFileName[0] && !(sumsFile = fopen(sumsFileName, "w"))) {
+      error(errIO, -1, "Couldn't open digest file '{0:s}'", sumsFileName);
+      exitCode = 2;
+      goto err1;
+    }
+    if (checkFileName[0] && !(sums = readSums(checkFileName, &nSums))) {
+      error(errIO, -1, "Couldn't read digest file '{0:s}'", checkFileName);
+      if (sumsFile) {
+	fclose(sumsFile);
+      }
+      exitCode = 2;
+      goto err1;
+    }
+    memset(totals, 0, sizeof(totals));
+    if (verifyMode) {
+      printf("record\tdecoder\tout_bytes\tmd5\tresult\tsource\n");
+    } else {
+      printf("record\tdecoder\tin_bytes\tout_bytes\tcalls\tus_per_call"
+	     "\tout_mb_per_sec\tallocs_per_call\tsource\n");
+    }
+    recNum = 0;
+    exitCode = 0;
+    for (i = 1; i < argc; ++i) {
+      if (!(f = fopen(argv[i], "rb"))) {
+	error(errIO, -1, "Couldn't open corpus file '{0:s}'", argv[i]);
+	exitCode = 2;
+	continue;
+      }
+      if (!fgets(line, sizeof(line), f) ||
+	  strncmp(line, corpusMagic, strlen(corpusMagic))) {
+	error(errSyntaxError, -1, "'{0:s}' is not a corpus file", argv[i]);
+	fclose(f);
+	exitCode = 1;
+	continue;
+      }
+      while ((rec = readRecord(f, argv[i]))) {
+	if (verifyMode) {
+	  if (!verifyRecord(rec, recNum, sumsFile, sums, nSums) &&
+	      exitCode == 0) {
+	    exitCode = 3;
+	  }
+	} else {
+	  benchRecord(rec, recNum, totals);
+	}
+	++recNum;
+	freeRecord(rec);
+      }
+      fclose(f);
+    }
+    if (sums) {
+      for (i = 0; i < nSums; ++i) {
+	if (sums[i]) {
+	  delete sums[i];
+	}
+      }
+      gfree(sums);
+    }
+    if (sumsFile) {
+      fclose(sumsFile);
+    }
+    for (i = 0; i < nBenchDecoders; ++i) {
+      t = &totals[i];
+      if (t->nRecords > 0) {
+	printResult("total", benchDecoderNames[i], t->inBytes, t->outBytes,
+		    t->calls, t->time, t->allocs, "-");
+      }
+    }
+  }
+
+ err1:
+  delete globalParams;
+ err0:
+
+  // check for memory leaks
+  Object::memCheck(stderr);
+  gMemReport(stderr);
+
+  return exitCode;
+}
@@ -0,0 +1,562 @@
+//========================================================================
+//
+// pdftilebench.cc
+//
+// Tile cache benchmark.  This drives the viewer's TileMap and
+// TileCache (without a window) through a scripted scroll sequence,
+// and reports how long each visible tile takes to be rasterized after
+// it scrolls into view.  A tile that was prefetched before the scroll
+// is ready immediately.
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+#include "gtypes.h"
+#include "gmem.h"
+#include "gmempp.h"
+#include "parseargs.h"
+#include "GString.h"
+#include "GList.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "SplashTypes.h"
+#include "DisplayState.h"
+#include "TileMap.h"
+#include "TileCache.h"
+#include "TileCompositor.h"
+#include "config.h"
+
+//------------------------------------------------------------------------
+
+static int firstPage = 1;
+static char zoomStr[16] = "125";
+static char modeStr[32] = "continuous";
+static int winW = 1024;
+static int winH = 768;
+static int scrollStep = 0;
+static int nSteps = 0;
+static int dwell = 100;
+static int nThreads = -1;
+static int cacheSize = -1;
+static int cacheMem = -1;
+static char scriptFileName[256] = "";
+static GBool verbose = gFalse;
+static char ownerPassword[33] = "";
+static char userPassword[33] = "";
+static char cfgFileName[256] = "";
+static GBool printVersion = gFalse;
+static GBool printHelp = gFalse;
+
+static ArgDesc argDesc[] = {
+  {"-f",        argInt,     &firstPage,      0,
+   "page to start at"},
+  {"-z",        argString,  zoomStr,         sizeof(zoomStr),
+   "zoom: percentage, 'page', or 'width' (default is 125)"},
+  {"-mode",     argString,  modeStr,         sizeof(modeStr),
+   "display mode: single, continuous, sideBySideSingle,\n"
+   "                     sideBySideContinuous, horizontalContinuous"},
+  {"-W",        argInt,     &winW,           0,
+   "window width (default is 1024)"},
+  {"-H",        argInt,     &winH,           0,
+   "window height (default is 768)"},
+  {"-step",     argInt,     &scrollStep,     0,
+   "scroll step, in pixels (default is 1/4 of the window)"},
+  {"-steps",    argInt,     &nSteps,         0,
+   "number of scroll steps (default is to the end)"},
+  {"-dwell",    argInt,     &dwell,          0,
+   "ms to wait after each scroll step (default is 100)"},
+  {"-script",   argString,  scriptFileName,  sizeof(scriptFileName),
+   "read the scroll sequence from this file"},
+  {"-threads",  argInt,     &nThreads,       0,
+   "number of worker threads"},
+  {"-cache",    argInt,     &cacheSize,      0,
+   "tile cache size, in tiles"},
+  {"-mem",      argInt,     &cacheMem,       0,
+   "tile cache memory, in MB (0 disables prefetching)"},
+  {"-verbose",  argFlag,    &verbose,        0,
+   "print the time for each scroll step"},
+  {"-opw",      argString,  ownerPassword,   sizeof(ownerPassword),
+   "owner password (for encrypted files)"},
+  {"-upw",      argString,  userPassword,    sizeof(userPassword),
+   "user password (for encrypted files)"},
+  {"-cfg",      argString,  cfgFileName,     sizeof(cfgFileName),
+   "configuration file to use in place of .xpdfrc"},
+  {"-v",        argFlag,    &printVersion,   0,
+   "print copyright and version info"},
+  {"-h",        argFlag,    &printHelp,      0,
+   "print usage information"},
+  {"-help",     argFlag,    &printHelp,      0,
+   "print usage information"},
+  {"--help",    argFlag,    &printHelp,      0,
+   "print usage information"},
+  {"-?",        argFlag,    &printHelp,      0,
+   "print usage information"},
+  {NULL}
+};
+
+//------------------------------------------------------------------------
+
+// One step of the scroll sequence: either a relative scroll by
+// (dx, dy) pixels, or (if page > 0) a jump to the top of a page.
+struct ScrollStep {
+  int dx, dy;
+  int page;
+};
+
+// Time between checks for finished tiles, in ms.
+#define pollInterval 1
+
+//------------------------------------------------------------------------
+
+// Returns a monotonic time, in seconds.
+static double getTime() {
+#ifdef _WIN32
+  LARGE_INTEGER freq, t;
+
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+#endif
+}
+
+static void sleepMS(int ms) {
+#ifdef _WIN32
+  Sleep(ms);
+#else
+  struct timespec t;
+
+  t.tv_sec = ms / 1000;
+  t.tv_nsec = (long)(ms % 1000) * 1000000;
+  nanosleep(&t, NULL);
+#endif
+}
+
+// Read a scroll script.  Each line is one of:
+//   down <pixels>, up <pixels>, left <pixels>, right <pixels>
+//   page <page number>
+// Blank lines and lines starting with '#' are ignored.  Returns NULL
+// on error.
+static ScrollStep *readScript(char *fileName, int *nStepsA) {
+  FILE *f;
+  ScrollStep *steps;
+  char buf[256], cmd[256];
+  char *p;
+  int size, n, arg, line;
+
+  if (!(f = fopen(fileName, "r"))) {
+    fprintf(stderr, "Couldn't open script file '%s'\n", fileName);
+    return NULL;
+  }
+  steps = NULL;
+  size = n = 0;
+  line = 0;
+  while (fgets(buf, sizeof(buf), f)) {
+    ++line;
+    for (p = buf; *p && isspace(*p & 0xff); ++p) ;
+    if (!*p || *p == '#') {
+      continue;
+    }
+    if (sscanf(p, "%255s %d", cmd, &arg) != 2) {
+      fprintf(stderr, "Bad line %d in script file '%s'\n", line, fileName);
+      gfree(steps);
+      fclose(f);
+      return NULL;
+    }
+    if (n == size) {
+      size = size ? 2 * size : 64;
+      steps = (ScrollStep *)greallocn(steps, size, sizeof(ScrollStep));
+    }
+    steps[n].dx = steps[n].dy = steps[n].page = 0;
+    if (!strcmp(cmd, "down")) {
+      steps[n].dy = arg;
+    } else if (!strcmp(cmd, "up")) {
+      steps[n].dy = -arg;
+    } else if (!strcmp(cmd, "right")) {
+      steps[n].dx = arg;
+    } else if (!strcmp(cmd, "left")) {
+      steps[n].dx = -arg;
+    } else if (!strcmp(cmd, "page") && arg > 0) {
+      steps[n].page = arg;
+    } else {
+      fprintf(stderr, "Bad line %d in script file '%s'\n", line, fileName);
+      gfree(steps);
+      fclose(f);
+      return NULL;
+    }
+    ++n;
+  }
+  fclose(f);
+  if (!n) {
+    fprintf(stderr, "No scroll steps in script file '%s'\n", fileName);
+    return NULL;
+  }
+  *nStepsA = n;
+  return steps;
+}
+
+// Apply one scroll step.  In the single-page modes, scrolling past
+// the bottom (top) of the page moves to the top (bottom) of the next
+// (previous) page, as the viewer does.
+static void doScrollStep(DisplayState *state, TileMap *tileMap,
+			 ScrollStep *step) {
+  int horizMax, vertMax, pg, nPages, pageStep, x, y;
+
+  nPages = state->getDoc()->getNumPages();
+  if (step->page > 0) {
+    pg = step->page > nPages ? nPages : step->page;
+    if (state->displayModeIsSideBySide()) {
+      pg = ((pg - 1) & ~1) + 1;
+    }
+    state->setScrollPosition(pg, tileMap->getPageLeftX(pg),
+			     tileMap->getPageTopY(pg));
+    return;
+  }
+  pg = state->getScrollPage();
+  x = state->getScrollX() + step->dx;
+  y = state->getScrollY() + step->dy;
+  tileMap->getScrollLimits(&horizMax, &vertMax);
+  if (!state->displayModeIsContinuous()) {
+    pageStep = state->displayModeIsSideBySide() ? 2 : 1;
+    if (y > vertMax - state->getWinH() && step->dy > 0 &&
+	pg + pageStep <= nPages) {
+      state->setScrollPosition(pg + pageStep, x < 0 ? 0 : x, 0);
+      return;
+    }
+    if (y < 0 && step->dy < 0 && pg - pageStep >= 1) {
+      pg -= pageStep;
+      y = tileMap->getPageBottomY(pg);
+      state->setScrollPosition(pg, x < 0 ? 0 : x, y < 0 ? 0 : y);
+      return;
+    }
+  }
+  if (x > horizMax - state->getWinW()) {
+    x = horizMax - state->getWinW();
+  }
+  if (x < 0) {
+    x = 0;
+  }
+  if (y > vertMax - state->getWinH()) {
+    y = vertMax - state->getWinH();
+  }
+  if (y < 0) {
+    y = 0;
+  }
+  state->setScrollPosition(pg, x, y);
+}
+
+static int cmpDoubles(const void *p1, const void *p2) {
+  double d1 = *(double *)p1;
+  double d2 = *(double *)p2;
+  return d1 < d2 ? -1 : d1 > d2 ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+  PDFDoc *doc;
+  GString *ownerPW, *userPW;
+  DisplayState *state;
+  TileMap *tileMap;
+  TileCache *tileCache;
+  TileCompositor *tileCompositor;
+  DisplayMode displayMode;
+  ScrollStep *steps;
+  ScrollStep defaultStep;
+  GList *tiles;
+  GBool *ready;
+  GBool ok, finished, anyFinished, firstPoll;
+  double *latency;
+  double zoom, t0, t, tStart, latencySum, stepTime, maxStepTime;
+  double totalStepTime;
+  int latencySize, nLatency, nReady, nTiles, nLeft, stepReady, nStepsRun;
+  int horizMax, vertMax, exitCode, stepIdx, i;
+
+  exitCode = 99;
+  steps = NULL;
+
+  // parse args
+  fixCommandLine(&argc, &argv);
+  ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc != 2 || printVersion || printHelp) {
+    fprintf(stderr, "pdftilebench version %s\n", xpdfVersion);
+    fprintf(stderr, "%s\n", xpdfCopyright);
+    if (!printVersion) {
+      printUsage("pdftilebench", "<PDF-file>", argDesc);
+    }
+    goto err0;
+  }
+  if (!strcmp(modeStr, "single")) {
+    displayMode = displaySingle;
+  } else if (!strcmp(modeStr, "continuous")) {
+    displayMode = displayContinuous;
+  } else if (!strcmp(modeStr, "sideBySideSingle")) {
+    displayMode = displaySideBySideSingle;
+  } else if (!strcmp(modeStr, "sideBySideContinuous")) {
+    displayMode = displaySideBySideContinuous;
+  } else if (!strcmp(modeStr, "horizontalContinuous")) {
+    displayMode = displayHorizontalContinuous;
+  } else {
+    fprintf(stderr, "Bad '-mode' value on command line\n");
+    goto err0;
+  }
+  if (!strcmp(zoomStr, "page")) {
+    zoom = zoomPage;
+  } else if (!strcmp(zoomStr, "width")) {
+    zoom = zoomWidth;
+  } else if ((zoom = atof(zoomStr)) <= 0) {
+    fprintf(stderr, "Bad '-z' value on command line\n");
+    goto err0;
+  }
+  if (winW < 1 || winH < 1) {
+    fprintf(stderr, "Bad window size on command line\n");
+    goto err0;
+  }
+
+  // read config file
+  globalParams = new GlobalParams(cfgFileName);
+  globalParams->setErrQuiet(gTrue);
+  globalParams->setupBaseFonts(NULL);
+  if (nThreads < 1) {
+    nThreads = globalParams->getWorkerThreads();
+  }
+  if (cacheSize < 0) {
+    cacheSize = globalParams->getTileCacheSize();
+  }
+  if (cacheMem < 0) {
+    cacheMem = globalParams->getTileCacheMemory();
+  }
+
+  // read the scroll script
+  if (scriptFileName[0]) {
+    if (!(steps = readScript(scriptFileName, &nSteps))) {
+      exitCode = 2;
+      goto err1;
+    }
+  }
+
+  // open PDF file
+  if (ownerPassword[0]) {
+    ownerPW = new GString(ownerPassword);
+  } else {
+    ownerPW = NULL;
+  }
+  if (userPassword[0]) {
+    userPW = new GString(userPassword);
+  } else {
+    userPW = NULL;
+  }
+  doc = new PDFDoc(argv[1], ownerPW, userPW);
+  if (userPW) {
+    delete userPW;
+  }
+  if (ownerPW) {
+    delete ownerPW;
+  }
+  if (!doc->isOk()) {
+    fprintf(stderr, "Couldn't open PDF file '%s'\n", argv[1]);
+    exitCode = 1;
+    goto err2;
+  }
+  if (firstPage < 1 || firstPage > doc->getNumPages()) {
+    firstPage = 1;
+  }
+
+  // set up the display
+  state = new DisplayState(globalParams->getMaxTileWidth(),
+			   globalParams->getMaxTileHeight(),
+			   cacheSize, cacheMem, nThreads,
+			   splashModeRGB8, 4);
+  tileMap = new TileMap(state);
+  tileCache = new TileCache(state);
+  tileCompositor = new TileCompositor(state, tileMap, tileCache);
+  state->setDoc(doc);
+  state->setWindowSize(winW, winH);
+  state->setDisplayMode(displayMode);
+  state->setZoom(zoom);
+  if (state->displayModeIsSideBySide()) {
+    firstPage = ((firstPage - 1) & ~1) + 1;
+  }
+  state->setScrollPosition(firstPage, tileMap->getPageLeftX(firstPage),
+			   tileMap->getPageTopY(firstPage));
+
+  // the default script scrolls forward by <scrollStep> until the end
+  // of the document (or for <nSteps> steps)
+  if (!steps) {
+    if (scrollStep <= 0) {
+      scrollStep = (displayMode == displayHorizontalContinuous ? winW : winH)
+	           / 4;
+      if (scrollStep < 1) {
+	scrollStep = 1;
+      }
+    }
+    defaultStep.dx = defaultStep.dy = defaultStep.page = 0;
+    if (displayMode == displayHorizontalContinuous) {
+      defaultStep.dx = scrollStep;
+    } else {
+      defaultStep.dy = scrollStep;
+    }
+  }
+
+  if (verbose) {
+    printf("step\tpage\tx\ty\ttiles\tready\tms\n");
+  }
+  latencySize = 256;
+  latency = (double *)gmallocn(latencySize, sizeof(double));
+  nLatency = nReady = 0;
+  latencySum = 0;
+  ready = NULL;
+  totalStepTime = maxStepTime = 0;
+  nStepsRun = 0;
+  tStart = getTime();
+  for (stepIdx = 0; ; ++stepIdx) {
+
+    // scroll (step 0 is the initial display)
+    if (stepIdx > 0) {
+      if (nSteps > 0 && stepIdx > nSteps) {
+	break;
+      }
+      if (steps) {
+	doScrollStep(state, tileMap, &steps[stepIdx - 1]);
+      } else {
+	tileMap->getScrollLimits(&horizMax, &vertMax);
+	if (displayMode == displayContinuous ||
+	    displayMode == displaySideBySideContinuous) {
+	  if (state->getScrollY() >= vertMax - winH) {
+	    break;
+	  }
+	} else if (displayMode == displayHorizontalContinuous) {
+	  if (state->getScrollX() >= horizMax - winW) {
+	    break;
+	  }
+	} else {
+	  if (state->getScrollY() >= vertMax - winH &&
+	      state->getScrollPage() + (state->displayModeIsSideBySide()
+					? 2 : 1)
+	        > doc->getNumPages()) {
+	    break;
+	  }
+	}
+	doScrollStep(state, tileMap, &defaultStep);
+      }
+    }
+
+    // wait for the visible tiles, as the compositor would: reset the
+    // active list whenever a visible tile finishes
+    t0 = getTime();
+    tiles = tileMap->getTileList();
+    tileCache->setActiveTileList(tiles, tileMap->getPrefetchTileList());
+    nTiles = tiles->getLength();
+    ready = (GBool *)greallocn(ready, nTiles > 0 ? nTiles : 1,
+			       sizeof(GBool));
+    for (i = 0; i < nTiles; ++i) {
+      ready[i] = gFalse;
+    }
+    nLeft = nTiles;
+    stepReady = 0;
+    firstPoll = gTrue;
+    while (1) {
+      anyFinished = gFalse;
+      t = getTime() - t0;
+      for (i = 0; i < nTiles; ++i) {
+	if (!ready[i]) {
+	  tileCache->getTileBitmap((TileDesc *)tiles->get(i), &finished);
+	  if (finished) {
+	    ready[i] = gTrue;
+	    anyFinished = gTrue;
+	    --nLeft;
+	    if (nLatency == latencySize) {
+	      latencySize *= 2;
+	      latency = (double *)greallocn(latency, latencySize,
+					    sizeof(double));
+	    }
+	    latency[nLatency++] = t;
+	    latencySum += t;
+	    if (firstPoll) {
+	      ++stepReady;
+	    }
+	  }
+	}
+      }
+      if (anyFinished) {
+	tileCache->setActiveTileList(tiles, tileMap->getPrefetchTileList());
+      }
+      if (!nLeft) {
+	break;
+      }
+      firstPoll = gFalse;
+      sleepMS(pollInterval);
+    }
+    nReady += stepReady;
+    stepTime = getTime() - t0;
+    totalStepTime += stepTime;
+    if (stepTime > maxStepTime) {
+      maxStepTime = stepTime;
+    }
+    ++nStepsRun;
+    if (verbose) {
+      printf("%d\t%d\t%d\t%d\t%d\t%d\t%.1f\n",
+	     stepIdx, tileMap->getFirstPage(),
+	     state->getScrollX(), state->getScrollY(),
+	     nTiles, stepReady, 1000 * stepTime);
+    }
+
+    // give the prefetcher time to work, as a reader would
+    sleepMS(dwell);
+  }
+  t = getTime() - tStart;
+
+  // report
+  qsort(latency, nLatency, sizeof(double), &cmpDoubles);
+  printf("scroll steps:         %d\n", nStepsRun);
+  printf("visible tiles:        %d\n", nLatency);
+  if (nLatency > 0) {
+    printf("ready on arrival:     %d (%.1f%%)\n",
+	   nReady, (100.0 * nReady) / nLatency);
+    printf("time to visible tile: mean %.1f ms, median %.1f ms, "
+	   "95th %.1f ms, max %.1f ms\n",
+	   1000 * latencySum / nLatency,
+	   1000 * latency[nLatency / 2],
+	   1000 * latency[(nLatency * 95) / 100],
+	   1000 * latency[nLatency - 1]);
+  }
+  if (nStepsRun > 0) {
+    printf("time to full window:  mean %.1f ms, max %.1f ms\n",
+	   1000 * totalStepTime / nStepsRun, 1000 * maxStepTime);
+  }
+  printf("total time:           %.1f ms\n", 1000 * t);
+  gfree(latency);
+  gfree(ready);
+  exitCode = 0;
+
+  // clean up -- the TileCache destructor stops the worker threads,
+  // so it must be deleted before the PDFDoc
+  delete tileCompositor;
+  delete tileCache;
+  delete tileMap;
+  delete state;
+ err2:
+  delete doc;
+ err1:
+  gfree(steps);
+  delete globalParams;
+ err0:
+
+  // check for memory leaks
+  Object::memCheck(stderr);
+  gMemReport(stderr);
+
+  return exitCode;
+}
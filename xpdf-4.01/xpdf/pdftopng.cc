@@ -24,6 +24,7 @@
 #include "SplashBitmap.h"
 #include "Splash.h"
 #include "SplashOutputDev.h"
+#include "SplashBandRenderer.h"
 #include "config.h"
 
 static int firstPage = 1;
@@ -32,6 +33,7 @@ static double resolution = 150;
 static GBool mono = gFalse;
 static GBool gray = gFalse;
 static GBool pngAlpha = gFalse;
+static int nThreads = 1;
 static char enableFreeTypeStr[16] = "";
 static char antialiasStr[16] = "";
 static char vectorAntialiasStr[16] = "";
@@ -63,6 +65,10 @@ static ArgDesc argDesc[] = {
    "enable font anti-aliasing: yes, no"},
   {"-aaVector",   argString,      vectorAntialiasStr, sizeof(vectorAntialiasStr),
    "enable vector anti-aliasing: yes, no"},
+#if MULTITHREADED
+  {"-threads",    argInt,         &nThreads,      0,
+   "number of rendering threads (default is 1)"},
+#endif
   {"-opw",    argString,   ownerPassword,  sizeof(ownerPassword),
    "owner password (for encrypted files)"},
   {"-upw",    argString,   userPassword,   sizeof(userPassword),
@@ -97,7 +103,7 @@ int main(int argc, char *argv[]) {
   GString *pngFile;
   GString *ownerPW, *userPW;
   SplashColor paperColor;
-  SplashOutputDev *splashOut;
+  SplashBandRenderer *renderer;
   GBool ok;
   int exitCode;
   int pg;
@@ -184,21 +190,24 @@ int main(int argc, char *argv[]) {
   // write PNG files
   if (mono) {
     paperColor[0] = 0xff;
-    splashOut = new SplashOutputDev(splashModeMono1, 1, gFalse, paperColor);
+    renderer = new SplashBandRenderer(splashModeMono1, 1, gFalse, paperColor,
+				      nThreads);
   } else if (gray) {
     paperColor[0] = 0xff;
-    splashOut = new SplashOutputDev(splashModeMono8, 1, gFalse, paperColor);
+    renderer = new SplashBandRenderer(splashModeMono8, 1, gFalse, paperColor,
+				      nThreads);
   } else {
     paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
-    splashOut = new SplashOutputDev(splashModeRGB8, 1, gFalse, paperColor);
+    renderer = new SplashBandRenderer(splashModeRGB8, 1, gFalse, paperColor,
+				      nThreads);
   }
   if (pngAlpha) {
-    splashOut->setNoComposite(gTrue);
+    renderer->setNoComposite(gTrue);
   }
-  splashOut->startDoc(doc->getXRef());
+  renderer->startDoc(doc);
   for (pg = firstPage; pg <= lastPage; ++pg) {
-    doc->displayPage(splashOut, pg, resolution, resolution, 0,
-		     gFalse, gTrue, gFalse);
+    renderer->displayPage(pg, resolution, resolution, 0,
+			  gFalse, gTrue, gFalse);
     if (mono) {
       if (!strcmp(pngRoot, "-")) {
 	f = stdout;
@@ -213,8 +222,8 @@ int main(int argc, char *argv[]) {
 	delete pngFile;
       }
       setupPNG(&png, &pngInfo, f,
-	       1, PNG_COLOR_TYPE_GRAY, resolution, splashOut->getBitmap());
-      writePNGData(png, splashOut->getBitmap());
+	       1, PNG_COLOR_TYPE_GRAY, resolution, renderer->getBitmap());
+      writePNGData(png, renderer->getBitmap());
       finishPNG(&png, &pngInfo);
       fclose(f);
     } else if (gray) {
@@ -232,8 +241,8 @@ int main(int argc, char *argv[]) {
       }
       setupPNG(&png, &pngInfo, f,
 	       8, pngAlpha ? PNG_COLOR_TYPE_GRAY_ALPHA : PNG_COLOR_TYPE_GRAY,
-	       resolution, splashOut->getBitmap());
-      writePNGData(png, splashOut->getBitmap());
+	       resolution, renderer->getBitmap());
+      writePNGData(png, renderer->getBitmap());
       finishPNG(&png, &pngInfo);
       fclose(f);
     } else { // RGB
@@ -251,13 +260,13 @@ int main(int argc, char *argv[]) {
       }
       setupPNG(&png, &pngInfo, f,
 	       8, pngAlpha ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
-	       resolution, splashOut->getBitmap());
-      writePNGData(png, splashOut->getBitmap());
+	       resolution, renderer->getBitmap());
+      writePNGData(png, renderer->getBitmap());
       finishPNG(&png, &pngInfo);
       fclose(f);
     }
   }
-  delete splashOut;
+  delete renderer;
 
   exitCode = 0;
 
@@ -26,6 +26,7 @@
 #include "SplashBitmap.h"
 #include "Splash.h"
 #include "SplashOutputDev.h"
+#include "SplashBandRenderer.h"
 #include "config.h"
 
 static int firstPage = 1;
@@ -39,6 +40,8 @@ static GBool cmyk = gFalse;
 static char enableFreeTypeStr[16] = "";
 static char antialiasStr[16] = "";
 static char vectorAntialiasStr[16] = "";
+static int nThreads = 1;
+static int bandHeight = 0;
 static char ownerPassword[33] = "";
 static char userPassword[33] = "";
 static GBool quiet = gFalse;
@@ -69,6 +72,12 @@ static ArgDesc argDesc[] = {
    "enable font anti-aliasing: yes, no"},
   {"-aaVector",   argString,      vectorAntialiasStr, sizeof(vectorAntialiasStr),
    "enable vector anti-aliasing: yes, no"},
+#if MULTITHREADED
+  {"-threads",    argInt,         &nThreads,      0,
+   "number of rendering threads (default is 1)"},
+#endif
+  {"-band",       argInt,         &bandHeight,    0,
+   "rasterize in bands of this many rows, to limit memory use"},
   {"-opw",    argString,   ownerPassword,  sizeof(ownerPassword),
    "owner password (for encrypted files)"},
   {"-upw",    argString,   userPassword,   sizeof(userPassword),
@@ -90,6 +99,8 @@ static ArgDesc argDesc[] = {
   {NULL}
 };
 
+static void writeBand(SplashBitmap *band, void *data);
+
 int main(int argc, char *argv[]) {
   PDFDoc *doc;
   char *fileName;
@@ -97,7 +108,8 @@ int main(int argc, char *argv[]) {
   GString *ppmFile;
   GString *ownerPW, *userPW;
   SplashColor paperColor;
-  SplashOutputDev *splashOut;
+  SplashBandRenderer *renderer;
+  FILE *f;
   GBool ok;
   int exitCode;
   int pg, n;
@@ -211,35 +223,62 @@ int main(int argc, char *argv[]) {
   // write PPM files
   if (mono) {
     paperColor[0] = 0xff;
-    splashOut = new SplashOutputDev(splashModeMono1, 1, gFalse, paperColor);
+    renderer = new SplashBandRenderer(splashModeMono1, 1, gFalse, paperColor,
+				      nThreads);
   } else if (gray) {
     paperColor[0] = 0xff;
-    splashOut = new SplashOutputDev(splashModeMono8, 1, gFalse, paperColor);
+    renderer = new SplashBandRenderer(splashModeMono8, 1, gFalse, paperColor,
+				      nThreads);
 #if SPLASH_CMYK
   } else if (cmyk) {
     paperColor[0] = paperColor[1] = paperColor[2] = paperColor[3] = 0;
-    splashOut = new SplashOutputDev(splashModeCMYK8, 1, gFalse, paperColor);
+    renderer = new SplashBandRenderer(splashModeCMYK8, 1, gFalse, paperColor,
+				      nThreads);
 #endif // SPLASH_CMYK
   } else {
     paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
-    splashOut = new SplashOutputDev(splashModeRGB8, 1, gFalse, paperColor);
+    renderer = new SplashBandRenderer(splashModeRGB8, 1, gFalse, paperColor,
+				      nThreads);
   }
-  splashOut->startDoc(doc->getXRef());
+  renderer->startDoc(doc);
   for (pg = firstPage; pg <= lastPage; ++pg) {
-    doc->displayPage(splashOut, pg, resolution, resolution, 0,
-		     gFalse, gTrue, gFalse);
+    if (bandHeight > 0) {
+      // write each band as soon as it is rasterized
+      if (!strcmp(ppmRoot, "-")) {
+	f = stdout;
+#ifdef _WIN32
+	_setmode(_fileno(f), _O_BINARY);
+#endif
+      } else {
+	ppmFile = GString::format("{0:s}-{1:06d}.{2:s}", ppmRoot, pg, ext);
+	f = fopen(ppmFile->getCString(), "wb");
+	delete ppmFile;
+	if (!f) {
+	  continue;
+	}
+      }
+      renderer->displayPageBands(pg, resolution, resolution, 0,
+				 gFalse, gTrue, gFalse,
+				 bandHeight, &writeBand, f);
+      if (f != stdout) {
+	fclose(f);
+      }
+      continue;
+    }
+    renderer->displayPage(pg, resolution, resolution, 0,
+			  gFalse, gTrue, gFalse);
     if (!strcmp(ppmRoot, "-")) {
 #ifdef _WIN32
       _setmode(_fileno(stdout), _O_BINARY);
 #endif
-      splashOut->getBitmap()->writePNMFile(stdout);
+      renderer->getBitmap()->writePNMFile(stdout);
     } else {
       ppmFile = GString::format("{0:s}-{1:06d}.{2:s}", ppmRoot, pg, ext);
-      splashOut->getBitmap()->writePNMFile(ppmFile->getCString());
+      renderer->getBitmap()->writePNMFile(ppmFile->getCString());
       delete ppmFile;
     }
   }
-  delete splashOut;
+  delete renderer;
 
   exitCode = 0;
 
@@ -255,3 +294,13 @@ int main(int argc, char *argv[]) {
 
   return exitCode;
 }
+
+static void writeBand(SplashBitmap *band, void *data) {
+  FILE *f;
+
+  f = (FILE *)data;
+  if (band->getBandY() == 0) {
+    band->writePNMHeader(f);
+  }
+  band->writePNMRows(f);
+}